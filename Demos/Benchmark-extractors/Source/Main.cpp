@@ -0,0 +1,476 @@
+/*
+  ==============================================================================
+
+  Benchmark of the timbreID feature extractors
+
+  Measures the latency of store() and compute() for every extractor, sweeping
+  window sizes (64-8192), block sizes (32-1024), window functions and sample
+  types (float, double). The spectral modules are also measured with the
+  window and block sizes fixed at compile time (modules "<name>Fixed", at
+  256, 512 and 1024 samples with 64-sample blocks). Results are written as
+  JSON so that they can be compared between releases.
+  The startup time (construction and prepare() of the spectral modules at
+  every window size, i.e. the FFTW planning time) is measured first, with the
+  planner flags given by --planner. With --wisdom the FFTW wisdom is imported
+  from the file before and exported to it after, so that a second run shows
+  the startup time of measured plans found in the wisdom.
+
+  Usage: Benchmark-extractors [--iterations N] [--output file.json]
+                              [--module name] [--quick]
+                              [--planner estimate|measure|patient] [--wisdom file]
+
+  Author: Domenico Stefani (domenico.stefani96 AT gmail.com)
+
+  ==============================================================================
+*/
+
+#include <JuceHeader.h>
+#include "tidRTLog.hpp"
+#include "attackTime.hpp"
+#include "bark.hpp"
+#include "barkSpec.hpp"
+#include "barkSpecBrightness.hpp"
+#include "bfcc.hpp"
+#include "cepstrum.hpp"
+#include "mfcc.hpp"
+#include "peakSample.hpp"
+#include "zeroCrossing.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <ctime>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+using Clock = std::chrono::steady_clock;
+
+static const unsigned long int SAMPLE_RATE = 48000;
+
+struct Options
+{
+    int iterations = 200;
+    std::string outputPath = "timbreID-benchmark.json";
+    std::string module = "";        // Empty for all the modules
+    bool quick = false;             // Reduced sweep, for a quick check
+    std::string planner = "estimate";
+    std::string wisdomPath = "";    // Empty for no wisdom file
+};
+
+/** Latency samples of one operation, in nanoseconds */
+struct Latency
+{
+    std::vector<double> samples;
+
+    void add(Clock::time_point start, Clock::time_point end)
+    {
+        samples.push_back(std::chrono::duration<double, std::nano>(end - start).count());
+    }
+
+    double mean() const
+    {
+        double sum = 0.0;
+        for (double s : samples)
+            sum += s;
+        return samples.empty() ? 0.0 : sum / samples.size();
+    }
+
+    std::string toJson()
+    {
+        if (samples.empty())
+            return "null";
+        std::sort(samples.begin(), samples.end());
+        std::ostringstream json;
+        json << "{\"meanNs\": " << mean() << ", \"p50Ns\": " << samples[samples.size() / 2]
+             << ", \"p99Ns\": " << samples[(samples.size() * 99) / 100] << ", \"maxNs\": " << samples.back() << "}";
+        return json.str();
+    }
+};
+
+/** One point of the sweep */
+struct Config
+{
+    std::string module;
+    std::string sampleType;
+    unsigned long int windowSize;
+    unsigned int blockSize;
+    tIDLib::WindowFunctionType windowFunction;
+    bool hasWindowFunction;
+};
+
+static const char* windowFunctionName(tIDLib::WindowFunctionType func)
+{
+    switch (func)
+    {
+        case tIDLib::WindowFunctionType::rectangular: return "rectangular";
+        case tIDLib::WindowFunctionType::blackman: return "blackman";
+        case tIDLib::WindowFunctionType::cosine: return "cosine";
+        case tIDLib::WindowFunctionType::hamming: return "hamming";
+        case tIDLib::WindowFunctionType::hann: return "hann";
+        default: return "unknown";
+    }
+}
+
+/**
+ * Store iterations blocks of noise into the module, timing store() and, after
+ * every block, compute(). The first blocks fill the analysis window and are
+ * not timed.
+ */
+template <typename SampleType, typename Module, typename ComputeFunction>
+static std::string runConfig(const Config& config, Module& module, int iterations, ComputeFunction compute)
+{
+    const int warmupBlocks = (int)(config.windowSize / config.blockSize) + 10;
+    const int numSignalBlocks = 64;
+
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<float> noise(-0.5f, 0.5f);
+    std::vector<AudioBuffer<SampleType>> signal(numSignalBlocks, AudioBuffer<SampleType>(1, (int)config.blockSize));
+    for (AudioBuffer<SampleType>& block : signal)
+        for (int i = 0; i < (int)config.blockSize; ++i)
+            block.getWritePointer(0)[i] = (SampleType)noise(gen);
+
+    Latency storeLatency, computeLatency;
+    for (int it = -warmupBlocks; it < iterations; ++it)
+    {
+        AudioBuffer<SampleType>& block = signal[(size_t)(it + warmupBlocks) % numSignalBlocks];
+        const auto t0 = Clock::now();
+        module.store(block, (short)0);
+        const auto t1 = Clock::now();
+        const bool computed = compute(module);
+        const auto t2 = Clock::now();
+        if (it < 0)
+            continue;
+        storeLatency.add(t0, t1);
+        if (computed)
+            computeLatency.add(t1, t2);
+    }
+
+    // Real-time factor: audio duration of a block over the time to store it and compute the features once
+    const double blockDurationNs = 1e9 * config.blockSize / (double)SAMPLE_RATE;
+    const double realTimeFactor = blockDurationNs / (storeLatency.mean() + computeLatency.mean());
+
+    std::ostringstream json;
+    json << "    {\"module\": \"" << config.module << "\", \"sampleType\": \"" << config.sampleType
+         << "\", \"windowSize\": " << config.windowSize << ", \"blockSize\": " << config.blockSize
+         << ", \"windowFunction\": ";
+    if (config.hasWindowFunction)
+        json << "\"" << windowFunctionName(config.windowFunction) << "\"";
+    else
+        json << "null";
+    json << ", \"store\": " << storeLatency.toJson() << ", \"compute\": " << computeLatency.toJson()
+         << ", \"realTimeFactor\": " << realTimeFactor << "}";
+    return json.str();
+}
+
+static std::vector<unsigned long int> getWindowSizes(const Options& options)
+{
+    if (options.quick)
+        return {256, 1024, 4096};
+    return {64, 128, 256, 512, 1024, 2048, 4096, 8192};
+}
+
+#if TID_FFT_BACKEND == TID_FFT_BACKEND_FFTW
+static const char* FFT_BACKEND_NAME = "fftw";
+
+static unsigned int getPlannerFlags(const std::string& planner)
+{
+    if (planner == "estimate")
+        return FFTWPLANNERFLAG;
+    if (planner == "measure")
+        return FFTW_MEASURE;
+    if (planner == "patient")
+        return FFTW_PATIENT;
+    throw std::invalid_argument("Unknown planner '" + planner + "'");
+}
+#else
+static const char* FFT_BACKEND_NAME = "builtin";
+
+// The built-in FFT has no planner, the flags are only validated
+static unsigned int getPlannerFlags(const std::string& planner)
+{
+    if (planner != "estimate" && planner != "measure" && planner != "patient")
+        throw std::invalid_argument("Unknown planner '" + planner + "'");
+    return 0;
+}
+#endif
+
+/**
+ * Time to construct and prepare one instance of every spectral module at every
+ * window size, starting from an empty plan cache (the FFTW wisdom is not forgotten)
+ */
+static double measureStartupMillis(const Options& options)
+{
+   #if TID_FFT_BACKEND == TID_FFT_BACKEND_FFTW
+    tid::FftwPlanCache::getInstance().releaseUnused();
+   #endif
+    const auto start = Clock::now();
+    for (unsigned long int windowSize : getWindowSizes(options))
+    {
+        tid::BarkSpec<float> barkSpec(windowSize);
+        tid::BarkSpecBrightness<float> barkSpecBrightness(windowSize);
+        tid::Bfcc<float> bfcc(windowSize);
+        tid::Mfcc<float> mfcc(windowSize);
+        tid::Cepstrum<float> cepstrum(windowSize);
+        tid::Bark<float> bark(windowSize);
+        barkSpec.prepare(SAMPLE_RATE, 64);
+        barkSpecBrightness.prepare(SAMPLE_RATE, 64);
+        bfcc.prepare(SAMPLE_RATE, 64);
+        mfcc.prepare(SAMPLE_RATE, 64);
+        cepstrum.prepare(SAMPLE_RATE, 64);
+        bark.prepare(SAMPLE_RATE, 64);
+    }
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+/**
+ * The spectral modules with the window and block sizes fixed at compile time
+ * (tidFixedSize.hpp), reported as "<module>Fixed" to compare them with the
+ * modules sized at run time
+ */
+template <typename SampleType, unsigned long int WINDOW_SIZE, unsigned int BLOCK_SIZE, typename Selected, typename Report>
+static void runFixedSizeModules(const Options& options, const std::string& sampleType, Selected selected, Report report)
+{
+    Config config{"", sampleType, WINDOW_SIZE, BLOCK_SIZE, tIDLib::WindowFunctionType::blackman, true};
+
+    if (selected(config.module = "barkSpecFixed"))
+    {
+        tid::BarkSpec<SampleType, WINDOW_SIZE, BLOCK_SIZE> module(WINDOW_SIZE);
+        module.prepare(SAMPLE_RATE, BLOCK_SIZE);
+        module.setWindowFunction(config.windowFunction);
+        report(config, runConfig<SampleType>(config, module, options.iterations, [](decltype(module)& m) { m.compute(); return true; }));
+    }
+    if (selected(config.module = "barkSpecBrightnessFixed"))
+    {
+        tid::BarkSpecBrightness<SampleType, WINDOW_SIZE, BLOCK_SIZE> module(WINDOW_SIZE);
+        module.prepare(SAMPLE_RATE, BLOCK_SIZE);
+        module.setWindowFunction(config.windowFunction);
+        report(config, runConfig<SampleType>(config, module, options.iterations, [](decltype(module)& m) { m.compute(); return true; }));
+    }
+    if (selected(config.module = "bfccFixed"))
+    {
+        tid::Bfcc<SampleType, WINDOW_SIZE, BLOCK_SIZE> module(WINDOW_SIZE);
+        module.prepare(SAMPLE_RATE, BLOCK_SIZE);
+        module.setWindowFunction(config.windowFunction);
+        report(config, runConfig<SampleType>(config, module, options.iterations, [](decltype(module)& m) { m.compute(); return true; }));
+    }
+    if (selected(config.module = "mfccFixed"))
+    {
+        tid::Mfcc<SampleType, WINDOW_SIZE, BLOCK_SIZE> module(WINDOW_SIZE);
+        module.prepare(SAMPLE_RATE, BLOCK_SIZE);
+        module.setWindowFunction(config.windowFunction);
+        report(config, runConfig<SampleType>(config, module, options.iterations, [](decltype(module)& m) { m.compute(); return true; }));
+    }
+    if (selected(config.module = "cepstrumFixed"))
+    {
+        tid::Cepstrum<SampleType, WINDOW_SIZE, BLOCK_SIZE> module(WINDOW_SIZE);
+        module.prepare(SAMPLE_RATE, BLOCK_SIZE);
+        module.setWindowFunction(config.windowFunction);
+        report(config, runConfig<SampleType>(config, module, options.iterations, [](decltype(module)& m) { m.compute(); return true; }));
+    }
+}
+
+template <typename SampleType>
+static void runModules(const Options& options, const std::string& sampleType, std::vector<std::string>& results)
+{
+    const std::vector<unsigned long int> windowSizes = getWindowSizes(options);
+    std::vector<unsigned int> blockSizes = {32, 64, 128, 256, 512, 1024};
+    std::vector<tIDLib::WindowFunctionType> windowFunctions = {
+        tIDLib::WindowFunctionType::rectangular, tIDLib::WindowFunctionType::blackman,
+        tIDLib::WindowFunctionType::cosine, tIDLib::WindowFunctionType::hamming, tIDLib::WindowFunctionType::hann};
+    if (options.quick)
+    {
+        blockSizes = {64, 512};
+        windowFunctions = {tIDLib::WindowFunctionType::blackman};
+    }
+
+    auto selected = [&options](const std::string& module) {
+        return options.module.empty() || options.module == module;
+    };
+    auto report = [&results](const Config& config, std::string json) {
+        std::cerr << config.module << " " << config.sampleType << " window " << config.windowSize << " block "
+                  << config.blockSize << (config.hasWindowFunction ? " " : "")
+                  << (config.hasWindowFunction ? windowFunctionName(config.windowFunction) : "") << std::endl;
+        results.push_back(json);
+    };
+
+    for (unsigned long int windowSize : windowSizes)
+        for (unsigned int blockSize : blockSizes)
+        {
+            // Spectral modules, for every window function
+            for (tIDLib::WindowFunctionType func : windowFunctions)
+            {
+                Config config{"", sampleType, windowSize, blockSize, func, true};
+
+                if (selected(config.module = "barkSpec"))
+                {
+                    tid::BarkSpec<SampleType> module(windowSize);
+                    module.prepare(SAMPLE_RATE, blockSize);
+                    module.setWindowFunction(func);
+                    report(config, runConfig<SampleType>(config, module, options.iterations,
+                                                         [](tid::BarkSpec<SampleType>& m) { m.compute(); return true; }));
+                }
+                if (selected(config.module = "barkSpecBrightness"))
+                {
+                    tid::BarkSpecBrightness<SampleType> module(windowSize);
+                    module.prepare(SAMPLE_RATE, blockSize);
+                    module.setWindowFunction(func);
+                    report(config, runConfig<SampleType>(config, module, options.iterations,
+                                                         [](tid::BarkSpecBrightness<SampleType>& m) { m.compute(); return true; }));
+                }
+                if (selected(config.module = "bfcc"))
+                {
+                    tid::Bfcc<SampleType> module(windowSize);
+                    module.prepare(SAMPLE_RATE, blockSize);
+                    module.setWindowFunction(func);
+                    report(config, runConfig<SampleType>(config, module, options.iterations,
+                                                         [](tid::Bfcc<SampleType>& m) { m.compute(); return true; }));
+                }
+                if (selected(config.module = "mfcc"))
+                {
+                    tid::Mfcc<SampleType> module(windowSize);
+                    module.prepare(SAMPLE_RATE, blockSize);
+                    module.setWindowFunction(func);
+                    report(config, runConfig<SampleType>(config, module, options.iterations,
+                                                         [](tid::Mfcc<SampleType>& m) { m.compute(); return true; }));
+                }
+                if (selected(config.module = "cepstrum"))
+                {
+                    tid::Cepstrum<SampleType> module(windowSize);
+                    module.prepare(SAMPLE_RATE, blockSize);
+                    module.setWindowFunction(func);
+                    report(config, runConfig<SampleType>(config, module, options.iterations,
+                                                         [](tid::Cepstrum<SampleType>& m) { m.compute(); return true; }));
+                }
+                if (selected(config.module = "bark"))
+                {
+                    // Bark computes in store(), every hop (windowSize/4 samples)
+                    tid::Bark<SampleType> module(windowSize);
+                    module.prepare(SAMPLE_RATE, blockSize);
+                    module.setWindowFunction(func);
+                    // Thresholds that are never reached: every hop takes the same path, and no onset events pile up in the queue (nothing pops them here)
+                    module.setThresh(1e20f, 1e30f);
+                    report(config, runConfig<SampleType>(config, module, options.iterations,
+                                                         [](tid::Bark<SampleType>&) { return false; }));
+                }
+            }
+
+            // Time domain modules, no window function
+            Config config{"", sampleType, windowSize, blockSize, tIDLib::WindowFunctionType::rectangular, false};
+
+            if (selected(config.module = "attackTime"))
+            {
+                tid::AttackTime<SampleType> module(windowSize);
+                module.prepare(SAMPLE_RATE, blockSize);
+                report(config, runConfig<SampleType>(config, module, options.iterations, [](tid::AttackTime<SampleType>& m) {
+                    unsigned long int peakSampIdx, attackStartIdx;
+                    float attackTime;
+                    m.compute(&peakSampIdx, &attackStartIdx, &attackTime);
+                    return true;
+                }));
+            }
+            if (selected(config.module = "peakSample"))
+            {
+                tid::PeakSample<SampleType> module(windowSize);
+                module.prepare(SAMPLE_RATE, blockSize);
+                report(config, runConfig<SampleType>(config, module, options.iterations,
+                                                     [](tid::PeakSample<SampleType>& m) { m.compute(); return true; }));
+            }
+            if (selected(config.module = "zeroCrossing"))
+            {
+                tid::ZeroCrossing<SampleType> module(windowSize);
+                module.prepare(SAMPLE_RATE, blockSize);
+                report(config, runConfig<SampleType>(config, module, options.iterations,
+                                                     [](tid::ZeroCrossing<SampleType>& m) { m.compute(); return true; }));
+            }
+        }
+
+    // Common sizes of the plugins, with the sizes fixed at compile time
+    runFixedSizeModules<SampleType, 256, 64>(options, sampleType, selected, report);
+    runFixedSizeModules<SampleType, 512, 64>(options, sampleType, selected, report);
+    runFixedSizeModules<SampleType, 1024, 64>(options, sampleType, selected, report);
+}
+
+static Options parseArguments(int argc, char* argv[])
+{
+    Options options;
+    for (int i = 1; i < argc; ++i)
+    {
+        const std::string arg = argv[i];
+        if (arg == "--iterations" && i + 1 < argc)
+            options.iterations = std::max(1, std::atoi(argv[++i]));
+        else if (arg == "--output" && i + 1 < argc)
+            options.outputPath = argv[++i];
+        else if (arg == "--module" && i + 1 < argc)
+            options.module = argv[++i];
+        else if (arg == "--quick")
+            options.quick = true;
+        else if (arg == "--planner" && i + 1 < argc)
+            getPlannerFlags(options.planner = argv[++i]); // Validate
+        else if (arg == "--wisdom" && i + 1 < argc)
+            options.wisdomPath = argv[++i];
+        else
+            throw std::invalid_argument("Unknown argument '" + arg + "'");
+    }
+    return options;
+}
+
+//==============================================================================
+int main (int argc, char* argv[])
+{
+    Options options;
+    try
+    {
+        options = parseArguments(argc, argv);
+    }
+    catch (const std::invalid_argument& e)
+    {
+        std::cerr << e.what() << std::endl
+                  << "Usage: " << argv[0] << " [--iterations N] [--output file.json] [--module name] [--quick]"
+                  << " [--planner estimate|measure|patient] [--wisdom file]" << std::endl;
+        return 1;
+    }
+
+   #if TID_FFT_BACKEND == TID_FFT_BACKEND_FFTW
+    tid::FftwPlanCache& planCache = tid::FftwPlanCache::getInstance();
+    const bool wisdomImported = !options.wisdomPath.empty() && planCache.importWisdom(options.wisdomPath);
+    planCache.setPlannerFlags(getPlannerFlags(options.planner));
+   #else
+    const bool wisdomImported = false;
+   #endif
+    const double startupMillis = measureStartupMillis(options);
+    std::cerr << "Startup (" << FFT_BACKEND_NAME << " " << options.planner << (wisdomImported ? ", wisdom imported" : "") << "): "
+              << startupMillis << " ms" << std::endl;
+
+    std::vector<std::string> results;
+    runModules<float>(options, "float", results);
+    runModules<double>(options, "double", results);
+
+    char date[32];
+    const std::time_t now = std::time(nullptr);
+    std::strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", std::gmtime(&now));
+
+    std::ofstream output(options.outputPath);
+    output << "{\n  \"benchmark\": \"timbreID-extractors\",\n  \"formatVersion\": 1,\n  \"date\": \"" << date
+           << "\",\n  \"sampleRate\": " << SAMPLE_RATE << ",\n  \"iterations\": " << options.iterations
+           << ",\n  \"fftBackend\": \"" << FFT_BACKEND_NAME << "\",\n  \"planner\": \"" << options.planner << "\",\n  \"wisdomImported\": " << (wisdomImported ? "true" : "false")
+           << ",\n  \"startupMs\": " << startupMillis << ",\n  \"results\": [\n";
+    for (size_t i = 0; i < results.size(); ++i)
+        output << results[i] << (i + 1 < results.size() ? ",\n" : "\n");
+    output << "  ]\n}\n";
+
+   #if TID_FFT_BACKEND == TID_FFT_BACKEND_FFTW
+    if (!options.wisdomPath.empty() && !planCache.exportWisdom(options.wisdomPath))
+        std::cerr << "Could not write the FFTW wisdom to " << options.wisdomPath << std::endl;
+   #endif
+
+    if (!output)
+    {
+        std::cerr << "Could not write " << options.outputPath << std::endl;
+        return 1;
+    }
+    std::cerr << results.size() << " configurations written to " << options.outputPath << std::endl;
+    return 0;
+}
@@ -226,7 +226,14 @@ void DemoEditor::performStoreClearActions()
     if(processor.clear.load())
     {
         //std::cout << "clearAll pressed" << std::endl;
-        this->processor.csvsaver.clearEntries();
+        try
+        {
+            this->processor.featureRecorder.clearEntries();
+        }
+        catch (std::exception& e)
+        {
+            std::cerr << "Cannot clear the recording: " << e.what() << std::endl;
+        }
         this->processor.onsetCounterAtomic.store(0);
         processor.clear.store(false);
     }
@@ -238,7 +245,14 @@ void DemoEditor::performStoreClearActions()
         std::string path = temp.getFullPathName().toStdString();
         //std::cout << "path " << path << std::endl;
 
-        this->processor.csvsaver.writeToFile(path,processor.header);
+        try
+        {
+            this->processor.featureRecorder.writeToFile(path,DemoProcessor::CSV_FLOAT_PRECISION);
+        }
+        catch (std::exception& e)
+        {
+            std::cerr << "Cannot save " << path << ": " << e.what() << std::endl;
+        }
         write.setDefaultText2(generateName(this->dirpath));
         processor.savefile.store(false);
     }
@@ -267,7 +281,7 @@ void DemoEditor::performStoreClearActions()
 //     else if(&clearAll == button)
 //     {
 //         std::cout << "clearAll pressed" << std::endl;
-//         this->processor.csvsaver.clearEntries();
+//         this->processor.featureRecorder.clearEntries();
 //         this->processor.onsetCounterAtomic.store(0);
 //     }
 //     else if(write.hasButton(button))
@@ -277,7 +291,7 @@ void DemoEditor::performStoreClearActions()
 //         std::string path = temp.getFullPathName().toStdString();
 //         std::cout << "path " << path << std::endl;
 
-//         this->processor.csvsaver.writeToFile(path,processor.header);
+//         this->processor.featureRecorder.writeToFile(path,DemoProcessor::CSV_FLOAT_PRECISION);
 //         write.setDefaultText2(generateName(this->dirpath));
 //     }
 // }
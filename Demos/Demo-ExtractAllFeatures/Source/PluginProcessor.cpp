@@ -61,6 +61,14 @@ DemoProcessor::DemoProcessor()
     suspendProcessing (true);
 
     header = featexts.getHeader();
+    try
+    {
+        featureRecorder.start(RECORDING_PATH, header);
+    }
+    catch (std::exception &e)
+    {
+        rtlogger.logInfo("ERROR: cannot start the feature recorder: ", e.what());
+    }
     rtlogger.logInfo("Initializing Onset detector");
 
     /** ADD ONSET DETECTOR LISTENER **/
@@ -90,10 +98,10 @@ DemoProcessor::DemoProcessor()
 
 void DemoProcessor::logInCsvSpecial(std::string messagestr)
 {
-    Entry<VECTOR_SIZE>* currentEntry = csvsaver.entryToWrite();
+    Entry<VECTOR_SIZE>* currentEntry = featureRecorder.entryToWrite();
 
     if (!currentEntry)
-        rtlogger.logInfo("ERROR: csv buffer full");
+        rtlogger.logInfo("ERROR: feature recorder full or not recording");
     else
     {
         currentEntry->onsetDetectionTime = sampleCounter; // juce::Time::getMillisecondCounterHiRes();
@@ -105,12 +113,13 @@ void DemoProcessor::logInCsvSpecial(std::string messagestr)
         /*--------------------/
         | 3. STORE Entry      |
         /--------------------*/
-        size_t oc = csvsaver.confirmEntry();
+        size_t oc = featureRecorder.confirmEntry();
         // onsetCounterAtomic.exchange(oc);
     }
 }
 
 DemoProcessor::~DemoProcessor(){
+    featureRecorder.stop();
    #ifdef DO_LOG_TO_FILE
     /** Log last queued messages before closing **/
     logPollingRoutine();
@@ -255,12 +264,11 @@ void DemoProcessor::onsetDetectedRoutine ()
     rtlogger.logInfo("Onset detected");
     char message[tid::RealTimeLogger::LogEntry::MESSAGE_LENGTH];
 
-    Entry<VECTOR_SIZE>* currentFV = csvsaver.entryToWrite();
-
     if (storageState.load() == StorageState::store)
     {
+        Entry<VECTOR_SIZE>* currentFV = featureRecorder.entryToWrite();
         if (!currentFV)
-            rtlogger.logInfo("ERROR: buffer full");
+            rtlogger.logInfo("ERROR: feature recorder full or not recording");
         else
         {
             /*--------------------/
@@ -279,7 +287,7 @@ void DemoProcessor::onsetDetectedRoutine ()
             /*--------------------/
             | 3. STORE FEATURES   |
             /--------------------*/
-            size_t oc = csvsaver.confirmEntry();
+            size_t oc = featureRecorder.confirmEntry();
 
             onsetCounterAtomic++;   // I stopped using the next line when introducing special log entries in the csv buffer, otherwise they would be counted.
             // onsetCounterAtomic.exchange(oc);
@@ -301,7 +309,7 @@ void DemoProcessor::parameterChanged(const juce::String & parameterID, float new
         this->clear = true;
         // std::cout << "set clear to " << std::endl;
         // std::cout << "clearAll pressed" << std::endl;
-        // this->processor.csvsaver.clearEntries();
+        // this->processor.featureRecorder.clearEntries();
         // this->processor.onsetCounterAtomic.store(0);
     }    
     else if (parameterID == this->SAVEFILE_ID)
@@ -312,7 +320,7 @@ void DemoProcessor::parameterChanged(const juce::String & parameterID, float new
         // std::string path = temp.getFullPathName().toStdString();
         // std::cout << "path " << path << std::endl;
 
-        // this->processor.csvsaver.writeToFile(path,processor.header);
+        // this->processor.featureRecorder.writeToFile(path,CSV_FLOAT_PRECISION);
         // write.setDefaultText2(generateName(this->dirpath));
     }
 }
@@ -13,7 +13,7 @@
 
 #pragma once
 
-#include "csv_saver.h"
+#include "feature_recorder.h"
 #include "juce_timbreID.h"
 #include "postOnsetTimer.h"
 #include <JuceHeader.h>
@@ -94,7 +94,13 @@ class DemoProcessor : public AudioProcessor,
 
     static const unsigned int VECTOR_SIZE = featexts.getFeVectorSize();
 
-    SaveToCsv<100000, VECTOR_SIZE, CSV_FLOAT_PRECISION> csvsaver;
+    // Entries are streamed to RECORDING_PATH (in the user documents folder) while the plugin runs, "Save Csv" converts the recording
+    static const unsigned int RECORDER_RING_SIZE = 1024;
+    FeatureRecorder<VECTOR_SIZE, RECORDER_RING_SIZE> featureRecorder;
+    const std::string RECORDING_PATH = juce::File::getSpecialLocation(juce::File::userDocumentsDirectory)
+                                           .getChildFile("featureExtractor-recording.tidf")
+                                           .getFullPathName()
+                                           .toStdString();
     int pluginSampleRate, pluginBlockSize;
     void logInCsvSpecial(std::string messagestr);
     long unsigned int sampleCounter = 0;
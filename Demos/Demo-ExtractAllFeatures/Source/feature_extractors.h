@@ -265,10 +265,12 @@ public:
             /-----------------------------------------*/
             barkSpecRes = this->barkSpec.compute();
 
-            jassert(barkSpecRes.size() == _BARKSPEC_RES_SIZE);
+            // The number of bands depends on the sample rate (50 Bark bands at 44.1 kHz, 51 at 48 kHz):
+            // the vector keeps the first ones, and the bands missing at lower sample rates are 0
+            const int numBarkSpec = std::min<int>((int)barkSpecRes.size(), _BARKSPEC_RES_SIZE);
             for(int i=0; i<_BARKSPEC_RES_SIZE; ++i)
             {
-                featureVector[(last+1) + i] = barkSpecRes[i];
+                featureVector[(last+1) + i] = (i < numBarkSpec) ? barkSpecRes[i] : 0.0f;
             }
             newLast = last + _BARKSPEC_RES_SIZE;
         #ifdef LOG_SIZES
@@ -282,10 +284,10 @@ public:
             | 04 - Bark Frequency Cepstral Coefficients |
             /------------------------------------------*/
             bfccRes = this->bfcc.compute();
-            jassert(bfccRes.size() == _BFCC_RES_SIZE);
+            const int numBfcc = std::min<int>((int)bfccRes.size(), _BFCC_RES_SIZE);
             for(int i=0; i<_BFCC_RES_SIZE; ++i)
             {
-                featureVector[(last+1) + i] = bfccRes[i];
+                featureVector[(last+1) + i] = (i < numBfcc) ? bfccRes[i] : 0.0f;
             }
             newLast = last + _BFCC_RES_SIZE;
            #ifdef LOG_SIZES
@@ -316,10 +318,10 @@ public:
             | 06 - Mel Frequency Cepstral Coefficients |
             /-----------------------------------------*/
             mfccRes = this->mfcc.compute();
-            jassert(mfccRes.size() == _MFCC_RES_SIZE);
+            const int numMfcc = std::min<int>((int)mfccRes.size(), _MFCC_RES_SIZE);
             for(int i=0; i<_MFCC_RES_SIZE; ++i)
             {
-                featureVector[(last+1) + i] = mfccRes[i];
+                featureVector[(last+1) + i] = (i < numMfcc) ? mfccRes[i] : 0.0f;
             }
             newLast = last + _MFCC_RES_SIZE;
            #ifdef LOG_SIZES
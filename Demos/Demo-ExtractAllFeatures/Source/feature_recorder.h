@@ -0,0 +1,408 @@
+/*
+  ==============================================================================
+
+  Feature Recorder
+  Streams the feature vectors computed in the audio thread to a binary file,
+  from a background writer thread, with bounded memory.
+  (Replaces the SaveToCsv recorder, that stopped recording when its fixed
+  buffer was full and wrote everything as CSV at the end)
+
+  - The audio thread fills the slots of a single-producer single-consumer
+    lock-free ring (entryToWrite + confirmEntry), it never blocks nor allocates.
+    If the ring is full (writer late) the entry is dropped and counted.
+  - The writer thread copies the ready slots to its own staging buffer, gives
+    the slots back to the audio thread, then appends the staging buffer to the
+    file (double buffering), so disk latency never holds ring slots.
+  - convertToCsv() converts a recording to the CSV format of the old SaveToCsv.
+  - If the writer thread fails (the file can't be reopened by clearEntries()),
+    it stops the recording and keeps the error (getError()), which
+    clearEntries() and writeToFile() throw.
+
+  Binary format (native byte order, little-endian on all supported targets):
+
+      char     magic[4]      "TIDF"
+      uint32   version       1
+      uint32   numFeatures
+      uint32   headerSize    size of the header in bytes
+      char     header[headerSize]   feature names separated by '\n'
+      records, each of RECORD_SIZE bytes:
+          uint64   onsetDetectionTime
+          uint64   featureComputationTime
+          int32    featureExtractionWindowSize
+          int32    sampleRate
+          int32    blockSize
+          uint32   isSpecial
+          char     message[52]      (zero terminated, only for special entries)
+          float32  features[numFeatures]
+
+  Author: Domenico Stefani (domenico.stefani96 AT gmail.com)
+
+  ==============================================================================
+*/
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+template <unsigned int FEATURE_NUM> struct Entry
+{
+    float features[FEATURE_NUM];
+    long unsigned int onsetDetectionTime, featureComputationTime;
+    int featureExtractionWindowSize, sampleRate, blockSize;
+    bool isSpecial = false;
+    char message[51];
+
+    void writeMessage(const char message[])
+    {
+        this->isSpecial = true;
+        strncpy(this->message, message, 51);
+    }
+
+    void reset()
+    {
+        for (float &val : features)
+            val = 0.0f;
+        onsetDetectionTime = 0;
+        featureComputationTime = 0;
+        isSpecial = false;
+        message[0] = '\0';
+    }
+};
+
+/**
+ * @brief Streaming recorder of feature vectors
+ *
+ * @tparam FEATURE_NUM number of features of each entry
+ * @tparam RING_SIZE   number of entries that can wait for the writer thread (memory is bounded by this)
+ */
+template <unsigned int FEATURE_NUM, unsigned int RING_SIZE> class FeatureRecorder
+{
+  public:
+    static constexpr size_t MESSAGE_SIZE = 52;
+    static constexpr size_t RECORD_SIZE = 2 * sizeof(uint64_t) + 4 * sizeof(int32_t) + MESSAGE_SIZE + FEATURE_NUM * sizeof(float);
+
+    FeatureRecorder() : ring(new Entry<FEATURE_NUM>[RING_SIZE])
+    {
+    }
+
+    ~FeatureRecorder()
+    {
+        stop();
+    }
+
+    /**
+     * Open (truncate) the binary file and start the writer thread.
+     * Call it from a non real-time thread.
+     * @throws std::runtime_error if the file can't be opened
+     */
+    void start(const std::string &path, const std::vector<std::string> &header)
+    {
+        if (header.size() != FEATURE_NUM)
+            throw std::logic_error("Header size must be equal to the number of features (" +
+                                   std::to_string(header.size()) + " != " + std::to_string(FEATURE_NUM) + ")");
+        stop();
+        this->path = path;
+        this->header = header;
+        setError("");
+        openFile();
+        this->running.store(true);
+        this->writerThread = std::thread([this] { writerLoop(); });
+    }
+
+    /** Write the remaining entries, stop the writer thread and close the file */
+    void stop()
+    {
+        // The writer thread may have stopped the recording itself, after an error
+        this->running.store(false);
+        if (this->writerThread.joinable())
+            this->writerThread.join();
+        this->file.close();
+    }
+
+    bool isRecording() const
+    {
+        return this->running.load();
+    }
+
+    //========================= AUDIO THREAD ===================================
+    /** Slot for the next entry, or nullptr if not recording or the ring is full (real-time safe) */
+    Entry<FEATURE_NUM> *entryToWrite()
+    {
+        const uint64_t head = this->head.load(std::memory_order_relaxed);
+        if (!this->running.load(std::memory_order_relaxed))
+            return nullptr;
+        if (head - this->tail.load(std::memory_order_acquire) >= RING_SIZE)
+        {
+            this->dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        }
+        Entry<FEATURE_NUM> *res = &this->ring[head % RING_SIZE];
+        res->reset();
+        return res;
+    }
+
+    /** Publish the entry returned by entryToWrite() to the writer thread */
+    size_t confirmEntry()
+    {
+        const uint64_t head = this->head.load(std::memory_order_relaxed) + 1;
+        this->head.store(head, std::memory_order_release);
+        return (size_t)head;
+    }
+
+    //========================= OTHER THREADS ==================================
+    /**
+     * Discard the recording (the file restarts from the header)
+     * @throws std::runtime_error if the writer thread failed and stopped the recording
+     */
+    void clearEntries()
+    {
+        this->clearRequested.store(true);
+        waitWriter([this] { return !this->clearRequested.load(); });
+        throwIfFailed();
+    }
+
+    /** Wait until all the entries confirmed so far are written to the file */
+    void flush()
+    {
+        const uint64_t target = this->head.load(std::memory_order_acquire);
+        waitWriter([this, target] { return this->flushed.load() >= target; });
+    }
+
+    /**
+     * Flush the recording and convert it to CSV (entries confirmed later are not included)
+     * @throws std::runtime_error if the writer thread failed and stopped the recording, or if the CSV can't be written
+     */
+    void writeToFile(const std::string &csvPath, unsigned int precision)
+    {
+        flush();
+        throwIfFailed();
+        convertToCsv(this->path, csvPath, precision, this->written.load());
+    }
+
+    /** Number of entries written to the file */
+    uint64_t getNumWritten() const
+    {
+        return this->written.load();
+    }
+
+    /** Number of entries dropped because the ring was full */
+    uint64_t getNumDropped() const
+    {
+        return this->dropped.load();
+    }
+
+    const std::string &getPath() const
+    {
+        return this->path;
+    }
+
+    /** Error that stopped the writer thread, empty if there was none */
+    std::string getError() const
+    {
+        std::lock_guard<std::mutex> lock(this->errorMutex);
+        return this->error;
+    }
+
+    /**
+     * Convert a binary recording to CSV, in the format of the old SaveToCsv
+     * (metadata columns, then the features, special entries have their message instead of the features).
+     * A record that is still being written (incomplete) at the end of the file is ignored.
+     * @param maxEntries convert at most this number of entries
+     * @return number of entries converted
+     * @throws std::runtime_error if the binary file is not valid
+     */
+    static size_t convertToCsv(const std::string &binaryPath, const std::string &csvPath, unsigned int precision,
+                               uint64_t maxEntries = std::numeric_limits<uint64_t>::max())
+    {
+        std::ifstream in(binaryPath, std::ios::binary);
+        char magic[4];
+        uint32_t version = 0, numFeatures = 0, headerSize = 0;
+        in.read(magic, 4);
+        in.read((char *)&version, sizeof(version));
+        in.read((char *)&numFeatures, sizeof(numFeatures));
+        in.read((char *)&headerSize, sizeof(headerSize));
+        if (!in || std::memcmp(magic, "TIDF", 4) != 0 || version != 1)
+            throw std::runtime_error("'" + binaryPath + "' is not a feature recording");
+        std::string headerText(headerSize, '\0');
+        in.read(&headerText[0], headerSize);
+
+        std::ofstream csvFile(csvPath);
+        if (!csvFile)
+            throw std::runtime_error("Cannot open '" + csvPath + "'");
+
+        // WRITE HEADER
+        csvFile << "onsetDetectionTime,featureComputationTime,featureExtractionWindowSize,sampleRate,blockSize,";
+        for (char &c : headerText)
+            if (c == '\n')
+                c = ',';
+        csvFile << headerText << "\n";
+
+        // WRITE ENTRIES
+        const size_t recordSize = 2 * sizeof(uint64_t) + 4 * sizeof(int32_t) + MESSAGE_SIZE + numFeatures * sizeof(float);
+        std::vector<char> record(recordSize);
+        size_t count = 0;
+        while (count < maxEntries && in.read(record.data(), recordSize))
+        {
+            uint64_t onsetDetectionTime, featureComputationTime;
+            int32_t meta[3];
+            uint32_t isSpecial;
+            const char *p = record.data();
+            std::memcpy(&onsetDetectionTime, p, 8);
+            std::memcpy(&featureComputationTime, p + 8, 8);
+            std::memcpy(meta, p + 16, 12);
+            std::memcpy(&isSpecial, p + 28, 4);
+            const char *message = p + 32;
+            const char *features = p + 32 + MESSAGE_SIZE;
+
+            csvFile << std::setprecision(std::numeric_limits<double>::digits10 + 1) << onsetDetectionTime << ","
+                    << featureComputationTime << "," << meta[0] << "," << meta[1] << "," << meta[2] << ",";
+            if (isSpecial)
+                csvFile << message << '\n';
+            else
+            {
+                csvFile << std::setprecision(precision);
+                for (size_t j = 0; j < numFeatures; ++j)
+                {
+                    float value;
+                    std::memcpy(&value, features + j * sizeof(float), sizeof(float));
+                    csvFile << value << (j != numFeatures - 1 ? "," : "\n");
+                }
+            }
+            ++count;
+        }
+        return count;
+    }
+
+  private:
+    std::unique_ptr<Entry<FEATURE_NUM>[]> ring;
+    std::atomic<uint64_t> head{0}, tail{0};
+    std::atomic<uint64_t> written{0}, dropped{0};
+    std::atomic<uint64_t> flushed{0}; // Entries before this index are in the file (or discarded)
+    std::atomic<bool> running{false}, clearRequested{false};
+
+    std::thread writerThread;
+    std::ofstream file;
+    std::string path;
+    std::vector<std::string> header;
+    std::vector<char> staging; // Writer thread only
+    mutable std::mutex errorMutex;
+    std::string error;
+
+    static constexpr unsigned int WRITER_PERIOD_MS = 10;
+
+    void setError(const std::string &message)
+    {
+        std::lock_guard<std::mutex> lock(this->errorMutex);
+        this->error = message;
+    }
+
+    void throwIfFailed() const
+    {
+        const std::string message = getError();
+        if (!message.empty())
+            throw std::runtime_error("Feature recorder stopped: " + message);
+    }
+
+    template <typename Condition> void waitWriter(Condition done)
+    {
+        while (this->running.load() && !done())
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    void openFile()
+    {
+        this->file.close();
+        this->file.open(this->path, std::ios::binary | std::ios::trunc);
+        if (!this->file)
+            throw std::runtime_error("Cannot open '" + this->path + "' for writing");
+
+        std::string headerText;
+        for (size_t i = 0; i < this->header.size(); ++i)
+            headerText += this->header[i] + (i != this->header.size() - 1 ? "\n" : "");
+        const uint32_t version = 1, numFeatures = FEATURE_NUM, headerSize = (uint32_t)headerText.size();
+        this->file.write("TIDF", 4);
+        this->file.write((const char *)&version, sizeof(version));
+        this->file.write((const char *)&numFeatures, sizeof(numFeatures));
+        this->file.write((const char *)&headerSize, sizeof(headerSize));
+        this->file.write(headerText.data(), headerText.size());
+        this->file.flush();
+        this->written.store(0);
+    }
+
+    void writerLoop()
+    {
+        this->staging.reserve((size_t)RING_SIZE * RECORD_SIZE);
+        while (this->running.load())
+        {
+            if (this->clearRequested.load())
+            {
+                // Everything confirmed until now is discarded
+                const uint64_t head = this->head.load(std::memory_order_acquire);
+                this->tail.store(head, std::memory_order_release);
+                try
+                {
+                    openFile();
+                }
+                catch (const std::exception &e)
+                {
+                    // An exception leaving the thread would terminate the host: stop recording instead
+                    setError(e.what());
+                    this->clearRequested.store(false);
+                    this->running.store(false);
+                    return;
+                }
+                this->flushed.store(head);
+                this->clearRequested.store(false);
+            }
+            if (!drain())
+                std::this_thread::sleep_for(std::chrono::milliseconds(WRITER_PERIOD_MS));
+        }
+        drain();
+    }
+
+    /** Move the ready entries to the staging buffer, release their slots, append them to the file */
+    bool drain()
+    {
+        const uint64_t tail = this->tail.load(std::memory_order_relaxed);
+        const uint64_t head = this->head.load(std::memory_order_acquire);
+        if (head == tail)
+            return false;
+
+        this->staging.resize((size_t)(head - tail) * RECORD_SIZE);
+        char *p = this->staging.data();
+        for (uint64_t i = tail; i < head; ++i, p += RECORD_SIZE)
+            serialize(this->ring[i % RING_SIZE], p);
+        this->tail.store(head, std::memory_order_release);
+
+        this->file.write(this->staging.data(), this->staging.size());
+        this->file.flush();
+        this->written.fetch_add(head - tail);
+        this->flushed.store(head);
+        return true;
+    }
+
+    static void serialize(const Entry<FEATURE_NUM> &entry, char *p)
+    {
+        const uint64_t times[2] = {entry.onsetDetectionTime, entry.featureComputationTime};
+        const int32_t meta[3] = {entry.featureExtractionWindowSize, entry.sampleRate, entry.blockSize};
+        const uint32_t isSpecial = entry.isSpecial ? 1 : 0;
+        std::memcpy(p, times, 16);
+        std::memcpy(p + 16, meta, 12);
+        std::memcpy(p + 28, &isSpecial, 4);
+        std::memset(p + 32, 0, MESSAGE_SIZE);
+        if (entry.isSpecial)
+            std::memcpy(p + 32, entry.message, strnlen(entry.message, MESSAGE_SIZE - 1));
+        std::memcpy(p + 32 + MESSAGE_SIZE, entry.features, FEATURE_NUM * sizeof(float));
+    }
+};
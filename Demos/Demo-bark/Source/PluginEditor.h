@@ -78,6 +78,8 @@ private:
 
     void pollingRoutine()
     {
+        // Onsets are queued by the audio thread, the listeners are called here
+        processor.bark.dispatchOnsetEvents();
         if(processor.onsetMonitorState.exchange(false))
             barkLed.switchOn();
         updateDataLabel();
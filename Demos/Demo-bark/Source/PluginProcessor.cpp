@@ -65,8 +65,8 @@ void DemoProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer& midiMe
         tid::Bark<float>::GrowthData growthData = bark.store(buffer,(short int)0);
 
         /** Retrieve the total growth and the growth data list **/
-        std::vector<float>* growth = growthData.getGrowth();
-        float* totalGrowth = growthData.getTotalGrowth();
+        const std::vector<float>* growth = growthData.getGrowth();
+        const float* totalGrowth = growthData.getTotalGrowth();
 
         /** Check whether the data is valid: depending on analysis and
             whether spew mode is ON, the growthData will be provided
@@ -111,9 +111,9 @@ void DemoProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer& midiMe
 
 /**
  * Onset Detected Callback
- * Remember that this is called from the audio thread so it must not update the GUI directly
+ * Called by bark.dispatchOnsetEvents(), that the editor calls from the message thread
 **/
-void DemoProcessor::onsetDetected (tid::Bark<float> * bark)
+void DemoProcessor::onsetDetected (tid::Bark<float> * bark, const tid::Bark<float>::OnsetEvent&)
 {
     if(bark == &this->bark)
         this->onsetMonitorState.exchange(true);
@@ -0,0 +1,188 @@
+/*
+  ===================================================================================
+     Lockfree zero-copy SPSC queue to feed features to the Classifier and receive
+     predictions
+
+     The queue owns BUFFER_SIZE preallocated slots of ELEMENT_SIZE floats, each one
+     starting on its own cache line. Instead of copying elements in and out, the
+     producer writes directly into a slot and the consumer reads directly from it:
+
+        float* slot = queue.acquireWrite();       // Producer
+        if (slot != nullptr) { fill(slot); queue.commit(); }
+
+        float* slot = queue.acquireRead();        // Consumer
+        if (slot != nullptr) { use(slot); queue.release(); }
+
+     ELEMENT_SIZE can be fixed at compile time, or set to RUNTIME_ELEMENT_SIZE (0)
+     and specified later with reserve(), which allocates and must not be called
+     while the queue is in use.
+
+     Author: Domenico Stefani (domenico.stefani96 AT gmail.com)
+  ===================================================================================
+*/
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+namespace SlotQueue
+{
+
+constexpr std::size_t CACHE_LINE_SIZE = 64;
+constexpr std::size_t FLOATS_PER_LINE = CACHE_LINE_SIZE / sizeof(float);
+constexpr std::size_t RUNTIME_ELEMENT_SIZE = 0;
+
+/** Number of floats of a slot, rounded up so that every slot starts on a new cache line */
+constexpr std::size_t paddedSize(std::size_t elementSize)
+{
+    return ((elementSize + FLOATS_PER_LINE - 1) / FLOATS_PER_LINE) * FLOATS_PER_LINE;
+}
+
+/** Slot storage for a compile time element size */
+template <std::size_t ELEMENT_SIZE, std::size_t BUFFER_SIZE>
+class SlotStorage
+{
+  public:
+    static constexpr std::size_t STRIDE = paddedSize(ELEMENT_SIZE);
+
+    float *slot(std::size_t idx) { return &data[idx * STRIDE]; }
+    std::size_t getElementSize() const { return ELEMENT_SIZE; }
+
+  private:
+    alignas(CACHE_LINE_SIZE) float data[BUFFER_SIZE * STRIDE] = {};
+};
+
+/** Slot storage for a runtime element size (see reserve) */
+template <std::size_t BUFFER_SIZE>
+class SlotStorage<RUNTIME_ELEMENT_SIZE, BUFFER_SIZE>
+{
+  public:
+    float *slot(std::size_t idx)
+    {
+        if (base == nullptr)
+            throw std::logic_error("ClassifierSlotQueue: reserve() must be called before using a runtime-sized queue");
+        return base + idx * stride;
+    }
+    std::size_t getElementSize() const { return elementSize; }
+
+    void reserve(std::size_t newElementSize)
+    {
+        this->elementSize = newElementSize;
+        this->stride = paddedSize(newElementSize);
+        // One extra cache line to align the first slot
+        this->buffer.assign(BUFFER_SIZE * this->stride + FLOATS_PER_LINE, 0.0f);
+        const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(this->buffer.data());
+        const std::size_t misalignment = address % CACHE_LINE_SIZE;
+        const std::size_t offset = misalignment == 0 ? 0 : (CACHE_LINE_SIZE - misalignment) / sizeof(float);
+        this->base = this->buffer.data() + offset;
+    }
+
+  private:
+    std::vector<float> buffer;
+    float *base = nullptr;
+    std::size_t elementSize = 0, stride = 0;
+};
+
+} // namespace SlotQueue
+
+template <std::size_t ELEMENT_SIZE, std::size_t BUFFER_SIZE>
+class ClassifierSlotQueue
+{
+  public:
+    static_assert(BUFFER_SIZE > 0, "ClassifierSlotQueue needs at least one slot");
+
+    /** Construct a ClassifierSlotQueue with BUFFER_SIZE preallocated slots (runtime-sized queues need reserve) */
+    ClassifierSlotQueue() {}
+
+    /**
+     * Allocate the slots of a runtime-sized queue (ELEMENT_SIZE == SlotQueue::RUNTIME_ELEMENT_SIZE).
+     * NOT real-time safe, and neither thread can be using the queue while this is called.
+     */
+    template <std::size_t E = ELEMENT_SIZE, typename std::enable_if<E == SlotQueue::RUNTIME_ELEMENT_SIZE, int>::type = 0>
+    void reserve(std::size_t elementSize)
+    {
+        this->storage.reserve(elementSize);
+        this->writeIndex.store(0, std::memory_order_relaxed);
+        this->readIndex.store(0, std::memory_order_relaxed);
+    }
+
+    /** Number of floats in each slot */
+    std::size_t getElementSize() const { return this->storage.getElementSize(); }
+
+    //=========================================================================
+    // Producer side
+
+    /**
+     * Get the next free slot, or nullptr if the queue is full.
+     * The slot becomes visible to the consumer only after commit().
+     * Calling acquireWrite again before commit returns the same slot.
+     */
+    float *acquireWrite()
+    {
+        const std::size_t write = this->writeIndex.load(std::memory_order_relaxed);
+        if (write - this->readIndex.load(std::memory_order_acquire) >= BUFFER_SIZE)
+            return nullptr;
+        return this->storage.slot(write % BUFFER_SIZE);
+    }
+
+    /** Publish the slot returned by the last acquireWrite() */
+    void commit()
+    {
+        this->writeIndex.store(this->writeIndex.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    //=========================================================================
+    // Consumer side
+
+    /**
+     * Get the oldest committed slot, or nullptr if the queue is empty.
+     * The slot stays valid (and cannot be overwritten) until release(); the consumer
+     * owns it in the meantime, so it can also be processed in place.
+     */
+    float *acquireRead()
+    {
+        const std::size_t read = this->readIndex.load(std::memory_order_relaxed);
+        if (read == this->writeIndex.load(std::memory_order_acquire))
+            return nullptr;
+        return this->storage.slot(read % BUFFER_SIZE);
+    }
+
+    /** Give the slot returned by the last acquireRead() back to the producer */
+    void release()
+    {
+        this->readIndex.store(this->readIndex.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+    /**
+     * Copy the oldest element to destination (getElementSize() floats) and release its slot.
+     * Convenience for small elements that the consumer wants to keep.
+     * @return false if the queue was empty
+     */
+    bool read(float *destination)
+    {
+        const float *slot = this->acquireRead();
+        if (slot == nullptr)
+            return false;
+        std::copy(slot, slot + this->getElementSize(), destination);
+        this->release();
+        return true;
+    }
+
+    /** Number of committed slots not yet released (approximate if called while the other thread is active) */
+    std::size_t getNumReady() const
+    {
+        return this->writeIndex.load(std::memory_order_acquire) - this->readIndex.load(std::memory_order_acquire);
+    }
+
+  private:
+    SlotQueue::SlotStorage<ELEMENT_SIZE, BUFFER_SIZE> storage;
+    // Indexes grow monotonically (a 64bit counter never wraps around in practice)
+    // and live on separate cache lines to avoid false sharing between the two threads
+    alignas(SlotQueue::CACHE_LINE_SIZE) std::atomic<std::size_t> writeIndex{0};
+    alignas(SlotQueue::CACHE_LINE_SIZE) std::atomic<std::size_t> readIndex{0};
+};
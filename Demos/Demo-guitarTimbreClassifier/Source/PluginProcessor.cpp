@@ -82,9 +82,6 @@ DemoProcessor::DemoProcessor()
     bark.setMask(4, 0.75);
     bark.setFilterRange(0, 49);
     bark.setThresh(-1, 30);
-
-    /** ADD ONSET DETECTOR LISTENER **/
-    bark.addListener(this);
    #endif
 
     juce::var parsedJson;
@@ -106,6 +103,9 @@ DemoProcessor::DemoProcessor()
        #elif USE_TORCHSCRIPT
         rtlogger.logInfo("Neural Network interpreter: TorchScript");
         MODEL_PATH = JsonConf::getNestedStringProperty(parsedJson,"models","torchscript");
+       #elif defined(USE_TID_NN)
+        rtlogger.logInfo("Neural Network interpreter: built-in tid::nn");
+        MODEL_PATH = JsonConf::getNestedStringProperty(parsedJson,"models","tidnn");
        #else
         rtlogger.logInfo("ERROR, can't find a preprocessor directive with the neural interpreter to use");
        #endif
@@ -256,6 +256,10 @@ DemoProcessor::DemoProcessor()
         rtlogger.logInfo("Classifier object could not be created");
         throw std::logic_error("Classifier object could not be created");
     }
+   #ifdef USE_TID_NN
+    if (selectedFeatures.size() != TidNN::TidNNModel::inSize)
+        throw std::logic_error("The tid::nn model takes "+std::to_string(TidNN::TidNNModel::inSize)+" inputs, but "+std::to_string(selectedFeatures.size())+" features are selected (change TidNNModel in tidNNClassifier.h)");
+   #endif
    #ifndef FAST_MODE_1
     rtlogger.logValue("Classifier object instantiated at time:  ",juce::Time::getMillisecondCounterHiRes());
     std::cout << "Classifier object instantiated at time:  " << juce::Time::getMillisecondCounterHiRes() << std::endl << std::flush;
@@ -432,6 +436,10 @@ void DemoProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer& midiMe
        #else
         /** STORE THE BUFFER FOR COMPUTATION **/
         bark.store(buffer,(short int)MONO_CHANNEL);
+        /** THE CLASSIFICATION STARTS IN THIS BLOCK, SO THE ONSET EVENTS ARE POPPED ON THE AUDIO THREAD **/
+        tid::Bark<float>::OnsetEvent onsetEvent;
+        while (bark.popOnsetEvent(onsetEvent))
+            onsetDetected(onsetEvent);
        #endif
     } catch(std::exception& e) {
        #ifndef FAST_MODE_1
@@ -447,11 +455,11 @@ void DemoProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer& midiMe
 
    #ifndef SEQUENTIAL_CLASSIFICATION
     /** CHECK IF THE CLASSIFIER HAS FINIHED **/
-    bool readPred = DemoProcessor::classificationData.predictionBuffer.read(classificationOutputVector); // read predictions from rt thread when available
+    bool readPred = DemoProcessor::classificationData.predictionBuffer.read(classificationOutputVector.data()); // read predictions from rt thread when available
     if (readPred) // if a value was read
     {
         rtlogger.logInfo("Classification Finished");
-        rtlogger.logValue("Classification output: ",classificationOutputVector[0]);
+        rtlogger.logBinary("Classification output: {}",classificationOutputVector[0]);
         classificationFinished();
     }
    #endif
@@ -487,9 +495,8 @@ void DemoProcessor::onsetDetected (tid::aubio::Onset<float> *aubioOnset){
     if(aubioOnset == &this->aubioOnset)
     {
 #else
-void DemoProcessor::onsetDetected (tid::Bark<float> * bark)
+void DemoProcessor::onsetDetected (const tid::Bark<float>::OnsetEvent&)
 {
-    if(bark == &this->bark)
     {
 #endif
       #ifndef FAST_MODE_1
@@ -503,8 +510,8 @@ void DemoProcessor::onsetDetected (tid::Bark<float> * bark)
         {
             float actualDelayMs = postOnsetTimer.start(POST_ONSET_DELAY_MS);
            #ifndef FAST_MODE_1
-            rtlogger.logValue("Start waiting for ",actualDelayMs,"ms");
-            rtlogger.logValue("(Closes approximation to ",(float)POST_ONSET_DELAY_MS,"ms in block sizes)");
+            rtlogger.logBinary("Start waiting for {} ms",actualDelayMs);
+            rtlogger.logBinary("(Closes approximation to {} ms in block sizes)",(float)POST_ONSET_DELAY_MS);
            #endif
         }
        #else
@@ -529,22 +536,33 @@ void DemoProcessor::onsetDetectedRoutine ()
 
     /** LOG BEGINNING OF FEATURE EXTRACTION **/
    #ifdef MEASURE_COMPUTATION_LATENCY
-    rtlogger.logValue("Feature extraction started at ",juce::Time::getMillisecondCounterHiRes());
-    rtlogger.logValue("(",(juce::Time::getMillisecondCounterHiRes() - latencyTime),"ms after onset detection)");
+    rtlogger.logBinary("Feature extraction started at {}",juce::Time::getMillisecondCounterHiRes());
+    rtlogger.logBinary("({} ms after onset detection)",(juce::Time::getMillisecondCounterHiRes() - latencyTime));
    #endif
   #endif
 
     /*--------------------/
     | 1. EXTRACT FEATURES |
     /--------------------*/
-    this->featexts.computeSelectedFeaturesAndScale(featureVector.data());
+   #ifndef SEQUENTIAL_CLASSIFICATION
+    // Features are computed directly into a free slot of the queue read by the classification thread
+    float* const featureDestination = DemoProcessor::classificationData.featureBuffer.acquireWrite();
+    if (featureDestination == nullptr)
+    {
+        rtlogger.logInfo("Feature queue is full, onset discarded");
+        return;
+    }
+   #else
+    float* const featureDestination = featureVector.data();
+   #endif
+    this->featexts.computeSelectedFeaturesAndScale(featureDestination);
     
 
   #ifndef FAST_MODE_1
     /** LOG ENDING OF FEATURE EXTRACTION **/
    #ifdef MEASURE_COMPUTATION_LATENCY
-    rtlogger.logValue("Feature extraction stopped at ",juce::Time::getMillisecondCounterHiRes());
-    rtlogger.logValue("(Feature extraction stopped ",(juce::Time::getMillisecondCounterHiRes() - latencyTime),"ms after onset detection)");
+    rtlogger.logBinary("Feature extraction stopped at {}",juce::Time::getMillisecondCounterHiRes());
+    rtlogger.logBinary("(Feature extraction stopped {} ms after onset detection)",(juce::Time::getMillisecondCounterHiRes() - latencyTime));
    #endif
   #endif
 
@@ -553,20 +571,22 @@ void DemoProcessor::onsetDetectedRoutine ()
     /----------------------------------*/
   #ifndef FAST_MODE_1
    #ifdef MEASURE_COMPUTATION_LATENCY
-    rtlogger.logValue("(",(juce::Time::getMillisecondCounterHiRes()-latencyTime),"ms after onset detection}");
+    rtlogger.logBinary("({} ms after onset detection)",(juce::Time::getMillisecondCounterHiRes()-latencyTime));
     this->classf_start = juce::Time::getMillisecondCounterHiRes();
    #endif
   #endif
 
     this->chrono_start = std::chrono::high_resolution_clock::now();
    #ifndef SEQUENTIAL_CLASSIFICATION
-    rtlogger.logInfo("Triggering classification (writing feature vector to buffer)");
-    DemoProcessor::classificationData.featureBuffer.write(featureVector);    // Write the feature vector to a ring buffer, for parallel classification
+    rtlogger.logInfo("Triggering classification (committing feature vector slot)");
+    DemoProcessor::classificationData.featureBuffer.commit();    // Publish the feature slot to the classification thread
     // Note to self:
     // Here I tried to use juce::Thread::notify() to wake up the classification thread
     // This meant having a wait(-1) in a loop inside the classifier callback (instead of the successive wait)
     // Contrary to what was hinted in the JUCE forum, this causes mode switches in Xenomai so it is not rt safe. 
     // Old line: classificationThread.notify();
+    // RealTimeWakeup::post() is a single atomic increment instead (see rtWakeup.h)
+    DemoProcessor::classificationData.featuresReady.post();
    #else
     // classify(DemoProcessor::timbreClassifier,&(featureVector[0]), featureVector.size(),&(classificationOutputVector[0]), classificationOutputVector.size()); // Execute inference with the Interpreter of choice (see PluginProcessor.h)
     classifyFlat2D(DemoProcessor::timbreClassifier,featureVector.data(),\
@@ -589,22 +609,20 @@ void DemoProcessor::classificationFinished()
         this->chrono_end = std::chrono::high_resolution_clock::now();
         this->classf_end = juce::Time::getMillisecondCounterHiRes();
     #endif
-    rtlogger.logValue("Classification started at ",this->classf_start);
-    rtlogger.logValue("Classification stopped at ",this->classf_end);
-    rtlogger.logValue("Chrono duration",std::to_string(std::chrono::duration_cast<std::chrono::microseconds>(chrono_end - chrono_start).count()).c_str());
-    rtlogger.logValue("(Classification stopped ",(this->classf_end-this->latencyTime),"ms after onset detection");
+    rtlogger.logBinary("Classification started at {}",this->classf_start);
+    rtlogger.logBinary("Classification stopped at {}",this->classf_end);
+    rtlogger.logBinary("Chrono duration {}",(int64)std::chrono::duration_cast<std::chrono::microseconds>(chrono_end - chrono_start).count());
+    rtlogger.logBinary("(Classification stopped {} ms after onset detection",(this->classf_end-this->latencyTime));
    #endif
   #endif
 
     bool VERBOSERES = true,
          VERBOSE = true;
-
-    char message[tid::RealTimeLogger::LogEntry::MESSAGE_LENGTH];
   
    #ifdef DEBUG_WITH_SPIKE
-    rtlogger.logValue("CreatingLogSignal started at",juce::Time::getMillisecondCounterHiRes());
+    rtlogger.logBinary("CreatingLogSignal started at {}",juce::Time::getMillisecondCounterHiRes());
     squaredsinewt.playHalfwave();
-    rtlogger.logValue("CreatingLogSignal stopped at",juce::Time::getMillisecondCounterHiRes());
+    rtlogger.logBinary("CreatingLogSignal stopped at {}",juce::Time::getMillisecondCounterHiRes());
    #endif
 
     // Simple argmax
@@ -618,8 +636,7 @@ void DemoProcessor::classificationFinished()
     /** LOG CLASSIFICATION RESULTS AND TIME **/
     if (VERBOSERES)
     {
-        snprintf(message,sizeof(message),"Result: Predicted class %d with confidence %f",prediction,confidence);
-        rtlogger.logInfo(message);
+        rtlogger.logBinary("Result: Predicted class {} with confidence {}",prediction,confidence);
     }
 
     /** LOG ADDITIONAL INFO (CONFIDENCE VALUES FOR ALL CLASSES) **/
@@ -627,8 +644,7 @@ void DemoProcessor::classificationFinished()
     {
         for (int j = 0; j < classificationOutputVector.size(); ++j)
         {
-            snprintf(message,sizeof(message),"Class %d confidence %f",j,classificationOutputVector[j]);
-            rtlogger.logInfo(message);
+            rtlogger.logBinary("Class {} confidence {}",j,classificationOutputVector[j]);
         }
     }
    #endif
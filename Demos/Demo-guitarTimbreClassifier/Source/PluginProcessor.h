@@ -43,6 +43,10 @@
 #include "torch-classifier-lib.h"
 #endif
 
+#ifdef USE_TID_NN
+#include "tidNNClassifier.h" // Built-in dependency-free backend (include/tidNN.hpp)
+#endif
+
 #define DO_USE_ATTACKTIME true
 #define DO_USE_BARKSPECBRIGHTNESS true
 #define DO_USE_BARKSPEC true
@@ -59,9 +63,9 @@
 
 #define MEASURED_ONSET_DETECTION_DELAY_MS 7.7066666667f
 
-#include "ClassifierArrayFifoQueue.h"  // Lock-free queue that can store whole std::array elements
-#include "ClassifierVectorFifoQueue.h" // Same but with vectors, for runtime-defined size
+#include "ClassifierSlotQueue.h" // Lock-free zero-copy queue of preallocated slots (compile or runtime size)
 #include "postOnsetTimer.h"
+#include "rtWakeup.h" // Wakes up the classification thread without syscalls from the audio thread
 #include <thread>
 
 #define USE_AUBIO_ONSET // If this commented, the bark onset detector is used, otherwise the aubio onset module is used
@@ -91,13 +95,13 @@ const int CLASSIFICATION_FIFO_BUFFER = 5; // Size of the ring buffers
 struct ClassificationData
 {
     // In and Out buffers for parallel classification
-    ClassifierVectorQueue<CLASSIFICATION_FIFO_BUFFER>
+    // Features are computed directly into the slots and classified in place, so no copies are made
+    ClassifierSlotQueue<SlotQueue::RUNTIME_ELEMENT_SIZE, CLASSIFICATION_FIFO_BUFFER>
         featureBuffer; // Audio thread --(featurevector)-> Classification thread
-    ClassifierArrayQueue<N_CLASSES, CLASSIFICATION_FIFO_BUFFER>
+    ClassifierSlotQueue<N_CLASSES, CLASSIFICATION_FIFO_BUFFER>
         predictionBuffer; // Audio thread <--(predictions)--- Classification thread
-    // Element types for both queues
-    using features_t = ClassifierVectorQueue<CLASSIFICATION_FIFO_BUFFER>::ElementType;
-    using predictions_t = ClassifierArrayQueue<N_CLASSES, CLASSIFICATION_FIFO_BUFFER>::ElementType;
+    // Posted by the audio thread after writing to featureBuffer
+    RealTimeWakeup featuresReady;
     // Run flag, to start and stop the classification thread
     std::atomic<bool> run;
     std::atomic<int> i;
@@ -117,6 +121,9 @@ class ClassificationThread : public juce::Thread
 
     ~ClassificationThread() override
     {
+        signalThreadShouldExit();
+        if (cdata != nullptr)
+            cdata->featuresReady.post(); // Wake up the thread so that it can exit right away
         stopThread(2000); // allow the thread 2 seconds to stop cleanly - should be plenty of time.
     }
 
@@ -142,14 +149,14 @@ class ClassificationThread : public juce::Thread
 
     void set1DinputSize(size_t featureNumber)
     {
-        this->cdata->featureBuffer.reserveVectorSize(featureNumber);
+        this->cdata->featureBuffer.reserve(featureNumber);
     }
 
     void set2DinputSize(size_t nRows, size_t nCols)
     {
         this->cdata->nRows = nRows;
         this->cdata->nCols = nCols;
-        this->cdata->featureBuffer.reserveVectorSize(nRows * nCols);
+        this->cdata->featureBuffer.reserve(nRows * nCols);
     }
 
     void run() override
@@ -161,19 +168,29 @@ class ClassificationThread : public juce::Thread
             if (tclassifier == nullptr)
                 throw std::logic_error("Invalid timbreClassifier pointer;");
 
-            static ClassificationData::features_t readFeatures;
-            if (cdata->featureBuffer.read(readFeatures)) // Read from feature queue
+            // Sleep until the audio thread posts new features (timeout to check threadShouldExit)
+            if (!cdata->featuresReady.wait(std::chrono::milliseconds(100)))
+                continue;
+
+            // Drain the feature queue (posts can be coalesced)
+            while (float *readFeatures = cdata->featureBuffer.acquireRead())
             {
-                static ClassificationData::predictions_t towritePredictions;
+                float *towritePredictions = cdata->predictionBuffer.acquireWrite();
+                if (towritePredictions == nullptr) // The audio thread is not consuming predictions, drop the features
+                {
+                    cdata->featureBuffer.release();
+                    continue;
+                }
                 // 1D input
-                // classify(*tclassifier,&(readFeatures[0]), readFeatures.size(),&(towritePredictions[0]),
-                // towritePredictions.size());
+                // classify(*tclassifier, readFeatures, cdata->featureBuffer.getElementSize(), towritePredictions,
+                // N_CLASSES);
 
                 // 2D input
                 if (cdata->nRows == -1 || cdata->nCols == -1)
                     throw std::logic_error("Invalid input size");
-                classifyFlat2D(*tclassifier, readFeatures.data(), cdata->nRows, cdata->nCols, towritePredictions.data(),
-                               towritePredictions.size(), false);
+                classifyFlat2D(*tclassifier, readFeatures, cdata->nRows, cdata->nCols, towritePredictions, N_CLASSES,
+                               false);
+                cdata->featureBuffer.release();
 #ifndef STOP_OSC
                 if (isOSCconnected)
                 {
@@ -210,14 +227,8 @@ class ClassificationThread : public juce::Thread
                     }
                 }
 #endif
-                cdata->predictionBuffer.write(towritePredictions);
+                cdata->predictionBuffer.commit();
             }
-
-            // wait(1); // Wait to avoid starving (Busy waiting)
-
-            // Possible alternative for quicker polling
-            using namespace std::chrono_literals;
-            std::this_thread::sleep_for(500us);
         }
     }
 
@@ -241,11 +252,9 @@ class ClassificationThread : public juce::Thread
 
 } // namespace CData
 
-class DemoProcessor : public AudioProcessor,
+class DemoProcessor : public AudioProcessor
 #ifdef USE_AUBIO_ONSET
-                      public tid::aubio::Onset<float>::Listener
-#else
-                      public tid::Bark<float>::Listener
+                    , public tid::aubio::Onset<float>::Listener
 #endif
 {
   public:
@@ -283,7 +292,8 @@ class DemoProcessor : public AudioProcessor,
 #else
     /**    Initialize the onset detector      **/
     tid::Bark<float> bark{BARK_WINDOW_SIZE, BARK_HOP_SIZE, BARK_SPACING};
-    void onsetDetected(tid::Bark<float> *bark);
+    /** Called from processBlock for every onset event popped from bark, right after store() **/
+    void onsetDetected(const tid::Bark<float>::OnsetEvent& event);
 #endif
 
     PostOnsetTimer postOnsetTimer;
@@ -353,6 +363,8 @@ class DemoProcessor : public AudioProcessor,
      * or
      * rtlogger.logInfo(message, timeAtStart, timeAtEnd); // both times can be obtained with
      Time::getHighResolutionTicks();
+     * or, on the audio thread, with the binary mode that defers formatting to pop:
+     * rtlogger.logBinary("Value {} at {} ms", value, timeMs); // The format must be a string literal
      *
      * Messages have to be consumed with:
      * rtlogger.pop(le)
@@ -430,6 +442,8 @@ class DemoProcessor : public AudioProcessor,
                     msg += " | end: " + std::to_string(end);
                     msg += " | difference: " + std::to_string(diff) + "s";
                 }
+                if (le.timestamp != 0) // Time at which the entry was logged
+                    msg += " | t: " + std::to_string((le.timestamp * 1.0) / this->highResFrequency);
                 fileLogger->logMessage(msg);
             }
         }
@@ -1,6 +1,9 @@
 #ifndef POST_ONSET_TIMER_H
 #define POST_ONSET_TIMER_H
 
+#include <cmath>
+#include <stdexcept>
+
 using int64 = long long;
 enum TimerState {IDLE, STARTED};
 
@@ -0,0 +1,180 @@
+/*
+  ===================================================================================
+     Real-time safe wake-up signal for the Classification thread
+
+     The audio thread posts with a single lock-free atomic increment, so posting
+     never enters the kernel and cannot cause mode switches on Xenomai (Elk Audio OS).
+     The waiting thread spins for a short bounded (adaptive) time, then sleeps with
+     an exponential backoff capped at maxSleep.
+
+     On stock Linux, RTWAKEUP_USE_FUTEX can be set to 1 to park the waiting thread
+     on a futex instead of the backoff. In that case post() issues a FUTEX_WAKE
+     syscall, but only when the waiter is actually parked.
+     Do NOT enable it on Xenomai, where any Linux syscall from the audio thread
+     causes a mode switch.
+
+     Author: Domenico Stefani (domenico.stefani96 AT gmail.com)
+  ===================================================================================
+*/
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <thread>
+#include <algorithm>
+
+#ifndef RTWAKEUP_USE_FUTEX
+#define RTWAKEUP_USE_FUTEX 0
+#endif
+
+#if RTWAKEUP_USE_FUTEX
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <ctime>
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+
+class RealTimeWakeup
+{
+public:
+    using Clock = std::chrono::steady_clock;
+
+    // post() must be callable from the audio callback (and from signal handlers),
+    // which is only true if the atomics used never fall back to a lock
+    static_assert(std::atomic<uint32_t>::is_always_lock_free, "RealTimeWakeup requires lock-free 32bit atomics");
+
+    /**
+     * @param minSpin   spin iterations used after a long idle period
+     * @param maxSpin   spin iterations used right after a wake-up (onsets come in bursts)
+     * @param minSleep  first sleep period of the backoff, after the spin phase
+     * @param maxSleep  maximum sleep period of the backoff (worst case wake latency)
+     */
+    RealTimeWakeup(uint32_t minSpin = 256, uint32_t maxSpin = 16384,
+                   std::chrono::microseconds minSleep = std::chrono::microseconds(10),
+                   std::chrono::microseconds maxSleep = std::chrono::microseconds(200))
+        : minSpin(minSpin), maxSpin(std::max(minSpin, maxSpin)), spinBudget(minSpin),
+          minSleep(minSleep), maxSleep(std::max(minSleep, maxSleep))
+    {
+    }
+
+    /**
+     * Signal the waiting thread.
+     * Real-time safe and async-signal safe: a single atomic increment, no locks,
+     * no allocation, no syscall (unless RTWAKEUP_USE_FUTEX is enabled and the
+     * waiter is parked).
+     */
+    void post() noexcept
+    {
+        sequence.fetch_add(1, std::memory_order_seq_cst);
+       #if RTWAKEUP_USE_FUTEX
+        if (parked.load(std::memory_order_seq_cst))
+            syscall(SYS_futex, reinterpret_cast<uint32_t *>(&sequence), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+       #endif
+    }
+
+    /**
+     * Wait until post() is called or the timeout expires.
+     * Multiple posts that happen before the waiter wakes up are coalesced into
+     * a single wake-up, so the caller should drain its queue completely.
+     * Only ONE thread can wait on the same RealTimeWakeup object.
+     * @return true if woken by post(), false on timeout
+     */
+    bool wait(std::chrono::microseconds timeout)
+    {
+        const Clock::time_point deadline = Clock::now() + timeout;
+
+        // 1. Bounded spin, cheap wake-ups while onsets are close together
+        for (uint32_t i = 0; i < spinBudget; ++i)
+        {
+            if (consume())
+            {
+                spinBudget = maxSpin;
+                return true;
+            }
+            cpuRelax();
+        }
+
+        // 2. Sleep with exponential backoff (or park on the futex)
+        std::chrono::microseconds sleepPeriod = minSleep;
+        while (true)
+        {
+            if (consume())
+            {
+                spinBudget = std::max(minSpin, spinBudget / 2);
+                return true;
+            }
+
+            const Clock::time_point now = Clock::now();
+            if (now >= deadline)
+            {
+                spinBudget = minSpin;
+                return false;
+            }
+            const auto remaining = std::chrono::duration_cast<std::chrono::microseconds>(deadline - now);
+
+           #if RTWAKEUP_USE_FUTEX
+            parkOnFutex(std::min(remaining, maxSleep));
+           #else
+            std::this_thread::sleep_for(std::min(sleepPeriod, remaining));
+            sleepPeriod = std::min(sleepPeriod * 2, maxSleep);
+           #endif
+        }
+    }
+
+    /** Number of posts so far (wraps around), mostly for testing */
+    uint32_t getPostCount() const noexcept
+    {
+        return sequence.load(std::memory_order_relaxed);
+    }
+
+private:
+    /** Return true if there was at least one post since the last consume */
+    bool consume() noexcept
+    {
+        const uint32_t current = sequence.load(std::memory_order_acquire);
+        if (current != lastSeen)
+        {
+            lastSeen = current;
+            return true;
+        }
+        return false;
+    }
+
+    static inline void cpuRelax() noexcept
+    {
+       #if defined(__x86_64__) || defined(__i386__)
+        _mm_pause();
+       #elif defined(__aarch64__) || defined(__arm__)
+        __asm__ __volatile__("yield");
+       #endif
+    }
+
+   #if RTWAKEUP_USE_FUTEX
+    void parkOnFutex(std::chrono::microseconds period)
+    {
+        struct timespec ts;
+        ts.tv_sec = period.count() / 1000000;
+        ts.tv_nsec = (period.count() % 1000000) * 1000;
+
+        parked.store(1, std::memory_order_seq_cst);
+        // The kernel re-checks the value atomically, a post between this check and the syscall is not lost
+        if (sequence.load(std::memory_order_seq_cst) == lastSeen)
+            syscall(SYS_futex, reinterpret_cast<uint32_t *>(&sequence), FUTEX_WAIT_PRIVATE, lastSeen, &ts, nullptr, 0);
+        parked.store(0, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint32_t> parked{0};
+   #endif
+
+    std::atomic<uint32_t> sequence{0};
+    uint32_t lastSeen = 0; // Only accessed by the waiting thread
+
+    const uint32_t minSpin, maxSpin;
+    uint32_t spinBudget;
+    const std::chrono::microseconds minSleep, maxSleep;
+};
@@ -0,0 +1,201 @@
+/*
+  ===================================================================================
+     Built-in classifier backend (USE_TID_NN), based on tid::nn (include/tidNN.hpp)
+
+     Same interface as the wrappers in libs/deep-classf-runtime-wrappers, so that
+     it can be selected like the TFLite/RTNeural/ONNX/TorchScript backends, but
+     with no external dependency.
+     The network architecture is defined at compile time (TidNNModel below) and
+     MUST match the exported model. Weights are loaded from either:
+     - a tidNN binary file (.bin, see tidNN.hpp), where only the number of
+       weights of each layer is checked
+     - an RTNeural json export (.json), whose layer types, sizes and activations
+       are checked against TidNNModel (createClassifier fails with the reason
+       if they differ). Flatten and dropout layers are skipped, since tid::nn
+       uses channels-last data, and activation layers are fused into the
+       previous layer
+     Only the configs of the models with this architecture have a "tidnn" entry
+     (modelA, 180 features). Change TidNNModel to use another model.
+
+     Author: Domenico Stefani (domenico.stefani96 AT gmail.com)
+  ===================================================================================
+*/
+#pragma once
+
+#include "tidNN.hpp"
+#include <JuceHeader.h>
+#include <fstream>
+#include <iostream>
+#include <memory>
+
+#ifndef TIDNN_INPUT_SIZE
+#define TIDNN_INPUT_SIZE 180 // Number of selected features (nRows*nCols of the feature matrix)
+#endif
+#ifndef TIDNN_OUTPUT_SIZE
+#define TIDNN_OUTPUT_SIZE 8 // Number of classes
+#endif
+
+namespace TidNN
+{
+using namespace tid::nn;
+
+// MLP used for the guitar technique classifier, change it to match the exported model
+using TidNNModel = Model<Dense<TIDNN_INPUT_SIZE, 100, ReLU>,
+                         Dense<100, 50, ReLU>,
+                         Dense<50, TIDNN_OUTPUT_SIZE, Softmax>>;
+
+/** Append all the numbers of a (possibly nested) json array, in row-major order */
+inline void flattenJsonArray(const juce::var &value, std::vector<float> &destination)
+{
+    if (value.isArray())
+        for (const juce::var &item : *value.getArray())
+            flattenJsonArray(item, destination);
+    else
+        destination.push_back((float)(double)value);
+}
+
+/** Product of the non-null dimensions of a Keras shape ([null, 180] or [null, 20, 32]) */
+inline std::size_t shapeSize(const juce::var &shape)
+{
+    std::size_t size = 1;
+    if (const juce::Array<juce::var> *dims = shape.getArray())
+        for (const juce::var &dim : *dims)
+            if (!dim.isVoid())
+                size *= (std::size_t)(int)dim;
+    return size;
+}
+
+/** Last dimension of a Keras shape (units of a Dense layer, filters of a Conv1D layer) */
+inline std::size_t lastDimension(const juce::var &shape)
+{
+    const juce::Array<juce::var> *dims = shape.getArray();
+    return (dims == nullptr || dims->isEmpty()) ? 0 : (std::size_t)(int)dims->getLast();
+}
+
+/**
+ * Load the weights of an RTNeural json export into the model.
+ * The architecture of the file (layer types, sizes, activations) is checked
+ * against TidNNModel, since a file with the same number of weights but a
+ * different layout would load silently and give wrong results.
+ * @throws std::invalid_argument if the file cannot be parsed or does not match TidNNModel
+ */
+inline void loadRTNeuralJson(TidNNModel &model, const std::string &path)
+{
+    juce::var parsedJson;
+    if (!juce::JSON::parse(juce::File(path).loadFileAsString(), parsedJson).wasOk())
+        throw std::invalid_argument("Error parsing the model json file at '" + path + "'");
+    const juce::Array<juce::var> *layers = parsedJson["layers"].getArray();
+    if (layers == nullptr)
+        throw std::invalid_argument("No 'layers' array in the model json file at '" + path + "'");
+
+    const std::string mismatch = "The model at '" + path + "' does not match TidNNModel (tidNNClassifier.h): ";
+    const std::size_t inSize = shapeSize(parsedJson["in_shape"]);
+    if (inSize != TidNNModel::inSize)
+        throw std::invalid_argument(mismatch + "it takes " + std::to_string(inSize) + " inputs, TidNNModel takes " +
+                                    std::to_string(TidNNModel::inSize));
+
+    std::size_t layerIdx = 0;
+    for (int i = 0; i < layers->size(); ++i)
+    {
+        const juce::var &layer = (*layers)[i];
+        const std::string type = layer["type"].toString().toStdString();
+        const juce::Array<juce::var> *weights = layer["weights"].getArray();
+        if (weights == nullptr || weights->size() == 0)
+        {
+            // flatten and dropout do not change a channels-last buffer, activations are checked with their layer
+            if (type == "flatten" || type == "dropout" || type == "activation")
+                continue;
+            throw std::invalid_argument(mismatch + "layer type '" + type + "' is not supported by tid::nn");
+        }
+        if (layerIdx >= TidNNModel::numLayers)
+            throw std::invalid_argument(mismatch + "it has more than " + std::to_string(TidNNModel::numLayers) +
+                                        " layers with weights");
+        const LayerInfo expected = TidNNModel::getLayerInfo(layerIdx);
+        const std::string layerName = "layer " + std::to_string(layerIdx) + " (" + type + ")";
+        if (type != expected.type)
+            throw std::invalid_argument(mismatch + layerName + " should be " + expected.type);
+        if (lastDimension(layer["shape"]) != expected.outChannels)
+            throw std::invalid_argument(mismatch + layerName + " has " + std::to_string(lastDimension(layer["shape"])) +
+                                        " outputs per step, TidNNModel has " + std::to_string(expected.outChannels));
+        if (type == "conv1d" && lastDimension(layer["kernel_size"]) != expected.kernelSize)
+            throw std::invalid_argument(mismatch + layerName + " has kernel size " +
+                                        std::to_string(lastDimension(layer["kernel_size"])) + ", TidNNModel has " +
+                                        std::to_string(expected.kernelSize));
+
+        // Activation of the layer itself, or of the activation layer that follows it
+        std::string activation = layer["activation"].toString().toStdString();
+        if (activation.empty())
+            activation = "linear";
+        if (i + 1 < layers->size() && (*layers)[i + 1]["type"].toString() == "activation")
+        {
+            if (activation != "linear")
+                throw std::invalid_argument(mismatch + layerName + " is followed by a second activation");
+            activation = (*layers)[i + 1]["activation"].toString().toStdString();
+        }
+        if (activation != expected.activation)
+            throw std::invalid_argument(mismatch + layerName + " has activation '" + activation +
+                                        "', TidNNModel has '" + expected.activation + "'");
+
+        if (weights->size() != 2)
+            throw std::invalid_argument(mismatch + layerName + " is expected to have a kernel and a bias");
+        std::vector<float> kernel, bias;
+        flattenJsonArray((*weights)[0], kernel);
+        flattenJsonArray((*weights)[1], bias);
+        model.setLayerWeights(layerIdx++, kernel, bias);
+    }
+    if (layerIdx != TidNNModel::numLayers)
+        throw std::invalid_argument(mismatch + "it has " + std::to_string(layerIdx) + " layers with weights, TidNNModel has " +
+                                    std::to_string(TidNNModel::numLayers));
+}
+} // namespace TidNN
+
+typedef TidNN::TidNNModel *ClassifierPtr;
+
+inline ClassifierPtr createClassifier(std::string modelPath, bool verbose = false)
+{
+    auto model = std::make_unique<TidNN::TidNNModel>();
+    try
+    {
+        if (juce::File(modelPath).hasFileExtension("json"))
+            TidNN::loadRTNeuralJson(*model, modelPath);
+        else
+        {
+            std::ifstream file(modelPath, std::ios::binary);
+            if (!file)
+                throw std::invalid_argument("Could not open the model file at '" + modelPath + "'");
+            model->loadBinary(file);
+        }
+    }
+    catch (const std::invalid_argument &e)
+    {
+        std::cerr << "tidNN: " << e.what() << std::endl;
+        return nullptr;
+    }
+    if (verbose)
+        std::cout << "tidNN model loaded from " << modelPath << " (" << TidNN::TidNNModel::numLayers << " layers)"
+                  << std::endl;
+    return model.release();
+}
+
+inline void deleteClassifier(ClassifierPtr classifier)
+{
+    delete classifier;
+}
+
+inline void classify(ClassifierPtr classifier, const float *input, size_t inputSize, float *output, size_t outputSize,
+                     bool verbose = false)
+{
+    if (inputSize != TidNN::TidNNModel::inSize || outputSize != TidNN::TidNNModel::outSize)
+        throw std::logic_error("tidNN: input/output sizes (" + std::to_string(inputSize) + "," +
+                               std::to_string(outputSize) + ") do not match TidNNModel");
+    classifier->forward(input, output);
+    if (verbose)
+        std::cout << "tidNN: classified, output[0] = " << output[0] << std::endl;
+}
+
+inline void classifyFlat2D(ClassifierPtr classifier, const float *input, size_t nRows, size_t nCols, float *output,
+                           size_t outputSize, bool verbose = false)
+{
+    // Row-major nRows x nCols is already the channels-last layout used by tid::nn
+    classify(classifier, input, nRows * nCols, output, outputSize, verbose);
+}
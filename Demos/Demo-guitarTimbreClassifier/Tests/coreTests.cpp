@@ -0,0 +1,1050 @@
+/*
+  Tests of the headless core library (TID_HEADLESS, no JUCE).
+  Built only from the top-level CMakeLists.txt, when FFTW is available.
+*/
+#include <gtest/gtest.h>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <vector>
+#include "attackTime.hpp"
+#include "bark.hpp"
+#include "barkSpec.hpp"
+#include "bfcc.hpp"
+#include "cepstrum.hpp"
+#include "knn.hpp"
+#include "mfcc.hpp"
+#include "peakSample.hpp"
+#include "zeroCrossing.hpp"
+#include "windowed_feature_extraction.h"
+#include "tidBatchExtractor.hpp"
+#include "tidReconfigurable.hpp"
+
+// The post onset timer of the demos, in its own namespace because its global int64 is ambiguous with juce::int64
+namespace demo
+{
+#include "../Source/postOnsetTimer.h"
+}
+
+static_assert(TID_HEADLESS, "The core tests are meant for the headless library");
+
+static float testSignal(long n)
+{
+    const long phase = n % 9600;
+    const float envelope = phase < 2400 ? std::exp(-phase / 400.0f) : 0.0f;
+    return envelope * std::sin(0.07f * n) + 0.001f * std::sin(0.3f * n);
+}
+
+TEST(CoreTest, rawStoreMatchesAudioBuffer)
+{
+    const unsigned int blockSize = 64;
+    tid::BarkSpec<float> rawBarkSpec(1024), bufferBarkSpec(1024);
+    tid::Mfcc<float> rawMfcc(1024), bufferMfcc(1024);
+    tid::ZeroCrossing<float> rawZeroCrossing(512), bufferZeroCrossing(512);
+    rawBarkSpec.prepare(48000, blockSize);
+    bufferBarkSpec.prepare(48000, blockSize);
+    rawMfcc.prepare(48000, blockSize);
+    bufferMfcc.prepare(48000, blockSize);
+    rawZeroCrossing.prepare(48000, blockSize);
+    bufferZeroCrossing.prepare(48000, blockSize);
+
+    AudioBuffer<float> buffer(2, blockSize);
+    long n = 0;
+    for (int block = 0; block < 40; ++block)
+    {
+        for (unsigned int i = 0; i < blockSize; ++i)
+            buffer.getWritePointer(1)[i] = testSignal(n++);
+        rawBarkSpec.store(buffer.getReadPointer(1), blockSize);
+        bufferBarkSpec.store(buffer, 1);
+        rawMfcc.store(buffer.getReadPointer(1), blockSize);
+        bufferMfcc.store(buffer, 1);
+        rawZeroCrossing.store(buffer.getReadPointer(1), blockSize);
+        bufferZeroCrossing.store(buffer, 1);
+    }
+    ASSERT_EQ(rawBarkSpec.compute(), bufferBarkSpec.compute());
+    ASSERT_EQ(rawMfcc.compute(), bufferMfcc.compute());
+    ASSERT_EQ(rawZeroCrossing.compute(), bufferZeroCrossing.compute());
+    ASSERT_THROW(bufferBarkSpec.store(buffer, 2), std::invalid_argument);
+}
+
+class OnsetCollector : public tid::Bark<float>::Listener
+{
+public:
+    void onsetDetected(tid::Bark<float>*, const tid::Bark<float>::OnsetEvent& event) override { events.push_back(event); }
+    std::vector<tid::Bark<float>::OnsetEvent> events;
+};
+
+/** Detect the onsets of 10 attacks, 200ms apart, with a sample-clock debounce */
+static std::vector<tid::Bark<float>::OnsetEvent> detectOnsets(int debounceMillis, bool earlyDetection = false)
+{
+    const unsigned int blockSize = 64;
+    tid::Bark<float> bark(1024, 128);
+    bark.prepare(48000, blockSize);
+    bark.setThresh(-1, 30);
+    bark.setDebounce(debounceMillis);
+    bark.setEarlyDetection(earlyDetection);
+    OnsetCollector collector;
+    bark.addListener(&collector);
+
+    std::vector<float> block(blockSize);
+    long n = 0;
+    while (n < 10 * 9600)
+    {
+        for (float& s : block)
+            s = testSignal(n++);
+        bark.store(block.data(), blockSize);
+    }
+    // Events stay queued until they are dispatched (fewer than the queue size here)
+    const size_t numDispatched = bark.dispatchOnsetEvents();
+    EXPECT_EQ(numDispatched, collector.events.size());
+    EXPECT_EQ(bark.getNumDroppedOnsetEvents(), 0u);
+    bark.removeListener(&collector);
+    return collector.events;
+}
+
+static int countOnsets(int debounceMillis)
+{
+    return (int)detectOnsets(debounceMillis).size();
+}
+
+TEST(CoreTest, realTimeLoggerPopsInLoggingOrder)
+{
+    tid::RealTimeLogger logger("test");
+    logger.logInfo("text 0");
+    logger.logBinary("binary {}", 1);
+    logger.logBinary("binary {}", 2);
+    logger.logInfo("text 3");
+    logger.logBinary("binary {}", 4);
+
+    const char* expected[] = {"text 0", "binary 1", "binary 2", "text 3", "binary 4"};
+    tid::RealTimeLogger::LogEntry entry;
+    long long previousTimestamp = 0;
+    for (const char* message : expected)
+    {
+        ASSERT_TRUE(logger.pop(entry));
+        ASSERT_STREQ(entry.message, message);
+        ASSERT_NE(entry.timestamp, 0);
+        ASSERT_GE(entry.timestamp, previousTimestamp);
+        previousTimestamp = entry.timestamp;
+    }
+    ASSERT_FALSE(logger.pop(entry));
+}
+
+TEST(CoreTest, attackTimeMatchesFullSearch)
+{
+    // Reference: the original search over the whole signal buffer (tIDLib::peakSample, tIDLib::findAttackStartSamp)
+    const uint32 blockSize = 64;
+    const unsigned long windowSize = 300;
+    tid::AttackTime<float> attackTime(windowSize);
+    attackTime.prepare(48000, blockSize);
+    attackTime.setMaxSearchRange(10);
+    attackTime.setNumSampsThresh(8);
+    const unsigned long range = attackTime.getMaxSearchRange();
+    std::vector<float> signalBuffer(range + blockSize, 0.0f);
+
+    for (long block = 0; block < 300; ++block)
+    {
+        if (block == 150)
+            attackTime.setSampMagThresh(0.02f);
+        std::vector<float> samples(blockSize);
+        for (uint32 i = 0; i < blockSize; ++i)
+            samples[i] = (block % 9 == 0) ? 0.0f : testSignal(block * blockSize + i) * (float)((block * 7 + i) % 5);
+        attackTime.store(samples.data(), samples.size());
+        signalBuffer.erase(signalBuffer.begin(), signalBuffer.begin() + blockSize);
+        signalBuffer.insert(signalBuffer.end(), samples.begin(), samples.end());
+
+        const unsigned long offsetSample = (unsigned long)(tIDLib::FEATURE_EXTRACTION_OFFSET * blockSize);
+        const unsigned long startSample = range + blockSize - offsetSample - windowSize - 1;
+        std::vector<float> analysis(signalBuffer.begin() + startSample, signalBuffer.begin() + startSample + windowSize);
+        unsigned long expectedPeak;
+        float peakVal;
+        tIDLib::peakSample(analysis, &expectedPeak, &peakVal);
+        expectedPeak += startSample;
+        std::vector<float> search(range);
+        for (unsigned long i = 0; i < range; ++i)
+            search[i] = signalBuffer[std::max<long>(0, (long)expectedPeak - (long)(range - 1 - i))];
+        const unsigned long start = tIDLib::findAttackStartSamp(search, attackTime.getSampMagThresh(), 8);
+
+        unsigned long peak, attackStart;
+        float value;
+        attackTime.compute(&peak, &attackStart, &value);
+        ASSERT_EQ(peak, expectedPeak);
+        if (start == ULONG_MAX)
+            ASSERT_EQ(value, -1.0f);
+        else
+        {
+            ASSERT_EQ(attackStart, expectedPeak - (range - start));
+            ASSERT_FLOAT_EQ(value, (range - start) / 48000.0 * 1000.0);
+        }
+    }
+}
+
+TEST(CoreTest, peakSampleAndZeroCrossingMatchFullScan)
+{
+    const uint32 blockSize = 64;
+    const unsigned long windowSize = 1000;
+    tid::PeakSample<float> peakSample(windowSize);
+    tid::ZeroCrossing<float> zeroCrossing(windowSize);
+    peakSample.prepare(48000, blockSize);
+    zeroCrossing.prepare(48000, blockSize);
+    std::vector<float> signalBuffer(windowSize + blockSize, 0.0f);
+
+    for (long block = 0; block < 200; ++block)
+    {
+        std::vector<float> samples(blockSize);
+        for (uint32 i = 0; i < blockSize; ++i)
+            samples[i] = (block % 7 == 0) ? 0.0f : std::round(4.0f * testSignal(block * blockSize + i)) / 4.0f;
+        peakSample.store(samples.data(), samples.size());
+        zeroCrossing.store(samples.data(), samples.size());
+        signalBuffer.erase(signalBuffer.begin(), signalBuffer.begin() + blockSize);
+        signalBuffer.insert(signalBuffer.end(), samples.begin(), samples.end());
+
+        const unsigned long offsetSample = (unsigned long)(tIDLib::FEATURE_EXTRACTION_OFFSET * blockSize);
+        const std::vector<float> window(signalBuffer.begin() + offsetSample, signalBuffer.begin() + offsetSample + windowSize);
+        const auto expectedPeak = std::max_element(window.begin(), window.end(),
+                                                   [](float a, float b) { return std::fabs(a) < std::fabs(b); });
+
+        float peak;
+        unsigned long peakIdx;
+        peakSample.compute(peak, peakIdx);
+        ASSERT_EQ(peak, std::fabs(*expectedPeak));
+        ASSERT_EQ(peakIdx, (unsigned long)(expectedPeak - window.begin()));
+        ASSERT_EQ(zeroCrossing.compute(), tIDLib::zeroCrossingRate(window));
+    }
+}
+
+TEST(CoreTest, barkDebounceOnSampleClock)
+{
+    const int onsets = countOnsets(100);
+    ASSERT_GE(onsets, 9);
+    ASSERT_LE(onsets, 10);
+    // A debounce longer than the distance between attacks skips every other attack
+    ASSERT_LE(countOnsets(300), onsets / 2 + 1);
+}
+
+TEST(CoreTest, barkOnsetEventsCarrySampleIndex)
+{
+    const std::vector<tid::Bark<float>::OnsetEvent> events = detectOnsets(100);
+    ASSERT_GE(events.size(), 2u);
+    for (size_t i = 0; i < events.size(); ++i)
+    {
+        ASSERT_GT(events[i].velocity, 0.0f);
+        ASSERT_GT(events[i].growth, 0.0f);
+        if (i > 0)
+        {
+            // Attacks are 9600 samples apart, reported with the resolution of a hop
+            const int64 distance = (int64)(events[i].sampleIndex - events[i - 1].sampleIndex);
+            ASSERT_NEAR((double)distance, 9600.0, 128.0);
+        }
+    }
+}
+
+TEST(CoreTest, growthMaskUpdateMatchesSeparatePasses)
+{
+    // Reference: the weighting, growth and mask passes of bark~, one after the other
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<float> uniform(0.0f, 2.0f);
+    for (unsigned short maskPeriods : {0, 1, 4})
+    {
+        const t_filterIdx numFilters = 51; // not a multiple of the SIMD width
+        const t_filterIdx loBin = 5, hiBin = 40;
+        std::vector<float> weights(numFilters), bandRange(numFilters), mask(numFilters, 0.0f), growth(numFilters);
+        std::vector<float> refMask(numFilters, 0.0f), refGrowth(numFilters);
+        std::vector<unsigned short> counters(numFilters, 0);
+        std::vector<unsigned int> refPeriods(numFilters, 0);
+        for (t_filterIdx i = 0; i < numFilters; ++i)
+        {
+            weights[i] = uniform(gen);
+            bandRange[i] = (i >= loBin && i <= hiBin) ? 1.0f : 0.0f;
+        }
+
+        for (int period = 0; period < 40; ++period)
+        {
+            std::vector<float> energy(numFilters);
+            for (float& e : energy)
+                e = uniform(gen) * (period % 7 == 0 ? 4.0f : 1.0f);
+
+            float totalGrowth, totalVel;
+            tIDLib::growthMaskUpdate(numFilters, energy.data(), weights.data(), bandRange.data(), mask.data(), counters.data(),
+                                     maskPeriods, 0.7f, growth.data(), totalGrowth, totalVel);
+
+            float refTotalGrowth = 0.0f, refTotalVel = 0.0f;
+            for (t_filterIdx i = 0; i < numFilters; ++i)
+                energy[i] *= weights[i];
+            for (t_filterIdx i = 0; i < numFilters; ++i)
+            {
+                refTotalVel += energy[i];
+                refGrowth[i] = 0.0f;
+                if (energy[i] > refMask[i])
+                    refGrowth[i] = energy[i] / (refMask[i] + 1.0e-15f) - 1.0f;
+                if (i >= loBin && i <= hiBin && refGrowth[i] > 0)
+                    refTotalGrowth += refGrowth[i];
+            }
+            for (t_filterIdx i = 0; i < numFilters; ++i)
+            {
+                if (energy[i] > refMask[i])
+                {
+                    refMask[i] = energy[i];
+                    refPeriods[i] = 0;
+                }
+                else if (++refPeriods[i] >= maskPeriods)
+                    refMask[i] *= 0.7f;
+            }
+
+            ASSERT_EQ(growth, refGrowth);
+            ASSERT_EQ(mask, refMask);
+            ASSERT_NEAR(totalGrowth, refTotalGrowth, 1e-5f * std::max(1.0f, refTotalGrowth));
+            ASSERT_NEAR(totalVel, refTotalVel, 1e-5f * std::max(1.0f, refTotalVel));
+        }
+    }
+}
+
+TEST(CoreTest, barkSpewModeReportsDoubleBufferedGrowth)
+{
+    const unsigned int blockSize = 128;
+    tid::Bark<float> bark(1024, 128);
+    bark.prepare(48000, blockSize);
+    bark.setSpewMode(true);
+
+    std::vector<float> block(blockSize);
+    long n = 0;
+    auto storeNext = [&]() {
+        for (float& s : block)
+            s = testSignal(n++);
+        return bark.store(block.data(), blockSize);
+    };
+
+    // In spew mode every hop is reported, alternating between the two growth buffers without copies
+    const tid::Bark<float>::GrowthData first = storeNext();
+    ASSERT_NE(first.getGrowth(), nullptr);
+    ASSERT_NE(first.getTotalGrowth(), nullptr);
+    const std::vector<float> firstValues = *first.getGrowth();
+    const tid::Bark<float>::GrowthData second = storeNext();
+    ASSERT_NE(second.getGrowth(), first.getGrowth());
+    ASSERT_EQ(*first.getGrowth(), firstValues); // The previous report is still readable
+    ASSERT_EQ(storeNext().getGrowth(), first.getGrowth());
+
+    bark.setSpewMode(false);
+    ASSERT_EQ(storeNext().getGrowth(), nullptr);
+}
+
+TEST(CoreTest, barkEarlyDetectionReportsEarlier)
+{
+    const std::vector<tid::Bark<float>::OnsetEvent> standard = detectOnsets(100);
+    const std::vector<tid::Bark<float>::OnsetEvent> early = detectOnsets(100, true);
+    ASSERT_EQ(early.size(), standard.size());
+    for (size_t i = 0; i < early.size(); ++i)
+    {
+        ASSERT_LT(early[i].sampleIndex, standard[i].sampleIndex);
+        ASSERT_EQ(standard[i].onsetIndex, standard[i].sampleIndex);
+        // Attacks start every 9600 samples, the estimate is within two early hops
+        const int64 attack = (int64)(early[i].onsetIndex + 4800) / 9600 * 9600;
+        ASSERT_NEAR((double)early[i].onsetIndex, (double)attack, 64.0);
+        ASSERT_LE(early[i].onsetIndex, early[i].sampleIndex);
+    }
+}
+
+/** Offline computeFrames() gives the same coefficients of compute() on the windows of a stream of blocks */
+template <class Module>
+static void checkComputeFramesMatchesCompute(Module& live, Module& offline)
+{
+    const size_t blockSize = 64, windowSize = live.getWindowSize();
+    live.prepare(48000, blockSize);
+    offline.prepare(48000, blockSize);
+    std::vector<float> signal(blockSize * 40);
+    for (size_t n = 0; n < signal.size(); ++n)
+        signal[n] = testSignal((long)n + 2000);
+
+    const size_t numBlocks = signal.size() / blockSize, numFrames = numBlocks - windowSize / blockSize + 1;
+    const std::vector<float> frames = offline.computeFrames(signal.data(), numFrames, blockSize);
+    ASSERT_EQ(frames.size(), numFrames * live.getNumFilters());
+    for (size_t block = 0; block < numBlocks; ++block)
+    {
+        live.store(signal.data() + block * blockSize, blockSize);
+        if (block + 1 < windowSize / blockSize)
+            continue;
+        const size_t frame = block + 1 - windowSize / blockSize;
+        const std::vector<float>& coefficients = live.compute();
+        ASSERT_TRUE(std::equal(coefficients.begin(), coefficients.end(), frames.begin() + frame * live.getNumFilters()));
+    }
+}
+
+TEST(CoreTest, batchedFilterbankAndDctMatchPerFrame)
+{
+    tid::Bfcc<float> liveBfcc(256, 0.5f), offlineBfcc(256, 0.5f);
+    checkComputeFramesMatchesCompute(liveBfcc, offlineBfcc);
+
+    tid::Mfcc<float> liveMfcc(256, 100), offlineMfcc(256, 100);
+    for (tid::Mfcc<float>* mfcc : {&liveMfcc, &offlineMfcc})
+    {
+        mfcc->setWindowFunction(tIDLib::WindowFunctionType::hann);
+        mfcc->setFilterOperation(tIDLib::FilterOperation::averageFilterEnergy);
+        mfcc->setNormalize(false);
+    }
+    checkComputeFramesMatchesCompute(liveMfcc, offlineMfcc);
+
+    // A number of frames that is not a multiple of the tile, with strides longer than the rows
+    tIDLib::DiscreteCosineTransform<float> dct;
+    dct.precomputeBasis(13);
+    std::vector<float> input(11 * 16), output(11 * 20, -1.0f);
+    for (size_t i = 0; i < input.size(); ++i)
+        input[i] = testSignal((long)i * 37);
+    dct.computeBatch(input.data(), 11, 16, output.data(), 20);
+    for (size_t f = 0; f < 11; ++f)
+    {
+        std::vector<float> frameIn(input.begin() + f * 16, input.begin() + f * 16 + 13), frameOut(13);
+        dct.compute(frameIn, frameOut);
+        ASSERT_TRUE(std::equal(frameOut.begin(), frameOut.end(), output.begin() + f * 20));
+        ASSERT_EQ(output[f * 20 + 13], -1.0f); // Padding of the rows untouched
+    }
+}
+
+ // Handles of the process-wide caches, for the lifetime test they share (see tidWindowTable.hpp)
+struct WindowTableCacheTraits
+{
+    using Handle = tid::WindowTable;
+    static tid::WindowTableCache& cache() { return tid::WindowTableCache::getInstance(); }
+    static size_t size() { return cache().getNumTables(); }
+    static void acquire(Handle& handle, int n) { handle.acquire(tIDLib::WindowFunctionType::hann, (unsigned long int)n); }
+};
+
+struct FilterbankCacheTraits
+{
+    using Handle = tid::SharedFilterbank;
+    static tid::FilterbankCache& cache() { return tid::FilterbankCache::getInstance(); }
+    static size_t size() { return cache().getNumFilterbanks(); }
+    static void acquire(Handle& handle, int n) { handle.acquire(tid::FilterbankScale::bark, 0.5f, (unsigned long int)n, tIDLib::SAMPLERATEDEFAULT); }
+};
+
+ #if TID_FFT_BACKEND == TID_FFT_BACKEND_FFTW
+struct FftwPlanCacheTraits
+{
+    struct Handle
+    {
+        Handle() : real(fftwf_alloc_real(2048)), complex(fftwf_alloc_complex(1025)) {}
+        ~Handle() { plan.reset(); fftwf_free(real); fftwf_free(complex); }
+        float* real;
+        fftwf_complex* complex;
+        tid::FftwPlan plan;
+    };
+    static tid::FftwPlanCache& cache() { return tid::FftwPlanCache::getInstance(); }
+    static size_t size() { return cache().getNumPlans(); }
+    static void acquire(Handle& handle, int n) { handle.plan.createRealToComplex(n, handle.real, handle.complex); }
+};
+using CacheTypes = ::testing::Types<WindowTableCacheTraits, FilterbankCacheTraits, FftwPlanCacheTraits>;
+ #else
+using CacheTypes = ::testing::Types<WindowTableCacheTraits, FilterbankCacheTraits>;
+ #endif
+
+template <typename Traits>
+class CacheTest : public ::testing::Test {};
+TYPED_TEST_SUITE(CacheTest, CacheTypes);
+
+TYPED_TEST(CacheTest, entriesAreSharedAndKeptUntilReleased)
+{
+    TypeParam::cache().releaseUnused();
+    const size_t numEntries = TypeParam::size();
+    {
+        typename TypeParam::Handle a, b;
+        TypeParam::acquire(a, 1000);
+        TypeParam::acquire(b, 1000);
+        EXPECT_EQ(TypeParam::size(), numEntries + 1); // One entry for both handles
+        TypeParam::acquire(b, 2000);
+        EXPECT_EQ(TypeParam::size(), numEntries + 2);
+        TypeParam::acquire(b, 1000); // Back to a key in use, nothing created
+        EXPECT_EQ(TypeParam::size(), numEntries + 2);
+    }
+    // Kept for the next handles until they are released
+    EXPECT_EQ(TypeParam::size(), numEntries + 2);
+    TypeParam::cache().releaseUnused();
+    EXPECT_EQ(TypeParam::size(), numEntries);
+}
+
+ #if TID_FFT_BACKEND == TID_FFT_BACKEND_FFTW
+TEST(CoreTest, fftwPlansAreSharedBetweenInstances)
+{
+    tid::FftwPlanCache& cache = tid::FftwPlanCache::getInstance();
+    cache.releaseUnused();
+    const size_t numPlans = cache.getNumPlans();
+    tid::Cepstrum<float> a(1000), b(1000);
+    EXPECT_EQ(cache.getNumPlans(), numPlans + 2); // One forward and one backward plan for both
+    a.prepare(48000, 64);
+    b.prepare(48000, 64);
+    for (long block = 0; block < 20; ++block)
+    {
+        std::vector<float> samples(64);
+        for (size_t i = 0; i < samples.size(); ++i)
+            samples[i] = testSignal(block * 64 + (long)i);
+        a.store(samples.data(), samples.size());
+        b.store(samples.data(), samples.size());
+    }
+    const std::vector<float> cepstrumA = a.compute();
+    ASSERT_EQ(cepstrumA, b.compute());
+}
+ #endif
+
+TEST(CoreTest, windowTablesAreSharedBetweenInstances)
+{
+    tid::WindowTableCache& cache = tid::WindowTableCache::getInstance();
+    cache.releaseUnused();
+    const size_t numTables = cache.getNumTables();
+    tid::BarkSpec<float> barkSpec(1000);
+    tid::Bfcc<float> bfcc(1000);
+    tid::Mfcc<float> mfcc(1000);
+    EXPECT_EQ(cache.getNumTables(), numTables + 1); // One blackman table for the three modules
+    bfcc.setWindowFunction(tIDLib::WindowFunctionType::hann);
+    mfcc.setWindowFunction(tIDLib::WindowFunctionType::rectangular); // No table
+    EXPECT_EQ(cache.getNumTables(), numTables + 2);
+
+    tid::WindowTable a, b;
+    a.acquire(tIDLib::WindowFunctionType::hann, 1000);
+    b.acquire(tIDLib::WindowFunctionType::hann, 1000);
+    ASSERT_EQ(a.data(), b.data());
+    ASSERT_EQ(reinterpret_cast<uintptr_t>(a.data()) % tid::WindowTableCache::TABLE_ALIGNMENT, 0u);
+    std::vector<float> hann(1000);
+    tIDLib::initHannWindow(hann);
+    ASSERT_TRUE(std::equal(hann.begin(), hann.end(), a.data()));
+    b.acquire(tIDLib::WindowFunctionType::rectangular, 1000);
+    ASSERT_EQ(b.data(), nullptr);
+}
+
+TEST(CoreTest, filterbanksAreSharedBetweenInstances)
+{
+    tid::FilterbankCache& cache = tid::FilterbankCache::getInstance();
+    cache.releaseUnused();
+    const size_t numFilterbanks = cache.getNumFilterbanks();
+    tid::BarkSpec<float> barkSpec(1000);
+    tid::Bfcc<float> bfcc(1000);
+    tid::Bark<float> bark(1000, 128, 0.5f);
+    EXPECT_EQ(cache.getNumFilterbanks(), numFilterbanks + 1); // One 0.5 Bark filterbank for the three modules
+    bfcc.createFilterbank(1.0f);
+    EXPECT_EQ(cache.getNumFilterbanks(), numFilterbanks + 2);
+    const size_t numCoefficients = bfcc.compute().size();
+    ASSERT_THROW(bfcc.createFilterbank(7.0f), std::invalid_argument);
+    EXPECT_EQ(bfcc.compute().size(), numCoefficients); // Previous filterbank kept
+
+    tid::SharedFilterbank a, b;
+    a.acquire(tid::FilterbankScale::bark, 0.5f, 1000, tIDLib::SAMPLERATEDEFAULT);
+    b.acquire(tid::FilterbankScale::bark, 0.5f, 1000, tIDLib::SAMPLERATEDEFAULT);
+    ASSERT_EQ(&a.getFilters(), &b.getFilters());
+    ASSERT_EQ((size_t)a.getNumFilters(), barkSpec.compute().size());
+    ASSERT_EQ(a.getFilterFreqs().size(), (size_t)a.getNumFilters() + 2);
+
+    // Binary search of the filter bins, same bins as a linear search (lowest on ties)
+    std::vector<float> binFreqs(513);
+    for (size_t i = 0; i < binFreqs.size(); ++i)
+        binFreqs[i] = tIDLib::bin2freq(i, 1024, 44100.0f);
+    std::mt19937 gen(3);
+    std::uniform_real_distribution<float> target(-100.0f, 23000.0f);
+    for (int t = 0; t < 2000; ++t)
+    {
+        const float freq = (t % 4 == 0) ? (binFreqs[t % 512] + binFreqs[t % 512 + 1]) * 0.5f : target(gen);
+        t_binIdx nearest = 0;
+        for (t_binIdx i = 1; i < binFreqs.size(); ++i)
+            if (std::fabs(binFreqs[i] - freq) < std::fabs(binFreqs[nearest] - freq))
+                nearest = i;
+        ASSERT_EQ(tIDLib::nearestBinIndex(freq, binFreqs, binFreqs.size()), nearest);
+    }
+}
+
+TEST(CoreTest, reconfigurableSwapsAtBlockBoundary)
+{
+    const unsigned int blockSize = 64;
+    tid::Reconfigurable<tid::Bfcc<float>> bfcc(1024, 0.5f);
+    tid::Bfcc<float> reference(1024, 0.5f);  // reconfigured in place, at the same blocks
+    bfcc.prepare(tIDLib::SAMPLERATEDEFAULT, blockSize, 1024 + blockSize);
+    reference.prepare(tIDLib::SAMPLERATEDEFAULT, blockSize);
+
+    std::mt19937 gen(5);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<float> block(blockSize);
+    auto storeBlocks = [&](int numBlocks) {
+        for (int b = 0; b < numBlocks; ++b)
+        {
+            for (float& s : block)
+                s = dist(gen);
+            bfcc.store(block.data(), blockSize);
+            reference.store(block.data(), blockSize);
+            ASSERT_EQ(bfcc.get().compute(), reference.compute());
+        }
+    };
+    storeBlocks(20);
+
+    // Applied to the standby, live at the next block with the history replayed
+    ASSERT_TRUE(bfcc.reconfigure([](tid::Bfcc<float>& b) { b.createFilterbank(1.0f); }));
+    ASSERT_FALSE(bfcc.isUpToDate());
+    reference.createFilterbank(1.0f);
+    storeBlocks(1);
+    ASSERT_TRUE(bfcc.isUpToDate());
+
+    // Queued while the previous swap is pending
+    ASSERT_TRUE(bfcc.reconfigure([](tid::Bfcc<float>& b) { b.setWindowFunction(tIDLib::WindowFunctionType::hann); }));
+    const bool normalize = !reference.getNormalize();
+    ASSERT_FALSE(bfcc.reconfigure([normalize](tid::Bfcc<float>& b) { b.setNormalize(normalize); }));
+    reference.setWindowFunction(tIDLib::WindowFunctionType::hann);
+    storeBlocks(1);
+    ASSERT_TRUE(bfcc.update());
+    reference.setNormalize(normalize);
+    storeBlocks(3);
+
+    // A change that throws is dropped, the module keeps its configuration
+    ASSERT_THROW(bfcc.reconfigure([](tid::Bfcc<float>& b) { b.createFilterbank(7.0f); }), std::invalid_argument);
+    ASSERT_TRUE(bfcc.isUpToDate());
+    ASSERT_EQ(bfcc.getLatest().getNormalize(), normalize);
+    storeBlocks(3);
+}
+
+// Counts the calls of the Reconfigurable
+struct ResetCounter
+{
+    void prepare(double, unsigned int) { ++resets; }
+    void reset() { ++resets; }
+    void store(const float*, size_t n) { stored += n; }
+    int resets = 0;
+    size_t stored = 0;
+    bool changed = false;
+};
+
+TEST(CoreTest, reconfigurableResetsOffTheAudioThread)
+{
+    tid::Reconfigurable<ResetCounter> counter;
+    counter.prepare(48000, 64, 128);
+    const std::vector<float> block(64, 0.0f);
+    for (int b = 0; b < 4; ++b)
+        counter.store(block.data(), block.size());
+
+    ASSERT_TRUE(counter.reconfigure([](ResetCounter& c) { c.changed = true; }));
+    const int resets = counter.getLatest().resets;  // prepare() and the reset when the change is applied
+    ASSERT_EQ(resets, 2);
+    ASSERT_EQ(counter.getLatest().stored, 0u);
+    counter.store(block.data(), block.size());
+    ASSERT_TRUE(counter.get().changed);
+    ASSERT_EQ(counter.get().resets, resets);  // Not by the audio thread, which only replays the history
+    ASSERT_EQ(counter.get().stored, 128u + 64u);
+}
+
+// Same configuration of Demo-ExtractAllFeatures
+using BatchTestExtractors = WFE::FeatureExtractors<704, true, true, true, true, true, true, true, true, 64, 4, 2, 2>;
+
+static void writeFloatWav(const std::string& path, const std::vector<float>& samples, uint32_t sampleRate)
+{
+    auto u32 = [](uint32_t v) { return std::string{(char)(v & 0xFF), (char)((v >> 8) & 0xFF), (char)((v >> 16) & 0xFF), (char)(v >> 24)}; };
+    auto u16 = [](uint32_t v) { return std::string{(char)(v & 0xFF), (char)((v >> 8) & 0xFF)}; };
+    const uint32_t dataSize = (uint32_t)(samples.size() * sizeof(float));
+    std::ofstream file(path, std::ios::binary);
+    file << "RIFF" << u32(36 + dataSize) << "WAVE"
+         << "fmt " << u32(16) << u16(3) << u16(1) << u32(sampleRate) << u32(sampleRate * 4) << u16(4) << u16(32)
+         << "data" << u32(dataSize);
+    file.write((const char*)samples.data(), dataSize);
+}
+
+/** The block loop of DemoProcessor::processBlock (Demo-ExtractAllFeatures, DO_DELAY_ONSET) with given onset blocks */
+static std::vector<float> realTimeFeatures(const std::vector<float>& samples, const std::vector<long>& onsetBlocks,
+                                           double sampleRate, float postOnsetDelayMs)
+{
+    auto featexts = std::make_unique<BatchTestExtractors>();
+    featexts->prepare(sampleRate, 64);
+    demo::PostOnsetTimer postOnsetTimer;
+    postOnsetTimer.prepare((int)sampleRate, 64);
+
+    std::vector<float> features;
+    AudioBuffer<float> buffer(1, 64);
+    for (long block = 0; block * 64 < (long)samples.size() || postOnsetTimer.isStarted(); ++block)
+    {
+        if (postOnsetTimer.isExpired())
+        {
+            features.resize(features.size() + BatchTestExtractors::getFeVectorSize());
+            featexts->computeFeatureVectors(features.data() + features.size() - BatchTestExtractors::getFeVectorSize());
+        }
+        for (long i = 0; i < 64; ++i)
+            buffer.getWritePointer(0)[i] = block * 64 + i < (long)samples.size() ? samples[block * 64 + i] : 0.0f;
+        featexts->storeAndCompute(buffer, 0);
+        if (std::find(onsetBlocks.begin(), onsetBlocks.end(), block) != onsetBlocks.end() && postOnsetTimer.isIdle())
+            postOnsetTimer.start(postOnsetDelayMs);
+        postOnsetTimer.updateTimer();
+    }
+    return features;
+}
+
+TEST(CoreTest, batchExtractionMatchesRealTimeLoop)
+{
+    const double sampleRate = 48000;
+    const float postOnsetDelayMs = 704 / sampleRate * 1000.0 - 7.7066666667; // As in Demo-ExtractAllFeatures
+
+    std::vector<std::vector<float>> signals(3);
+    for (size_t f = 0; f < signals.size(); ++f)
+        for (long n = 0; n < 12000 + 3000 * (long)f; ++n)
+            signals[f].push_back(testSignal(n + 100 * f));
+
+    // Onset at 0.2035s is ignored (it is during the post onset delay of the previous one), the last one is at the end of the file
+    const std::vector<std::vector<double>> onsetTimes = {{0.001, 0.2005, 0.2035}, {0.05, 0.2}, {0.01, 0.372}};
+
+    std::vector<tid::batch::Job> jobs;
+    for (size_t f = 0; f < signals.size(); ++f)
+    {
+        const std::string path = "batchTest" + std::to_string(f) + ".wav";
+        writeFloatWav(path, signals[f], (uint32_t)sampleRate);
+        jobs.push_back({path, onsetTimes[f]});
+    }
+    writeFloatWav("batchTestOtherRate.wav", signals[0], 44100);
+    jobs.push_back({"batchTestOtherRate.wav", {0.1}});
+    jobs.push_back({"batchTestMissing.wav", {0.1}});
+
+    tid::batch::Settings settings;
+    settings.sampleRate = sampleRate;
+    settings.postOnsetDelayMs = postOnsetDelayMs;
+    tid::batch::BatchExtractor<BatchTestExtractors> batch(settings, 2);
+    const std::vector<tid::batch::Result> results = batch.process(jobs);
+    ASSERT_EQ(results.size(), jobs.size());
+
+    for (size_t f = 0; f < signals.size(); ++f)
+    {
+        std::vector<long> onsetBlocks;
+        for (double t : onsetTimes[f])
+            onsetBlocks.push_back((long)std::floor(t * sampleRate) / 64);
+        const std::vector<float> expected = realTimeFeatures(signals[f], onsetBlocks, sampleRate, postOnsetDelayMs);
+
+        ASSERT_TRUE(results[f].error.empty()) << results[f].error;
+        ASSERT_EQ(results[f].path, jobs[f].path);
+        ASSERT_EQ(results[f].features.size(), results[f].getNumRows() * BatchTestExtractors::getFeVectorSize());
+        ASSERT_EQ(results[f].features, expected); // Exactly the same values
+    }
+    ASSERT_EQ(results[0].getNumRows(), 2u);
+    ASSERT_EQ(results[0].ignoredOnsets, 1u);
+    ASSERT_EQ(results[0].onsetBlocks, (std::vector<unsigned long>{0, 150}));
+    ASSERT_EQ(results[0].extractionBlocks, (std::vector<unsigned long>{5, 155}));
+    ASSERT_GT(results[2].extractionBlocks.back() * 64, signals[2].size()); // Completed with zeros after the end
+    ASSERT_FALSE(results[3].error.empty());
+    ASSERT_FALSE(results[4].error.empty());
+
+    for (const tid::batch::Job& job : jobs)
+        std::remove(job.path.c_str());
+}
+
+TEST(CoreTest, batchOnsetDetectionIsDeterministic)
+{
+    std::vector<float> signal;
+    for (long n = 0; n < 3 * 9600; ++n)
+        signal.push_back(testSignal(n));
+
+    tid::batch::Settings settings;
+    settings.detectOnsets = true;
+    settings.onsetDetector.debounceMillis = 100;
+    tid::batch::BatchExtractor<BatchTestExtractors> batch(settings, 2);
+    const tid::batch::Result first = batch.processSamples(signal.data(), signal.size(), {}, 0);
+    const tid::batch::Result second = batch.processSamples(signal.data(), signal.size(), {}, 1);
+    ASSERT_GE(first.getNumRows(), 2u);
+    ASSERT_LE(first.getNumRows(), 3u);
+    ASSERT_EQ(first.onsetBlocks, second.onsetBlocks);
+    ASSERT_EQ(first.features, second.features);
+}
+
+TEST(CoreTest, knnAndFeatureMatricesNpyRoundTrip)
+{
+    tid::KNNclassifier knn;
+    for (int i = 0; i < 6; ++i)
+        knn.trainModel({(float)i, 2.0f * i, -0.5f * i, i < 3 ? 1.0f : 10.0f});
+    knn.manualCluster(2, 0, 0, 2);
+    knn.manualCluster(2, 1, 3, 5);
+
+    ASSERT_TRUE(knn.writeNpzData("knnTest.npz"));
+    ASSERT_TRUE(knn.writeNpyData("knnTest.npy"));
+    knn.writeClustersNpy("knnTestLabels.npy");
+
+    tid::KNNclassifier fromNpz;
+    ASSERT_TRUE(fromNpz.readNpzData("knnTest.npz"));
+    tid::KNNclassifier fromNpy;
+    ASSERT_TRUE(fromNpy.readNpyData("knnTest.npy"));
+    fromNpy.readClustersNpy("knnTestLabels.npy");
+    ASSERT_EQ(fromNpz.getNumInstances(), 6u);
+    ASSERT_EQ(fromNpy.getNumInstances(), 6u);
+    for (unsigned int i = 0; i < 6; ++i)
+    {
+        ASSERT_EQ(fromNpz.getFeatureVec(i), knn.getFeatureVec(i));
+        ASSERT_EQ(fromNpy.getFeatureVec(i), knn.getFeatureVec(i));
+        ASSERT_EQ(fromNpz.getClusterMembership(i), i < 3 ? 0u : 1u);
+        ASSERT_EQ(fromNpy.getClusterMembership(i), i < 3 ? 0u : 1u);
+    }
+    ASSERT_EQ(std::get<0>(fromNpz.classifySample({4.2f, 8.4f, -2.1f, 10.0f})[0]), 1u);
+
+    // Labels that do not match the database are rejected
+    tid::npy::writeNpy("knnTestLabels.npy", std::vector<int32_t>{0, 2, 2, 2, 2, 2}, {6});
+    fromNpy.readClustersNpy("knnTestLabels.npy");
+    ASSERT_EQ(fromNpy.getClusterMembership(0), 0u);
+    ASSERT_EQ(fromNpy.getClusterMembership(5), 1u);
+
+    // Flat feature matrices of the windowed extractors
+    BatchTestExtractors featexts;
+    std::vector<float> matrices(3 * BatchTestExtractors::getFeVectorSize());
+    for (size_t i = 0; i < matrices.size(); ++i)
+        matrices[i] = std::sin(0.01f * i);
+    featexts.writeFeatureMatricesNpz("featuresTest.npz", matrices.data(), 3);
+    const tid::npy::Array read = BatchTestExtractors::readFeatureMatrices("featuresTest.npz");
+    ASSERT_EQ(read.getShape().size(), 3u);
+    ASSERT_EQ(read.getNumRows(), 3u);
+    ASSERT_EQ(read.toVector<float>(), matrices);
+    ASSERT_EQ(tid::npy::NpzFile("featuresTest.npz").get("feature_names").toStrings().size(), read.getShape()[2]);
+    ASSERT_THROW(BatchTestExtractors::readFeatureMatrices("knnTest.npy"), std::invalid_argument);
+
+    for (const char* path : {"knnTest.npz", "knnTest.npy", "knnTestLabels.npy", "featuresTest.npz"})
+        std::remove(path);
+}
+
+TEST(CoreTest, featureExtractorsArenaMatchesHeap)
+{
+    auto onHeap = std::make_unique<BatchTestExtractors>();
+    auto inArena = std::make_unique<BatchTestExtractors>();
+    inArena->setArenaEnabled(true);
+    onHeap->prepare(48000, 64);
+    inArena->prepare(44100, 64);
+    inArena->prepare(48000, 64); // laid out again, from the previous block
+
+    const BatchTestExtractors::MemoryFootprint footprint = inArena->getMemoryFootprint();
+    ASSERT_GT(footprint.bufferBytes, 0u);
+    ASSERT_EQ(footprint.arenaBytes, footprint.bufferBytes);
+    ASSERT_EQ(footprint.overflowBytes, 0u);
+    ASSERT_EQ(onHeap->getMemoryFootprint().bufferBytes, footprint.bufferBytes);
+    ASSERT_EQ(onHeap->getMemoryFootprint().arenaBytes, 0u);
+    ASSERT_GE(footprint.getTotalBytes(), footprint.objectBytes + footprint.bufferBytes);
+
+    AudioBuffer<float> buffer(1, 64);
+    std::vector<float> heapFeatures(BatchTestExtractors::getFeVectorSize()), arenaFeatures(heapFeatures.size());
+    for (long block = 0; block < 40; ++block)
+    {
+        for (long i = 0; i < 64; ++i)
+            buffer.getWritePointer(0)[i] = testSignal(block * 64 + i);
+        onHeap->storeAndCompute(buffer, 0);
+        inArena->storeAndCompute(buffer, 0);
+        if (block % 10 == 9)
+        {
+            onHeap->computeFeatureVectors(heapFeatures.data());
+            inArena->computeFeatureVectors(arenaFeatures.data());
+            ASSERT_EQ(heapFeatures, arenaFeatures);
+        }
+    }
+    ASSERT_EQ(inArena->getMemoryFootprint().overflowBytes, 0u);
+}
+
+/** Store the test signal into two modules and compare the results of compute() after every block */
+template <typename Dynamic, typename Fixed>
+static void expectSameResults(Dynamic& dynamic, Fixed& fixed, unsigned int blockSize = 64)
+{
+    dynamic.prepare(48000, blockSize);
+    fixed.prepare(48000, blockSize);
+    std::vector<float> block(blockSize);
+    for (long b = 0; b < 40; ++b)
+    {
+        for (long i = 0; i < (long)blockSize; ++i)
+            block[i] = testSignal(b * (long)blockSize + i);
+        dynamic.store(block.data(), block.size());
+        fixed.store(block.data(), block.size());
+        ASSERT_EQ(dynamic.compute(), fixed.compute());
+    }
+}
+
+TEST(CoreTest, fixedSizeModulesMatchDynamic)
+{
+    // Window tables computed at compile time
+    for (tIDLib::WindowFunctionType type : {tIDLib::blackman, tIDLib::cosine, tIDLib::hamming, tIDLib::hann})
+    {
+        tid::WindowTable shared;
+        shared.acquire(type, 1024);
+        const float* fixed = tid::fixed::getWindowTable<1024>(type);
+        ASSERT_TRUE(std::equal(fixed, fixed + 1024, shared.data()));
+    }
+    ASSERT_EQ(tid::fixed::getWindowTable<256>(tIDLib::rectangular), nullptr);
+
+    {
+        tid::BarkSpec<float> dynamic(256, 0.5f);
+        tid::BarkSpec<float, 256, 64> fixed(256, 0.5f);
+        expectSameResults(dynamic, fixed);
+    }
+    {
+        tid::BarkSpecBrightness<float> dynamic(256, 0.5f, 8.5f);
+        tid::BarkSpecBrightness<float, 256, 64> fixed(256, 0.5f, 8.5f);
+        expectSameResults(dynamic, fixed);
+    }
+    {
+        tid::Bfcc<float> dynamic(512, 0.5f);
+        tid::Bfcc<float, 512, 64> fixed(512, 0.5f);
+        dynamic.setWindowFunction(tIDLib::hann);
+        fixed.setWindowFunction(tIDLib::hann);
+        expectSameResults(dynamic, fixed);
+    }
+    {
+        tid::Mfcc<float> dynamic(256, 100.0f);
+        tid::Mfcc<float, 256, 64> fixed(256, 100.0f);
+        expectSameResults(dynamic, fixed);
+    }
+    {
+        tid::Cepstrum<float> dynamic(1024);
+        tid::Cepstrum<float, 1024, 64> fixed(1024);
+        dynamic.setWindowFunction(tIDLib::rectangular);
+        fixed.setWindowFunction(tIDLib::rectangular);
+        expectSameResults(dynamic, fixed);
+    }
+
+    ASSERT_THROW((tid::Bfcc<float, 256, 64>(512)), std::invalid_argument);
+    tid::Bfcc<float, 256, 64> bfcc(256);
+    ASSERT_THROW(bfcc.prepare(48000, 128), std::invalid_argument);
+    ASSERT_THROW(bfcc.setWindowSize(512), std::invalid_argument);
+    {
+        // Only the window size fixed, as in WFE::FeatureExtractors
+        tid::Bfcc<float> dynamic(256, 0.5f);
+        tid::Bfcc<float, 256> fixedWindow(256, 0.5f);
+        expectSameResults(dynamic, fixedWindow, 128);
+    }
+}
+
+TEST(CoreTest, featureExtractorsAcceptHostBlockSize)
+{
+    for (unsigned int blockSize : {32u, 128u})
+    {
+        auto featexts = std::make_unique<BatchTestExtractors>();
+        featexts->setArenaEnabled(true);
+        ASSERT_NO_THROW(featexts->prepare(48000, blockSize));
+        AudioBuffer<float> buffer(1, (int)blockSize);
+        for (long block = 0; block < 40; ++block)
+        {
+            for (long i = 0; i < (long)blockSize; ++i)
+                buffer.getWritePointer(0)[i] = testSignal(block * (long)blockSize + i);
+            featexts->storeAndCompute(buffer, 0);
+        }
+        std::vector<float> features(BatchTestExtractors::getFeVectorSize());
+        featexts->computeFeatureVectors(features.data());
+        for (float feature : features)
+            ASSERT_TRUE(std::isfinite(feature));
+        ASSERT_EQ(featexts->getMemoryFootprint().overflowBytes, 0u);
+    }
+}
+
+int main(int argc, char **argv){
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
+
+/** Signal of channel c: the test signal with attacks shifted and scaled per channel */
+static float channelSignal(unsigned int channel, long n)
+{
+    return (0.4f + 0.1f * channel) * testSignal(n + 1700 * (long)channel);
+}
+
+TEST(CoreTest, multiChannelModulesMatchSingleChannel)
+{
+    // 48000 Hz, not the default sample rate: every module acquires the filterbank for it in prepare()
+    const unsigned int numChannels = 6, blockSize = 64, windowSize = 1024;
+    tid::MultiBarkSpec<float> multiBarkSpec(numChannels, windowSize);
+    tid::MultiBfcc<float> multiBfcc(numChannels, windowSize);
+    tid::MultiZeroCrossing<float> multiZeroCrossing(numChannels, windowSize);
+    tid::MultiPeakSample<float> multiPeakSample(numChannels, 1000);
+    multiBarkSpec.prepare(48000, blockSize);
+    multiBfcc.prepare(48000, blockSize);
+    multiZeroCrossing.prepare(48000, blockSize);
+    multiPeakSample.prepare(48000, blockSize);
+
+    std::vector<std::unique_ptr<tid::BarkSpec<float>>> barkSpecs;
+    std::vector<std::unique_ptr<tid::Bfcc<float>>> bfccs;
+    std::vector<std::unique_ptr<tid::ZeroCrossing<float>>> zeroCrossings;
+    std::vector<std::unique_ptr<tid::PeakSample<float>>> peakSamples;
+    for (unsigned int c = 0; c < numChannels; ++c)
+    {
+        barkSpecs.emplace_back(new tid::BarkSpec<float>(windowSize));
+        bfccs.emplace_back(new tid::Bfcc<float>(windowSize));
+        zeroCrossings.emplace_back(new tid::ZeroCrossing<float>(windowSize));
+        peakSamples.emplace_back(new tid::PeakSample<float>(1000));
+        barkSpecs[c]->prepare(48000, blockSize);
+        bfccs[c]->prepare(48000, blockSize);
+        zeroCrossings[c]->prepare(48000, blockSize);
+        peakSamples[c]->prepare(48000, blockSize);
+    }
+
+    AudioBuffer<float> buffer(numChannels + 1, blockSize);
+    for (long block = 0; block < 120; ++block)
+    {
+        for (unsigned int c = 0; c < numChannels; ++c)
+        {
+            float* samples = buffer.getWritePointer(c + 1);
+            for (unsigned int i = 0; i < blockSize; ++i)
+                samples[i] = (block % 11 == c) ? 0.0f : channelSignal(c, block * blockSize + i);
+            barkSpecs[c]->store(samples, blockSize);
+            bfccs[c]->store(samples, blockSize);
+            zeroCrossings[c]->store(samples, blockSize);
+            peakSamples[c]->store(samples, blockSize);
+        }
+        multiBarkSpec.store(buffer, 1);
+        multiBfcc.store(buffer, 1);
+        multiZeroCrossing.store(buffer, 1);
+        multiPeakSample.store(buffer, 1);
+        if (block % 5 != 0)
+            continue;
+
+        const std::vector<std::vector<float>>& barkSpectra = multiBarkSpec.compute();
+        const std::vector<std::vector<float>>& cepstra = multiBfcc.compute();
+        const std::vector<uint32>& crossings = multiZeroCrossing.compute();
+        float peaks[tIDLib::INTERLEAVEDLANES];
+        unsigned long peakIdx[tIDLib::INTERLEAVEDLANES];
+        multiPeakSample.compute(peaks, peakIdx);
+        for (unsigned int c = 0; c < numChannels; ++c)
+        {
+            ASSERT_EQ(barkSpectra[c], barkSpecs[c]->compute());
+            ASSERT_EQ(cepstra[c], bfccs[c]->compute());
+            ASSERT_EQ(crossings[c], zeroCrossings[c]->compute());
+            float peak;
+            unsigned long index;
+            peakSamples[c]->compute(peak, index);
+            ASSERT_EQ(peaks[c], peak);
+            ASSERT_EQ(peakIdx[c], index);
+        }
+    }
+    ASSERT_THROW(multiBarkSpec.store(buffer, 2), std::invalid_argument);
+    ASSERT_THROW(tid::MultiBfcc<float>(tIDLib::INTERLEAVEDLANES + 1), std::invalid_argument);
+}
+
+TEST(CoreTest, multiChannelBarkMatchesSingleChannel)
+{
+    const unsigned int numChannels = 6, blockSize = 64;
+    tid::MultiBark<float> multiBark(numChannels, 1024, 128);
+    multiBark.prepare(48000, blockSize);
+    multiBark.setThresh(-1, 30);
+    std::vector<std::unique_ptr<tid::Bark<float>>> barks;
+    for (unsigned int c = 0; c < numChannels; ++c)
+    {
+        barks.emplace_back(new tid::Bark<float>(1024, 128));
+        barks[c]->prepare(48000, blockSize);
+        barks[c]->setThresh(-1, 30);
+    }
+
+    std::vector<std::vector<float>> blocks(numChannels, std::vector<float>(blockSize));
+    std::vector<const float*> channels;
+    for (const std::vector<float>& block : blocks)
+        channels.push_back(block.data());
+    std::vector<std::vector<uint64>> expected(numChannels), detected(numChannels);
+    long n = 0;
+    while (n < 6 * 9600)
+    {
+        for (unsigned int c = 0; c < numChannels; ++c)
+            for (unsigned int i = 0; i < blockSize; ++i)
+                blocks[c][i] = channelSignal(c, n + i);
+        n += blockSize;
+        multiBark.store(channels.data(), blockSize);
+        for (unsigned int c = 0; c < numChannels; ++c)
+        {
+            barks[c]->store(blocks[c].data(), blockSize);
+            tid::Bark<float>::OnsetEvent event;
+            while (barks[c]->popOnsetEvent(event))
+                expected[c].push_back(event.sampleIndex);
+        }
+        tid::MultiBark<float>::OnsetEvent event;
+        while (multiBark.popOnsetEvent(event))
+            detected[event.channel].push_back(event.sampleIndex);
+    }
+    for (unsigned int c = 0; c < numChannels; ++c)
+    {
+        ASSERT_GE(expected[c].size(), 4u);
+        ASSERT_EQ(detected[c], expected[c]);
+    }
+}
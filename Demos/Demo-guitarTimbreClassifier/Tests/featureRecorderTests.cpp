@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+#include "../../Demo-ExtractAllFeatures/Source/feature_recorder.h"
+
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+static std::vector<std::string> readLines(const std::string &path)
+{
+    std::ifstream file(path);
+    std::vector<std::string> lines;
+    for (std::string line; std::getline(file, line);)
+        lines.push_back(line);
+    return lines;
+}
+
+TEST(FeatureRecorderTest, streamsMoreEntriesThanTheRing)
+{
+    FeatureRecorder<3, 64> recorder;
+    recorder.start("recorderTest.tidf", {"a", "b", "c"});
+
+    // Many more entries than the ring holds, the writer thread keeps up since we wait when the ring is full
+    const int numEntries = 1000;
+    for (int i = 0; i < numEntries;)
+    {
+        Entry<3> *entry = recorder.entryToWrite();
+        if (entry == nullptr)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+            continue;
+        }
+        if (i == 500)
+            entry->writeMessage("Special");
+        for (int j = 0; j < 3; ++j)
+            entry->features[j] = i + j * 0.5f;
+        entry->onsetDetectionTime = i;
+        entry->featureComputationTime = i + 64;
+        entry->featureExtractionWindowSize = 704;
+        entry->sampleRate = 48000;
+        entry->blockSize = 64;
+        recorder.confirmEntry();
+        ++i;
+    }
+
+    recorder.writeToFile("recorderTest.csv", 8);
+    ASSERT_EQ(recorder.getNumWritten(), (uint64_t)numEntries);
+
+    const std::vector<std::string> lines = readLines("recorderTest.csv");
+    ASSERT_EQ(lines.size(), (size_t)numEntries + 1);
+    ASSERT_EQ(lines[0], "onsetDetectionTime,featureComputationTime,featureExtractionWindowSize,sampleRate,blockSize,a,b,c");
+    ASSERT_EQ(lines[1], "0,64,704,48000,64,0,0.5,1");
+    ASSERT_EQ(lines[11], "10,74,704,48000,64,10,10.5,11");
+    ASSERT_EQ(lines[501], "500,564,704,48000,64,Special");
+
+    // Clear discards the recording, new entries start a new one
+    recorder.clearEntries();
+    Entry<3> *entry = recorder.entryToWrite();
+    ASSERT_NE(entry, nullptr);
+    entry->features[0] = 7.0f;
+    entry->featureExtractionWindowSize = entry->sampleRate = entry->blockSize = 1;
+    recorder.confirmEntry();
+    recorder.stop();
+    ASSERT_EQ(recorder.getNumWritten(), 1u);
+    ASSERT_EQ(recorder.entryToWrite(), nullptr); // Not recording
+    using Recorder = FeatureRecorder<3, 64>;
+    ASSERT_EQ(Recorder::convertToCsv("recorderTest.tidf", "recorderTest.csv", 8), 1u);
+    ASSERT_EQ(readLines("recorderTest.csv")[1], "0,0,1,1,1,7,0,0");
+
+    std::remove("recorderTest.tidf");
+    std::remove("recorderTest.csv");
+}
+
+TEST(FeatureRecorderTest, dropsWhenTheRingIsFull)
+{
+    FeatureRecorder<1, 4> recorder;
+    ASSERT_EQ(recorder.entryToWrite(), nullptr); // Not started
+    recorder.start("recorderDropTest.tidf", {"x"});
+    // Without waiting, at least the entries beyond the ring size may be dropped, never blocking
+    int accepted = 0;
+    for (int i = 0; i < 100; ++i)
+        if (Entry<1> *entry = recorder.entryToWrite())
+        {
+            entry->features[0] = (float)i;
+            recorder.confirmEntry();
+            ++accepted;
+        }
+    recorder.stop();
+    ASSERT_EQ(recorder.getNumWritten(), (uint64_t)accepted);
+    ASSERT_EQ(recorder.getNumDropped(), (uint64_t)(100 - accepted));
+    std::remove("recorderDropTest.tidf");
+}
+
+TEST(FeatureRecorderTest, writerErrorStopsTheRecording)
+{
+    FeatureRecorder<1, 4> recorder;
+    recorder.start("recorderErrorTest.tidf", {"x"});
+    // The file can't be reopened by clearEntries(): a directory takes its place
+    std::remove("recorderErrorTest.tidf");
+    std::filesystem::create_directory("recorderErrorTest.tidf");
+
+    ASSERT_THROW(recorder.clearEntries(), std::runtime_error);
+    ASSERT_FALSE(recorder.isRecording());
+    ASSERT_FALSE(recorder.getError().empty());
+    ASSERT_EQ(recorder.entryToWrite(), nullptr);
+    ASSERT_THROW(recorder.writeToFile("recorderErrorTest.csv", 8), std::runtime_error);
+    recorder.stop();
+
+    std::filesystem::remove("recorderErrorTest.tidf");
+    std::remove("recorderErrorTest.csv");
+}
@@ -0,0 +1,86 @@
+/*
+  Latency of the FFT backends (include/tidFft.hpp) at the sizes of the modules
+
+  Times the forward real FFT of the built-in backend (tid::fft::RealFft) and,
+  when the library is built with the FFTW backend, of FFTW with estimated and
+  measured plans. Sizes are the window sizes of the demos and of
+  Benchmark-extractors (256 is the window of WFE::FeatureExtractors, 704 a
+  non power-of-two one), plus the time to create a plan.
+
+  Usage: fftBenchmark [iterations]
+*/
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+#include "tidFft.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+static double elapsedNs(Clock::time_point start, Clock::time_point end)
+{
+    return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+/** Median time of one call of execute, in ns */
+template <typename ExecuteFunction>
+static double medianNs(int iterations, ExecuteFunction execute)
+{
+    for (int i = 0; i < 100; ++i) // Warm-up
+        execute();
+    std::vector<double> samples;
+    for (int r = 0; r < 15; ++r)
+    {
+        const auto start = Clock::now();
+        for (int i = 0; i < iterations; ++i)
+            execute();
+        samples.push_back(elapsedNs(start, Clock::now()) / iterations);
+    }
+    std::sort(samples.begin(), samples.end());
+    return samples[samples.size() / 2];
+}
+
+int main(int argc, char* argv[])
+{
+    const int iterations = argc > 1 ? std::max(1, std::atoi(argv[1])) : 2000;
+
+    std::printf("%6s %14s %14s", "size", "builtin [ns]", "plan [us]");
+ #if TID_FFT_BACKEND == TID_FFT_BACKEND_FFTW
+    std::printf(" %14s %14s %14s %14s", "estimate [ns]", "plan [us]", "measure [ns]", "plan [us]");
+ #endif
+    std::printf("\n");
+
+    std::mt19937 gen(1);
+    std::uniform_real_distribution<float> noise(-1.0f, 1.0f);
+    for (int n : {64, 128, 256, 512, 704, 1024, 2048, 4096, 8192})
+    {
+        std::vector<float> input(n);
+        for (float& v : input)
+            v = noise(gen);
+        tid::fft::Complex* spectrum = tid::fft::allocComplex(n / 2 + 1);
+
+        tid::BuiltinFftPlan builtin;
+        auto start = Clock::now();
+        builtin.createRealToComplex(n, input.data(), spectrum);
+        const double builtinPlanUs = elapsedNs(start, Clock::now()) / 1000.0;
+        std::printf("%6d %14.1f %14.1f", n, medianNs(iterations, [&] { builtin.execute(); }), builtinPlanUs);
+
+ #if TID_FFT_BACKEND == TID_FFT_BACKEND_FFTW
+        tid::FftwPlanCache& cache = tid::FftwPlanCache::getInstance();
+        for (unsigned int flags : {(unsigned int)FFTW_ESTIMATE, (unsigned int)FFTW_MEASURE})
+        {
+            cache.setPlannerFlags(flags);
+            tid::FftwPlan fftw;
+            start = Clock::now();
+            fftw.createRealToComplex(n, input.data(), spectrum);
+            const double planUs = elapsedNs(start, Clock::now()) / 1000.0;
+            std::printf(" %14.1f %14.1f", medianNs(iterations, [&] { fftw.execute(); }), planUs);
+        }
+ #endif
+        std::printf("\n");
+        tid::fft::freeComplex(spectrum);
+    }
+    return 0;
+}
@@ -0,0 +1,105 @@
+#include <gtest/gtest.h>
+#include <cmath>
+#include <complex>
+#include <random>
+#include <vector>
+#include "tidRealFft.hpp"
+
+using tid::fft::RealFft;
+
+static std::vector<float> randomSignal(size_t size, unsigned int seed)
+{
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<float> res(size);
+    for (float &v : res)
+        v = dist(gen);
+    return res;
+}
+
+// Power-of-two sizes (split real FFT), the others use Bluestein
+static const size_t TEST_SIZES[] = {1, 2, 3, 4, 5, 8, 16, 64, 100, 256, 704, 1000, 1024, 4096};
+
+TEST(TidFftTest, forwardMatchesDft)
+{
+    for (size_t n : TEST_SIZES)
+    {
+        const std::vector<float> x = randomSignal(n, (unsigned int)n);
+        RealFft fft;
+        fft.prepare(n);
+        std::vector<float> spectrum(2 * (n / 2 + 1));
+        fft.forward(x.data(), spectrum.data());
+
+        for (size_t k = 0; k <= n / 2; ++k)
+        {
+            std::complex<double> expected = 0.0;
+            for (size_t t = 0; t < n; ++t)
+                expected += (double)x[t] * std::polar(1.0, -2.0 * M_PI * (double)((k * t) % n) / (double)n);
+            // Error relative to the energy of the signal (about sqrt(n))
+            ASSERT_NEAR(spectrum[2 * k], expected.real(), 2e-6 * n) << "n = " << n << ", k = " << k;
+            ASSERT_NEAR(spectrum[2 * k + 1], expected.imag(), 2e-6 * n) << "n = " << n << ", k = " << k;
+        }
+    }
+}
+
+TEST(TidFftTest, inverseIsUnnormalized)
+{
+    for (size_t n : TEST_SIZES)
+    {
+        const std::vector<float> x = randomSignal(n, (unsigned int)n + 1);
+        RealFft fft;
+        fft.prepare(n);
+        std::vector<float> spectrum(2 * (n / 2 + 1)), y(n);
+        fft.forward(x.data(), spectrum.data());
+
+        // Like FFTW's complex to real, the imaginary parts of DC and Nyquist are ignored
+        spectrum[1] = 123.0f;
+        if (n % 2 == 0)
+            spectrum[n + 1] = -45.0f;
+        fft.inverse(spectrum.data(), y.data());
+        for (size_t t = 0; t < n; ++t)
+            ASSERT_NEAR(y[t] / n, x[t], 2e-6f) << "n = " << n << ", t = " << t;
+    }
+}
+
+TEST(TidFftTest, interleavedMatchesRealFft)
+{
+    const size_t L = tid::fft::InterleavedRealFft::LANES;
+    for (size_t n : {2, 4, 8, 16, 64, 256, 1024, 4096})
+        for (unsigned int numSignals : {1u, 3u, 4u, 5u, 8u})
+            for (bool magnitude : {false, true})
+            {
+                tid::fft::InterleavedRealFft multiFft;
+                multiFft.prepare(n, numSignals);
+                const size_t lanes = multiFft.getNumLanes();
+                std::vector<std::vector<float>> signals;
+                std::vector<float> input(n * lanes, 0.0f), output((n / 2 + 1) * L, -1.0f);
+                for (unsigned int c = 0; c < numSignals; ++c)
+                {
+                    signals.push_back(randomSignal(n, (unsigned int)(n + c)));
+                    for (size_t t = 0; t < n; ++t)
+                        input[t * lanes + c] = signals[c][t];
+                }
+                multiFft.forwardPower(input.data(), output.data(), magnitude);
+
+                // Exactly the power (or magnitude) of the spectrum of RealFft
+                RealFft fft;
+                fft.prepare(n);
+                std::vector<float> spectrum(2 * (n / 2 + 1));
+                for (unsigned int c = 0; c < numSignals; ++c)
+                {
+                    fft.forward(signals[c].data(), spectrum.data());
+                    for (size_t k = 0; k <= n / 2; ++k)
+                    {
+                        float expected = spectrum[2 * k] * spectrum[2 * k] + spectrum[2 * k + 1] * spectrum[2 * k + 1];
+                        if (magnitude)
+                            expected = std::sqrt(expected);
+                        ASSERT_EQ(output[k * L + c], expected) << "n = " << n << ", signal " << c << ", k = " << k;
+                    }
+                }
+            }
+
+    tid::fft::InterleavedRealFft multiFft;
+    ASSERT_THROW(multiFft.prepare(1000, 4), std::invalid_argument);
+    ASSERT_THROW(multiFft.prepare(1024, L + 1), std::invalid_argument);
+}
@@ -0,0 +1,205 @@
+/*
+  Inference latency of tid::nn (include/tidNN.hpp) on the classifier shapes
+
+  nnBenchmark compares the compile-time sized tid::nn models against a
+  straightforward runtime-sized implementation (per-layer std::vector buffers,
+  scalar loops) on random weights.
+
+  nnBenchmark-<backend> (built when the corresponding NN_BENCHMARK_<BACKEND>_DIR
+  is given to CMake, see CMakeLists.txt) compares tid::nn with one of the
+  interpreter wrappers of the demo (libs/deep-classf-runtime-wrappers) on the
+  same model: the wrapper loads its own export (.tflite, .onnx, .pt, RTNeural
+  .json) and tid::nn the tidNN binary of the same weights. Both run the same
+  classifyFlat2D call as the classification thread of the demo, on the same
+  input, and the largest difference between the outputs is reported.
+
+  Usage: nnBenchmark [iterations]
+         nnBenchmark-<backend> <wrapper model> <tidnn .bin model> [iterations]
+*/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+#include "tidNN.hpp"
+
+#ifdef TIDNN_BENCHMARK_WRAPPER // Same wrapper headers as the demo (PluginProcessor.h)
+#if defined(USE_TFLITE)
+#include "tflitewrapper.h"
+#elif defined(USE_RTNEURAL_CTIME) || defined(USE_RTNEURAL_RTIME)
+#include "rtneuralwrapper.h"
+#elif defined(USE_ONNX)
+#include "onnxwrapper.h"
+#elif defined(USE_TORCHSCRIPT)
+#include "torch-classifier-lib.h"
+#else
+#error "TIDNN_BENCHMARK_WRAPPER requires one of USE_TFLITE, USE_RTNEURAL_CTIME, USE_RTNEURAL_RTIME, USE_ONNX, USE_TORCHSCRIPT"
+#endif
+#include <fstream>
+#endif
+
+using namespace tid::nn;
+using Clock = std::chrono::steady_clock;
+
+struct RuntimeLayer
+{
+    bool conv;
+    std::size_t inLength, inChannels, outChannels, kernelSize; // Dense: inLength = 1, kernelSize = 1
+    int activation;                                            // 0 identity, 1 relu, 2 softmax
+    std::vector<float> kernel, bias;                           // Keras order
+};
+
+/** Reference: runtime sizes, allocating output buffers, scalar loops in Keras weight order */
+static std::vector<float> runtimeForward(const std::vector<RuntimeLayer> &layers, std::vector<float> x)
+{
+    for (const RuntimeLayer &l : layers)
+    {
+        const std::size_t outLength = l.inLength - l.kernelSize + 1;
+        std::vector<float> y(outLength * l.outChannels);
+        for (std::size_t t = 0; t < outLength; ++t)
+            for (std::size_t o = 0; o < l.outChannels; ++o)
+            {
+                float sum = l.bias[o];
+                for (std::size_t k = 0; k < l.kernelSize; ++k)
+                    for (std::size_t c = 0; c < l.inChannels; ++c)
+                        sum += x[(t + k) * l.inChannels + c] * l.kernel[(k * l.inChannels + c) * l.outChannels + o];
+                y[t * l.outChannels + o] = sum;
+            }
+        if (l.activation == 1)
+            ReLU::apply(y.data(), y.size());
+        else if (l.activation == 2)
+            Softmax::apply(y.data(), y.size());
+        x = std::move(y);
+    }
+    return x;
+}
+
+static void report(const char *label, std::vector<double> &times)
+{
+    std::sort(times.begin(), times.end());
+    std::printf("  %-22s p50 %9.2fus  p99 %9.2fus\n", label, times[times.size() / 2], times[(times.size() * 99) / 100]);
+}
+
+static std::vector<float> randomVector(std::size_t size, std::mt19937 &gen)
+{
+    std::uniform_real_distribution<float> dist(-0.5f, 0.5f);
+    std::vector<float> res(size);
+    for (float &v : res)
+        v = dist(gen);
+    return res;
+}
+
+template <typename ModelType>
+static void run(const char *name, std::vector<RuntimeLayer> layers, int iterations)
+{
+    std::mt19937 gen(42);
+    auto model = std::make_unique<ModelType>();
+    for (std::size_t l = 0; l < layers.size(); ++l)
+    {
+        RuntimeLayer &layer = layers[l];
+        layer.kernel = randomVector(layer.kernelSize * layer.inChannels * layer.outChannels, gen);
+        layer.bias = randomVector(layer.outChannels, gen);
+        model->setLayerWeights(l, layer.kernel, layer.bias);
+    }
+    const std::vector<float> input = randomVector(ModelType::inSize, gen);
+    std::vector<float> output(ModelType::outSize);
+
+    std::vector<double> tidTimes, runtimeTimes;
+    double maxError = 0.0;
+    for (int i = 0; i < iterations; ++i)
+    {
+        auto t0 = Clock::now();
+        model->forward(input.data(), output.data());
+        auto t1 = Clock::now();
+        std::vector<float> reference = runtimeForward(layers, input);
+        auto t2 = Clock::now();
+        tidTimes.push_back(std::chrono::duration<double, std::micro>(t1 - t0).count());
+        runtimeTimes.push_back(std::chrono::duration<double, std::micro>(t2 - t1).count());
+        for (std::size_t o = 0; o < output.size(); ++o)
+            maxError = std::max(maxError, (double)std::fabs(output[o] - reference[o]));
+    }
+
+    std::printf("%s (max abs difference %.2e)\n", name, maxError);
+    report("tid::nn", tidTimes);
+    report("runtime reference", runtimeTimes);
+}
+
+#ifdef TIDNN_BENCHMARK_WRAPPER
+/** Model A (MLP on the 180 selected features, one row), same layout as TidNNModel in tidNNClassifier.h */
+using ModelA = Model<Dense<180, 100, ReLU>, Dense<100, 50, ReLU>, Dense<50, 8, Softmax>>;
+
+static int runWrapper(const char *wrapperModelPath, const char *tidnnModelPath, int iterations)
+{
+    auto model = std::make_unique<ModelA>();
+    std::ifstream file(tidnnModelPath, std::ios::binary);
+    if (!file)
+    {
+        std::fprintf(stderr, "Could not open the tidNN model at '%s'\n", tidnnModelPath);
+        return 1;
+    }
+    model->loadBinary(file);
+    ClassifierPtr classifier = createClassifier(wrapperModelPath, false);
+    if (classifier == nullptr)
+    {
+        std::fprintf(stderr, "The wrapper could not load the model at '%s'\n", wrapperModelPath);
+        return 1;
+    }
+
+    std::mt19937 gen(42);
+    const std::vector<float> input = randomVector(ModelA::inSize, gen);
+    std::vector<float> tidOutput(ModelA::outSize), wrapperOutput(ModelA::outSize);
+    std::vector<double> tidTimes, wrapperTimes;
+    double maxError = 0.0;
+    for (int i = 0; i < iterations; ++i)
+    {
+        auto t0 = Clock::now();
+        model->forward(input.data(), tidOutput.data());
+        auto t1 = Clock::now();
+        classifyFlat2D(classifier, input.data(), 1, ModelA::inSize, wrapperOutput.data(), ModelA::outSize, false);
+        auto t2 = Clock::now();
+        tidTimes.push_back(std::chrono::duration<double, std::micro>(t1 - t0).count());
+        wrapperTimes.push_back(std::chrono::duration<double, std::micro>(t2 - t1).count());
+        for (std::size_t o = 0; o < ModelA::outSize; ++o)
+            maxError = std::max(maxError, (double)std::fabs(tidOutput[o] - wrapperOutput[o]));
+    }
+    deleteClassifier(classifier);
+
+    std::printf("MLP 180-100-50-8 (max abs difference %.2e)\n", maxError);
+    report("tid::nn", tidTimes);
+    report("wrapper", wrapperTimes);
+    return 0;
+}
+#endif
+
+int main(int argc, char **argv)
+{
+#ifdef TIDNN_BENCHMARK_WRAPPER
+    if (argc < 3)
+    {
+        std::fprintf(stderr, "Usage: %s <wrapper model> <tidnn .bin model> [iterations]\n", argv[0]);
+        return 1;
+    }
+    return runWrapper(argv[1], argv[2], argc > 3 ? std::atoi(argv[3]) : 2000);
+#else
+    const int iterations = argc > 1 ? std::atoi(argv[1]) : 2000;
+
+    // Model A shape: MLP on the 180 selected features
+    run<Model<Dense<180, 100, ReLU>, Dense<100, 50, ReLU>, Dense<50, 8, Softmax>>>(
+        "MLP 180-100-50-8",
+        {{false, 1, 180, 100, 1, 1, {}, {}}, {false, 1, 100, 50, 1, 1, {}, {}}, {false, 1, 50, 8, 1, 2, {}, {}}},
+        iterations);
+
+    // Small CNN on a 2D feature matrix (20 frames x 32 features)
+    run<Model<Conv1D<20, 32, 16, 3, ReLU>, Conv1D<18, 16, 16, 3, ReLU>, Dense<256, 32, ReLU>, Dense<32, 8, Softmax>>>(
+        "CNN 20x32 conv16-conv16-32-8",
+        {{true, 20, 32, 16, 3, 1, {}, {}},
+         {true, 18, 16, 16, 3, 1, {}, {}},
+         {false, 1, 256, 32, 1, 1, {}, {}},
+         {false, 1, 32, 8, 1, 2, {}, {}}},
+        iterations);
+    return 0;
+#endif
+}
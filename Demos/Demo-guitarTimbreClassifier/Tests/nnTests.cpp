@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+#include <memory>
+#include <random>
+#include <sstream>
+#include "tidNN.hpp"
+
+using namespace tid::nn;
+
+static std::vector<float> randomVector(std::size_t size, unsigned int seed)
+{
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<float> dist(-1.0f, 1.0f);
+    std::vector<float> res(size);
+    for (float &v : res)
+        v = dist(gen);
+    return res;
+}
+
+static void writeUint32(std::ostream &stream, uint32_t value)
+{
+    stream.write(reinterpret_cast<const char *>(&value), 4); // Little-endian host assumed
+}
+
+TEST(TidNNTest, dotMatchesScalar)
+{
+    for (std::size_t n : {1, 3, 4, 7, 8, 15, 16, 17, 33, 180})
+    {
+        std::vector<float> a = randomVector(n, 1), b = randomVector(n, 2);
+        ASSERT_NEAR(dot(a.data(), b.data(), n), dotScalar(a.data(), b.data(), n), 1e-4f) << "n = " << n;
+    }
+}
+
+TEST(TidNNTest, denseKerasOrder)
+{
+    const std::size_t IN = 5, OUT = 3;
+    std::vector<float> kernel = randomVector(IN * OUT, 3), bias = randomVector(OUT, 4), input = randomVector(IN, 5);
+    Dense<IN, OUT, ReLU> dense;
+    dense.setWeights(kernel.data(), bias.data());
+    float output[OUT];
+    dense.forward(input.data(), output);
+
+    for (std::size_t o = 0; o < OUT; ++o)
+    {
+        float expected = bias[o];
+        for (std::size_t i = 0; i < IN; ++i)
+            expected += input[i] * kernel[i * OUT + o];
+        ASSERT_NEAR(output[o], std::max(expected, 0.0f), 1e-5f);
+    }
+}
+
+TEST(TidNNTest, conv1dKerasOrder)
+{
+    const std::size_t LEN = 9, IN_CH = 4, OUT_CH = 6, K = 3;
+    std::vector<float> kernel = randomVector(K * IN_CH * OUT_CH, 6), bias = randomVector(OUT_CH, 7),
+                       input = randomVector(LEN * IN_CH, 8);
+    Conv1D<LEN, IN_CH, OUT_CH, K> conv;
+    conv.setWeights(kernel.data(), bias.data());
+    std::vector<float> output(conv.outSize);
+    conv.forward(input.data(), output.data());
+
+    for (std::size_t t = 0; t < conv.outLength; ++t)
+        for (std::size_t o = 0; o < OUT_CH; ++o)
+        {
+            float expected = bias[o];
+            for (std::size_t k = 0; k < K; ++k)
+                for (std::size_t c = 0; c < IN_CH; ++c)
+                    expected += input[(t + k) * IN_CH + c] * kernel[(k * IN_CH + c) * OUT_CH + o];
+            ASSERT_NEAR(output[t * OUT_CH + o], expected, 1e-5f);
+        }
+}
+
+TEST(TidNNTest, modelBinaryRoundTrip)
+{
+    using TestModel = Model<Conv1D<6, 3, 4, 2, ReLU>, Dense<20, 8, Tanh>, Dense<8, 3, Softmax>>;
+    auto reference = std::make_unique<TestModel>();
+    auto loaded = std::make_unique<TestModel>();
+
+    std::stringstream binary;
+    binary.write("TIDN", 4);
+    writeUint32(binary, 1);
+    writeUint32(binary, TestModel::numLayers);
+    const std::size_t sizes[3][2] = {{2 * 3 * 4, 4}, {20 * 8, 8}, {8 * 3, 3}};
+    for (std::size_t l = 0; l < 3; ++l)
+    {
+        std::vector<float> weights = randomVector(sizes[l][0], 10 + l), biases = randomVector(sizes[l][1], 20 + l);
+        reference->setLayerWeights(l, weights, biases);
+        writeUint32(binary, weights.size());
+        writeUint32(binary, biases.size());
+        binary.write(reinterpret_cast<const char *>(weights.data()), weights.size() * sizeof(float));
+        binary.write(reinterpret_cast<const char *>(biases.data()), biases.size() * sizeof(float));
+    }
+    loaded->loadBinary(binary);
+
+    std::vector<float> input = randomVector(TestModel::inSize, 30);
+    float out1[3], out2[3];
+    reference->forward(input.data(), out1);
+    loaded->forward(input.data(), out2);
+    float sum = 0.0f;
+    for (int i = 0; i < 3; ++i)
+    {
+        ASSERT_FLOAT_EQ(out1[i], out2[i]);
+        sum += out1[i];
+    }
+    ASSERT_NEAR(sum, 1.0f, 1e-5f); // Softmax output
+}
+
+TEST(TidNNTest, sizeMismatchThrows)
+{
+    Model<Dense<4, 2>> model;
+    ASSERT_THROW(model.setLayerWeights(0, std::vector<float>(7), std::vector<float>(2)), std::invalid_argument);
+    ASSERT_THROW(model.setLayerWeights(1, std::vector<float>(8), std::vector<float>(2)), std::invalid_argument);
+    std::stringstream notAModel("NOPE");
+    ASSERT_THROW(model.loadBinary(notAModel), std::invalid_argument);
+
+    // Counts are checked before the weights are read (or allocated)
+    std::stringstream corrupt;
+    corrupt.write("TIDN", 4);
+    writeUint32(corrupt, 1);
+    writeUint32(corrupt, 1);
+    writeUint32(corrupt, 0xFFFFFFF0u);
+    writeUint32(corrupt, 2);
+    ASSERT_THROW(model.loadBinary(corrupt), std::invalid_argument);
+}
+
+TEST(TidNNTest, layerInfoDescribesTheModel)
+{
+    using TestModel = Model<Conv1D<6, 2, 3, 2, ReLU>, Dense<15, 4, Softmax>>;
+    const LayerInfo conv = TestModel::getLayerInfo(0), dense = TestModel::getLayerInfo(1);
+    ASSERT_STREQ(conv.type, "conv1d");
+    ASSERT_STREQ(conv.activation, "relu");
+    ASSERT_EQ(conv.outChannels, 3u);
+    ASSERT_EQ(conv.kernelSize, 2u);
+    ASSERT_STREQ(dense.type, "dense");
+    ASSERT_STREQ(dense.activation, "softmax");
+    ASSERT_EQ(dense.inSize, 15u);
+    ASSERT_EQ(dense.outSize, 4u);
+    ASSERT_THROW(TestModel::getLayerInfo(2), std::invalid_argument);
+}
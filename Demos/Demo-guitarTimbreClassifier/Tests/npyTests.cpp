@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+#include "tidNpy.hpp"
+
+using namespace tid::npy;
+
+TEST(TidNpyTest, npyRoundTripIsMappedAndAligned)
+{
+    const std::string path = "tidNpyTest.npy";
+    std::vector<float> values(7 * 5);
+    for (size_t i = 0; i < values.size(); ++i)
+        values[i] = 0.25f * i - 3.0f;
+    writeNpy(path, values, {7, 5});
+
+    const Array array = loadNpy(path);
+    EXPECT_EQ(array.getDescr(), "<f4");
+    EXPECT_EQ(array.getShape(), (std::vector<size_t>{7, 5}));
+    EXPECT_EQ(array.getNumRows(), 7u);
+    EXPECT_EQ(array.getNumCols(), 5u);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(array.data<float>()) % DATA_ALIGNMENT, 0u);
+    EXPECT_EQ(array.toVector<float>(), values);
+    EXPECT_THROW(array.data<double>(), std::invalid_argument);
+ #if TID_NPY_MMAP
+    EXPECT_TRUE(array.isMapped());
+ #endif
+
+    // Without mmap the contents are the same
+    EXPECT_EQ(loadNpy(path, false).toVector<float>(), values);
+    std::remove(path.c_str());
+}
+
+TEST(TidNpyTest, readsNumpyHeaders)
+{
+    // Header as written by np.save for a float64 (2, 3) array, followed by unaligned data
+    const std::string path = "tidNpyNumpy.npy";
+    const std::string dict = "{'descr': '<f8', 'fortran_order': False, 'shape': (2, 3), }\n";
+    const double values[6] = {1.0, -2.0, 3.5, 4.0, 5.0, -6.25};
+    {
+        std::ofstream stream(path, std::ios::binary);
+        stream.write("\x93NUMPY\x01\x00", 8);
+        const char length[2] = {(char)dict.size(), 0};
+        stream.write(length, 2);
+        stream.write(dict.data(), (std::streamsize)dict.size());
+        stream.write(reinterpret_cast<const char*>(values), sizeof(values));
+    }
+
+    const Array array = loadNpy(path);
+    EXPECT_EQ(array.getShape(), (std::vector<size_t>{2, 3}));
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(array.data<double>()) % alignof(double), 0u);
+    EXPECT_EQ(array.toVector<float>(), (std::vector<float>{1.0f, -2.0f, 3.5f, 4.0f, 5.0f, -6.25f}));
+    std::remove(path.c_str());
+}
+
+TEST(TidNpyTest, npzRoundTrip)
+{
+    const std::string path = "tidNpyTest.npz";
+    const std::vector<float> features = {1, 2, 3, 4, 5, 6};
+    const std::vector<uint32_t> labels = {0, 1, 1};
+    const std::vector<std::string> names = {"bfcc_1", "zeroCrossing"};
+    {
+        NpzWriter npz(path);
+        npz.add("features", features, {3, 2});
+        npz.add("labels", labels, {3});
+        npz.addStrings("names", names);
+    } // closed by the destructor
+
+    const NpzFile npz(path);
+    EXPECT_EQ(npz.getNames(), (std::vector<std::string>{"features", "labels", "names"}));
+    EXPECT_FALSE(npz.contains("lengths"));
+    EXPECT_THROW(npz.get("lengths"), std::invalid_argument);
+
+    const Array f = npz.get("features");
+    EXPECT_EQ(f.getShape(), (std::vector<size_t>{3, 2}));
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(f.data<float>()) % DATA_ALIGNMENT, 0u);
+    EXPECT_EQ(f.toVector<float>(), features);
+    EXPECT_EQ(npz.get("labels").toVector<uint32_t>(), labels);
+    EXPECT_EQ(npz.get("names").toStrings(), names);
+    std::remove(path.c_str());
+}
+
+TEST(TidNpyTest, malformedFilesThrow)
+{
+    const std::string path = "tidNpyMalformed.npy";
+    {
+        std::ofstream stream(path, std::ios::binary);
+        stream << "not a numpy file";
+    }
+    EXPECT_THROW(loadNpy(path), std::invalid_argument);
+    EXPECT_THROW(NpzFile{path}, std::invalid_argument);
+    EXPECT_THROW(loadNpy("tidNpyMissing.npy"), std::runtime_error);
+    EXPECT_THROW(writeNpy(path, std::vector<float>(5), {2, 3}), std::invalid_argument);
+    std::remove(path.c_str());
+}
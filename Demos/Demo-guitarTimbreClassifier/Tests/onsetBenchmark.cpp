@@ -0,0 +1,244 @@
+/*
+  Detection latency and false positives of tid::Bark on synthetic plucks
+
+  Synthesizes a sequence of plucked notes (noise burst attack, decaying
+  harmonics, notes ringing over each other, tremolo and a noise floor as
+  sources of false positives) at known onset times, and runs Bark with the
+  settings of the guitar classifier demo (1024 window, 128 hop, 64 sample
+  blocks) in the standard mode and with the early detection, for a few
+  thresholds.
+  For every configuration it prints the detected, missed and false onsets,
+  the report latency (end of the block that reported the onset minus the true
+  onset) and the error of the estimated onset position (onsetIndex).
+  It then times the analysis of 1, 2, 4, 6 and 8 channels (e.g. the strings
+  of a hexaphonic pickup) with one tid::MultiBark and with one tid::Bark per
+  channel, in microseconds per block (best of three runs). MultiBark only
+  transforms all the channels at once with the built-in FFT backend and at
+  least 3 channels, and with AVX (TID_USE_AVX) 8 channels take one vector.
+
+  Usage: onsetBenchmark [number of plucks] [seed]
+*/
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <vector>
+#include "bark.hpp"
+
+static const unsigned int SAMPLE_RATE = 48000;
+static const unsigned int BLOCK_SIZE = 64;
+static const double MATCH_WINDOW_MS = 60.0; // an onset reported later than this is a miss (and a false positive)
+
+struct Pluck
+{
+    size_t onset;
+    float f0;
+    float amplitude;
+    float decaySeconds;
+};
+
+static std::vector<float> synthesize(int numPlucks, unsigned int seed, std::vector<Pluck>& plucks)
+{
+    std::mt19937 gen(seed);
+    std::uniform_real_distribution<float> uniform(0.0f, 1.0f);
+    std::normal_distribution<float> noise(0.0f, 1.0f);
+
+    size_t position = SAMPLE_RATE / 2;
+    for (int p = 0; p < numPlucks; ++p)
+    {
+        const float midiNote = 40.0f + std::floor(uniform(gen) * 36.0f);
+        plucks.push_back({position, 440.0f * std::pow(2.0f, (midiNote - 69.0f) / 12.0f),
+                          0.05f + 0.85f * uniform(gen), 0.2f + 1.0f * uniform(gen)});
+        position += (size_t)((0.25f + 0.45f * uniform(gen)) * SAMPLE_RATE);
+    }
+
+    std::vector<float> signal(position + SAMPLE_RATE / 2, 0.0f);
+    for (const Pluck& pluck : plucks)
+    {
+        const size_t length = std::min(signal.size() - pluck.onset, (size_t)(5.0f * pluck.decaySeconds * SAMPLE_RATE));
+        const float tremoloRate = 4.0f + 3.0f * uniform(gen), tremoloDepth = 0.3f * uniform(gen);
+        for (size_t i = 0; i < length; ++i)
+        {
+            const float t = (float)i / SAMPLE_RATE;
+            float value = 0.0f;
+            for (int h = 1; h <= 8 && h * pluck.f0 < SAMPLE_RATE * 0.45f; ++h)
+                value += std::sin(2.0f * (float)M_PI * h * pluck.f0 * t) * std::exp(-t * h / pluck.decaySeconds) / h;
+            if (i < SAMPLE_RATE / 500) // 2 ms pick noise
+                value += 0.5f * noise(gen) * (1.0f - (float)i * 500.0f / SAMPLE_RATE);
+            const float attack = std::min(1.0f, (float)i / (0.001f * SAMPLE_RATE));
+            const float tremolo = 1.0f - tremoloDepth * 0.5f * (1.0f - std::cos(2.0f * (float)M_PI * tremoloRate * t));
+            signal[pluck.onset + i] += pluck.amplitude * attack * tremolo * value * 0.4f;
+        }
+    }
+    for (float& s : signal)
+        s += 0.001f * noise(gen);
+    return signal;
+}
+
+struct Result
+{
+    int detected = 0, missed = 0, falsePositives = 0;
+    std::vector<double> latencyMs, estimateErrorMs;
+};
+
+static double percentile(std::vector<double> values, double p)
+{
+    if (values.empty())
+        return 0.0;
+    std::sort(values.begin(), values.end());
+    return values[std::min(values.size() - 1, (size_t)(p * (values.size() - 1) + 0.5))];
+}
+
+/** Settings of the guitar classifier demo */
+template <typename Detector>
+static void configure(Detector& bark, float hiThresh)
+{
+    bark.prepare(SAMPLE_RATE, BLOCK_SIZE);
+    bark.setDebounce(200);
+    bark.setMask(4, 0.75f);
+    bark.setFilterRange(0, 49);
+    bark.setThresh(-1, hiThresh);
+}
+
+static Result evaluate(const std::vector<float>& signal, const std::vector<Pluck>& plucks, bool early, float hiThresh, float earlyThresh)
+{
+    tid::Bark<float> bark(1024, 128, 0.5f);
+    configure(bark, hiThresh);
+    if (early)
+    {
+        bark.setEarlyDetection(true, 256, 32);
+        bark.setEarlyThresh(earlyThresh);
+    }
+
+    std::vector<tid::Bark<float>::OnsetEvent> events;
+    tid::Bark<float>::OnsetEvent event;
+    for (size_t start = 0; start + BLOCK_SIZE <= signal.size(); start += BLOCK_SIZE)
+    {
+        bark.store(signal.data() + start, BLOCK_SIZE);
+        while (bark.popOnsetEvent(event))
+            events.push_back(event);
+    }
+
+    Result result;
+    const double samplesToMs = 1000.0 / SAMPLE_RATE;
+    std::vector<bool> used(events.size(), false);
+    for (const Pluck& pluck : plucks)
+    {
+        bool found = false;
+        for (size_t e = 0; e < events.size() && !found; ++e)
+        {
+            const double latency = ((double)events[e].sampleIndex - (double)pluck.onset) * samplesToMs;
+            if (!used[e] && latency >= 0.0 && latency <= MATCH_WINDOW_MS)
+            {
+                used[e] = found = true;
+                result.latencyMs.push_back(latency);
+                result.estimateErrorMs.push_back(((double)events[e].onsetIndex - (double)pluck.onset) * samplesToMs);
+            }
+        }
+        if (found)
+            ++result.detected;
+        else
+            ++result.missed;
+    }
+    result.falsePositives = (int)std::count(used.begin(), used.end(), false);
+    return result;
+}
+
+/** Microseconds per block to analyse numChannels channels, each one the signal delayed by a few milliseconds */
+static void benchmarkChannels(const std::vector<float>& signal, unsigned int numChannels, double& barksUs, double& multiBarkUs, int& barksOnsets, int& multiBarkOnsets)
+{
+    std::vector<std::vector<float>> channels(numChannels, std::vector<float>(signal.size(), 0.0f));
+    for (unsigned int c = 0; c < numChannels; ++c)
+        std::copy(signal.begin(), signal.end() - c * SAMPLE_RATE / 100, channels[c].begin() + c * SAMPLE_RATE / 100);
+    std::vector<const float*> pointers(numChannels);
+    const size_t numBlocks = signal.size() / BLOCK_SIZE;
+    using Clock = std::chrono::steady_clock;
+
+    std::vector<std::unique_ptr<tid::Bark<float>>> barks;
+    for (unsigned int c = 0; c < numChannels; ++c)
+    {
+        barks.emplace_back(new tid::Bark<float>(1024, 128, 0.5f));
+        configure(*barks.back(), 30.0f);
+    }
+    tid::Bark<float>::OnsetEvent event;
+    barksOnsets = 0;
+    Clock::time_point start = Clock::now();
+    for (size_t b = 0; b < numBlocks; ++b)
+        for (unsigned int c = 0; c < numChannels; ++c)
+        {
+            barks[c]->store(channels[c].data() + b * BLOCK_SIZE, BLOCK_SIZE);
+            while (barks[c]->popOnsetEvent(event))
+                ++barksOnsets;
+        }
+    barksUs = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / numBlocks;
+
+    tid::MultiBark<float> multiBark(numChannels, 1024, 128, 0.5f);
+    configure(multiBark, 30.0f);
+    tid::MultiBark<float>::OnsetEvent multiEvent;
+    multiBarkOnsets = 0;
+    start = Clock::now();
+    for (size_t b = 0; b < numBlocks; ++b)
+    {
+        for (unsigned int c = 0; c < numChannels; ++c)
+            pointers[c] = channels[c].data() + b * BLOCK_SIZE;
+        multiBark.store(pointers.data(), BLOCK_SIZE);
+        while (multiBark.popOnsetEvent(multiEvent))
+            ++multiBarkOnsets;
+    }
+    multiBarkUs = std::chrono::duration<double, std::micro>(Clock::now() - start).count() / numBlocks;
+}
+
+int main(int argc, char* argv[])
+{
+    const int numPlucks = argc > 1 ? std::max(1, std::atoi(argv[1])) : 200;
+    const unsigned int seed = argc > 2 ? (unsigned int)std::atoi(argv[2]) : 1;
+
+    std::vector<Pluck> plucks;
+    const std::vector<float> signal = synthesize(numPlucks, seed, plucks);
+    std::printf("%d plucks, %.1f s at %u Hz, blocks of %u samples\n\n", numPlucks, (double)signal.size() / SAMPLE_RATE, SAMPLE_RATE, BLOCK_SIZE);
+    std::printf("%-9s %6s %6s %8s %8s %6s %12s %12s %12s %14s %14s\n", "mode", "hi", "early", "detected", "missed", "false",
+                "latency avg", "latency p50", "latency p95", "estimate avg", "estimate p95");
+
+    auto print = [&](const char* mode, float hiThresh, float earlyThresh, const Result& r) {
+        double sum = 0.0, errorSum = 0.0;
+        std::vector<double> absoluteErrors;
+        for (double l : r.latencyMs)
+            sum += l;
+        for (double e : r.estimateErrorMs)
+        {
+            errorSum += e;
+            absoluteErrors.push_back(std::fabs(e));
+        }
+        const double count = std::max<size_t>(1, r.latencyMs.size());
+        std::printf("%-9s %6.0f %6.0f %8d %8d %6d %9.2f ms %9.2f ms %9.2f ms %11.2f ms %11.2f ms\n", mode, hiThresh, earlyThresh,
+                    r.detected, r.missed, r.falsePositives, sum / count, percentile(r.latencyMs, 0.5), percentile(r.latencyMs, 0.95),
+                    errorSum / count, percentile(absoluteErrors, 0.95));
+    };
+
+    for (float hiThresh : {10.0f, 30.0f, 60.0f})
+    {
+        print("standard", hiThresh, 0.0f, evaluate(signal, plucks, false, hiThresh, 0.0f));
+        for (float earlyThresh : {5.0f, 10.0f, 20.0f, 40.0f})
+            print("early", hiThresh, earlyThresh, evaluate(signal, plucks, true, hiThresh, earlyThresh));
+    }
+
+    std::printf("\n%-9s %16s %16s %8s %14s\n", "channels", "N x Bark", "MultiBark", "speedup", "onsets (N/M)");
+    for (unsigned int numChannels : {1u, 2u, 4u, 6u, 8u})
+    {
+        double barksUs = 0.0, multiBarkUs = 0.0;
+        int barksOnsets, multiBarkOnsets;
+        for (int run = 0; run < 3; ++run)
+        {
+            double runBarksUs, runMultiBarkUs;
+            benchmarkChannels(signal, numChannels, runBarksUs, runMultiBarkUs, barksOnsets, multiBarkOnsets);
+            barksUs = (run == 0) ? runBarksUs : std::min(barksUs, runBarksUs);
+            multiBarkUs = (run == 0) ? runMultiBarkUs : std::min(multiBarkUs, runMultiBarkUs);
+        }
+        std::printf("%-9u %10.2f us/blk %10.2f us/blk %7.2fx %7d/%d\n", numChannels, barksUs, multiBarkUs, barksUs / multiBarkUs,
+                    barksOnsets, multiBarkOnsets);
+    }
+    return 0;
+}
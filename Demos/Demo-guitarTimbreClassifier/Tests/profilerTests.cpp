@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+#include <thread>
+#define TID_ENABLE_PROFILER 1
+#include "tidProfiler.hpp"
+
+using namespace tid::profiler;
+
+TEST(ProfilerTest, bucketBoundsContainValue)
+{
+    for (uint64_t v : {0ull, 1ull, 7ull, 8ull, 9ull, 15ull, 16ull, 100ull, 1000ull, 123456ull, 1ull << 39})
+    {
+        const unsigned int b = Histogram::bucketIndex(v);
+        ASSERT_LT(b, Histogram::NUM_BUCKETS);
+        ASSERT_GE(Histogram::bucketUpperBound(b), v) << "v = " << v;
+        if (b > 0)
+        {
+            ASSERT_LT(Histogram::bucketUpperBound(b - 1), v) << "v = " << v;
+        }
+        // Relative error of the bucket bound is below 1/SUB_BUCKETS
+        ASSERT_LE(Histogram::bucketUpperBound(b) - v, v / Histogram::SUB_BUCKETS) << "v = " << v;
+    }
+    ASSERT_EQ(Histogram::bucketIndex(~0ull), Histogram::NUM_BUCKETS - 1);
+}
+
+TEST(ProfilerTest, percentilesAcrossThreads)
+{
+    reset();
+    const double nsPerTick = 1e9 / getTicksPerSecond();
+    auto worker = [](uint64_t offset) {
+        for (uint64_t i = 1; i <= 500; ++i)
+            record(Module::knn, Stage::knnDistance, (offset + i) * 1000);
+    };
+    std::thread t1(worker, 0), t2(worker, 500);
+    t1.join();
+    t2.join();
+
+    // Values 1000..1000000 ticks, uniformly
+    const Stats stats = getStats(Module::knn, Stage::knnDistance);
+    ASSERT_EQ(stats.count, 1000u);
+    ASSERT_NEAR(stats.max, 1000000 * nsPerTick, 1.0);
+    ASSERT_NEAR(stats.p50 / nsPerTick, 500000.0, 500000.0 / Histogram::SUB_BUCKETS);
+    ASSERT_NEAR(stats.p99 / nsPerTick, 990000.0, 990000.0 / Histogram::SUB_BUCKETS);
+    ASSERT_EQ(getStats(Module::knn, Stage::knnTopK).count, 0u);
+
+    reset();
+    ASSERT_EQ(getStats(Module::knn, Stage::knnDistance).count, 0u);
+}
+
+TEST(ProfilerTest, threadsBeyondThePoolAreDropped)
+{
+    reset();
+    const unsigned int numThreads = Registry::MAX_THREADS + 2;
+    for (unsigned int t = 0; t < numThreads; ++t)
+    {
+        std::thread thread([] { record(Module::bfcc, Stage::dct, 100); });
+        thread.join();
+    }
+    // Every record is either in the histogram of its own thread or counted as dropped
+    const uint64_t recorded = getStats(Module::bfcc, Stage::dct).count;
+    ASSERT_GE(getNumDroppedRecords(), 2u);
+    ASSERT_EQ(recorded + getNumDroppedRecords(), numThreads);
+}
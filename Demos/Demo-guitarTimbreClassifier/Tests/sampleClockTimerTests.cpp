@@ -0,0 +1,70 @@
+#include <gtest/gtest.h>
+#include "tidSampleClockTimer.hpp"
+
+class CountingTimer : public tid::SampleClockTimer
+{
+public:
+    void timerCallback() override
+    {
+        ++calls;
+        if (stopOnCallback)
+            stopTimer();
+    }
+    int calls = 0;
+    bool stopOnCallback = false;
+};
+
+TEST(SampleClockTimerTest, firesAfterInterval)
+{
+    CountingTimer timer;
+    timer.setTimerSampleRate(48000);
+    timer.advanceTimer(48000); // Not running
+    ASSERT_EQ(timer.calls, 0);
+
+    timer.startTimer(100); // 4800 samples
+    timer.advanceTimer(4799);
+    ASSERT_EQ(timer.calls, 0);
+    timer.advanceTimer(1);
+    ASSERT_EQ(timer.calls, 1);
+    ASSERT_TRUE(timer.isTimerRunning());
+
+    // Periodic like juce::Timer, more than one interval in a block calls more than once
+    timer.advanceTimer(4800 * 2);
+    ASSERT_EQ(timer.calls, 3);
+}
+
+TEST(SampleClockTimerTest, stopAndRestart)
+{
+    CountingTimer timer;
+    timer.setTimerSampleRate(44100);
+    timer.stopOnCallback = true;
+    timer.startTimer(10); // 441 samples
+    timer.advanceTimer(10000);
+    ASSERT_EQ(timer.calls, 1);
+    ASSERT_FALSE(timer.isTimerRunning());
+
+    timer.startTimer(10);
+    timer.advanceTimer(400);
+    timer.startTimer(10); // Restart resets the interval
+    timer.advanceTimer(400);
+    ASSERT_EQ(timer.calls, 1);
+    timer.advanceTimer(41);
+    ASSERT_EQ(timer.calls, 2);
+}
+
+TEST(SampleClockTimerTest, debounceEndsAfterInterval)
+{
+    tid::SampleClockDebounce debounce;
+    debounce.setSampleRate(48000);
+    ASSERT_FALSE(debounce.isActive());
+    debounce.start(10); // 480 samples
+    debounce.advance(479);
+    ASSERT_TRUE(debounce.isActive());
+    debounce.advance(1);
+    ASSERT_FALSE(debounce.isActive());
+    debounce.advance(48000); // One-shot
+    ASSERT_FALSE(debounce.isActive());
+    debounce.start(10);
+    debounce.clear();
+    ASSERT_FALSE(debounce.isActive());
+}
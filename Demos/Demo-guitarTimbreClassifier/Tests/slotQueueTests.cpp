@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+#include <cstdint>
+#include <thread>
+#include "../Source/ClassifierSlotQueue.h"
+
+static bool isCacheLineAligned(const float *ptr)
+{
+    return reinterpret_cast<std::uintptr_t>(ptr) % SlotQueue::CACHE_LINE_SIZE == 0;
+}
+
+TEST(ClassifierSlotQueueTest, emptyAndFull)
+{
+    ClassifierSlotQueue<8, 3> queue;
+    ASSERT_EQ(queue.acquireRead(), nullptr);
+    for (int i = 0; i < 3; ++i)
+    {
+        float *slot = queue.acquireWrite();
+        ASSERT_NE(slot, nullptr);
+        slot[0] = (float)i;
+        queue.commit();
+    }
+    ASSERT_EQ(queue.acquireWrite(), nullptr);
+    ASSERT_EQ(queue.getNumReady(), 3u);
+
+    for (int i = 0; i < 3; ++i)
+    {
+        const float *slot = queue.acquireRead();
+        ASSERT_NE(slot, nullptr);
+        ASSERT_EQ(slot[0], (float)i);
+        queue.release();
+    }
+    ASSERT_EQ(queue.acquireRead(), nullptr);
+}
+
+TEST(ClassifierSlotQueueTest, slotsAreAlignedAndDistinct)
+{
+    ClassifierSlotQueue<SlotQueue::RUNTIME_ELEMENT_SIZE, 5> queue;
+    queue.reserve(180);
+    ASSERT_EQ(queue.getElementSize(), 180u);
+
+    const float *previous = nullptr;
+    for (int i = 0; i < 5; ++i)
+    {
+        float *slot = queue.acquireWrite();
+        ASSERT_TRUE(isCacheLineAligned(slot));
+        if (previous != nullptr)
+        {
+            ASSERT_GE(slot - previous, 180);
+        }
+        previous = slot;
+        queue.commit();
+    }
+
+    ClassifierSlotQueue<8, 5> fixedQueue;
+    ASSERT_TRUE(isCacheLineAligned(fixedQueue.acquireWrite()));
+}
+
+TEST(ClassifierSlotQueueTest, readCopiesAndReleases)
+{
+    ClassifierSlotQueue<4, 2> queue;
+    float *slot = queue.acquireWrite();
+    for (int i = 0; i < 4; ++i)
+        slot[i] = (float)(i + 1);
+    queue.commit();
+
+    float out[4] = {0};
+    ASSERT_TRUE(queue.read(out));
+    ASSERT_EQ(out[3], 4.0f);
+    ASSERT_FALSE(queue.read(out));
+}
+
+TEST(ClassifierSlotQueueTest, crossThread)
+{
+    const int N_ELEMENTS = 20000;
+    const std::size_t ELEMENT_SIZE = 33;
+    ClassifierSlotQueue<SlotQueue::RUNTIME_ELEMENT_SIZE, 5> queue;
+    queue.reserve(ELEMENT_SIZE);
+
+    // A failed assertion in the consumer would only leave the lambda (and the
+    // producer would wait forever), so it records the first mismatch instead
+    int firstMismatch = -1;
+    std::thread consumer([&queue, &firstMismatch]() {
+        int expected = 0;
+        while (expected < N_ELEMENTS)
+        {
+            const float *slot = queue.acquireRead();
+            if (slot == nullptr)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            for (std::size_t i = 0; i < ELEMENT_SIZE; ++i)
+                if (firstMismatch < 0 && slot[i] != (float)(expected + i))
+                    firstMismatch = expected;
+            queue.release();
+            ++expected;
+        }
+    });
+
+    for (int n = 0; n < N_ELEMENTS; ++n)
+    {
+        float *slot;
+        while ((slot = queue.acquireWrite()) == nullptr)
+            std::this_thread::yield();
+        for (std::size_t i = 0; i < ELEMENT_SIZE; ++i)
+            slot[i] = (float)(n + i);
+        queue.commit();
+    }
+    consumer.join();
+    ASSERT_EQ(firstMismatch, -1);
+    ASSERT_EQ(queue.getNumReady(), 0u);
+}
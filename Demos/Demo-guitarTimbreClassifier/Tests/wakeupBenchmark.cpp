@@ -0,0 +1,105 @@
+/*
+  Wake latency benchmark for the Classification thread wake-up strategies
+
+  Compares (on the machine where it runs):
+   - The old 500us sleep polling
+   - RealTimeWakeup (adaptive spin + backoff, or futex with RTWAKEUP_USE_FUTEX=1)
+
+  For each strategy, a producer posts at random intervals (as onsets would) and
+  the waiting thread measures the time between post and wake-up.
+  CPU time used by the waiting thread is reported as well.
+*/
+#include <algorithm>
+#include <cstdio>
+#include <ctime>
+#include <random>
+#include <thread>
+#include <vector>
+#include "../Source/rtWakeup.h"
+
+using Clock = std::chrono::steady_clock;
+using namespace std::chrono_literals;
+
+struct Result
+{
+    std::vector<double> latenciesUs;
+    double waiterCpuMs = 0;
+};
+
+static double threadCpuMs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec * 1e3 + ts.tv_nsec / 1e6;
+}
+
+template <typename WaitFunction, typename PostFunction>
+static Result runBenchmark(int nPosts, WaitFunction waitForPost, PostFunction post)
+{
+    Result res;
+    std::atomic<int64_t> postTime{0};
+    std::atomic<bool> done{false};
+    std::atomic<int> consumed{0};
+
+    std::thread waiter([&] {
+        double cpuStart = threadCpuMs();
+        while (!done)
+        {
+            if (waitForPost())
+            {
+                const int64_t now = Clock::now().time_since_epoch().count();
+                res.latenciesUs.push_back((now - postTime.load()) / 1000.0);
+                consumed++;
+            }
+        }
+        res.waiterCpuMs = threadCpuMs() - cpuStart;
+    });
+
+    std::mt19937 rng(42);
+    std::uniform_int_distribution<int> intervalMs(2, 20);
+    for (int i = 0; i < nPosts; ++i)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(intervalMs(rng)));
+        postTime = Clock::now().time_since_epoch().count();
+        post();
+        while (consumed <= i)
+            std::this_thread::yield();
+    }
+    done = true;
+    post();
+    waiter.join();
+    return res;
+}
+
+static void report(const char *name, Result res)
+{
+    auto &l = res.latenciesUs;
+    std::sort(l.begin(), l.end());
+    auto pct = [&](double p) { return l[std::min(l.size() - 1, (size_t)(p * l.size()))]; };
+    printf("%-28s p50 %8.1fus  p99 %8.1fus  max %8.1fus  waiter CPU %7.1fms\n", name, pct(0.5), pct(0.99), l.back(),
+           res.waiterCpuMs);
+}
+
+int main(int argc, char **argv)
+{
+    const int N_POSTS = argc > 1 ? atoi(argv[1]) : 300;
+
+    {
+        std::atomic<bool> flag{false};
+        auto res = runBenchmark(
+            N_POSTS,
+            [&] {
+                std::this_thread::sleep_for(500us);
+                return flag.exchange(false);
+            },
+            [&] { flag = true; });
+        report("sleep_for(500us) polling", res);
+    }
+    {
+        RealTimeWakeup wakeup;
+        auto res = runBenchmark(
+            N_POSTS, [&] { return wakeup.wait(100ms); }, [&] { wakeup.post(); });
+        report(RTWAKEUP_USE_FUTEX ? "RealTimeWakeup (futex)" : "RealTimeWakeup (spin+backoff)", res);
+    }
+    return 0;
+}
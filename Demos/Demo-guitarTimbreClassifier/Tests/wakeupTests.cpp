@@ -0,0 +1,74 @@
+#include <gtest/gtest.h>
+#include <csignal>
+#include <thread>
+#include "../Source/rtWakeup.h"
+
+using namespace std::chrono_literals;
+
+TEST(RealTimeWakeupTest, timeout)
+{
+    RealTimeWakeup wakeup;
+    auto start = RealTimeWakeup::Clock::now();
+    ASSERT_FALSE(wakeup.wait(2ms));
+    ASSERT_GE(RealTimeWakeup::Clock::now() - start, 2ms);
+}
+
+TEST(RealTimeWakeupTest, postBeforeWait)
+{
+    RealTimeWakeup wakeup;
+    wakeup.post();
+    ASSERT_TRUE(wakeup.wait(0us));
+    ASSERT_FALSE(wakeup.wait(0us));
+}
+
+TEST(RealTimeWakeupTest, coalescedPosts)
+{
+    RealTimeWakeup wakeup;
+    wakeup.post();
+    wakeup.post();
+    wakeup.post();
+    ASSERT_EQ(wakeup.getPostCount(), 3u);
+    ASSERT_TRUE(wakeup.wait(0us));
+    ASSERT_FALSE(wakeup.wait(0us));
+}
+
+TEST(RealTimeWakeupTest, crossThread)
+{
+    RealTimeWakeup wakeup;
+    const int N_POSTS = 50;
+    std::atomic<int> received{0};
+
+    std::thread waiter([&] {
+        while (received < N_POSTS)
+            if (wakeup.wait(1s))
+                received++;
+    });
+
+    for (int i = 0; i < N_POSTS; ++i)
+    {
+        wakeup.post();
+        // Wait for the waiter to consume the post, to avoid coalescing
+        while (received <= i)
+            std::this_thread::yield();
+    }
+    waiter.join();
+    ASSERT_EQ(received, N_POSTS);
+}
+
+static RealTimeWakeup *signalWakeup = nullptr;
+static void postFromSignalHandler(int)
+{
+    signalWakeup->post();
+}
+
+TEST(RealTimeWakeupTest, postFromSignalHandler)
+{
+    // post() has to be async-signal safe (no locks), like it has to be safe in the audio callback
+    RealTimeWakeup wakeup;
+    signalWakeup = &wakeup;
+    auto previous = std::signal(SIGUSR1, postFromSignalHandler);
+    std::raise(SIGUSR1);
+    std::signal(SIGUSR1, previous);
+    ASSERT_TRUE(wakeup.wait(0us));
+    signalWakeup = nullptr;
+}
@@ -22,7 +22,13 @@ You should have received a copy of the GNU General Public License along with thi
 */
 #pragma once
 
+#include "tidJuceCompat.hpp"
 #include "tIDLib.hpp"
+#include "tidProfiler.hpp"
+#include "tidSlidingWindow.hpp"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
 #include <vector>
 
 #include <climits>  // ULONG_MAX
@@ -69,9 +75,16 @@ public:
     /** Resets the processing pipeline. */
     void reset() noexcept
     {
-        std::fill(signalBuffer.begin(), signalBuffer.end(), SampleType{0});
-        std::fill(analysisBuffer.begin(), analysisBuffer.end(), 0.0f);
-        std::fill(searchBuffer.begin(), searchBuffer.end(), 0.0f);
+        // the signal buffer starts filled with zeros, as in the original module
+        this->numSamples = 0;
+        this->peakTracker.clear();
+        const int64 bufferLength = (int64)(this->maxSearchRange + this->blockSize);
+        for (int64 i = 0; i < bufferLength; ++i)
+            this->history[(size_t)i] = 0.0f;
+        this->numSamples = bufferLength;
+        for (int64 t = std::max<int64>(0, bufferLength - (int64)this->peakLag - (int64)this->analysisWindowSize); t + (int64)this->peakLag < bufferLength; ++t)
+            this->peakTracker.push(t, 0.0f);
+        rebuildAttackTrackers();
        #if ASYNC_FEATURE_EXTRACTION
         this->lastStoreTime = juce::Time::currentTimeMillis();
        #endif
@@ -89,6 +102,17 @@ public:
             throw std::invalid_argument("Channel index has to be between 0 and "+std::to_string(numChannels-1)+" (found "+std::to_string(channel)+" instead)");
         storeAudioBlock(buffer.getReadPointer(channel), buffer.getNumSamples());
     }
+
+    /**
+     * Stores an audio block into the buffer of the module
+     * Raw pointer version of store(), for use without JUCE buffers.
+     * @param input samples of the audio block
+     * @param n number of samples, it has to match the block size given to prepare()
+    */
+    void store (const SampleType* input, size_t n)
+    {
+        storeAudioBlock(input, n);
+    }
     //==============================================================================
 
     void compute(unsigned long int* rPeakSampIdx, unsigned long int* rAttackStartIdx, float *rAttackTime)
@@ -104,51 +128,70 @@ public:
         if(offsetSample >= this->blockSize)
             offsetSample = this->blockSize - 1;
        #else
-        if ((tIDLib::FEATURE_EXTRACTION_OFFSET < 0.0f) || (tIDLib::FEATURE_EXTRACTION_OFFSET > 1.0f)) throw new std::logic_error("FEATURE_EXTRACTION_OFFSET must be between 0.0 and 1.0 (found "+std::to_string(tIDLib::FEATURE_EXTRACTION_OFFSET)+" instead)");
         uint32 offsetSample = (unsigned long int)(tIDLib::FEATURE_EXTRACTION_OFFSET * (double)this->blockSize);
        #endif
 
-        // took a while to get this calculation right, but it seems correct now. remember that offsetSample is always between 0 and 63 (or blockSize-1), and finding startSample within x_signalBuffer involves a few other steps. (wbrent original comment)
-        unsigned long int startSample = (this->maxSearchRange + this->blockSize) - offsetSample - analysisWindowSize - 1;
-
-        // construct analysis window
-        for(unsigned long int i = 0, j = startSample; i < analysisWindowSize; ++i, ++j)
-            this->analysisBuffer[i] = (float)this->signalBuffer[j];
-
-        unsigned long int peakSampIdx = 0;
-        float peakSampVal = 0.0f;
-        tIDLib::peakSample(this->analysisBuffer, &peakSampIdx, &peakSampVal);
+        // the analysis window is the same of the original module (signalBuffer[startSample+1 ... startSample+analysisWindowSize-1],
+        // the first sample was skipped by tIDLib::peakSample), in absolute sample times
+        const int64 lastSample = this->numSamples - 1;
+        const int64 bufferStart = this->numSamples - (int64)(this->maxSearchRange + this->blockSize);
+        const int64 windowEnd = lastSample - (int64)offsetSample - 1;
+        jassert(windowEnd - (int64)this->analysisWindowSize + 2 > bufferStart); // the window has to fit in the signal buffer
+        const int64 windowStart = std::max(windowEnd - (int64)this->analysisWindowSize + 2, bufferStart + 1);
+
+        if (this->attackTrackersMagThresh != this->sampMagThresh || this->attackTrackersNumSampsThresh != this->numSampsThresh)
+            rebuildAttackTrackers();
+
+        // Peak: earliest maximum of the window. The sliding maximum is up to date peakLag samples
+        // before the last one, the rest of the window (only when offsetSample varies) is scanned.
+        int64 peakTime = -1;
+        float peakVal = -FLT_MAX;
+        this->peakTracker.getMax(windowStart, peakTime, peakVal);
+        for (int64 t = std::max(lastSample - (int64)this->peakLag + 1, windowStart); t <= windowEnd; ++t)
+            if (historyAt(t) > peakVal)
+            {
+                peakTime = t;
+                peakVal = historyAt(t);
+            }
 
-        peakSampIdx += startSample; // add startSample back so we can find the peak sample index relative to x_signalBuffer (wbrent original comment)
+        // index relative to the signal buffer (maxSearchRange + blockSize samples) as in the original module
+        unsigned long int peakSampIdx = (unsigned long int)(peakTime - bufferStart);
 
-        unsigned long int i = this->maxSearchRange;
-        unsigned long int j = peakSampIdx;
+        // Attack start: the latest run of at least numSampsThresh samples below sampMagThresh, in the
+        // maxSearchRange samples that end with the peak. Samples older than the signal buffer have the
+        // value of its first sample, like in the search buffer of the original module.
+        const int64 searchStart = peakTime - (int64)this->maxSearchRange + 1;
+        const int64 visibleStart = std::max(bufferStart, searchStart);
+        const int64 minRun = getMinAttackRun();
 
-        while(i--)
-        {
-            if(j == 0)
-                this->searchBuffer[i] = this->signalBuffer[j];
-            else
+        int64 firstAbove = peakTime + 1;
+        for (size_t i = 0; i < this->aboveTimes.size(); ++i)
+            if (this->aboveTimes[i] >= visibleStart)
             {
-                this->searchBuffer[i] = this->signalBuffer[j];
-                j--;
+                firstAbove = std::min(firstAbove, this->aboveTimes[i]);
+                break;
             }
-        }
 
-        // send searchBuffer to routine to find the point where sample magnitude is below x_sampMagThresh for at least x_numSampsThresh samples (wbrent original comment)
-        unsigned long int attackStartIdx = tIDLib::findAttackStartSamp(searchBuffer, sampMagThresh, numSampsThresh);
+        int64 runEnd = -1;
+        const int64 lastQualified = this->lastQualifiedHistory[(size_t)(peakTime % (int64)this->lastQualifiedHistory.size())];
+        if (lastQualified >= firstAbove)
+            runEnd = lastQualified;
+        else if (firstAbove > visibleStart && (firstAbove - 1) - searchStart + 1 >= minRun)
+            runEnd = firstAbove - 1; // the run goes back to the start of the search range
 
+        unsigned long int attackStartIdx = ULONG_MAX;
         float attackTime = 0.0f;
         // if the index returned is ULONG_MAX, the search failed
-        if(attackStartIdx == ULONG_MAX)
-        	attackTime = -1.0f;
+        if (runEnd < 0)
+            attackTime = -1.0f;
         else
         {
-            // attack duration in samples is the end of buffer index (where the peak sample was) minus the start index
-            attackTime = (this->maxSearchRange - attackStartIdx)/this->sampleRate;
+            // attack duration in samples is the peak sample time minus the attack start time
+            const unsigned long int attackSamples = (unsigned long int)(peakTime - (runEnd - minRun + 1) + 1);
+            attackTime = attackSamples/this->sampleRate;
             attackTime *= 1000.0f; // convert seconds to milliseconds
-            // overwrite attackStartIdx to be the index relative to the entire table
-            attackStartIdx = peakSampIdx - (this->maxSearchRange - attackStartIdx);
+            // attackStartIdx is the index relative to the signal buffer
+            attackStartIdx = peakSampIdx - attackSamples;
         }
 
         // Output the values just computed ------------------------
@@ -160,6 +203,8 @@ public:
 
     void setWindowSize(uint32 windowSize)
     {
+        if (windowSize < 2)
+            throw std::invalid_argument("Window size has to be at least 2 samples");
         this->analysisWindowSize = windowSize;
         resizeAnalysisBuffer();
         reset();
@@ -249,31 +294,111 @@ public:
         return res;
     }
 
+    /**
+     * Place the buffers used at every block in an arena, in the order in
+     * which they are accessed (see tid::Arena)
+    */
+    void layoutBuffers(Arena& arena)
+    {
+        arena.place(this->history);
+        this->peakTracker.layoutBuffers(arena);
+        arena.place(this->lastQualifiedHistory);
+        this->aboveTimes.layoutBuffers(arena);
+    }
+
 private:
 
     void resizeAnalysisBuffer()
     {
-        analysisBuffer.resize(analysisWindowSize, 0.0f);
+        // the peak of the analysis window is at most analysisWindowSize + blockSize samples old
+        this->peakTracker.setWindowLength(this->analysisWindowSize - 1);
+        this->lastQualifiedHistory.assign(this->analysisWindowSize + this->blockSize + 2, -1);
     }
 
     void resizeAllBuffers()
     {
-        signalBuffer.resize(maxSearchRange + blockSize, SampleType{0});
-        searchBuffer.resize(maxSearchRange, 0.0f);
+       #if ASYNC_FEATURE_EXTRACTION
+        this->peakLag = this->blockSize + 1;
+       #else
+        this->peakLag = (uint32)(tIDLib::FEATURE_EXTRACTION_OFFSET * (double)this->blockSize) + 1;
+       #endif
+        // signal buffer of the original module (maxSearchRange + blockSize) plus the lag of the peak tracker
+        this->history.assign(this->maxSearchRange + 2 * this->blockSize + 1, 0.0f);
+        this->aboveTimes.setCapacity(this->maxSearchRange + this->blockSize + 1);
         resizeAnalysisBuffer();
     }
 
+    float historyAt(int64 time) const noexcept
+    {
+        return this->history[(size_t)(time % (int64)this->history.size())];
+    }
+
+    /** tIDLib::findAttackStartSamp needs at least two samples below the threshold */
+    int64 getMinAttackRun() const noexcept
+    {
+        return std::max<int64>(this->numSampsThresh, 2);
+    }
+
+    /**
+     * Updates the length of the current run of samples below sampMagThresh, the
+     * latest sample that ends a long enough run (for each sample time) and the
+     * samples above the threshold that are still in the signal buffer
+    */
+    void updateAttackTrackers(int64 time, float magnitude) noexcept
+    {
+        if (magnitude <= this->sampMagThresh)
+            ++this->belowRun;
+        else
+        {
+            this->belowRun = 0;
+            this->aboveTimes.push_back(time);
+        }
+
+        if (this->belowRun >= getMinAttackRun())
+            this->lastQualified = time;
+        this->lastQualifiedHistory[(size_t)(time % (int64)this->lastQualifiedHistory.size())] = this->lastQualified;
+
+        const int64 bufferStart = time + 1 - (int64)(this->maxSearchRange + this->blockSize);
+        while (!this->aboveTimes.empty() && this->aboveTimes.front() < bufferStart)
+            this->aboveTimes.pop_front();
+    }
+
+    /** Recomputes the attack trackers from the signal buffer, after a change of the thresholds */
+    void rebuildAttackTrackers() noexcept
+    {
+        this->attackTrackersMagThresh = this->sampMagThresh;
+        this->attackTrackersNumSampsThresh = this->numSampsThresh;
+
+        this->belowRun = 0;
+        this->lastQualified = -1;
+        this->aboveTimes.clear();
+        std::fill(this->lastQualifiedHistory.begin(), this->lastQualifiedHistory.end(), -1);
+
+        // runs are cut at the start of the signal buffer, which only affects runs that reach it (handled by compute)
+        const int64 bufferStart = this->numSamples - (int64)(this->maxSearchRange + this->blockSize);
+        for (int64 t = std::max<int64>(0, bufferStart); t < this->numSamples; ++t)
+            updateAttackTrackers(t, historyAt(t));
+    }
+
     void storeAudioBlock (const SampleType* input, size_t n) noexcept
     {
+        TID_PROFILE_SCOPE(attackTime, storeAudioBlock);
         jassert(n ==  this->blockSize);
 
-        // shift signal buffer contents N positions back
-    	for(uint64 i=0; i<maxSearchRange; ++i)
-    		signalBuffer[i] = signalBuffer[i+n];
+        if (this->attackTrackersMagThresh != this->sampMagThresh || this->attackTrackersNumSampsThresh != this->numSampsThresh)
+            rebuildAttackTrackers();
 
-    	// write new block to end of signal buffer.
-    	for(size_t i=0; i<n; ++i)
-    		signalBuffer[maxSearchRange+i] = input[i];
+        for (size_t i = 0; i < n; ++i)
+        {
+            const int64 time = this->numSamples++;
+            const float magnitude = fabsf((float)input[i]);
+            this->history[(size_t)(time % (int64)this->history.size())] = magnitude;
+            updateAttackTrackers(time, magnitude);
+
+            // the sliding maximum follows peakLag samples behind, at the end of the analysis window
+            if (time >= (int64)this->peakLag)
+                this->peakTracker.push(time - (int64)this->peakLag, historyAt(time - (int64)this->peakLag));
+        }
 
        #if ASYNC_FEATURE_EXTRACTION
         this->lastStoreTime = juce::Time::currentTimeMillis();
@@ -294,9 +419,25 @@ private:
     /** maximum search range */
     unsigned long int maxSearchRange = this->sampleRate * 2.0f; // two seconds
 
-    std::vector<SampleType> signalBuffer;
-    std::vector<float> analysisBuffer;
-    std::vector<float> searchBuffer;
+    /** Number of samples stored since reset(), including the zeros of the initial signal buffer */
+    int64 numSamples = 0;
+    /** Magnitude of the last samples (signal buffer of the original module), indexed by sample time */
+    ArenaVector<float> history;
+
+    /** Sliding maximum of the analysis window */
+    SlidingMax peakTracker;
+    /** Samples between the last one stored and the last one in peakTracker */
+    uint32 peakLag = 1;
+
+    /** Attack start trackers, computed for these thresholds */
+    float attackTrackersMagThresh = -1.0f;
+    unsigned short int attackTrackersNumSampsThresh = 0;
+    int64 belowRun = 0;
+    int64 lastQualified = -1;
+    /** For each sample time, the latest sample that ends a run of getMinAttackRun() samples below the threshold */
+    ArenaVector<int64> lastQualifiedHistory;
+    /** Times of the samples above the threshold in the signal buffer */
+    RingQueue<int64> aboveTimes;
 
    #if ASYNC_FEATURE_EXTRACTION
     uint32 lastStoreTime = juce::Time::currentTimeMillis(); // x_lastDspTime in Original PD library
@@ -21,8 +21,18 @@ You should have received a copy of the GNU General Public License along with thi
 */
 #pragma once
 
+#include "tidJuceCompat.hpp"
+#include "tidSampleClockTimer.hpp"
+#include "tidOnsetEvents.hpp"
 #include "tIDLib.hpp"
-#include "fftw3.h"
+#include "tidProfiler.hpp"
+#include "tidRTLog.hpp"
+#include "tidFft.hpp"
+#include "tidWindowTable.hpp"
+#include "tidFilterbank.hpp"
+#include "tidMultiChannel.hpp"
+#include <atomic>
+#include <climits>  // UINT_MAX
 
 #define DEBUGLOG_SUBFOLDER "tIDLib-bark"
 #define DEBUGLOG_FILENAME "debug_log_"
@@ -35,8 +45,99 @@ namespace tid   /* TimbreID namespace*/
 const float weights_dB[] = {-69.9f, -60.4f, -51.4f, -43.3f, -36.6f, -30.3f, -24.3f, -19.5f, -14.8f, -10.7f, -7.5f, -4.8f, -2.6f, -0.8f, 0.0f, 0.6f, 0.5f, 0.0f, -0.1f, 0.5f, 1.5f, 3.6f, 5.9f, 6.5f, 4.2f, -2.6f, -10.2f, -10.0f, -2.8f};
 const float weights_freqs[] = {20.0f, 25.0f, 31.5f, 40.0f, 50.0f, 63.0f, 80.0f, 100.0f, 125.0f, 160.0f, 200.0f, 250.0f, 315.0f, 400.0f, 500.0f, 630.0f, 800.0f, 1000.0f, 1250.0f, 1600.0f, 2000.0f, 2500.0f, 3150.0f, 4000.0f, 5000.0f, 6300.0f, 8000.0f, 10000.0f, 12500.0f};
 
+/**
+ * Loudness weights of the bands of a Bark filterbank (equal loudness
+ * contour of weights_dB), for the power or the magnitude spectrum.
+ * Used by Bark and MultiBark.
+*/
+inline void createBarkLoudnessWeights(std::vector<float>& loudWeights, t_filterIdx numFilters, float barkSpacing, tIDLib::SpectrumType spectrumType)
+{
+    std::vector<float> barkFreqs(numFilters,0.0f);
+    loudWeights.resize(numFilters);
+
+    float barkSum = barkSpacing;
+
+    for(t_filterIdx i = 0; i < numFilters; ++i)
+    {
+        barkFreqs[i] = tIDLib::bark2freq(barkSum);
+        barkSum += barkSpacing;
+    }
+
+    for(t_filterIdx i = 0; i < numFilters; ++i)
+    {
+        t_binIdx nearIdx = tIDLib::nearestBinIndex(barkFreqs[i], weights_freqs, tIDLib::NUMWEIGHTPOINTS);
+        float nearFreq = weights_freqs[nearIdx];
+        float diffdB = 0.0f;
+
+        float diffFreq, dBint;
+
+        // wbrent original comment:
+        // this doesn't have to be if/else'd into a greater/less situation.  later on i should write a more general interpolation solution, and maybe move it up to 4 points instead.
+        if(barkFreqs[i]>nearFreq)
+        {
+            if(nearIdx <= tIDLib::NUMWEIGHTPOINTS-2)
+            {
+                diffFreq = (barkFreqs[i] - nearFreq)/(weights_freqs[nearIdx+1] - nearFreq);
+                diffdB = diffFreq * (weights_dB[nearIdx+1] - weights_dB[nearIdx]);
+            }
+
+            dBint = weights_dB[nearIdx] + diffdB;
+        }
+        else
+        {
+            if(nearIdx > 0)
+            {
+                diffFreq = (barkFreqs[i] - weights_freqs[nearIdx-1])/(nearFreq - weights_freqs[nearIdx-1]);
+                diffdB = diffFreq * (weights_dB[nearIdx] - weights_dB[nearIdx-1]);
+            }
+
+            dBint = weights_dB[nearIdx-1] + diffdB;
+        }
+
+        switch(spectrumType)
+        {
+            case tIDLib::SpectrumType::powerSpectrum:
+                loudWeights[i] = powf(10.0f, dBint*0.1f);
+                break;
+            case tIDLib::SpectrumType::magnitudeSpectrum:
+                loudWeights[i] = powf(10.0f, dBint*0.05f);
+                break;
+            default:
+                throw std::logic_error("Spectrum type option not available!");
+        }
+
+    }
+}
+
+/**
+ * Onset reported by Bark
+*/
+struct BarkOnsetEvent
+{
+    uint64 sampleIndex; // samples stored since prepare()/reset() when the onset was reported (end of the analysis window)
+    uint64 onsetIndex;  // estimated position of the onset (same count), equal to sampleIndex without early detection
+    float growth;       // total growth of the analysis period that reported the onset
+    float velocity;     // total velocity (sum of the band energies) of the same period
+
+    /** Position of the onset from the first sample of the block that reported it (negative if it started in a previous block) */
+    int64 getOffsetInBlock(unsigned int blockSize) const noexcept
+    {
+        return (int64)this->onsetIndex - ((int64)this->sampleIndex - (int64)blockSize);
+    }
+};
+
+/**
+ * Onset detector
+ * The debounce runs on the sample clock (advanced in storeAudioBlock), so it
+ * does not depend on the message thread and works faster than real time.
+ * Onsets are published as OnsetEvent into a lock-free queue, to be consumed
+ * by one thread with popOnsetEvent() (the audio thread too, right after
+ * store()) or outside of the audio thread with dispatchOnsetEvents().
+ * With setEarlyDetection(), a short window analysed every few samples triggers
+ * the detection and the long window confirms it, reporting onsets earlier.
+*/
 template <typename SampleType>
-class Bark : private Timer
+class Bark : public tid::OnsetEventQueue<Bark<SampleType>, BarkOnsetEvent, 64>
 {
 public:
     //==========================================================================
@@ -116,58 +217,80 @@ public:
      * standard parameters
      * @param sampleRate The sample rate of the buffer
      * @param blockSize The size of the individual audio blocks
+     * A new sample rate acquires the filterbank for it (the filter range is
+     * kept if the number of filters does not change); with early detection, a
+     * new sample rate or block size also reallocates the short window and its
+     * FFT plan. Both can throw.
     */
-    void prepare (unsigned long int sampleRate, unsigned int blockSize) noexcept
+    void prepare (unsigned long int sampleRate, unsigned int blockSize)
     {
         if((sampleRate != this->sampleRate) || (blockSize != this->blockSize))
         {
+            const bool sampleRateChanged = (sampleRate != this->sampleRate);
             this->sampleRate = sampleRate;
             this->blockSize = blockSize;
             resizeBuffer();
+            if(sampleRateChanged)
+                acquireFilterbank();
+            if(this->earlyDetection)
+                initEarlyDetection();
         }
+        this->debounce.setSampleRate(sampleRate);
         reset();
     }
 
     /**
      * Resets the processing pipeline.
-     * It empties the analysis buffer
+     * It empties the analysis buffer and restarts the sample count of the onset events
     */
     void reset() noexcept
     {
         std::fill(signalBuffer.begin(), signalBuffer.end(), SampleType{0});
+        this->samplesStored = 0;
+        this->earlyTick = 0;
+        this->earlyTriggered = false;
+        std::fill(this->earlyMask.begin(), this->earlyMask.end(), 0.0f);
+        std::fill(this->earlyNumPeriods.begin(), this->earlyNumPeriods.end(), 0);
     }
     //==========================================================================
+    /** Onset reported by the detector (popOnsetEvent(), dispatchOnsetEvents() and the Listener are in OnsetEventQueue) */
+    using OnsetEvent = BarkOnsetEvent;
+
+    /** Default growth threshold of the short window of the early detection */
+    static constexpr float EARLY_THRESH_DEFAULT = 20.0f;
+    /** Filter spacing of the short window, coarser than the long one because of its lower frequency resolution */
+    static constexpr float EARLY_BARK_SPACING = 1.0f;
+    //==========================================================================
     /**
      * Container class for growth data
      * Used to return the growth values to the caller.
      * If the elements returned are valid, the getters will return them, otherwise
-     * nullptr is returned
+     * nullptr is returned.
+     * The growth list is not copied: it refers to one of the two growth buffers
+     * of the module, which stays unchanged until the next report (the following
+     * one is written to the other buffer), so reporting never allocates.
     */
     class GrowthData
     {
     public:
-        void setData(const std::vector<float>& growth, float totalGrowth)
+        void setData(const std::vector<float>& growth, float totalGrowth) noexcept
         {
-            this->growth = growth;
+            this->growth = &growth;
             this->totalGrowth = totalGrowth;
-            this->validData = true;
         }
-        std::vector<float>* getGrowth()
+        const std::vector<float>* getGrowth() const noexcept
         {
-            if(validData)
-                return &growth;
-            return nullptr;
+            return growth;
         }
-        float* getTotalGrowth()
+        const float* getTotalGrowth() const noexcept
         {
-            if(validData)
+            if(growth != nullptr)
                 return &totalGrowth;
             return nullptr;
         }
     private:
-        bool validData = false;
-        std::vector<float> growth;
-        float totalGrowth;
+        const std::vector<float>* growth = nullptr;
+        float totalGrowth = 0.0f;
     };
     //==========================================================================
 
@@ -196,6 +319,18 @@ public:
             throw std::invalid_argument("Channel index has to be between 0 and " + std::to_string(numChannels));
         return storeAudioBlock(buffer.getReadPointer(channel), buffer.getNumSamples());
     }
+
+    /**
+     * Stores an audio block into the buffer of the module
+     * Raw pointer version of store(), for use without JUCE buffers.
+     * @param input samples of the audio block
+     * @param n number of samples, it has to match the block size given to prepare()
+     * @return growth analysis data
+    */
+    GrowthData store (const SampleType* input, size_t n)
+    {
+        return storeAudioBlock(input, n);
+    }
     /*--------------------------- Setters/getters ----------------------------*/
 
     /**
@@ -206,6 +341,7 @@ public:
     void setWindowFunction(tIDLib::WindowFunctionType func)
     {
         this->windowFunction = func;
+        this->windowTable.acquire(func, this->analysisWindowSize);
     }
 
     /**
@@ -234,6 +370,63 @@ public:
         return std::make_pair(this->loThresh,this->hiThresh );
     }
 
+    /**
+     * Enable the low-latency multi-resolution detection
+     * A short window, analysed every earlyHop samples (also inside a block),
+     * triggers the detection when its total growth exceeds the early threshold.
+     * While triggered, the long window ending at the same sample is analysed
+     * too, and the onset is reported as soon as its growth exceeds the high
+     * threshold, without waiting for the growth to drop and for the next hop.
+     * Triggers that the long window does not confirm within one window are
+     * discarded. Onsets that the short window misses are still reported as
+     * in the standard mode.
+     * Early onsets are reported only with the onset events, whose onsetIndex
+     * is the position where the short window triggered.
+     * It allocates, do not call it from the audio thread.
+     * @param enable early detection state
+     * @param earlyWindowSize size of the short window (at most the analysis window size)
+     * @param earlyHop samples between two analyses of the short window
+    */
+    void setEarlyDetection(bool enable, unsigned long int earlyWindowSize = 256, unsigned long int earlyHop = 32)
+    {
+        if(enable)
+        {
+            if(earlyWindowSize < tIDLib::MINWINDOWSIZE || earlyWindowSize > this->analysisWindowSize)
+                throw std::invalid_argument("Early window size must be between "+std::to_string(tIDLib::MINWINDOWSIZE)+" and the analysis window size ("+std::to_string(this->analysisWindowSize)+").");
+            if(earlyHop < 1 || earlyHop > earlyWindowSize)
+                throw std::invalid_argument("Early hop must be between 1 and the early window size.");
+
+            this->earlyWindowSize = earlyWindowSize;
+            this->earlyHop = earlyHop;
+            initEarlyDetection();
+        }
+        this->earlyDetection = enable;
+        this->earlyTick = 0;
+        this->earlyTriggered = false;
+    }
+
+    bool getEarlyDetection() const noexcept
+    {
+        return this->earlyDetection;
+    }
+
+    /**
+     * Set the growth threshold of the short window
+     * Lower values trigger earlier, and the long window rejects more triggers.
+     * @param thresh early growth threshold
+    */
+    void setEarlyThresh(float thresh)
+    {
+        if(thresh <= 0)
+            throw std::invalid_argument("Early threshold must be positive");
+        this->earlyThresh = thresh;
+    }
+
+    float getEarlyThresh() const noexcept
+    {
+        return this->earlyThresh;
+    }
+
     /**
      * Set the minimum triggering
      * Set the velocity/amplitude threshold for the detector, which will ignore
@@ -302,13 +495,14 @@ public:
 
         this->loBin = lo;
         this->hiBin = hi;
+        updateBandRange();
     }
 
     /**
      * Set mask parameters
      * Specify a number of analysis periods and decay rate for the energy mask.
      * (From wbrent tIDLib bark~.pd help example)
-     * @param analysisPeriods The analysis period
+     * @param analysisPeriods The analysis period (at most tIDLib::MAXMASKPERIODS are counted)
      * @param decayRate The decay rate [ range (0.05,0.95) ]
     */
     void setMask(unsigned int analysisPeriods, float decayRate)
@@ -317,6 +511,7 @@ public:
             throw std::invalid_argument("Mask decay rate must be betweeen 0.05 and 0.95");
         this->maskPeriods = analysisPeriods;
         this->maskDecay = decayRate;
+        updateEarlyMask();
     }
 
     /**
@@ -443,8 +638,9 @@ public:
     std::string getFilterFreqsInfo() const noexcept
     {
         std::string res;
+        const std::vector<float>& filterFreqs = this->filterbank.getFilterFreqs();
         for(t_filterIdx i=0; i<this->numFilters+2; ++i)
-            res += "FilterFreq["+std::to_string(i)+"]: "+std::to_string(this->filterFreqs[i]);
+            res += "FilterFreq["+std::to_string(i)+"]: "+std::to_string(filterFreqs[i]);
         return res;
     }
 
@@ -504,43 +700,9 @@ public:
         return &rtlogger;
     }
 
-    /*-----------------------------*/
-
-    /**
-        Used to receive callbacks when an onset is detected.
-
-        @see Bark::addListener, Bark::removeListener
-    */
-    class Listener
-    {
-    public:
-        /** Destructor. */
-        virtual ~Listener() = default;
-
-        /** Called when the onset is detected. */
-        virtual void onsetDetected (Bark *) = 0;
-    };
-
-    /** Registers a listener to receive events when onsets are detected.
-        If the listener is already registered, this will not register it again.
-        @see removeListener
-    */
-    void addListener (Listener* newListener)
-    {
-        barkListeners.add(newListener);
-    }
-
-    /** Removes a previously-registered bark listener
-        @see addListener
-    */
-    void removeListener (Listener* listener)
-    {
-        barkListeners.remove(listener);
-    }
-
 private:
 
-    ListenerList<Listener> barkListeners;
+    uint64 samplesStored = 0;
     bool isDebugMode = false; // debug MODE
     bool isSpewMode = false;  // spew mode
 
@@ -558,12 +720,13 @@ private:
 
     float barkSpacing = tIDLib::BARKSPACINGDEFAULT;
     t_filterIdx numFilters = 0;
-    t_filterIdx sizeFilterFreqs;
-    std::vector<float> filterFreqs;
-    std::vector<tIDLib::t_filter> filterbank;
+    SharedFilterbank filterbank;  // shared, read-only
+    std::vector<float> bandEnergies;  // output of the filterbank
     tIDLib::FilterState filterState = tIDLib::FilterState::filterEnabled;
     tIDLib::FilterOperation filterOperation = tIDLib::FilterOperation::sumFilterEnergy;        //triangular filter operation type (sum or avg)
     std::vector<float> loudWeights;
+    std::vector<float> unitWeights;     // used when the loudness weighting is disabled
+    std::vector<float> bandRange;       // 1 for the bands in loBin..hiBin, 0 otherwise
 
     unsigned int measureTicks = UINT_MAX;
     float peakGrowth = 0.0f;
@@ -576,28 +739,48 @@ private:
     t_filterIdx loBin;
     t_filterIdx hiBin;
 
-    int debounceTime = 100;
+    int debounceTime = 100;         // converted to samples by the debounce
     float maskDecay = 0.7f;
     unsigned int maskPeriods = 4;
-    std::vector<t_filterIdx> numPeriods; // t_filterIdx type because this buffer is used to check making per filter band
+    std::vector<unsigned short> numPeriods; // periods since each band was above its mask, saturated at maskPeriods
 
-    bool debounceActive = false;    //system flag, stays true for debounceTime millis after every hit
+    SampleClockDebounce debounce;   // active for debounceTime millis (of samples) after every hit
     bool haveHit = false;
 
-    std::vector<float> blackman;
-    std::vector<float> cosine;
-    std::vector<float> hamming;
-    std::vector<float> hann;
+    WindowTable windowTable;   // shared, read-only table of windowFunction (none for rectangular)
 
     std::vector<SampleType> signalBuffer;
 
     std::vector<float> fftwInputVector;
     float *fftwIn;
-    fftwf_complex *fftwOut;
-    fftwf_plan fftwPlan;
+    fft::Complex *fftwOut;
+    FftPlan fftwPlan;
 
     std::vector<float> mask;
-    std::vector<float> growth;
+    std::vector<float> growthBuffers[2];   // double buffered, see GrowthData
+    int growthWriteIndex = 0;             // buffer written by the next analysis
+
+    /* low-latency multi-resolution detection */
+    bool earlyDetection = false;
+    unsigned long int earlyWindowSize = 256;
+    unsigned long int earlyHop = 32;
+    unsigned long int earlyTick = 0;    // samples since the last early analysis
+    float earlyThresh = EARLY_THRESH_DEFAULT;
+    bool earlyTriggered = false;
+    uint64 earlyTriggerIndex = 0;       // estimated onset position of the current trigger
+    std::vector<float> earlyWindowFunc;
+    std::vector<float> earlyInputVector;
+    fft::Complex *earlyOut = nullptr;
+    FftPlan earlyPlan;
+    SharedFilterbank earlyFilterbank;
+    t_filterIdx earlyNumFilters = 0;
+    std::vector<float> earlyBands;
+    std::vector<float> earlyMask;
+    std::vector<unsigned short> earlyNumPeriods;
+    std::vector<float> earlyGrowthBands;
+    std::vector<float> earlyUnit;       // unit weights and full band range of the short window
+    unsigned short earlyMaskPeriods = 4;
+    float earlyMaskDecay = 0.7f;
 
     tid::RealTimeLogger rtlogger { "bark onset" };
 
@@ -605,78 +788,27 @@ private:
 
     void createLoudnessWeighting()
     {
-        std::vector<float> barkFreqs(this->numFilters,0.0f);
-
-        float barkSum = this->barkSpacing;
-
-        for(t_filterIdx i = 0; i < this->numFilters; ++i)
-        {
-            barkFreqs[i] = tIDLib::bark2freq(barkSum);
-            barkSum += this->barkSpacing;
-        }
-
-        for(t_filterIdx i = 0; i < this->numFilters; ++i)
-        {
-            t_binIdx nearIdx = tIDLib::nearestBinIndex(barkFreqs[i], weights_freqs, tIDLib::NUMWEIGHTPOINTS);
-            float nearFreq = weights_freqs[nearIdx];
-            float diffdB = 0.0f;
-
-            float diffFreq, dBint;
-
-            // wbrent original comment:
-            // this doesn't have to be if/else'd into a greater/less situation.  later on i should write a more general interpolation solution, and maybe move it up to 4 points instead.
-            if(barkFreqs[i]>nearFreq)
-            {
-                if(nearIdx <= tIDLib::NUMWEIGHTPOINTS-2)
-                {
-                    diffFreq = (barkFreqs[i] - nearFreq)/(weights_freqs[nearIdx+1] - nearFreq);
-                    diffdB = diffFreq * (weights_dB[nearIdx+1] - weights_dB[nearIdx]);
-                }
-
-                dBint = weights_dB[nearIdx] + diffdB;
-            }
-            else
-            {
-                if(nearIdx > 0)
-                {
-                    diffFreq = (barkFreqs[i] - weights_freqs[nearIdx-1])/(nearFreq - weights_freqs[nearIdx-1]);
-                    diffdB = diffFreq * (weights_dB[nearIdx] - weights_dB[nearIdx-1]);
-                }
-
-                dBint = weights_dB[nearIdx-1] + diffdB;
-            }
-
-            switch(this->spectrumTypeUsed)
-            {
-                case tIDLib::SpectrumType::powerSpectrum:
-                    this->loudWeights[i] = powf(10.0f, dBint*0.1f);
-                    break;
-                case tIDLib::SpectrumType::magnitudeSpectrum:
-                    this->loudWeights[i] = powf(10.0f, dBint*0.05f);
-                    break;
-                default:
-                    throw std::logic_error("Spectrum type option not available!");
-            }
-
-        }
+        createBarkLoudnessWeights(this->loudWeights, this->numFilters, this->barkSpacing, this->spectrumTypeUsed);
     }
 
     /* END Utility functions -------------------------------------------------*/
 
-    void timerCallback() override
+    void resizeBuffer()
     {
-        Timer::stopTimer();
-        clearHit();
+        signalBuffer.resize(this->analysisWindowSize + this->blockSize,SampleType{0});
     }
 
-    void resizeBuffer()
+    void updateBandRange()
     {
-        signalBuffer.resize(this->analysisWindowSize + this->blockSize,SampleType{0});
+        this->bandRange.resize(this->numFilters);
+        for(t_filterIdx i=0; i<this->numFilters; ++i)
+            this->bandRange[i] = (i>=this->loBin && i<=this->hiBin) ? 1.0f : 0.0f;
     }
 
-    void clearHit()
+    /** Mask periods as used by tIDLib::growthMaskUpdate */
+    unsigned short getMaskPeriods() const noexcept
     {
-        this->debounceActive = false;
+        return (unsigned short)std::min<unsigned int>(this->maskPeriods, tIDLib::MAXMASKPERIODS);
     }
 
     void initModule()
@@ -684,155 +816,263 @@ private:
         resizeBuffer();
         reset();
 
-        this->blackman.resize(this->analysisWindowSize);
-        this->cosine.resize(this->analysisWindowSize);
-        this->hamming.resize(this->analysisWindowSize);
-        this->hann.resize(this->analysisWindowSize);
-         // initialize signal windowing functions
-        tIDLib::initBlackmanWindow(this->blackman);
-        tIDLib::initCosineWindow(this->cosine);
-        tIDLib::initHammingWindow(this->hamming);
-        tIDLib::initHannWindow(this->hann);
+        // window table shared with the other instances of the same size
+        this->windowTable.acquire(this->windowFunction, this->analysisWindowSize);
 
         this->fftwInputVector.resize(this->analysisWindowSize);
         this->fftwIn = &this->fftwInputVector[0];
 
         // set up the FFTW output buffer
-        this->fftwOut = (fftwf_complex *)fftwf_alloc_complex(this->analysisWindowSize*0.5f + 1);
-        // DFT plan
-        this->fftwPlan = fftwf_plan_dft_r2c_1d(this->analysisWindowSize, this->fftwIn, this->fftwOut, FFTWPLANNERFLAG);
+        this->fftwOut = fft::allocComplex(this->analysisWindowSize*0.5f + 1);
+        // DFT plan (shared with the other instances of the same size)
+        this->fftwPlan.createRealToComplex(this->analysisWindowSize, this->fftwIn, this->fftwOut);
 
         // we're supposed to initialize the input array after we create the plan
         for(unsigned long int i=0; i<this->analysisWindowSize; ++i)
             this->fftwIn[i] = 0.0f;
 
-        sizeFilterFreqs = tIDLib::getBarkBoundFreqs(this->filterFreqs, this->barkSpacing, this->sampleRate);
-
-        jassert(sizeFilterFreqs == this->filterFreqs.size());
-
-        // sizeFilterFreqs-2 is the correct number of filters, since we don't count the start point of the first filter, or the finish point of the last filter
-        this->numFilters = this->sizeFilterFreqs-2;
+        acquireFilterbank();
+    }
 
-        tIDLib::createFilterbank(this->filterFreqs, this->filterbank, this->numFilters, this->analysisWindowSize, this->sampleRate);
+    /** Acquire the filterbank for the current spacing, window size and sample rate, and size the band arrays for it */
+    void acquireFilterbank()
+    {
+        // filterbank shared with the other instances with the same spacing, window size and sample rate
+        this->filterbank.acquire(FilterbankScale::bark, this->barkSpacing, this->analysisWindowSize, this->sampleRate);
+        const t_filterIdx previousNumFilters = this->numFilters;
+        this->numFilters = this->filterbank.getNumFilters();
+        this->bandEnergies.resize(this->numFilters);
 
-        this->loBin = 0;
-        this->hiBin = this->numFilters-1;
+        if(this->numFilters != previousNumFilters)
+        {
+            this->loBin = 0;
+            this->hiBin = this->numFilters-1;
+        }
 
-        this->mask.resize(this->numFilters, 0.0f);
-        this->growth.resize(this->numFilters, 0.0f);
-        this->numPeriods.resize(this->numFilters, 0);
+        this->mask.assign(this->numFilters, 0.0f);
+        for(std::vector<float>& growthBuffer : this->growthBuffers)
+            growthBuffer.assign(this->numFilters, 0.0f);
+        this->numPeriods.assign(this->numFilters, 0);
         this->loudWeights.resize(this->numFilters, 0.0f);
+        this->unitWeights.assign(this->numFilters, 1.0f);
+        updateBandRange();
 
         createLoudnessWeighting();
     }
 
-    void outputOnset()
+    /** Publish an onset event (lock-free, real-time safe) */
+    void outputOnset(float totalGrowth, float totalVel) noexcept
     {
-        barkListeners.call([this] (Listener& l) { l.onsetDetected (this); });
+        outputOnset(totalGrowth, totalVel, this->samplesStored);
     }
 
-    GrowthData storeAudioBlock(const SampleType* input, size_t n)
+    void outputOnset(float totalGrowth, float totalVel, uint64 onsetIndex) noexcept
     {
-        jassert(n ==  this->blockSize);
+        this->publishOnsetEvent({this->samplesStored, onsetIndex, totalGrowth, totalVel});
+    }
 
-        GrowthData growthData;
-        unsigned long int window, windowHalf;
-        float totalGrowth, totalVel;
-        std::vector<float> *windowFuncPtr;
+    /* Early detection -------------------------------------------------------*/
 
-        window = this->analysisWindowSize;
-        windowHalf = this->analysisWindowSize*0.5f;
+    void initEarlyDetection()
+    {
+        this->earlyWindowFunc.resize(this->earlyWindowSize);
+        tIDLib::initHannWindow(this->earlyWindowFunc);
+
+        this->earlyPlan.reset();
+        if(this->earlyOut != nullptr)
+            fft::freeComplex(this->earlyOut);
+        this->earlyInputVector.assign(this->earlyWindowSize, 0.0f);
+        this->earlyOut = fft::allocComplex(this->earlyWindowSize/2 + 1);
+        this->earlyPlan.createRealToComplex(this->earlyWindowSize, this->earlyInputVector.data(), this->earlyOut);
+        std::fill(this->earlyInputVector.begin(), this->earlyInputVector.end(), 0.0f);
+
+        this->earlyFilterbank.acquire(FilterbankScale::bark, EARLY_BARK_SPACING, this->earlyWindowSize, this->sampleRate);
+        this->earlyNumFilters = this->earlyFilterbank.getNumFilters();
+        this->earlyBands.assign(this->earlyNumFilters, 0.0f);
+
+        this->earlyMask.assign(this->earlyNumFilters, 0.0f);
+        this->earlyNumPeriods.assign(this->earlyNumFilters, 0);
+        this->earlyGrowthBands.assign(this->earlyNumFilters, 0.0f);
+        this->earlyUnit.assign(this->earlyNumFilters, 1.0f);
+        updateEarlyMask();
+    }
 
-         // shift signal buffer contents back.
-        for(unsigned long int i=0; i<window; ++i)
-            this->signalBuffer[i] = this->signalBuffer[i+n];
+    /** Mask of the short window with the same time constants of the long one */
+    void updateEarlyMask()
+    {
+        const float hopRatio = (float)this->earlyHop / (float)this->hop;
+        this->earlyMaskPeriods = (unsigned short)std::min<float>(std::max(1.0f, this->maskPeriods / hopRatio + 0.5f), tIDLib::MAXMASKPERIODS);
+        this->earlyMaskDecay = powf(this->maskDecay, hopRatio);
+    }
 
-        // write new block to end of signal buffer.
-        for(unsigned long int i=0; i<n; ++i)
-            this->signalBuffer[window+i] = input[i];
+    /**
+     * Total growth of the short window that starts at windowStart, updating its mask
+     * @param earlyVel returns the sum of the band energies
+    */
+    float computeEarlyGrowth(const SampleType* windowStart, float& earlyVel)
+    {
+        float* earlyIn = this->earlyInputVector.data();
+        for(unsigned long int i=0; i<this->earlyWindowSize; ++i)
+            earlyIn[i] = windowStart[i] * this->earlyWindowFunc[i];
+
+        this->earlyPlan.execute();
+        tIDLib::power(this->earlyWindowSize/2 + 1, this->earlyOut, earlyIn);
+        tIDLib::filterbankMultiply(earlyIn, this->earlyBands.data(), false, false, this->earlyFilterbank.getFilters(), this->earlyNumFilters);
+
+        // all the bands, without weighting
+        float earlyGrowth;
+        tIDLib::growthMaskUpdate(this->earlyNumFilters, this->earlyBands.data(), this->earlyUnit.data(), this->earlyUnit.data(),
+                                 this->earlyMask.data(), this->earlyNumPeriods.data(), this->earlyMaskPeriods, this->earlyMaskDecay,
+                                 this->earlyGrowthBands.data(), earlyGrowth, earlyVel);
+        return earlyGrowth;
+    }
 
-        this->dspTick += n;
+    /** Report the triggered onset, confirmed by the long window */
+    void outputEarlyOnset(float totalGrowth, float totalVel) noexcept
+    {
+        if(this->isDebugMode)
+            rtlogger.logBinary("Early: {}",totalGrowth);
 
-        if(this->dspTick >= this->hop)
+        this->earlyTriggered = false;
+        this->haveHit = false;
+        this->debounce.start(this->debounceTime);
+        outputOnset(totalGrowth, totalVel, this->earlyTriggerIndex);
+    }
+
+    /**
+     * Analyse the short window every earlyHop samples of the block just stored,
+     * and confirm the triggers with the long window ending at the same sample
+    */
+    void detectEarlyOnsets(size_t n)
+    {
+        TID_PROFILE_SCOPE(bark, earlyDetection);
+        const uint64 blockStart = this->samplesStored - n;
+        // signalBuffer[analysisWindowSize] is the first sample of the block
+        const SampleType* block = this->signalBuffer.data() + this->analysisWindowSize;
+
+        for(size_t end = this->earlyHop - this->earlyTick; end <= n; end += this->earlyHop)
         {
-            this->dspTick = 0;
-            totalGrowth = 0.0f;
-            totalVel = 0.0f;
+            float earlyVel;
+            const float earlyGrowth = computeEarlyGrowth(block + end - this->earlyWindowSize, earlyVel);
+            const uint64 endIndex = blockStart + end;
 
-            switch(this->windowFunction)
+            if(!this->earlyTriggered)
             {
-                case tIDLib::WindowFunctionType::rectangular:
-                    break;
-                case tIDLib::WindowFunctionType::blackman:
-                    windowFuncPtr = &this->blackman;
-                    break;
-                case tIDLib::WindowFunctionType::cosine:
-                    windowFuncPtr = &this->cosine;
-                    break;
-                case tIDLib::WindowFunctionType::hamming:
-                    windowFuncPtr = &this->hamming;
-                    break;
-                case tIDLib::WindowFunctionType::hann:
-                    windowFuncPtr = &this->hann;
-                    break;
-                default:
-                    windowFuncPtr = &this->blackman;
-                    break;
-            };
-
-            // if windowFunction == 0, skip the windowing (rectangular)
-            if(this->windowFunction != tIDLib::WindowFunctionType::rectangular)
+                if(this->debounce.isActive() || this->haveHit || earlyVel < this->minvel || earlyGrowth <= this->earlyThresh)
+                    continue;
+                // the attack started after the previous analysis of the short window
+                this->earlyTriggered = true;
+                this->earlyTriggerIndex = endIndex - std::min<uint64>(this->earlyHop, endIndex);
+            }
+            else if(endIndex - this->earlyTriggerIndex > this->analysisWindowSize)
             {
-                for(unsigned long int i=0; i<window; ++i)
-                    this->fftwIn[i] = this->signalBuffer[i] * windowFuncPtr->at(i);
+                this->earlyTriggered = false;   // not confirmed
+                continue;
             }
-            else
+
+            // growth of the long window against the current mask, without updating it
+            computeBandEnergies(block + end - this->analysisWindowSize);
+            const float* weights = getBandWeights();
+            float totalGrowth = 0.0f, totalVel = 0.0f;
+            for(unsigned long int i=0; i < this->numFilters; ++i)
             {
-                for(unsigned long int i=0; i<window; ++i)
-                    this->fftwIn[i] = this->signalBuffer[i];
+                const float energy = this->bandEnergies[i] * weights[i];
+                const float growth = energy > this->mask[i] ? energy/(this->mask[i] + 1.0e-15f) - 1.0f : 0.0f;
+                totalVel += energy;
+                totalGrowth += std::max(growth, 0.0f) * this->bandRange[i];
             }
+            if(totalVel >= this->minvel && totalGrowth > this->hiThresh && !this->debounce.isActive())
+                outputEarlyOnset(totalGrowth, totalVel);
+        }
+        this->earlyTick = (this->earlyTick + n) % this->earlyHop;
+    }
 
-            fftwf_execute(this->fftwPlan);
+    /* END Early detection ---------------------------------------------------*/
 
-            // put the result of power calc back in fftwIn
-            tIDLib::power(windowHalf+1, this->fftwOut, this->fftwIn);
+    /**
+     * Window, FFT and filterbank of the long analysis window that starts at
+     * windowStart. The band energies are left in bandEnergies,
+     * without loudness weighting (see getBandWeights())
+    */
+    void computeBandEnergies(const SampleType* windowStart)
+    {
+        const unsigned long int window = this->analysisWindowSize;
+        const unsigned long int windowHalf = this->analysisWindowSize*0.5f;
 
-            if(this->spectrumTypeUsed == tIDLib::SpectrumType::magnitudeSpectrum)
-                tIDLib::mag(windowHalf+1, this->fftwIn);
+        TID_PROFILE_BEGIN(bark, windowCopy);
+        tIDLib::windowCopy(windowStart, this->windowTable.data(), this->fftwIn, window);
+        TID_PROFILE_END(bark, windowCopy);
 
-            switch(this->filterState)
-            {
-                case tIDLib::FilterState::filterDisabled:
-                    tIDLib::specFilterBands(windowHalf+1, this->numFilters, this->fftwIn, this->filterbank, this->normalize);
-                    break;
-                case tIDLib::FilterState::filterEnabled:
-                    tIDLib::filterbankMultiply(this->fftwIn, this->normalize, this->filterOperation, this->filterbank, this->numFilters);
-                    break;
-                default:
-                    throw std::logic_error("Filter option not available");
-                    break;
-            }
+        TID_PROFILE_BEGIN(bark, fft);
+        this->fftwPlan.execute();
+        TID_PROFILE_END(bark, fft);
 
-             // optional loudness weighting
-            if(this->useWeights)
-                for(unsigned long int i=0; i<this->numFilters; ++i)
-                    this->fftwIn[i] *= this->loudWeights[i];
+        // put the result of power calc back in fftwIn
+        tIDLib::power(windowHalf+1, this->fftwOut, this->fftwIn);
 
-            for(unsigned long int i=0; i < this->numFilters; ++i)
-            {
-                totalVel += this->fftwIn[i];
+        if(this->spectrumTypeUsed == tIDLib::SpectrumType::magnitudeSpectrum)
+            tIDLib::mag(windowHalf+1, this->fftwIn);
 
-                // init growth list to zero
-                this->growth[i] = 0.0f;
+        TID_PROFILE_BEGIN(bark, filterbank);
+        switch(this->filterState)
+        {
+            case tIDLib::FilterState::filterDisabled:
+                tIDLib::specFilterBands(windowHalf+1, this->numFilters, this->fftwIn, &this->bandEnergies[0], this->filterbank.getFilters(), this->normalize);
+                break;
+            case tIDLib::FilterState::filterEnabled:
+                tIDLib::filterbankMultiply(this->fftwIn, &this->bandEnergies[0], this->normalize, this->filterOperation, this->filterbank.getFilters(), this->numFilters);
+                break;
+            default:
+                throw std::logic_error("Filter option not available");
+                break;
+        }
+        TID_PROFILE_END(bark, filterbank);
+    }
 
-                // from p.3 of Puckette/Apel/Zicarelli, 1998
-                // salt divisor with + 1.0e-15 in case previous power was zero
-                if(this->fftwIn[i] > this->mask[i])
-                    this->growth[i] = this->fftwIn[i]/(this->mask[i] + 1.0f-15) - 1.0f;
+    /** Loudness weights of the bands, or ones if the weighting is disabled */
+    const float* getBandWeights() const noexcept
+    {
+        return this->useWeights ? this->loudWeights.data() : this->unitWeights.data();
+    }
 
-                if(i>=this->loBin && i<=this->hiBin && this->growth[i]>0)
-                    totalGrowth += this->growth[i];
-            }
+    GrowthData storeAudioBlock(const SampleType* input, size_t n)
+    {
+        TID_PROFILE_SCOPE(bark, storeAudioBlock);
+        jassert(n ==  this->blockSize);
+
+        GrowthData growthData;
+        const unsigned long int window = this->analysisWindowSize;
+        float totalGrowth, totalVel;
+
+         // shift signal buffer contents back.
+        for(unsigned long int i=0; i<window; ++i)
+            this->signalBuffer[i] = this->signalBuffer[i+n];
+
+        // write new block to end of signal buffer.
+        for(unsigned long int i=0; i<n; ++i)
+            this->signalBuffer[window+i] = input[i];
+
+        this->dspTick += n;
+        this->samplesStored += n;
+
+        // Debounce on the sample clock
+        this->debounce.advance(n);
+
+        if(this->earlyDetection)
+            detectEarlyOnsets(n);
+
+        if(this->dspTick >= this->hop)
+        {
+            this->dspTick = 0;
+            computeBandEnergies(this->signalBuffer.data());
+
+            // loudness weighting, growth, totals and mask update in one pass
+            std::vector<float>& growth = this->growthBuffers[this->growthWriteIndex];
+            TID_PROFILE_BEGIN(bark, growth);
+            tIDLib::growthMaskUpdate(this->numFilters, this->bandEnergies.data(), getBandWeights(), this->bandRange.data(),
+                                     this->mask.data(), this->numPeriods.data(), getMaskPeriods(), this->maskDecay,
+                                     growth.data(), totalGrowth, totalVel);
+            TID_PROFILE_END(bark, growth);
 
             if(this->measureTicks != UINT_MAX)
             {
@@ -843,19 +1083,22 @@ private:
                 this->measureTicks++;
             }
 
-            if(totalVel >= this->minvel && totalGrowth > this->hiThresh && !this->haveHit && !this->debounceActive)
+            if(this->earlyTriggered && totalVel >= this->minvel && totalGrowth > this->hiThresh && !this->debounce.isActive())
+            {
+                outputEarlyOnset(totalGrowth, totalVel);
+            }
+            else if(totalVel >= this->minvel && totalGrowth > this->hiThresh && !this->haveHit && !this->debounce.isActive())
             {
                 if(this->isDebugMode)
-                    rtlogger.logValue("Peak: ",totalGrowth);
+                    rtlogger.logBinary("Peak: {}",totalGrowth);
 
                 this->haveHit = true;
-                this->debounceActive = true;
-                Timer::startTimer(this->debounceTime); // wait debounceTime ms before allowing another attack
+                this->debounce.start(this->debounceTime); // wait debounceTime ms before allowing another attack
             }
             else if(this->haveHit && this->loThresh>0 && totalGrowth < this->loThresh) // if loThresh is an actual value (not -1), then wait until growth drops below that value before reporting attack
             {
                 if(this->isDebugMode)
-                    rtlogger.logValue("Drop: ",totalGrowth);
+                    rtlogger.logBinary("Drop: {}",totalGrowth);
 
                 this->haveHit = false;
 
@@ -863,12 +1106,12 @@ private:
                 if(!this->isSpewMode)
                     growthData.setData(growth,totalGrowth);
 
-                outputOnset();
+                outputOnset(totalGrowth, totalVel);
             }
             else if(this->haveHit && this->loThresh<0 && totalGrowth < this->prevTotalGrowth) // if loThresh == -1, report attack as soon as growth shows any decay at all
             {
                 if(this->isDebugMode)
-                    rtlogger.logValue("Drop: ",totalGrowth);
+                    rtlogger.logBinary("Drop: {}",totalGrowth);
 
                 this->haveHit = false;
 
@@ -876,29 +1119,17 @@ private:
                 if(!this->isSpewMode)
                     growthData.setData(growth,totalGrowth);
 
-                outputOnset();
+                outputOnset(totalGrowth, totalVel);
             }
 
             if(this->isSpewMode)
                 growthData.setData(growth,totalGrowth);
 
-            // update mask
-            for(unsigned long int i=0; i<this->numFilters; ++i)
-            {
-                if(this->fftwIn[i] > this->mask[i])
-                {
-                    this->mask[i] = this->fftwIn[i];
-                    this->numPeriods[i] = 0;
-                }
-                else
-                {
-                    this->numPeriods[i]++;
-                    if(this->numPeriods[i] >= this->maskPeriods)
-                        this->mask[i] *= this->maskDecay;
-                }
-            }
-
             this->prevTotalGrowth = totalGrowth;
+
+            // The reported growth stays untouched until the next report
+            if(growthData.getGrowth() != nullptr)
+                this->growthWriteIndex = 1 - this->growthWriteIndex;
         }
 
         return growthData;
@@ -907,9 +1138,364 @@ private:
     void freeMem()
     {
         // free FFTW stuff
-        fftwf_free(this->fftwOut);
-        fftwf_destroy_plan(this->fftwPlan);
+        fft::freeComplex(this->fftwOut);
+        this->fftwPlan.reset();
+        this->earlyPlan.reset();
+        if(this->earlyOut != nullptr)
+            fft::freeComplex(this->earlyOut);
+        this->earlyOut = nullptr;
     }
 };
 
+/**
+ * Onset reported by MultiBark
+*/
+struct MultiBarkOnsetEvent
+{
+    uint64 sampleIndex;     // samples stored since prepare()/reset() when the onset was reported (end of the analysis window)
+    unsigned int channel;   // channel of the onset, from 0 (the first channel analysed)
+    float growth;           // total growth of the analysis period that reported the onset
+    float velocity;         // total velocity (sum of the band energies) of the same period
+};
+
+/**
+ * Onset detector for up to tIDLib::INTERLEAVEDLANES channels (e.g. one per
+ * string of a hexaphonic pickup)
+ * Every channel is analysed like a Bark (standard mode, triangular filters),
+ * with its own mask, thresholds state and debounce, and reports the same
+ * onsets. The window table, the FFT, the filterbank and the loudness
+ * weights are shared by the channels, and the filterbank (and, with the
+ * built-in backend and 3 channels or more, the FFT) runs on all of them at
+ * once (see tidMultiChannel.hpp).
+ * Onsets are published as OnsetEvent, with the channel, into a lock-free
+ * queue like in Bark.
+*/
+template <typename SampleType>
+class MultiBark : public tid::OnsetEventQueue<MultiBark<SampleType>, MultiBarkOnsetEvent, 64 * tIDLib::INTERLEAVEDLANES>
+{
+public:
+    static constexpr unsigned int LANES = tIDLib::INTERLEAVEDLANES;
+
+    /**
+     * MultiBark constructor
+     * @param numChannels number of channels analysed (1 to tIDLib::INTERLEAVEDLANES)
+     * @param analysisWindowSize size of the analysis window
+     * @param hop number of samples are analysed at every period
+     * @param barkSpacing filter spacing in Barks
+    */
+    MultiBark(unsigned int numChannels, unsigned long int analysisWindowSize = tIDLib::WINDOWSIZEDEFAULT,
+              unsigned long int hop = tIDLib::WINDOWSIZEDEFAULT*0.25f, float barkSpacing = tIDLib::BARKSPACINGDEFAULT)
+    {
+        if(hop < 1)
+            throw std::invalid_argument("hop must be greater than 1 sample.");
+        this->hop = hop;
+        this->bands.setup(numChannels, analysisWindowSize, barkSpacing, this->sampleRate, analysisWindowSize + this->blockSize);
+        initChannels();
+        reset();
+    }
+
+    /**
+     * Initialization of the module (it allocates, the filterbank is built for the new sample rate)
+     * @param sampleRate The sample rate of the buffer
+     * @param blockSize The size of the individual audio blocks
+    */
+    void prepare (unsigned long int sampleRate, unsigned int blockSize)
+    {
+        this->sampleRate = sampleRate;
+        this->blockSize = blockSize;
+        this->bands.setup(getNumChannels(), getWindowSize(), getBarkSpacing(), (double)sampleRate, getWindowSize() + blockSize);
+        initChannels();
+        reset();
+    }
+
+    /**
+     * Resets the processing pipeline.
+     * It empties the analysis buffers, the masks and the detection state of every
+     * channel, and restarts the sample count of the onset events
+    */
+    void reset() noexcept
+    {
+        this->bands.clear();
+        this->samplesStored = 0;
+        this->dspTick = 0;
+        for(ChannelState& channel : this->channels)
+        {
+            std::fill(channel.mask.begin(), channel.mask.end(), 0.0f);
+            std::fill(channel.numPeriods.begin(), channel.numPeriods.end(), 0);
+            channel.prevTotalGrowth = 0.0f;
+            channel.haveHit = false;
+            channel.debounce.clear();
+        }
+    }
+    //==========================================================================
+    /** Onset reported by the detector, with its channel (the queue and the Listener are in OnsetEventQueue, as for Bark) */
+    using OnsetEvent = MultiBarkOnsetEvent;
+    //==========================================================================
+
+    /**
+     * Stores the channels firstChannel ... firstChannel+getNumChannels()-1 of an audio block
+     * Onset detection is performed every hop samples.
+     * @param buffer audio buffer
+     * @param firstChannel index of the first channel analysed
+    */
+    template <typename OtherSampleType>
+    void store (AudioBuffer<OtherSampleType>& buffer, short firstChannel = 0)
+    {
+        static_assert (std::is_same<OtherSampleType, SampleType>::value,
+                       "The sample-type of the MultiBark module must match the sample-type supplied to this store callback");
+        this->block.interleave(buffer, firstChannel);
+        store(this->block);
+    }
+
+    /**
+     * Stores an audio block of every channel
+     * @param channels getNumChannels() pointers to n samples
+     * @param n number of samples, it has to match the block size given to prepare()
+    */
+    void store (const SampleType* const* channels, size_t n)
+    {
+        this->block.interleave(channels, n);
+        store(this->block);
+    }
+
+    /** Stores an audio block already interleaved (at least getNumChannels() channels) */
+    void store (const InterleavedBlock& interleaved)
+    {
+        if(interleaved.getNumChannels() < getNumChannels())
+            throw std::invalid_argument("The interleaved block has "+std::to_string(interleaved.getNumChannels())+" channels, "+std::to_string(getNumChannels())+" are analysed");
+        storeAudioBlock(interleaved.getFrames(), interleaved.getNumFrames());
+    }
+    /*--------------------------- Setters/getters ----------------------------*/
+
+    /** Set the window function used (options in tIDLib header file) */
+    void setWindowFunction(tIDLib::WindowFunctionType func)
+    {
+        this->bands.setWindowFunction(func);
+    }
+
+    /**
+     * Set the growth thresholds (same for all the channels, see Bark::setThresh)
+     * @param lo low growth threshold (-1 to report at the first sign of decay)
+     * @param hi high growth threshold
+    */
+    void setThresh(float lo, float hi)
+    {
+        if(hi<lo)
+            throw std::invalid_argument("Low threshold is greater than High threshold");
+
+        this->hiThresh = hi;
+        this->loThresh = (lo < 0) ? -1 : lo;
+    }
+
+    std::pair<float,float> getThresh() const
+    {
+        return std::make_pair(this->loThresh,this->hiThresh);
+    }
+
+    /** Set the minimum total velocity to report an onset (see Bark::setMinvel) */
+    void setMinvel(float mv)
+    {
+        if(mv < 0)
+            throw std::invalid_argument("Minimum triggering velocity must be zero or positive");
+        this->minvel = mv;
+    }
+
+    /** Sum or average the energy in each filter (default: sum) */
+    void setFilterOperation(tIDLib::FilterOperation operationType) noexcept
+    {
+        this->bands.setFilterOperation(operationType);
+    }
+
+    /** Set the range of filters used in the total growth (see Bark::setFilterRange) */
+    void setFilterRange(float lo, float hi)
+    {
+        if(hi<lo)
+            throw std::invalid_argument("Low bin is greater than High bin");
+        if(lo < 0)
+            throw std::invalid_argument("Low bin is < 0 (must be zero or positive)");
+        if(hi >= getNumFilters())
+            throw std::invalid_argument("High bin must be smaller than the number of filters ("+std::to_string(getNumFilters())+")");
+
+        this->loBin = lo;
+        this->hiBin = hi;
+        updateBandRange();
+    }
+
+    /** Set mask parameters (see Bark::setMask) */
+    void setMask(unsigned int analysisPeriods, float decayRate)
+    {
+        if((decayRate < 0.05f) || (decayRate > 0.95f))
+            throw std::invalid_argument("Mask decay rate must be betweeen 0.05 and 0.95");
+        this->maskPeriods = analysisPeriods;
+        this->maskDecay = decayRate;
+    }
+
+    /** Set the debounce time of every channel, in milliseconds (see Bark::setDebounce) */
+    void setDebounce(int millis)
+    {
+        if(millis<0)
+            throw std::invalid_argument("Debounce time must be >= 0.");
+        this->debounceTime = millis;
+    }
+
+    int getDebounceTime() const noexcept
+    {
+        return this->debounceTime;
+    }
+
+    /** Set whether loudness weights are used */
+    void setUseWeights(bool useWeights) noexcept
+    {
+        this->useWeights = useWeights;
+    }
+
+    bool getUseWeights() const noexcept
+    {
+        return this->useWeights;
+    }
+
+    /** Set whether the power spectrum or the magnitude spectrum is used */
+    void setSpectrumType(tIDLib::SpectrumType spec)
+    {
+        this->bands.setSpectrumType(spec);
+        createBarkLoudnessWeights(this->loudWeights, getNumFilters(), getBarkSpacing(), spec);
+    }
+
+    /** Set whether to normalize the spectrum or not */
+    void setNormalize(bool normalize) noexcept
+    {
+        this->bands.setNormalize(normalize);
+    }
+
+    unsigned long int getWindowSize() const noexcept { return this->bands.getWindowSize(); }
+    unsigned long int getHop() const noexcept { return this->hop; }
+    float getBarkSpacing() const noexcept { return this->bands.getBarkSpacing(); }
+    unsigned int getNumChannels() const noexcept { return this->bands.getNumChannels(); }
+    t_filterIdx getNumFilters() const noexcept { return this->bands.getNumFilters(); }
+
+private:
+    /** Detection state of a channel */
+    struct ChannelState
+    {
+        std::vector<float> mask;
+        std::vector<unsigned short> numPeriods;
+        std::vector<float> growth;
+        float prevTotalGrowth = 0.0f;
+        bool haveHit = false;
+        SampleClockDebounce debounce;   // active for debounceTime millis (of samples) after every hit
+    };
+
+    void initChannels()
+    {
+        const t_filterIdx numFilters = getNumFilters();
+        this->channels.assign(getNumChannels(), ChannelState());
+        for(ChannelState& channel : this->channels)
+        {
+            channel.mask.assign(numFilters, 0.0f);
+            channel.numPeriods.assign(numFilters, 0);
+            channel.growth.assign(numFilters, 0.0f);
+            channel.debounce.setSampleRate((double)this->sampleRate);
+        }
+        this->channelEnergies.assign(numFilters, 0.0f);
+        this->unitWeights.assign(numFilters, 1.0f);
+        createBarkLoudnessWeights(this->loudWeights, numFilters, getBarkSpacing(), this->bands.getSpectrumType());
+        this->loBin = 0;
+        this->hiBin = numFilters-1;
+        updateBandRange();
+        this->block.prepare(getNumChannels(), this->blockSize);
+    }
+
+    void updateBandRange()
+    {
+        this->bandRange.resize(getNumFilters());
+        for(t_filterIdx i=0; i<getNumFilters(); ++i)
+            this->bandRange[i] = (i>=this->loBin && i<=this->hiBin) ? 1.0f : 0.0f;
+    }
+
+    /** Publish an onset event (lock-free, real-time safe) */
+    void outputOnset(unsigned int channel, float totalGrowth, float totalVel) noexcept
+    {
+        this->publishOnsetEvent({this->samplesStored, channel, totalGrowth, totalVel});
+    }
+
+    void storeAudioBlock(const float* frames, size_t n)
+    {
+        TID_PROFILE_SCOPE(bark, storeAudioBlock);
+        jassert(n == this->blockSize);
+
+        this->bands.push(frames, n);
+        this->dspTick += n;
+        this->samplesStored += n;
+
+        // Debounce on the sample clock, as in Bark
+        for(ChannelState& channel : this->channels)
+            channel.debounce.advance(n);
+
+        if(this->dspTick < this->hop)
+            return;
+        this->dspTick = 0;
+
+        const float* energies = this->bands.compute(n); // same window as Bark, which lags one block
+        const float* weights = this->useWeights ? this->loudWeights.data() : this->unitWeights.data();
+        const unsigned short maskPeriods = (unsigned short)std::min<unsigned int>(this->maskPeriods, tIDLib::MAXMASKPERIODS);
+
+        TID_PROFILE_BEGIN(bark, growth);
+        for(unsigned int c = 0; c < getNumChannels(); ++c)
+        {
+            ChannelState& channel = this->channels[c];
+            for(t_filterIdx i = 0; i < getNumFilters(); ++i)
+                this->channelEnergies[i] = energies[i * LANES + c];
+
+            float totalGrowth, totalVel;
+            tIDLib::growthMaskUpdate(getNumFilters(), this->channelEnergies.data(), weights, this->bandRange.data(),
+                                     channel.mask.data(), channel.numPeriods.data(), maskPeriods, this->maskDecay,
+                                     channel.growth.data(), totalGrowth, totalVel);
+
+            if(totalVel >= this->minvel && totalGrowth > this->hiThresh && !channel.haveHit && !channel.debounce.isActive())
+            {
+                channel.haveHit = true;
+                channel.debounce.start(this->debounceTime);
+            }
+            else if(channel.haveHit && this->loThresh>0 && totalGrowth < this->loThresh)
+            {
+                channel.haveHit = false;
+                outputOnset(c, totalGrowth, totalVel);
+            }
+            else if(channel.haveHit && this->loThresh<0 && totalGrowth < channel.prevTotalGrowth)
+            {
+                channel.haveHit = false;
+                outputOnset(c, totalGrowth, totalVel);
+            }
+
+            channel.prevTotalGrowth = totalGrowth;
+        }
+        TID_PROFILE_END(bark, growth);
+    }
+
+    uint64 samplesStored = 0;
+
+    unsigned long int sampleRate = tIDLib::SAMPLERATEDEFAULT;
+    unsigned int blockSize = tIDLib::BLOCKSIZEDEFAULT;
+    unsigned long int dspTick = 0;
+    unsigned long int hop = tIDLib::WINDOWSIZEDEFAULT*0.25f;
+
+    MultiChannelBarkBands bands;    // window, FFT and filterbank of all the channels
+    InterleavedBlock block;
+    std::vector<ChannelState> channels;
+    std::vector<float> channelEnergies; // band energies of one channel, deinterleaved
+    std::vector<float> loudWeights;
+    std::vector<float> unitWeights;     // used when the loudness weighting is disabled
+    std::vector<float> bandRange;       // 1 for the bands in loBin..hiBin, 0 otherwise
+    bool useWeights = false;
+
+    float loThresh = 3.0f;
+    float hiThresh = 7.0f;
+    float minvel = 1.0f;
+    t_filterIdx loBin = 0;
+    t_filterIdx hiBin = 0;
+    int debounceTime = 100;
+    float maskDecay = 0.7f;
+    unsigned int maskPeriods = 4;
+};
+
 } // namespace tid
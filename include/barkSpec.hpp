@@ -22,22 +22,30 @@ You should have received a copy of the GNU General Public License along with thi
 */
 #pragma once
 
+#include "tidJuceCompat.hpp"
 #include "tIDLib.hpp"
-#include "fftw3.h"
+#include "tidProfiler.hpp"
+#include "tidFft.hpp"
+#include "tidWindowTable.hpp"
+#include "tidFixedSize.hpp"
+#include "tidFilterbank.hpp"
+#include "tidMultiChannel.hpp"
 #include <stdexcept>
 
 namespace tid   /* TimbreID namespace*/
 {
 
-template <typename SampleType>
+template <typename SampleType, unsigned long int WINDOW_SIZE = dynamicSize, unsigned int BLOCK_SIZE = dynamicSize>
 class BarkSpec
 {
 public:
+    /** Storage and kernels for the window and block sizes, fixed or dynamicSize (see tidFixedSize.hpp) */
+    using Sizes = AnalysisSizes<WINDOW_SIZE, BLOCK_SIZE>;
 
     /** Creates a BarkSpec module with default parameters. */
     BarkSpec()
     {
-        this->analysisWindowSize = tIDLib::WINDOWSIZEDEFAULT;
+        this->analysisWindowSize = Sizes::defaultWindowSize;
         this->barkSpacing = tIDLib::BARKSPACINGDEFAULT;
         initModule();
     }
@@ -51,6 +59,7 @@ public:
     {
         if (analysisWindowSize < tIDLib::MINWINDOWSIZE)
             throw std::invalid_argument("Window size must be "+std::to_string(tIDLib::MINWINDOWSIZE)+" or greater.");
+        Sizes::checkWindowSize(analysisWindowSize);
 
         this->analysisWindowSize = analysisWindowSize;
         this->barkSpacing = tIDLib::BARKSPACINGDEFAULT;
@@ -68,6 +77,7 @@ public:
     {
         if (analysisWindowSize < tIDLib::MINWINDOWSIZE)
             throw std::invalid_argument("Window size must be "+std::to_string(tIDLib::MINWINDOWSIZE)+" or greater.");
+        Sizes::checkWindowSize(analysisWindowSize);
         if (barkSpacing < tIDLib::MINBARKSPACING || barkSpacing > tIDLib::MAXBARKSPACING)
             throw std::invalid_argument("Bark spacing must be between "+std::to_string(tIDLib::MINBARKSPACING)+" and "+std::to_string(tIDLib::MAXBARKSPACING)+" Barks");
 
@@ -92,11 +102,18 @@ public:
      * Prepares the module to play by clearing buffers and setting audio buffers
      * standard parameters
      * @param sampleRate The sample rate of the buffer
-     * @param blockSize The size of the individual audio blocks
+     * @param blockSize The size of the individual audio blocks (the fixed one, with a fixed block size)
+     * A new sample rate acquires the filterbank for it, which can throw.
     */
-    void prepare (unsigned long int sampleRate, unsigned int blockSize) noexcept
+    void prepare (unsigned long int sampleRate, unsigned int blockSize)
     {
-        this->sampleRate = sampleRate;
+        Sizes::checkBlockSize(blockSize);
+        if ((float)sampleRate != this->sampleRate)
+        {
+            // the filterbank depends on the sample rate
+            this->sampleRate = sampleRate;
+            createFilterbank(this->barkSpacing);
+        }
         if (blockSize != this->blockSize)
         {
             this->blockSize = blockSize;
@@ -123,15 +140,11 @@ public:
         if (barkSpacing < tIDLib::MINBARKSPACING || barkSpacing > tIDLib::MAXBARKSPACING)
             throw std::invalid_argument("Bark spacing must be between "+std::to_string(tIDLib::MINBARKSPACING)+" and "+std::to_string(tIDLib::MAXBARKSPACING)+" Barks");
 
+        // filterbank shared with the other instances with the same spacing, window size and sample rate
+        // (if it throws, the module keeps the previous one)
+        this->filterbank.acquire(FilterbankScale::bark, barkSpacing, this->analysisWindowSize, this->sampleRate);
         this->barkSpacing = barkSpacing;
-
-        this->sizeFilterFreqs = tIDLib::getBarkBoundFreqs(this->filterFreqs, this->barkSpacing, this->sampleRate);
-        jassert(sizeFilterFreqs == this->filterFreqs.size());
-
-        // sizeFilterFreqs-2 is the correct number of filters, since we don't count the start point of the first filter, or the finish point of the last filter
-        this->numFilters = this->sizeFilterFreqs-2;
-
-        tIDLib::createFilterbank(this->filterFreqs, this->filterbank, this->numFilters, this->analysisWindowSize, this->sampleRate);
+        this->numFilters = this->filterbank.getNumFilters();
 
         // resize listOut memory
         this->listOut.resize(this->numFilters);
@@ -159,15 +172,24 @@ public:
         storeAudioBlock(buffer.getReadPointer(channel), buffer.getNumSamples());
     }
 
+    /**
+     * Stores an audio block into the buffer of the module
+     * Raw pointer version of store(), for use without JUCE buffers.
+     * @param input samples of the audio block
+     * @param n number of samples, it has to match the block size given to prepare()
+    */
+    void store (const SampleType* input, size_t n)
+    {
+        storeAudioBlock(input, n);
+    }
+
     /**
      * Compute the bark spec coefficients
      * @return bark spec coefficients
     */
     std::vector<float>& compute()
     {
-        std::vector<float> *windowFuncPtr;
-
-        unsigned long int windowHalf = this->analysisWindowSize * 0.5f;
+        const unsigned long int windowHalf = Sizes::getWindowHalf(this->analysisWindowSize);
 
        #if ASYNC_FEATURE_EXTRACTION
         uint32 currentTime = tid::Time::getTimeSince(this->lastStoreTime);
@@ -175,64 +197,39 @@ public:
         if (offsetSample >= this->blockSize)
             offsetSample = this->blockSize-1;
        #else
-        if ((tIDLib::FEATURE_EXTRACTION_OFFSET < 0.0f) || (tIDLib::FEATURE_EXTRACTION_OFFSET > 1.0f)) throw new std::logic_error("FEATURE_EXTRACTION_OFFSET must be between 0.0 and 1.0 (found "+std::to_string(tIDLib::FEATURE_EXTRACTION_OFFSET)+" instead)");
         uint32 offsetSample = (unsigned long int)(tIDLib::FEATURE_EXTRACTION_OFFSET * (double)this->blockSize);
        #endif
 
+        TID_PROFILE_BEGIN(barkSpec, windowCopy);
         // construct analysis window using offsetSample as the end of the window
-        for (unsigned long int i=0, j=offsetSample; i<this->analysisWindowSize; ++i, ++j)
-            this->fftwInputVector[i] = this->signalBuffer[j];
-
-        switch(this->windowFunction)
-        {
-            case tIDLib::WindowFunctionType::rectangular:
-                break;
-            case tIDLib::WindowFunctionType::blackman:
-                windowFuncPtr = &this->blackman;
-                break;
-            case tIDLib::WindowFunctionType::cosine:
-                windowFuncPtr = &this->cosine;
-                break;
-            case tIDLib::WindowFunctionType::hamming:
-                windowFuncPtr = &this->hamming;
-                break;
-            case tIDLib::WindowFunctionType::hann:
-                windowFuncPtr = &this->hann;
-                break;
-            default:
-                windowFuncPtr = &this->blackman;
-                break;
-        };
+        Sizes::windowCopy(&this->signalBuffer[offsetSample], this->windowTable.data(), &this->fftwInputVector[0], this->analysisWindowSize);
+        TID_PROFILE_END(barkSpec, windowCopy);
 
-        // if windowFunction == rectangular, skip the windowing (rectangular)
-        if (this->windowFunction != tIDLib::WindowFunctionType::rectangular)
-            for (unsigned long int i=0; i<this->analysisWindowSize; ++i)
-                this->fftwInputVector[i] *= windowFuncPtr->at(i);
-
-        fftwf_execute(this->fftwPlan);
+        TID_PROFILE_BEGIN(barkSpec, fft);
+        this->fftwPlan.execute();
+        TID_PROFILE_END(barkSpec, fft);
 
         // put the result of power calc back in fftwIn
         float* fftwIn = &(fftwInputVector[0]);
-        tIDLib::power(windowHalf+1, this->fftwOut, fftwIn);
+        Sizes::power(windowHalf + 1, this->fftwOut, fftwIn);
 
         if (this->spectrumTypeUsed != tIDLib::SpectrumType::powerSpectrum)
-            tIDLib::mag(windowHalf+1, fftwIn);
+            Sizes::mag(windowHalf + 1, fftwIn);
 
+        TID_PROFILE_BEGIN(barkSpec, filterbank);
         switch(this->filterState)
         {
             case tIDLib::FilterState::filterDisabled: // like the old x_specBandAvg == true
-                tIDLib::specFilterBands(windowHalf+1, this->numFilters, fftwIn, this->filterbank, this->normalize);
+                tIDLib::specFilterBands(windowHalf+1, this->numFilters, fftwIn, &this->listOut[0], this->filterbank.getFilters(), this->normalize);
                 break;
             case tIDLib::FilterState::filterEnabled:
-                tIDLib::filterbankMultiply(fftwIn, this->normalize, this->filterOperation, this->filterbank, this->numFilters);
+                tIDLib::filterbankMultiply(fftwIn, &this->listOut[0], this->normalize, this->filterOperation, this->filterbank.getFilters(), this->numFilters);
                 break;
             default:
                 throw std::logic_error("Filter option not available");
                 break;
         }
-
-        for (t_filterIdx i = 0; i < this->numFilters; ++i)
-            this->listOut[i] = this->fftwInputVector[i];
+        TID_PROFILE_END(barkSpec, filterbank);
 
         return this->listOut;
     }
@@ -244,9 +241,10 @@ public:
      * Sets the window function (options in tIDLib header file)
      * @param func window fuction used
     */
-    void setWindowFunction(tIDLib::WindowFunctionType func) noexcept
+    void setWindowFunction(tIDLib::WindowFunctionType func)
     {
         this->windowFunction = func;
+        this->windowTable.acquire(func, this->analysisWindowSize);
     }
 
     /**
@@ -295,6 +293,7 @@ public:
     */
     void setWindowSize(uint32 windowSize)
     {
+        Sizes::checkWindowSize(windowSize);
         // FFT must be at least 4 points long
         if (windowSize < 4)
             throw std::invalid_argument("Window size must be 4 or greater");
@@ -305,18 +304,16 @@ public:
         this->signalBuffer.resize(this->analysisWindowSize + this->blockSize);
         this->fftwInputVector.resize(this->analysisWindowSize);
 
-        // free the FFTW output buffer, and re-malloc according to new window
-        fftwf_free(this->fftwOut);
 
-        // destroy old DFT plan, which depended on this->analysisWindowSize
-        fftwf_destroy_plan(this->fftwPlan);
+        // release old DFT plan, which depended on this->analysisWindowSize
+        this->fftwPlan.reset();
 
-        // allocate new fftwf_complex memory for the plan based on new window size
-        this->fftwOut = (fftwf_complex *) fftwf_alloc_complex(windowHalf+1);
+        // allocate new complex spectrum memory for the plan based on new window size
+        this->fftwOut = fft::resizeComplex(this->fftwOutBuffer, windowHalf+1);
 
-        // create a new DFT plan based on new window size
+        // get a DFT plan for the new window size from the shared cache
         float* fftwIn = &(fftwInputVector[0]);
-        this->fftwPlan = fftwf_plan_dft_r2c_1d(this->analysisWindowSize, fftwIn, this->fftwOut, FFTWPLANNERFLAG);
+        this->fftwPlan.createRealToComplex(this->analysisWindowSize, fftwIn, this->fftwOut);
 
         // we're supposed to initialize the input array after we create the plan
          for (unsigned long int i=0; i<this->analysisWindowSize; ++i)
@@ -326,18 +323,10 @@ public:
         for (unsigned long int i=0; i<this->analysisWindowSize+this->blockSize; ++i)
             this->signalBuffer[i] = 0.0f;
 
-        this->blackman.resize(this->analysisWindowSize);
-        this->cosine.resize(this->analysisWindowSize);
-        this->hamming.resize(this->analysisWindowSize);
-        this->hann.resize(this->analysisWindowSize);
+        // window table shared with the other instances of the same size
+        this->windowTable.acquire(this->windowFunction, this->analysisWindowSize);
 
-        // initialize signal windowing functions
-        tIDLib::initBlackmanWindow(this->blackman);
-        tIDLib::initCosineWindow(this->cosine);
-        tIDLib::initHammingWindow(this->hamming);
-        tIDLib::initHannWindow(this->hann);
-
-        tIDLib::createFilterbank(this->filterFreqs, this->filterbank, this->numFilters, this->analysisWindowSize, this->sampleRate);
+        this->filterbank.acquire(FilterbankScale::bark, this->barkSpacing, this->analysisWindowSize, this->sampleRate);
     }
 
     /**
@@ -376,12 +365,13 @@ public:
     {
         std::string res = "";
 
+        const std::vector<float>& filterFreqs = this->filterbank.getFilterFreqs();
         for (t_filterIdx i = 0; i < this->numFilters + 2; ++i)
         {
             res += "filterFreqs[";
             res += std::to_string(i);
             res += "]:";
-            res += std::to_string(this->filterFreqs[i]);
+            res += std::to_string(filterFreqs[i]);
         }
         return res;
     }
@@ -470,25 +460,42 @@ public:
             res += "filter size[";
             res += std::to_string(idx);
             res += "]: ";
-            res += std::to_string(this->filterbank[idx].size);
+            res += std::to_string(this->filterbank.getFilters()[idx].size);
 
-            for (t_binIdx i=0; i < this->filterbank[idx].size; ++i)
+            for (t_binIdx i=0; i < this->filterbank.getFilters()[idx].size; ++i)
             {
                 res += "\nval ";
                 res += std::to_string(i);
                 res += ": ";
-                res += std::to_string(this->filterbank[idx].filter[i]);
+                res += std::to_string(this->filterbank.getFilters()[idx].filter[i]);
             }
 
             res += "\nidxLo: ";
-            res += std::to_string(this->filterbank[idx].indices[0]);
+            res += std::to_string(this->filterbank.getFilters()[idx].indices[0]);
             res += ", idxHi: ";
-            res += std::to_string(this->filterbank[idx].indices[1]);
+            res += std::to_string(this->filterbank.getFilters()[idx].indices[1]);
         }
 
         return res;
     }
 
+    /**
+     * Place the buffers used at every block in an arena, in the order in
+     * which they are accessed (see tid::Arena)
+    */
+    void layoutBuffers(Arena& arena)
+    {
+        arena.place(this->signalBuffer);
+        arena.place(this->fftwInputVector);
+        arena.place(this->fftwOutBuffer);
+        if (arena.isPlacing())
+        {
+            // the plan runs on the new arrays
+            this->fftwOut = reinterpret_cast<fft::Complex*>(this->fftwOutBuffer.data());
+            this->fftwPlan.createRealToComplex(this->analysisWindowSize, this->fftwInputVector.data(), this->fftwOut);
+        }
+    }
+
 private:
 
     /**
@@ -497,14 +504,13 @@ private:
     void initModule()
     {
         this->sampleRate = tIDLib::SAMPLERATEDEFAULT;
-        this->blockSize = tIDLib::BLOCKSIZEDEFAULT;
+        this->blockSize = Sizes::defaultBlockSize;
         this->windowFunction = tIDLib::WindowFunctionType::blackman;
         this->normalize = true;
         this->spectrumTypeUsed = tIDLib::SpectrumType::magnitudeSpectrum;
        #if ASYNC_FEATURE_EXTRACTION
         this->lastStoreTime = juce::Time::currentTimeMillis();
        #endif
-        this->sizeFilterFreqs = 0;
         this->numFilters = 0; // this is just an init size that will be updated in createFilterbank anyway.
         this->filterState = tIDLib::FilterState::filterEnabled;
         this->filterOperation = tIDLib::FilterOperation::sumFilterEnergy;
@@ -516,36 +522,23 @@ private:
         for (unsigned long int i = 0; i < this->analysisWindowSize + this->blockSize; ++i)
             this->signalBuffer[i] = 0.0f;
 
-        this->blackman.resize(this->analysisWindowSize);
-        this->cosine.resize(this->analysisWindowSize);
-        this->hamming.resize(this->analysisWindowSize);
-        this->hann.resize(this->analysisWindowSize);
-
-        // initialize signal windowing functions
-        tIDLib::initBlackmanWindow(this->blackman);
-        tIDLib::initCosineWindow(this->cosine);
-        tIDLib::initHammingWindow(this->hamming);
-        tIDLib::initHannWindow(this->hann);
+        // window table shared with the other instances of the same size
+        this->windowTable.acquire(this->windowFunction, this->analysisWindowSize);
 
         // set up the FFTW output buffer
-        this->fftwOut = (fftwf_complex *)fftwf_alloc_complex(this->analysisWindowSize * 0.5f + 1);
+        this->fftwOut = fft::resizeComplex(this->fftwOutBuffer, this->analysisWindowSize * 0.5f + 1);
 
-        // DFT plan
+        // DFT plan (shared with the other instances of the same size)
         float* fftwIn = &(fftwInputVector[0]);
-        this->fftwPlan = fftwf_plan_dft_r2c_1d(this->analysisWindowSize, fftwIn, this->fftwOut, FFTWPLANNERFLAG);
+        this->fftwPlan.createRealToComplex(this->analysisWindowSize, fftwIn, this->fftwOut);
 
         // we're supposed to initialize the input array after we create the plan
          for (unsigned long int i = 0; i < this->analysisWindowSize; ++i)
             this->fftwInputVector[i] = 0.0f;
 
-        this->sizeFilterFreqs = tIDLib::getBarkBoundFreqs(this->filterFreqs, this->barkSpacing, this->sampleRate);
-        jassert(this->sizeFilterFreqs == this->filterFreqs.size());
-
-
-        // sizeFilterFreqs-2 is the correct number of filters, since we don't count the start point of the first filter, or the finish point of the last filter
-        this->numFilters = this->sizeFilterFreqs-2;
-
-        tIDLib::createFilterbank(this->filterFreqs, this->filterbank, this->numFilters, this->analysisWindowSize, this->sampleRate);
+        // filterbank shared with the other instances with the same spacing, window size and sample rate
+        this->filterbank.acquire(FilterbankScale::bark, this->barkSpacing, this->analysisWindowSize, this->sampleRate);
+        this->numFilters = this->filterbank.getNumFilters();
 
         // create listOut memory
         this->listOut.resize(this->numFilters);
@@ -558,13 +551,9 @@ private:
     */
     void storeAudioBlock(const SampleType* input, size_t n) noexcept
     {
-        // shift signal buffer contents back.
-        for (unsigned long int i=0; i < this->analysisWindowSize; ++i)
-            this->signalBuffer[i] = this->signalBuffer[i+n];
-
-        // write new block to end of signal buffer.
-        for (unsigned long int i=0; i < n; ++i)
-            this->signalBuffer[this->analysisWindowSize+i] = input[i];
+        TID_PROFILE_SCOPE(barkSpec, storeAudioBlock);
+        // shift signal buffer contents back and write the new block at its end
+        Sizes::storeBlock(this->signalBuffer.data(), this->analysisWindowSize, input, n);
 
        #if ASYNC_FEATURE_EXTRACTION
         this->lastStoreTime = juce::Time::currentTimeMillis();
@@ -576,8 +565,7 @@ private:
     */
     void freeMem()
     {
-        fftwf_free(this->fftwOut);
-        fftwf_destroy_plan(this->fftwPlan);
+        this->fftwPlan.reset();
     }
 
     //==========================================================================
@@ -594,23 +582,19 @@ private:
     uint32 lastStoreTime; // replaces x_lastDspTime
    #endif
 
-    std::vector<SampleType> signalBuffer;
+    typename Sizes::template SignalBuffer<SampleType> signalBuffer;
 
-    std::vector<float> fftwInputVector;
-    fftwf_complex *fftwOut;
-    fftwf_plan fftwPlan;
+    typename Sizes::WindowBuffer fftwInputVector;
+    fft::Complex *fftwOut;              // in fftwOutBuffer
+    typename Sizes::SpectrumBuffer fftwOutBuffer;
+    FftPlan fftwPlan;
 
-    std::vector<float> blackman;
-    std::vector<float> cosine;
-    std::vector<float> hamming;
-    std::vector<float> hann;
+    typename Sizes::Window windowTable;   // shared, read-only table of windowFunction (computed at compile time with a fixed window size, none for rectangular)
 
-    t_filterIdx sizeFilterFreqs;
     t_filterIdx numFilters;
 
     float barkSpacing;
-    std::vector<float> filterFreqs;
-    std::vector<tIDLib::t_filter> filterbank;
+    SharedFilterbank filterbank;  // shared, read-only
 
     tIDLib::FilterState filterState;         // replaces x_specBandAvg
     tIDLib::FilterOperation filterOperation; // replaces x_filterAvg
@@ -619,4 +603,149 @@ private:
     std::vector<float> listOut;
 };
 
+/**
+ * Bark spectrum of up to tIDLib::INTERLEAVEDLANES channels (e.g. hexaphonic pickups)
+ * Same results of a BarkSpec per channel (with the triangular filters,
+ * filterEnabled), but the window table, the FFT and the filterbank are
+ * shared by the channels and the filterbank (and, with the built-in backend
+ * and 3 channels or more, the FFT) runs on all of them at once
+ * (see tidMultiChannel.hpp).
+*/
+template <typename SampleType>
+class MultiBarkSpec
+{
+public:
+    /**
+     * MultiBarkSpec constructor
+     * @param numChannels number of channels analysed (1 to tIDLib::INTERLEAVEDLANES)
+     * @param analysisWindowSize size of the analysis window
+     * @param barkSpacing filter spacing in Barks
+    */
+    MultiBarkSpec(unsigned int numChannels, unsigned long int analysisWindowSize = tIDLib::WINDOWSIZEDEFAULT, float barkSpacing = tIDLib::BARKSPACINGDEFAULT)
+    {
+        this->bands.setWindowFunction(tIDLib::WindowFunctionType::blackman);
+        this->bands.setNormalize(true);
+        this->bands.setSpectrumType(tIDLib::SpectrumType::magnitudeSpectrum);
+        this->bands.setup(numChannels, analysisWindowSize, barkSpacing, this->sampleRate, analysisWindowSize + this->blockSize);
+        resizeBuffers();
+    }
+
+    /**
+     * Initialization of the module (it allocates, the filterbank is built for the new sample rate)
+     * @param sampleRate The sample rate of the buffer
+     * @param blockSize The size of the individual audio blocks
+    */
+    void prepare (double sampleRate, unsigned int blockSize)
+    {
+        this->sampleRate = sampleRate;
+        this->blockSize = blockSize;
+        this->bands.setup(getNumChannels(), getWindowSize(), this->bands.getBarkSpacing(), sampleRate, getWindowSize() + blockSize);
+        resizeBuffers();
+    }
+
+    /** Resets the processing pipeline (zeros in the analysis buffer of every channel) */
+    void reset() noexcept
+    {
+        this->bands.clear();
+    }
+
+    /**
+     * Stores the channels firstChannel ... firstChannel+getNumChannels()-1 of an audio block
+     * @param buffer audio buffer
+     * @param firstChannel index of the first channel analysed
+    */
+    template <typename OtherSampleType>
+    void store (AudioBuffer<OtherSampleType>& buffer, short firstChannel = 0)
+    {
+        static_assert (std::is_same<OtherSampleType, SampleType>::value,
+                       "The sample-type of the module must match the sample-type supplied to this store callback");
+        this->block.interleave(buffer, firstChannel);
+        store(this->block);
+    }
+
+    /**
+     * Stores an audio block of every channel
+     * @param channels getNumChannels() pointers to n samples
+     * @param n number of samples, it has to match the block size given to prepare()
+    */
+    void store (const SampleType* const* channels, size_t n)
+    {
+        this->block.interleave(channels, n);
+        store(this->block);
+    }
+
+    /** Stores an audio block already interleaved (at least getNumChannels() channels) */
+    void store (const InterleavedBlock& interleaved)
+    {
+        if (interleaved.getNumChannels() < getNumChannels())
+            throw std::invalid_argument("The interleaved block has "+std::to_string(interleaved.getNumChannels())+" channels, "+std::to_string(getNumChannels())+" are analysed");
+        TID_PROFILE_SCOPE(barkSpec, storeAudioBlock);
+        this->bands.push(interleaved.getFrames(), interleaved.getNumFrames());
+    }
+
+    /**
+     * Compute the bark spec coefficients of all the channels
+     * @return getNumChannels() vectors of getNumFilters() coefficients
+    */
+    const std::vector<std::vector<float>>& compute() noexcept
+    {
+        TID_PROFILE_BEGIN(barkSpec, filterbank);
+        const float* energies = this->bands.compute(getFeatureExtractionLag(this->blockSize));
+        TID_PROFILE_END(barkSpec, filterbank);
+
+        for (unsigned int c = 0; c < getNumChannels(); ++c)
+            for (t_filterIdx i = 0; i < getNumFilters(); ++i)
+                this->listOut[c][i] = energies[i * tIDLib::INTERLEAVEDLANES + c];
+        return this->listOut;
+    }
+
+    /*--------------------------- Setters/getters ----------------------------*/
+
+    /** Set the window function used (options in tIDLib header file) */
+    void setWindowFunction(tIDLib::WindowFunctionType func) { this->bands.setWindowFunction(func); }
+
+    /** Sum or average the energy in each filter (default: sum) */
+    void setFilterOperation(tIDLib::FilterOperation operationType) noexcept { this->bands.setFilterOperation(operationType); }
+
+    /** Set whether the power spectrum or the magnitude spectrum is used */
+    void setSpectrumType(tIDLib::SpectrumType spec) noexcept { this->bands.setSpectrumType(spec); }
+
+    /** Set the Spectrum Normalization mode (on/off) */
+    void setNormalize(bool norm) noexcept { this->bands.setNormalize(norm); }
+
+    bool getNormalize() const noexcept { return this->bands.getNormalize(); }
+
+    /** Set analysis window size (it allocates and clears the analysis buffers) */
+    void setWindowSize(uint32 windowSize)
+    {
+        this->bands.setup(getNumChannels(), windowSize, this->bands.getBarkSpacing(), this->sampleRate, windowSize + this->blockSize);
+        resizeBuffers();
+    }
+
+    /** Construct a new filterbank with a specific spacing (in Barks) */
+    void createFilterbank(float barkSpacing)
+    {
+        this->bands.setup(getNumChannels(), getWindowSize(), barkSpacing, this->sampleRate, getWindowSize() + this->blockSize);
+        resizeBuffers();
+    }
+
+    unsigned long int getWindowSize() const noexcept { return this->bands.getWindowSize(); }
+    unsigned int getNumChannels() const noexcept { return this->bands.getNumChannels(); }
+    t_filterIdx getNumFilters() const noexcept { return this->bands.getNumFilters(); }
+
+private:
+    void resizeBuffers()
+    {
+        this->block.prepare(getNumChannels(), this->blockSize);
+        this->listOut.assign(getNumChannels(), std::vector<float>(getNumFilters(), 0.0f));
+    }
+
+    double sampleRate = tIDLib::SAMPLERATEDEFAULT;
+    unsigned int blockSize = tIDLib::BLOCKSIZEDEFAULT;
+
+    MultiChannelBarkBands bands;
+    InterleavedBlock block;
+    std::vector<std::vector<float>> listOut;
+};
+
 } // namespace tid
@@ -22,8 +22,13 @@ You should have received a copy of the GNU General Public License along with thi
 */
 #pragma once
 
+#include "tidJuceCompat.hpp"
 #include "tIDLib.hpp"
-#include "fftw3.h"
+#include "tidProfiler.hpp"
+#include "tidFft.hpp"
+#include "tidWindowTable.hpp"
+#include "tidFixedSize.hpp"
+#include "tidFilterbank.hpp"
 #include <stdexcept>
 
 #define DEFAULTBOUNDARY 8.5
@@ -31,14 +36,17 @@ You should have received a copy of the GNU General Public License along with thi
 namespace tid   /* TimbreID namespace*/
 {
 
-template <typename SampleType>
+template <typename SampleType, unsigned long int WINDOW_SIZE = dynamicSize, unsigned int BLOCK_SIZE = dynamicSize>
 class BarkSpecBrightness
 {
 public:
+    /** Storage and kernels for the window and block sizes, fixed or dynamicSize (see tidFixedSize.hpp) */
+    using Sizes = AnalysisSizes<WINDOW_SIZE, BLOCK_SIZE>;
+
     /** Creates a BarkSpecBrightness module with default parameters. */
     BarkSpecBrightness()
     {
-        this->analysisWindowSize = tIDLib::WINDOWSIZEDEFAULT;
+        this->analysisWindowSize = Sizes::defaultWindowSize;
         this->barkSpacing = tIDLib::BARKSPACINGDEFAULT;
         this->barkBoundary = DEFAULTBOUNDARY;
         this->freqBoundary = tIDLib::bark2freq(this->barkBoundary);
@@ -54,6 +62,7 @@ public:
     {
         if(analysisWindowSize < tIDLib::MINWINDOWSIZE)
             throw std::invalid_argument("Window size must be "+std::to_string(tIDLib::MINWINDOWSIZE)+" or greater.");
+        Sizes::checkWindowSize(analysisWindowSize);
 
         this->analysisWindowSize = analysisWindowSize;
         this->barkSpacing = tIDLib::BARKSPACINGDEFAULT;
@@ -73,6 +82,7 @@ public:
     {
         if(analysisWindowSize < tIDLib::MINWINDOWSIZE)
             throw std::invalid_argument("Window size must be "+std::to_string(tIDLib::MINWINDOWSIZE)+" or greater.");
+        Sizes::checkWindowSize(analysisWindowSize);
         if(barkSpacing < tIDLib::MINBARKSPACING || barkSpacing > tIDLib::MAXBARKSPACING)
             throw std::invalid_argument("Bark spacing must be between "+std::to_string(tIDLib::MINBARKSPACING)+" and "+std::to_string(tIDLib::MAXBARKSPACING)+" Barks");
 
@@ -94,6 +104,7 @@ public:
     {
         if(analysisWindowSize < tIDLib::MINWINDOWSIZE)
             throw std::invalid_argument("Window size must be "+std::to_string(tIDLib::MINWINDOWSIZE)+" or greater.");
+        Sizes::checkWindowSize(analysisWindowSize);
         if(barkSpacing < tIDLib::MINBARKSPACING || barkSpacing > tIDLib::MAXBARKSPACING)
             throw std::invalid_argument("Bark spacing must be between "+std::to_string(tIDLib::MINBARKSPACING)+" and "+std::to_string(tIDLib::MAXBARKSPACING)+" Barks.");
         if(barkBoundary > tIDLib::MAXBARKS || barkBoundary < 0)
@@ -121,11 +132,18 @@ public:
      * Prepares the module to play by clearing buffers and setting audio buffers
      * standard parameters
      * @param sampleRate The sample rate of the buffer
-     * @param blockSize The size of the individual audio blocks
+     * @param blockSize The size of the individual audio blocks (the fixed one, with a fixed block size)
+     * A new sample rate acquires the filterbank for it, which can throw.
     */
-    void prepare (unsigned long int sampleRate, unsigned int blockSize) noexcept
+    void prepare (unsigned long int sampleRate, unsigned int blockSize)
     {
-        this->sampleRate = sampleRate;
+        Sizes::checkBlockSize(blockSize);
+        if ((float)sampleRate != this->sampleRate)
+        {
+            // the filterbank depends on the sample rate
+            this->sampleRate = sampleRate;
+            createFilterbank(this->barkSpacing);
+        }
         if(blockSize != this->blockSize)
         {
             this->blockSize = blockSize;
@@ -152,15 +170,12 @@ public:
         if(barkSpacing < tIDLib::MINBARKSPACING || barkSpacing > tIDLib::MAXBARKSPACING)
             throw std::invalid_argument("Bark spacing must be between "+std::to_string(tIDLib::MINBARKSPACING)+" and "+std::to_string(tIDLib::MAXBARKSPACING)+" Barks");
 
+        // filterbank shared with the other instances with the same spacing, window size and sample rate
+        // (if it throws, the module keeps the previous one)
+        this->filterbank.acquire(FilterbankScale::bark, barkSpacing, this->analysisWindowSize, this->sampleRate);
         this->barkSpacing = barkSpacing;
-
-        this->sizeFilterFreqs = tIDLib::getBarkBoundFreqs(this->filterFreqs, this->barkSpacing, this->sampleRate);
-        jassert(sizeFilterFreqs == this->filterFreqs.size());
-
-        // sizeFilterFreqs-2 is the correct number of filters, since we don't count the start point of the first filter, or the finish point of the last filter
-        this->numFilters = this->sizeFilterFreqs-2;
-
-        tIDLib::createFilterbank(this->filterFreqs, this->filterbank, this->numFilters, this->analysisWindowSize, this->sampleRate);
+        this->numFilters = this->filterbank.getNumFilters();
+        this->bandEnergies.resize(this->numFilters);
 
         this->barkFreqList.resize(this->numFilters);
 
@@ -192,6 +207,17 @@ public:
         return storeAudioBlock(buffer.getReadPointer(channel), buffer.getNumSamples());
     }
 
+    /**
+     * Stores an audio block into the buffer of the module
+     * Raw pointer version of store(), for use without JUCE buffers.
+     * @param input samples of the audio block
+     * @param n number of samples, it has to match the block size given to prepare()
+    */
+    void store (const SampleType* input, size_t n)
+    {
+        storeAudioBlock(input, n);
+    }
+
     /**
      * Compute the brightness value
      * @return brightness value
@@ -199,9 +225,7 @@ public:
     float compute()
     {
         float dividend, divisor, brightness;
-        std::vector<float> *windowFuncPtr;
-
-        unsigned long int windowHalf = this->analysisWindowSize * 0.5f;
+        const unsigned long int windowHalf = Sizes::getWindowHalf(this->analysisWindowSize);
 
        #if ASYNC_FEATURE_EXTRACTION
         uint32 currentTime = tid::Time::getTimeSince(this->lastStoreTime);
@@ -209,71 +233,47 @@ public:
         if(offsetSample >= this->blockSize)
             offsetSample = this->blockSize - 1;
        #else
-        if ((tIDLib::FEATURE_EXTRACTION_OFFSET < 0.0f) || (tIDLib::FEATURE_EXTRACTION_OFFSET > 1.0f)) throw new std::logic_error("FEATURE_EXTRACTION_OFFSET must be between 0.0 and 1.0 (found "+std::to_string(tIDLib::FEATURE_EXTRACTION_OFFSET)+" instead)");
         uint32 offsetSample = (uint32)(tIDLib::FEATURE_EXTRACTION_OFFSET * (double)this->blockSize);
        #endif
 
+        TID_PROFILE_BEGIN(barkSpecBrightness, windowCopy);
         // construct analysis window using offsetSample as the end of the window
-        for(unsigned long int i=0, j=offsetSample; i<this->analysisWindowSize; ++i, ++j)
-            this->fftwInputVector[i] = this->signalBuffer[j];
-
-        switch(this->windowFunction)
-        {
-            case tIDLib::WindowFunctionType::rectangular:
-                break;
-            case tIDLib::WindowFunctionType::blackman:
-                windowFuncPtr = &this->blackman;
-                break;
-            case tIDLib::WindowFunctionType::cosine:
-                windowFuncPtr = &this->cosine;
-                break;
-            case tIDLib::WindowFunctionType::hamming:
-                windowFuncPtr = &this->hamming;
-                break;
-            case tIDLib::WindowFunctionType::hann:
-                windowFuncPtr = &this->hann;
-                break;
-            default:
-                windowFuncPtr = &this->blackman;
-                break;
-        };
+        Sizes::windowCopy(&this->signalBuffer[offsetSample], this->windowTable.data(), &this->fftwInputVector[0], this->analysisWindowSize);
+        TID_PROFILE_END(barkSpecBrightness, windowCopy);
 
-        // if windowFunction == 0, skip the windowing (rectangular)
-        if(this->windowFunction != tIDLib::WindowFunctionType::rectangular)
-        {
-            for(unsigned long int i=0; i<this->analysisWindowSize; ++i)
-                this->fftwInputVector[i] *= windowFuncPtr->at(i);
-        }
-
-        fftwf_execute(this->fftwPlan);
+        TID_PROFILE_BEGIN(barkSpecBrightness, fft);
+        this->fftwPlan.execute();
+        TID_PROFILE_END(barkSpecBrightness, fft);
 
         // put the result of power calc back in fftwIn
         float* fftwIn = &fftwInputVector[0];
-        tIDLib::power(windowHalf+1, this->fftwOut, fftwIn);
+        Sizes::power(windowHalf + 1, this->fftwOut, fftwIn);
 
         if(this->spectrumTypeUsed == tIDLib::SpectrumType::magnitudeSpectrum)
-            tIDLib::mag(windowHalf+1, fftwIn);
+            Sizes::mag(windowHalf + 1, fftwIn);
 
+        TID_PROFILE_BEGIN(barkSpecBrightness, filterbank);
         switch(this->filterState)
         {
             case tIDLib::FilterState::filterDisabled:
-                tIDLib::specFilterBands(windowHalf+1, this->numFilters, fftwIn, this->filterbank, false);
+                tIDLib::specFilterBands(windowHalf+1, this->numFilters, fftwIn, &this->bandEnergies[0], this->filterbank.getFilters(), false);
                 break;
             case tIDLib::FilterState::filterEnabled:
-                tIDLib::filterbankMultiply(fftwIn, false, this->filterOperation, this->filterbank, this->numFilters);
+                tIDLib::filterbankMultiply(fftwIn, &this->bandEnergies[0], false, this->filterOperation, this->filterbank.getFilters(), this->numFilters);
                 break;
             default:
                 throw std::logic_error("Filter option not available");
                 break;
         }
+        TID_PROFILE_END(barkSpecBrightness, filterbank);
 
         dividend=divisor=brightness=0.0f;
 
         for(unsigned long int i=this->bandBoundary; i<this->numFilters; ++i)
-            dividend += this->fftwInputVector[i];
+            dividend += this->bandEnergies[i];
 
         for(unsigned long int i=0; i<this->numFilters; ++i)
-            divisor += this->fftwInputVector[i];
+            divisor += this->bandEnergies[i];
 
         if(divisor>0.0f)
             brightness = dividend/divisor;
@@ -293,6 +293,7 @@ public:
     void setWindowFunction(tIDLib::WindowFunctionType func)
     {
         this->windowFunction = func;
+        this->windowTable.acquire(func, this->analysisWindowSize);
     }
 
     /**
@@ -341,6 +342,7 @@ public:
     */
     void setWindowSize(uint32 windowSize)
     {
+        Sizes::checkWindowSize(windowSize);
         // FFT must be at least 4 points long
         if(windowSize < 4)
             throw std::invalid_argument("Window size must be 4 or greater");
@@ -352,18 +354,16 @@ public:
 
         this->analysisWindowSize = windowSize;
 
-        // free the FFTW output buffer, and re-malloc according to new window
-        fftwf_free(this->fftwOut);
 
-        // destroy old DFT plan, which depended on this->analysisWindowSize
-        fftwf_destroy_plan(this->fftwPlan);
+        // release old DFT plan, which depended on this->analysisWindowSize
+        this->fftwPlan.reset();
 
-        // allocate new fftwf_complex memory for the plan based on new window size
-        this->fftwOut = (fftwf_complex *) fftwf_alloc_complex(windowHalf+1);
+        // allocate new complex spectrum memory for the plan based on new window size
+        this->fftwOut = fft::resizeComplex(this->fftwOutBuffer, windowHalf+1);
 
-        // create a new DFT plan based on new window size
+        // get a DFT plan for the new window size from the shared cache
         float* fftwIn = &fftwInputVector[0];
-        this->fftwPlan = fftwf_plan_dft_r2c_1d(this->analysisWindowSize, fftwIn, this->fftwOut, FFTWPLANNERFLAG);
+        this->fftwPlan.createRealToComplex(this->analysisWindowSize, fftwIn, this->fftwOut);
 
         // we're supposed to initialize the input array after we create the plan
         for(unsigned long int i=0; i<this->analysisWindowSize; ++i)
@@ -373,18 +373,10 @@ public:
         for(unsigned long int i=0; i<this->analysisWindowSize+this->blockSize; ++i)
             this->signalBuffer[i] = 0.0f;
 
-        this->blackman.resize(windowSize);
-        this->cosine.resize(windowSize);
-        this->hamming.resize(windowSize);
-        this->hann.resize(windowSize);
-
-        // initialize signal windowing functions
-        tIDLib::initBlackmanWindow(this->blackman);
-        tIDLib::initCosineWindow(this->cosine);
-        tIDLib::initHammingWindow(this->hamming);
-        tIDLib::initHannWindow(this->hann);
+        // window table shared with the other instances of the same size
+        this->windowTable.acquire(this->windowFunction, windowSize);
 
-        tIDLib::createFilterbank(this->filterFreqs, this->filterbank, this->numFilters, this->analysisWindowSize, this->sampleRate);
+        this->filterbank.acquire(FilterbankScale::bark, this->barkSpacing, this->analysisWindowSize, this->sampleRate);
     }
 
     /**
@@ -490,6 +482,24 @@ public:
         return this->barkBoundary;
     }
 
+    /**
+     * Place the buffers used at every block in an arena, in the order in
+     * which they are accessed (see tid::Arena)
+    */
+    void layoutBuffers(Arena& arena)
+    {
+        arena.place(this->signalBuffer);
+        arena.place(this->fftwInputVector);
+        arena.place(this->fftwOutBuffer);
+        arena.place(this->bandEnergies);
+        if (arena.isPlacing())
+        {
+            // the plan runs on the new arrays
+            this->fftwOut = reinterpret_cast<fft::Complex*>(this->fftwOutBuffer.data());
+            this->fftwPlan.createRealToComplex(this->analysisWindowSize, this->fftwInputVector.data(), this->fftwOut);
+        }
+    }
+
 private:
 
     /**
@@ -498,13 +508,12 @@ private:
     void initModule()
     {
         this->sampleRate = tIDLib::SAMPLERATEDEFAULT;
-        this->blockSize = tIDLib::BLOCKSIZEDEFAULT;
+        this->blockSize = Sizes::defaultBlockSize;
         this->windowFunction = tIDLib::WindowFunctionType::blackman;
         this->spectrumTypeUsed = tIDLib::SpectrumType::magnitudeSpectrum;
        #if ASYNC_FEATURE_EXTRACTION
         this->lastStoreTime = juce::Time::currentTimeMillis();
        #endif
-        this->sizeFilterFreqs = 0;
         this->numFilters = 0; // this is just an init size that will be updated in createFilterbank anyway.
         this->filterState = tIDLib::FilterState::filterEnabled;
         this->filterOperation = tIDLib::FilterOperation::sumFilterEnergy;
@@ -516,23 +525,15 @@ private:
         for(unsigned long int i=0; i<this->analysisWindowSize+this->blockSize; ++i)
             this->signalBuffer[i] = 0.0f;
 
-        this->blackman.resize(this->analysisWindowSize);
-        this->cosine.resize(this->analysisWindowSize);
-        this->hamming.resize(this->analysisWindowSize);
-        this->hann.resize(this->analysisWindowSize);
-
-        // initialize signal windowing functions
-        tIDLib::initBlackmanWindow(this->blackman);
-        tIDLib::initCosineWindow(this->cosine);
-        tIDLib::initHammingWindow(this->hamming);
-        tIDLib::initHannWindow(this->hann);
+        // window table shared with the other instances of the same size
+        this->windowTable.acquire(this->windowFunction, this->analysisWindowSize);
 
         // set up the FFTW output buffer
-        this->fftwOut = (fftwf_complex *)fftwf_alloc_complex((this->analysisWindowSize * 0.5f) + 1);
+        this->fftwOut = fft::resizeComplex(this->fftwOutBuffer, (this->analysisWindowSize * 0.5f) + 1);
 
-        // DFT plan
+        // DFT plan (shared with the other instances of the same size)
         float* fftwIn = &fftwInputVector[0];
-        this->fftwPlan = fftwf_plan_dft_r2c_1d(this->analysisWindowSize, fftwIn, this->fftwOut, FFTWPLANNERFLAG);
+        this->fftwPlan.createRealToComplex(this->analysisWindowSize, fftwIn, this->fftwOut);
 
         jassert(fftwInputVector.size() == analysisWindowSize);
 
@@ -540,13 +541,10 @@ private:
         for(unsigned long int i=0; i<this->analysisWindowSize; ++i)
             this->fftwInputVector[i] = 0.0f;
 
-        this->sizeFilterFreqs = tIDLib::getBarkBoundFreqs(this->filterFreqs, this->barkSpacing, this->sampleRate);
-        jassert(this->sizeFilterFreqs == this->filterFreqs.size());
-
-        // sizeFilterFreqs-2 is the correct number of filters, since we don't count the start point of the first filter, or the finish point of the last filter
-        this->numFilters = this->sizeFilterFreqs-2;
-
-        tIDLib::createFilterbank(this->filterFreqs, this->filterbank, this->numFilters, this->analysisWindowSize, this->sampleRate);
+        // filterbank shared with the other instances with the same spacing, window size and sample rate
+        this->filterbank.acquire(FilterbankScale::bark, this->barkSpacing, this->analysisWindowSize, this->sampleRate);
+        this->numFilters = this->filterbank.getNumFilters();
+        this->bandEnergies.resize(this->numFilters);
 
         this->barkFreqList.resize(this->numFilters);
 
@@ -563,15 +561,11 @@ private:
     */
     void storeAudioBlock(const SampleType* input, size_t n) noexcept
     {
+        TID_PROFILE_SCOPE(barkSpecBrightness, storeAudioBlock);
         jassert(n ==  this->blockSize);
 
-        // shift signal buffer contents back.
-        for(unsigned long int i = 0; i < this->analysisWindowSize; ++i)
-            this->signalBuffer[i] = this->signalBuffer[i+n];
-
-        // write new block to end of signal buffer.
-        for(unsigned long int i = 0; i < n; ++i)
-            this->signalBuffer[this->analysisWindowSize+i] = input[i];
+        // shift signal buffer contents back and write the new block at its end
+        Sizes::storeBlock(this->signalBuffer.data(), this->analysisWindowSize, input, n);
 
        #if ASYNC_FEATURE_EXTRACTION
         this->lastStoreTime = juce::Time::currentTimeMillis();
@@ -579,13 +573,12 @@ private:
     }
 
     /**
-     * free the memory used by fftw3
+     * free the memory used by the FFT
     */
     void freeMem()
     {
         // free FFTW stuff
-        fftwf_free(this->fftwOut);
-        fftwf_destroy_plan(this->fftwPlan);
+        this->fftwPlan.reset();
     }
 
     //==========================================================================
@@ -602,24 +595,21 @@ private:
     uint32 lastStoreTime; // lastDspTime in Original PD library
    #endif
 
-    std::vector<SampleType> signalBuffer;
+    typename Sizes::template SignalBuffer<SampleType> signalBuffer;
 
-    std::vector<float> fftwInputVector;
-    fftwf_complex *fftwOut;
-    fftwf_plan fftwPlan;
+    typename Sizes::WindowBuffer fftwInputVector;
+    fft::Complex *fftwOut;              // in fftwOutBuffer
+    typename Sizes::SpectrumBuffer fftwOutBuffer;
+    FftPlan fftwPlan;
 
-    std::vector<float> blackman;
-    std::vector<float> cosine;
-    std::vector<float> hamming;
-    std::vector<float> hann;
+    typename Sizes::Window windowTable;   // shared, read-only table of windowFunction (computed at compile time with a fixed window size, none for rectangular)
 
-    t_filterIdx sizeFilterFreqs;
     t_filterIdx numFilters;
 
     std::vector<float> barkFreqList;
     float barkSpacing;
-    std::vector<float> filterFreqs;
-    std::vector<tIDLib::t_filter> filterbank;
+    SharedFilterbank filterbank;  // shared, read-only
+    ArenaVector<float> bandEnergies;  // output of the filterbank
 
     tIDLib::FilterState filterState;
     tIDLib::FilterOperation filterOperation;
@@ -23,22 +23,30 @@ You should have received a copy of the GNU General Public License along with thi
 */
 #pragma once
 
+#include "tidJuceCompat.hpp"
 #include "tIDLib.hpp"
-#include "fftw3.h"
+#include "tidProfiler.hpp"
+#include "tidFft.hpp"
+#include "tidWindowTable.hpp"
+#include "tidFixedSize.hpp"
+#include "tidFilterbank.hpp"
+#include "tidMultiChannel.hpp"
 #include <stdexcept>
 
 namespace tid   /* TimbreID namespace*/
 {
 
-template <typename SampleType>
+template <typename SampleType, unsigned long int WINDOW_SIZE = dynamicSize, unsigned int BLOCK_SIZE = dynamicSize>
 class Bfcc
 {
 public:
+    /** Storage and kernels for the window and block sizes, fixed or dynamicSize (see tidFixedSize.hpp) */
+    using Sizes = AnalysisSizes<WINDOW_SIZE, BLOCK_SIZE>;
 
     /** Creates a Bfcc module with default parameters. */
     Bfcc()
     {
-        this->analysisWindowSize = tIDLib::WINDOWSIZEDEFAULT;
+        this->analysisWindowSize = Sizes::defaultWindowSize;
         this->barkSpacing = tIDLib::BARKSPACINGDEFAULT;
         initModule();
     }
@@ -52,6 +60,7 @@ public:
     {
         if (analysisWindowSize < tIDLib::MINWINDOWSIZE)
             throw std::invalid_argument("Window size must be "+std::to_string(tIDLib::MINWINDOWSIZE)+" or greater.");
+        Sizes::checkWindowSize(analysisWindowSize);
 
         this->analysisWindowSize = analysisWindowSize;
         this->barkSpacing = tIDLib::BARKSPACINGDEFAULT;
@@ -69,6 +78,7 @@ public:
     {
         if (analysisWindowSize < tIDLib::MINWINDOWSIZE)
             throw std::invalid_argument("Window size must be "+std::to_string(tIDLib::MINWINDOWSIZE)+" or greater.");
+        Sizes::checkWindowSize(analysisWindowSize);
         if (barkSpacing < tIDLib::MINBARKSPACING || barkSpacing > tIDLib::MAXBARKSPACING)
             throw std::invalid_argument("Bark spacing must be between "+std::to_string(tIDLib::MINBARKSPACING)+" and "+std::to_string(tIDLib::MAXBARKSPACING)+" Barks");
 
@@ -93,11 +103,18 @@ public:
      * Prepares the module to play by clearing buffers and setting audio buffers
      * standard parameters
      * @param sampleRate The sample rate of the buffer
-     * @param blockSize The size of the individual audio blocks
+     * @param blockSize The size of the individual audio blocks (the fixed one, with a fixed block size)
+     * A new sample rate acquires the filterbank for it, which can throw.
     */
-    void prepare (unsigned long int sampleRate, unsigned int blockSize) noexcept
+    void prepare (unsigned long int sampleRate, unsigned int blockSize)
     {
-        this->sampleRate = sampleRate;
+        Sizes::checkBlockSize(blockSize);
+        if ((float)sampleRate != this->sampleRate)
+        {
+            // the filterbank depends on the sample rate
+            this->sampleRate = sampleRate;
+            createFilterbank(this->barkSpacing);
+        }
         if (blockSize != this->blockSize)
         {
             this->blockSize = blockSize;
@@ -124,15 +141,12 @@ public:
         if (barkSpacing < tIDLib::MINBARKSPACING || barkSpacing > tIDLib::MAXBARKSPACING)
             throw std::invalid_argument("Bark spacing must be between "+std::to_string(tIDLib::MINBARKSPACING)+" and "+std::to_string(tIDLib::MAXBARKSPACING)+" Barks");
 
+        // filterbank shared with the other instances with the same spacing, window size and sample rate
+        // (if it throws, the module keeps the previous one)
+        this->filterbank.acquire(FilterbankScale::bark, barkSpacing, this->analysisWindowSize, this->sampleRate);
         this->barkSpacing = barkSpacing;
-
-        this->sizeFilterFreqs = tIDLib::getBarkBoundFreqs(this->filterFreqs, this->barkSpacing, this->sampleRate);
-        jassert(sizeFilterFreqs == this->filterFreqs.size());
-
-        // sizeFilterFreqs-2 is the correct number of filters, since we don't count the start point of the first filter, or the finish point of the last filter
-        this->numFilters = this->sizeFilterFreqs-2;
-
-        tIDLib::createFilterbank(this->filterFreqs, this->filterbank, this->numFilters, this->analysisWindowSize, this->sampleRate);
+        this->numFilters = this->filterbank.getNumFilters();
+        this->bandEnergies.resize(this->numFilters);
 
         this->coefficientsVector.resize(this->numFilters);
         this->dctPlan.precomputeBasis(this->numFilters);
@@ -160,15 +174,24 @@ public:
         return storeAudioBlock(buffer.getReadPointer(channel), buffer.getNumSamples());
     }
 
+    /**
+     * Stores an audio block into the buffer of the module
+     * Raw pointer version of store(), for use without JUCE buffers.
+     * @param input samples of the audio block
+     * @param n number of samples, it has to match the block size given to prepare()
+    */
+    void store (const SampleType* input, size_t n)
+    {
+        storeAudioBlock(input, n);
+    }
+
     /**
      * Compute the bark frequency cepstral coefficients
      * @return cepstral coefficients
     */
     std::vector<float>& compute()
     {
-        std::vector<float> *windowFuncPtr;
-
-        unsigned long int windowHalf = this->analysisWindowSize * 0.5f;
+        const unsigned long int windowHalf = Sizes::getWindowHalf(this->analysisWindowSize);
 
        #if ASYNC_FEATURE_EXTRACTION
         uint32 currentTime = tid::Time::getTimeSince(this->lastStoreTime);
@@ -176,67 +199,68 @@ public:
         if (offsetSample >= this->blockSize)
             offsetSample = this->blockSize-1;
        #else
-        if ((tIDLib::FEATURE_EXTRACTION_OFFSET < 0.0f) || (tIDLib::FEATURE_EXTRACTION_OFFSET > 1.0f)) throw new std::logic_error("FEATURE_EXTRACTION_OFFSET must be between 0.0 and 1.0 (found "+std::to_string(tIDLib::FEATURE_EXTRACTION_OFFSET)+" instead)");
         uint32 offsetSample = (uint32)(tIDLib::FEATURE_EXTRACTION_OFFSET * (double)this->blockSize);
        #endif
 
+        TID_PROFILE_BEGIN(bfcc, windowCopy);
         // construct analysis window using offsetSample as the end of the window
-        for (unsigned long int i = 0, j = offsetSample; i < this->analysisWindowSize; ++i, ++j)
-            this->fftwInputVector[i] = this->signalBuffer[j];
-
-        switch(this->windowFunction)
-        {
-            case tIDLib::WindowFunctionType::rectangular:
-                break;
-            case tIDLib::WindowFunctionType::blackman:
-                windowFuncPtr = &this->blackman;
-                break;
-            case tIDLib::WindowFunctionType::cosine:
-                windowFuncPtr = &this->cosine;
-                break;
-            case tIDLib::WindowFunctionType::hamming:
-                windowFuncPtr = &this->hamming;
-                break;
-            case tIDLib::WindowFunctionType::hann:
-                windowFuncPtr = &this->hann;
-                break;
-            default:
-                windowFuncPtr = &this->blackman;
-                break;
-        };
+        Sizes::windowCopy(&this->signalBuffer[offsetSample], this->windowTable.data(), &this->fftwInputVector[0], this->analysisWindowSize);
+        TID_PROFILE_END(bfcc, windowCopy);
 
-        // if windowFunction == rectangular, skip the windowing (rectangular)
-        if (this->windowFunction != tIDLib::WindowFunctionType::rectangular)
-            for (unsigned long int i=0; i<this->analysisWindowSize; ++i)
-                this->fftwInputVector[i] *= windowFuncPtr->at(i);
-
-        fftwf_execute(this->fftwPlan);
+        TID_PROFILE_BEGIN(bfcc, fft);
+        this->fftwPlan.execute();
+        TID_PROFILE_END(bfcc, fft);
 
         // put the result of power calc back in fftwIn
-        tIDLib::power(windowHalf+1, this->fftwOut, &fftwInputVector[0]);
+        Sizes::power(windowHalf + 1, this->fftwOut, &fftwInputVector[0]);
 
         if (this->spectrumTypeUsed != tIDLib::SpectrumType::powerSpectrum)
-            tIDLib::mag(windowHalf+1, &fftwInputVector[0]);
+            Sizes::mag(windowHalf + 1, &fftwInputVector[0]);
 
+        TID_PROFILE_BEGIN(bfcc, filterbank);
         switch(this->filterState)
         {
             case tIDLib::FilterState::filterDisabled: // like the old x_specBandAvg == true
-                tIDLib::specFilterBands(windowHalf+1, this->numFilters, &fftwInputVector[0], this->filterbank, this->normalize);
+                tIDLib::specFilterBands(windowHalf+1, this->numFilters, &fftwInputVector[0], &this->bandEnergies[0], this->filterbank.getFilters(), this->normalize);
                 break;
             case tIDLib::FilterState::filterEnabled:
-                tIDLib::filterbankMultiply(&fftwInputVector[0], this->normalize, this->filterOperation, this->filterbank, this->numFilters);
+                tIDLib::filterbankMultiply(&fftwInputVector[0], &this->bandEnergies[0], this->normalize, this->filterOperation, this->filterbank.getFilters(), this->numFilters);
                 break;
             default:
                 throw std::logic_error("Filter option not available");
                 break;
         }
+        TID_PROFILE_END(bfcc, filterbank);
 
         // FFTW DCT-II
-        dctPlan.compute(fftwInputVector,coefficientsVector,this->numFilters);
+        TID_PROFILE_BEGIN(bfcc, dct);
+        dctPlan.compute(this->bandEnergies,coefficientsVector,this->numFilters);
+        TID_PROFILE_END(bfcc, dct);
 
         return this->coefficientsVector;
     }
 
+    /**
+     * Compute the bark frequency cepstral coefficients of many frames at once (offline)
+     * Frame f is input[f*hop, f*hop+analysisWindowSize), windowed like in compute().
+     * The FFT is computed frame by frame, then the filterbank and the DCT run as
+     * batched matrix products over all the frames (tIDLib::cepstralCoefficientsBatch),
+     * with the same results of compute() on the same windows.
+     * It allocates memory, do not call it from a real-time thread.
+     * @param input signal, at least (numFrames-1)*hop+analysisWindowSize samples
+     * @param numFrames number of frames
+     * @param hop distance between the start of two frames, in samples
+     * @return coefficients of the frames, numFrames rows of getNumFilters() values (row-major)
+    */
+    std::vector<float> computeFrames(const SampleType* input, size_t numFrames, size_t hop)
+    {
+        return tIDLib::cepstralCoefficientsBatch(input, numFrames, hop, this->analysisWindowSize, this->windowTable.data(),
+                                                 &this->fftwInputVector[0], this->fftwPlan, this->fftwOut,
+                                                 this->spectrumTypeUsed, this->filterState, this->normalize,
+                                                 this->filterOperation, this->filterbank.getFilters(), this->numFilters,
+                                                 this->dctPlan);
+    }
+
     /*--------------------------- Setters/getters ----------------------------*/
 
     /**
@@ -244,9 +268,10 @@ public:
      * Sets the window function (options in tIDLib header file)
      * @param func window fuction used
     */
-    void setWindowFunction(tIDLib::WindowFunctionType func) noexcept
+    void setWindowFunction(tIDLib::WindowFunctionType func)
     {
         this->windowFunction = func;
+        this->windowTable.acquire(func, this->analysisWindowSize);
     }
 
     /**
@@ -295,6 +320,7 @@ public:
     */
     void setWindowSize(uint32 windowSize)
     {
+        Sizes::checkWindowSize(windowSize);
         if (windowSize < tIDLib::MINWINDOWSIZE)
             throw std::invalid_argument("Window size must be "+std::to_string(tIDLib::MINWINDOWSIZE)+" or greater");
         this->analysisWindowSize = windowSize;
@@ -304,17 +330,15 @@ public:
         this->signalBuffer.resize(this->analysisWindowSize + this->blockSize);
         this->fftwInputVector.resize(this->analysisWindowSize);
 
-        // free the FFTW output buffer, and re-malloc according to new window
-        fftwf_free(this->fftwOut);
 
-        // destroy old DFT plan, which depended on this->analysisWindowSize
-        fftwf_destroy_plan(this->fftwPlan);
+        // release old DFT plan, which depended on this->analysisWindowSize
+        this->fftwPlan.reset();
 
-        // allocate new fftwf_complex memory for the plan based on new window size
-        this->fftwOut = (fftwf_complex *) fftwf_alloc_complex(windowHalf + 1);
+        // allocate new complex spectrum memory for the plan based on new window size
+        this->fftwOut = fft::resizeComplex(this->fftwOutBuffer, windowHalf + 1);
 
-        // create a new DFT plan based on new window size
-        this->fftwPlan = fftwf_plan_dft_r2c_1d(this->analysisWindowSize, &(fftwInputVector[0]), this->fftwOut, FFTWPLANNERFLAG);
+        // get a DFT plan for the new window size from the shared cache
+        this->fftwPlan.createRealToComplex(this->analysisWindowSize, &(fftwInputVector[0]), this->fftwOut);
 
         // we're supposed to initialize the input array after we create the plan
         for (unsigned long int i = 0; i < this->analysisWindowSize; ++i)
@@ -324,18 +348,10 @@ public:
         for (unsigned long int i = 0; i < this->analysisWindowSize + this->blockSize; ++i)
             this->signalBuffer[i] = 0.0f;
 
-        this->blackman.resize(this->analysisWindowSize);
-        this->cosine.resize(this->analysisWindowSize);
-        this->hamming.resize(this->analysisWindowSize);
-        this->hann.resize(this->analysisWindowSize);
+        // window table shared with the other instances of the same size
+        this->windowTable.acquire(this->windowFunction, this->analysisWindowSize);
 
-        // initialize signal windowing functions
-        tIDLib::initBlackmanWindow(this->blackman);
-        tIDLib::initCosineWindow(this->cosine);
-        tIDLib::initHammingWindow(this->hamming);
-        tIDLib::initHannWindow(this->hann);
-
-        tIDLib::createFilterbank(this->filterFreqs, this->filterbank, this->numFilters, this->analysisWindowSize, this->sampleRate);
+        this->filterbank.acquire(FilterbankScale::bark, this->barkSpacing, this->analysisWindowSize, this->sampleRate);
     }
 
     /**
@@ -365,6 +381,15 @@ public:
         return this->normalize;
     }
 
+    /**
+     * Get the number of filters (equal to the number of coefficients)
+     * @return number of filters
+    */
+    t_filterIdx getNumFilters() const noexcept
+    {
+        return this->numFilters;
+    }
+
     /**
      * Return a string containing the main parameters of the module.
      * Refer to the PD helper files of the original timbreID library to know more:
@@ -428,6 +453,25 @@ public:
         return res;
     }
 
+    /**
+     * Place the buffers used at every block in an arena, in the order in
+     * which they are accessed (see tid::Arena)
+    */
+    void layoutBuffers(Arena& arena)
+    {
+        arena.place(this->signalBuffer);
+        arena.place(this->fftwInputVector);
+        arena.place(this->fftwOutBuffer);
+        arena.place(this->bandEnergies);
+        this->dctPlan.layoutBuffers(arena);
+        if (arena.isPlacing())
+        {
+            // the plan runs on the new arrays
+            this->fftwOut = reinterpret_cast<fft::Complex*>(this->fftwOutBuffer.data());
+            this->fftwPlan.createRealToComplex(this->analysisWindowSize, this->fftwInputVector.data(), this->fftwOut);
+        }
+    }
+
 private:
 
     /**
@@ -436,14 +480,13 @@ private:
     void initModule()
     {
         this->sampleRate = tIDLib::SAMPLERATEDEFAULT;
-        this->blockSize = tIDLib::BLOCKSIZEDEFAULT;
+        this->blockSize = Sizes::defaultBlockSize;
         this->windowFunction = tIDLib::WindowFunctionType::blackman;
         this->normalize = true;
         this->spectrumTypeUsed = tIDLib::SpectrumType::magnitudeSpectrum;
        #if ASYNC_FEATURE_EXTRACTION
         this->lastStoreTime = juce::Time::currentTimeMillis();
        #endif
-        this->sizeFilterFreqs = 0;
         this->numFilters = 0; // this is just an init size that will be updated in createFilterbank anyway.
         this->filterState = tIDLib::FilterState::filterEnabled;
         this->filterOperation = tIDLib::FilterOperation::sumFilterEnergy;
@@ -455,34 +498,23 @@ private:
         for (unsigned long int i = 0; i < this->analysisWindowSize + this->blockSize; ++i)
             this->signalBuffer[i] = 0.0f;
 
-        this->blackman.resize(this->analysisWindowSize);
-        this->cosine.resize(this->analysisWindowSize);
-        this->hamming.resize(this->analysisWindowSize);
-        this->hann.resize(this->analysisWindowSize);
-
-        // initialize signal windowing functions
-        tIDLib::initBlackmanWindow(this->blackman);
-        tIDLib::initCosineWindow(this->cosine);
-        tIDLib::initHammingWindow(this->hamming);
-        tIDLib::initHannWindow(this->hann);
+        // window table shared with the other instances of the same size
+        this->windowTable.acquire(this->windowFunction, this->analysisWindowSize);
 
         // set up the FFTW output buffer
-        this->fftwOut = (fftwf_complex *)fftwf_alloc_complex(this->analysisWindowSize * 0.5f + 1);
+        this->fftwOut = fft::resizeComplex(this->fftwOutBuffer, this->analysisWindowSize * 0.5f + 1);
 
-        // DFT plan
-        this->fftwPlan = fftwf_plan_dft_r2c_1d(this->analysisWindowSize, &(fftwInputVector[0]), this->fftwOut, FFTWPLANNERFLAG);
+        // DFT plan (shared with the other instances of the same size)
+        this->fftwPlan.createRealToComplex(this->analysisWindowSize, &(fftwInputVector[0]), this->fftwOut);
 
         // we're supposed to initialize the input array after we create the plan
         for (unsigned long int i=0; i<this->analysisWindowSize; ++i)
             this->fftwInputVector[i] = 0.0f;
 
-        this->sizeFilterFreqs = tIDLib::getBarkBoundFreqs(this->filterFreqs, this->barkSpacing, this->sampleRate);
-        jassert(this->sizeFilterFreqs == this->filterFreqs.size());
-
-        // sizeFilterFreqs-2 is the correct number of filters, since we don't count the start point of the first filter, or the finish point of the last filter
-        this->numFilters = this->sizeFilterFreqs-2;
-
-        tIDLib::createFilterbank(this->filterFreqs, this->filterbank, this->numFilters, this->analysisWindowSize, this->sampleRate);
+        // filterbank shared with the other instances with the same spacing, window size and sample rate
+        this->filterbank.acquire(FilterbankScale::bark, this->barkSpacing, this->analysisWindowSize, this->sampleRate);
+        this->numFilters = this->filterbank.getNumFilters();
+        this->bandEnergies.resize(this->numFilters);
 
         this->coefficientsVector.resize(this->numFilters);
         this->dctPlan.precomputeBasis(this->numFilters);
@@ -495,13 +527,9 @@ private:
     */
     void storeAudioBlock(const SampleType* input, size_t n) noexcept
     {
-        // shift signal buffer contents back.
-        for (unsigned long int i = 0; i < this->analysisWindowSize; ++i)
-            this->signalBuffer[i] = this->signalBuffer[i+n];
-
-        // write new block to end of signal buffer.
-        for (unsigned long int i = 0; i < n; ++i)
-            this->signalBuffer[this->analysisWindowSize+i] = input[i];
+        TID_PROFILE_SCOPE(bfcc, storeAudioBlock);
+        // shift signal buffer contents back and write the new block at its end
+        Sizes::storeBlock(this->signalBuffer.data(), this->analysisWindowSize, input, n);
 
        #if ASYNC_FEATURE_EXTRACTION
         this->lastStoreTime = juce::Time::currentTimeMillis();
@@ -514,8 +542,7 @@ private:
     void freeMem()
     {
         // free FFTW stuff
-        fftwf_free(this->fftwOut);
-        fftwf_destroy_plan(this->fftwPlan);
+        this->fftwPlan.reset();
     }
 
     //==========================================================================
@@ -532,24 +559,21 @@ private:
     uint32 lastStoreTime; // replaces x_lastDspTime
    #endif
 
-    std::vector<SampleType> signalBuffer;
+    typename Sizes::template SignalBuffer<SampleType> signalBuffer;
 
-    std::vector<float> fftwInputVector;
-    fftwf_complex *fftwOut;
-    fftwf_plan fftwPlan;
-    tIDLib::DiscreteCosineTransform<SampleType> dctPlan;
+    typename Sizes::WindowBuffer fftwInputVector;
+    fft::Complex *fftwOut;              // in fftwOutBuffer
+    typename Sizes::SpectrumBuffer fftwOutBuffer;
+    FftPlan fftwPlan;
+    tIDLib::DiscreteCosineTransform<float> dctPlan; // Operates on the float spectrum, whatever the SampleType
 
-    std::vector<float> blackman;
-    std::vector<float> cosine;
-    std::vector<float> hamming;
-    std::vector<float> hann;
+    typename Sizes::Window windowTable;   // shared, read-only table of windowFunction (computed at compile time with a fixed window size, none for rectangular)
 
-    t_filterIdx sizeFilterFreqs;
     t_filterIdx numFilters;
 
     float barkSpacing;
-    std::vector<float> filterFreqs;
-    std::vector<tIDLib::t_filter> filterbank;
+    SharedFilterbank filterbank;  // shared, read-only
+    ArenaVector<float> bandEnergies;  // output of the filterbank
 
     tIDLib::FilterState filterState;         // replaces x_specBandAvg
     tIDLib::FilterOperation filterOperation; // replaces x_filterAvg
@@ -558,4 +582,158 @@ private:
     std::vector<float> coefficientsVector;
 };
 
+/**
+ * Bark frequency cepstral coefficients of up to tIDLib::INTERLEAVEDLANES channels (e.g. hexaphonic pickups)
+ * Same results of a Bfcc per channel (with the triangular filters,
+ * filterEnabled), but the window table, the FFT, the filterbank and the
+ * DCT basis are shared by the channels, and the filterbank and the DCT (and,
+ * with the built-in backend and 3 channels or more, the FFT) run on all of
+ * them at once (see tidMultiChannel.hpp).
+*/
+template <typename SampleType>
+class MultiBfcc
+{
+public:
+    /**
+     * MultiBfcc constructor
+     * @param numChannels number of channels analysed (1 to tIDLib::INTERLEAVEDLANES)
+     * @param analysisWindowSize size of the analysis window
+     * @param barkSpacing filter spacing in Barks
+    */
+    MultiBfcc(unsigned int numChannels, unsigned long int analysisWindowSize = tIDLib::WINDOWSIZEDEFAULT, float barkSpacing = tIDLib::BARKSPACINGDEFAULT)
+    {
+        this->bands.setWindowFunction(tIDLib::WindowFunctionType::blackman);
+        this->bands.setNormalize(true);
+        this->bands.setSpectrumType(tIDLib::SpectrumType::magnitudeSpectrum);
+        this->bands.setup(numChannels, analysisWindowSize, barkSpacing, this->sampleRate, analysisWindowSize + this->blockSize);
+        resizeBuffers();
+    }
+
+    /**
+     * Initialization of the module (it allocates, the filterbank is built for the new sample rate)
+     * @param sampleRate The sample rate of the buffer
+     * @param blockSize The size of the individual audio blocks
+    */
+    void prepare (double sampleRate, unsigned int blockSize)
+    {
+        this->sampleRate = sampleRate;
+        this->blockSize = blockSize;
+        this->bands.setup(getNumChannels(), getWindowSize(), this->bands.getBarkSpacing(), sampleRate, getWindowSize() + blockSize);
+        resizeBuffers();
+    }
+
+    /** Resets the processing pipeline (zeros in the analysis buffer of every channel) */
+    void reset() noexcept
+    {
+        this->bands.clear();
+    }
+
+    /**
+     * Stores the channels firstChannel ... firstChannel+getNumChannels()-1 of an audio block
+     * @param buffer audio buffer
+     * @param firstChannel index of the first channel analysed
+    */
+    template <typename OtherSampleType>
+    void store (AudioBuffer<OtherSampleType>& buffer, short firstChannel = 0)
+    {
+        static_assert (std::is_same<OtherSampleType, SampleType>::value,
+                       "The sample-type of the module must match the sample-type supplied to this store callback");
+        this->block.interleave(buffer, firstChannel);
+        store(this->block);
+    }
+
+    /**
+     * Stores an audio block of every channel
+     * @param channels getNumChannels() pointers to n samples
+     * @param n number of samples, it has to match the block size given to prepare()
+    */
+    void store (const SampleType* const* channels, size_t n)
+    {
+        this->block.interleave(channels, n);
+        store(this->block);
+    }
+
+    /** Stores an audio block already interleaved (at least getNumChannels() channels) */
+    void store (const InterleavedBlock& interleaved)
+    {
+        if (interleaved.getNumChannels() < getNumChannels())
+            throw std::invalid_argument("The interleaved block has "+std::to_string(interleaved.getNumChannels())+" channels, "+std::to_string(getNumChannels())+" are analysed");
+        TID_PROFILE_SCOPE(bfcc, storeAudioBlock);
+        this->bands.push(interleaved.getFrames(), interleaved.getNumFrames());
+    }
+
+    /**
+     * Compute the bfcc coefficients of all the channels
+     * @return getNumChannels() vectors of getNumFilters() coefficients
+    */
+    const std::vector<std::vector<float>>& compute() noexcept
+    {
+        TID_PROFILE_BEGIN(bfcc, filterbank);
+        const float* energies = this->bands.compute(getFeatureExtractionLag(this->blockSize));
+        TID_PROFILE_END(bfcc, filterbank);
+
+        TID_PROFILE_BEGIN(bfcc, dct);
+        this->dctPlan.computeInterleaved(energies, this->coefficients.data());
+        TID_PROFILE_END(bfcc, dct);
+
+        for (unsigned int c = 0; c < getNumChannels(); ++c)
+            for (t_filterIdx i = 0; i < getNumFilters(); ++i)
+                this->listOut[c][i] = this->coefficients[i * tIDLib::INTERLEAVEDLANES + c];
+        return this->listOut;
+    }
+
+    /*--------------------------- Setters/getters ----------------------------*/
+
+    /** Set the window function used (options in tIDLib header file) */
+    void setWindowFunction(tIDLib::WindowFunctionType func) { this->bands.setWindowFunction(func); }
+
+    /** Sum or average the energy in each filter (default: sum) */
+    void setFilterOperation(tIDLib::FilterOperation operationType) noexcept { this->bands.setFilterOperation(operationType); }
+
+    /** Set whether the power spectrum or the magnitude spectrum is used */
+    void setSpectrumType(tIDLib::SpectrumType spec) noexcept { this->bands.setSpectrumType(spec); }
+
+    /** Set the normalization flag */
+    void setNormalize(bool norm) noexcept { this->bands.setNormalize(norm); }
+
+    bool getNormalize() const noexcept { return this->bands.getNormalize(); }
+
+    /** Set analysis window size (it allocates and clears the analysis buffers) */
+    void setWindowSize(uint32 windowSize)
+    {
+        this->bands.setup(getNumChannels(), windowSize, this->bands.getBarkSpacing(), this->sampleRate, windowSize + this->blockSize);
+        resizeBuffers();
+    }
+
+    /** Construct a new filterbank with a specific spacing (in Barks) */
+    void createFilterbank(float barkSpacing)
+    {
+        this->bands.setup(getNumChannels(), getWindowSize(), barkSpacing, this->sampleRate, getWindowSize() + this->blockSize);
+        resizeBuffers();
+    }
+
+    unsigned long int getWindowSize() const noexcept { return this->bands.getWindowSize(); }
+    unsigned int getNumChannels() const noexcept { return this->bands.getNumChannels(); }
+    /** Number of filters (equal to the number of coefficients) */
+    t_filterIdx getNumFilters() const noexcept { return this->bands.getNumFilters(); }
+
+private:
+    void resizeBuffers()
+    {
+        this->block.prepare(getNumChannels(), this->blockSize);
+        this->dctPlan.precomputeBasis(getNumFilters());
+        this->coefficients.assign((size_t)getNumFilters() * tIDLib::INTERLEAVEDLANES, 0.0f);
+        this->listOut.assign(getNumChannels(), std::vector<float>(getNumFilters(), 0.0f));
+    }
+
+    double sampleRate = tIDLib::SAMPLERATEDEFAULT;
+    unsigned int blockSize = tIDLib::BLOCKSIZEDEFAULT;
+
+    MultiChannelBarkBands bands;
+    InterleavedBlock block;
+    tIDLib::DiscreteCosineTransform<float> dctPlan;
+    std::vector<float> coefficients;    // numFilters x INTERLEAVEDLANES
+    std::vector<std::vector<float>> listOut;
+};
+
 } // namespace tid
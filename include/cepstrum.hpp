@@ -22,22 +22,28 @@ You should have received a copy of the GNU General Public License along with thi
 */
 #pragma once
 
+#include "tidJuceCompat.hpp"
 #include "tIDLib.hpp"
-#include "fftw3.h"
+#include "tidProfiler.hpp"
+#include "tidFft.hpp"
+#include "tidWindowTable.hpp"
+#include "tidFixedSize.hpp"
 #include <stdexcept>
 
 namespace tid   /* TimbreID namespace*/
 {
 
-template <typename SampleType>
+template <typename SampleType, unsigned long int WINDOW_SIZE = dynamicSize, unsigned int BLOCK_SIZE = dynamicSize>
 class Cepstrum
 {
 public:
+    /** Storage and kernels for the window and block sizes, fixed or dynamicSize (see tidFixedSize.hpp) */
+    using Sizes = AnalysisSizes<WINDOW_SIZE, BLOCK_SIZE>;
 
     /** Creates a Cepstrum module with default parameters. */
     Cepstrum()
     {
-        this->analysisWindowSize = tIDLib::WINDOWSIZEDEFAULT;
+        this->analysisWindowSize = Sizes::defaultWindowSize;
         initModule();
     }
 
@@ -50,6 +56,7 @@ public:
     {
         if (analysisWindowSize < tIDLib::MINWINDOWSIZE)
             throw std::invalid_argument("Window size must be " + std::to_string(tIDLib::MINWINDOWSIZE) + " or greater.");
+        Sizes::checkWindowSize(analysisWindowSize);
 
         this->analysisWindowSize = analysisWindowSize;
         initModule();
@@ -71,10 +78,11 @@ public:
      * Prepares the module to play by clearing buffers and setting audio buffers
      * standard parameters
      * @param sampleRate The sample rate of the buffer
-     * @param blockSize The size of the individual audio blocks
+     * @param blockSize The size of the individual audio blocks (the fixed one, with a fixed block size)
     */
-    void prepare (unsigned long int sampleRate, unsigned int blockSize) noexcept
+    void prepare (unsigned long int sampleRate, unsigned int blockSize) noexcept(!Sizes::fixedBlock)
     {
+        Sizes::checkBlockSize(blockSize);
         this->sampleRate = sampleRate;
         if (blockSize != this->blockSize)
         {
@@ -117,14 +125,24 @@ public:
         return storeAudioBlock(buffer.getReadPointer(channel), buffer.getNumSamples());
     }
 
+    /**
+     * Stores an audio block into the buffer of the module
+     * Raw pointer version of store(), for use without JUCE buffers.
+     * @param input samples of the audio block
+     * @param n number of samples, it has to match the block size given to prepare()
+    */
+    void store (const SampleType* input, size_t n)
+    {
+        storeAudioBlock(input, n);
+    }
+
     /**
      * Compute the cepstrum coefficients
      * @return cepstrum coefficients
     */
     std::vector<float>& compute()
     {
-        std::vector<float> *windowFuncPtr;
-        unsigned long int windowHalf = this->analysisWindowSize * 0.5f;
+        const unsigned long int windowHalf = Sizes::getWindowHalf(this->analysisWindowSize);
 
        #if ASYNC_FEATURE_EXTRACTION
         uint32 currentTime = tid::Time::getTimeSince(this->lastStoreTime);
@@ -132,48 +150,24 @@ public:
         if (offsetSample >= this->blockSize)
             offsetSample = this->blockSize - 1;
        #else
-        if ((tIDLib::FEATURE_EXTRACTION_OFFSET < 0.0f) || (tIDLib::FEATURE_EXTRACTION_OFFSET > 1.0f)) throw new std::logic_error("FEATURE_EXTRACTION_OFFSET must be between 0.0 and 1.0 (found "+std::to_string(tIDLib::FEATURE_EXTRACTION_OFFSET)+" instead)");
         uint32 offsetSample = (uint32)(tIDLib::FEATURE_EXTRACTION_OFFSET * (double)this->blockSize);
        #endif
 
+        TID_PROFILE_BEGIN(cepstrum, windowCopy);
         // construct analysis window using offsetSample as the end of the window
-        for (unsigned long int i = 0, j = offsetSample; i < this->analysisWindowSize; ++i, ++j)
-            this->fftwInputVector[i] = this->signalBuffer[j];
+        Sizes::windowCopy(&this->signalBuffer[offsetSample], this->windowTable.data(), &this->fftwInputVector[0], this->analysisWindowSize);
+        TID_PROFILE_END(cepstrum, windowCopy);
 
-        switch(this->windowFunction)
-        {
-            case tIDLib::WindowFunctionType::rectangular:
-                break;
-            case tIDLib::WindowFunctionType::blackman:
-                windowFuncPtr = &this->blackman;
-                break;
-            case tIDLib::WindowFunctionType::cosine:
-                windowFuncPtr = &this->cosine;
-                break;
-            case tIDLib::WindowFunctionType::hamming:
-                windowFuncPtr = &this->hamming;
-                break;
-            case tIDLib::WindowFunctionType::hann:
-                windowFuncPtr = &this->hann;
-                break;
-            default:
-                windowFuncPtr = &this->blackman;
-                break;
-        };
-
-        // if windowFunction == 0, skip the windowing (rectangular)
-        if (this->windowFunction != tIDLib::WindowFunctionType::rectangular)
-            for (unsigned long int i=0; i<this->analysisWindowSize; ++i)
-                this->fftwInputVector[i] *= windowFuncPtr->at(i);
-
-        fftwf_execute(this->fftwForwardPlan);
+        TID_PROFILE_BEGIN(cepstrum, fft);
+        this->fftwForwardPlan.execute();
+        TID_PROFILE_END(cepstrum, fft);
 
         // put the result of power calc back in fftwIn
         float* fftwIn = &(this->fftwInputVector[0]);
-        tIDLib::power(windowHalf + 1, this->fftwOut, fftwIn);
+        Sizes::power(windowHalf + 1, this->fftwOut, fftwIn);
 
         if (this->spectrumTypeUsed != tIDLib::SpectrumType::powerSpectrum)
-            tIDLib::mag(windowHalf + 1, fftwIn);
+            Sizes::mag(windowHalf + 1, fftwIn);
 
         // add 1.0 to power or magnitude spectrum before taking the log and then IFT. Avoid large negative values from log(negativeNum)
         if (this->spectrumOffset)
@@ -189,7 +183,9 @@ public:
             this->fftwOut[i][1] = 0.0f;
         }
 
-        fftwf_execute(this->fftwBackwardPlan);
+        TID_PROFILE_BEGIN(cepstrum, ifft);
+        this->fftwBackwardPlan.execute();
+        TID_PROFILE_END(cepstrum, ifft);
 
         for (unsigned long int i = 0; i < windowHalf + 1; ++i)
             this->fftwInputVector[i] *= (1.0f / this->analysisWindowSize);
@@ -210,9 +206,10 @@ public:
      * Sets the window function (options in tIDLib header file)
      * @param func window fuction used
     */
-    void setWindowFunction(tIDLib::WindowFunctionType func) noexcept
+    void setWindowFunction(tIDLib::WindowFunctionType func)
     {
         this->windowFunction = func;
+        this->windowTable.acquire(func, this->analysisWindowSize);
     }
 
     /**
@@ -254,6 +251,7 @@ public:
     */
     void setWindowSize(uint32 windowSize)
     {
+        Sizes::checkWindowSize(windowSize);
         if (windowSize < tIDLib::MINWINDOWSIZE)
             throw std::invalid_argument("Window size must be " + std::to_string(tIDLib::MINWINDOWSIZE) + " or greater");
         this->analysisWindowSize = windowSize;
@@ -264,20 +262,18 @@ public:
         this->fftwInputVector.resize(this->analysisWindowSize);
         this->listOut.resize(windowHalf + 1);
 
-        // free the FFTW output buffer, and re-malloc according to new window
-        fftwf_free(this->fftwOut);
 
-        // destroy old plan, which depended on this->analysisWindowSize
-        fftwf_destroy_plan(this->fftwForwardPlan);
-        fftwf_destroy_plan(this->fftwBackwardPlan);
+        // release old plan, which depended on this->analysisWindowSize
+        this->fftwForwardPlan.reset();
+        this->fftwBackwardPlan.reset();
 
-        // allocate new fftwf_complex memory for the plan based on new window size
-        this->fftwOut = (fftwf_complex *) fftwf_alloc_complex(windowHalf + 1);
+        // allocate new complex spectrum memory for the plan based on new window size
+        this->fftwOut = fft::resizeComplex(this->fftwOutBuffer, windowHalf + 1);
 
-        // create a new DFT plan based on new window size
+        // get a DFT plan for the new window size from the shared cache
         float* fftwIn = &(this->fftwInputVector[0]);
-        this->fftwForwardPlan = fftwf_plan_dft_r2c_1d(this->analysisWindowSize, fftwIn, this->fftwOut, FFTWPLANNERFLAG);
-        this->fftwBackwardPlan = fftwf_plan_dft_c2r_1d(this->analysisWindowSize, this->fftwOut, fftwIn, FFTWPLANNERFLAG);
+        this->fftwForwardPlan.createRealToComplex(this->analysisWindowSize, fftwIn, this->fftwOut);
+        this->fftwBackwardPlan.createComplexToReal(this->analysisWindowSize, this->fftwOut, fftwIn);
 
         // we're supposed to initialize the input array after we create the plan
         for (unsigned long int i = 0; i < this->analysisWindowSize; ++i)
@@ -287,16 +283,8 @@ public:
         for (unsigned long int i = 0; i < this->analysisWindowSize + this->blockSize; ++i)
             this->signalBuffer[i] = 0.0f;
 
-        this->blackman.resize(this->analysisWindowSize);
-        this->cosine.resize(this->analysisWindowSize);
-        this->hamming.resize(this->analysisWindowSize);
-        this->hann.resize(this->analysisWindowSize);
-
-        // initialize signal windowing functions
-        tIDLib::initBlackmanWindow(this->blackman);
-        tIDLib::initCosineWindow(this->cosine);
-        tIDLib::initHammingWindow(this->hamming);
-        tIDLib::initHannWindow(this->hann);
+        // window table shared with the other instances of the same size
+        this->windowTable.acquire(this->windowFunction, this->analysisWindowSize);
     }
 
     /**
@@ -362,6 +350,24 @@ public:
         return res;
     }
 
+    /**
+     * Place the buffers used at every block in an arena, in the order in
+     * which they are accessed (see tid::Arena)
+    */
+    void layoutBuffers(Arena& arena)
+    {
+        arena.place(this->signalBuffer);
+        arena.place(this->fftwInputVector);
+        arena.place(this->fftwOutBuffer);
+        if (arena.isPlacing())
+        {
+            // the plans run on the new arrays
+            this->fftwOut = reinterpret_cast<fft::Complex*>(this->fftwOutBuffer.data());
+            this->fftwForwardPlan.createRealToComplex(this->analysisWindowSize, this->fftwInputVector.data(), this->fftwOut);
+            this->fftwBackwardPlan.createComplexToReal(this->analysisWindowSize, this->fftwOut, this->fftwInputVector.data());
+        }
+    }
+
 private:
 
     /**
@@ -371,13 +377,9 @@ private:
     */
     void storeAudioBlock(const SampleType* input, size_t n) noexcept
     {
-        // shift signal buffer contents back.
-        for (unsigned long int i = 0; i < this->analysisWindowSize; ++i)
-            this->signalBuffer[i] = this->signalBuffer[i + n];
-
-        // write new block to end of signal buffer.
-        for (unsigned long int i = 0; i < n; ++i)
-            this->signalBuffer[this->analysisWindowSize + i] = input[i];
+        TID_PROFILE_SCOPE(cepstrum, storeAudioBlock);
+        // shift signal buffer contents back and write the new block at its end
+        Sizes::storeBlock(this->signalBuffer.data(), this->analysisWindowSize, input, n);
 
        #if ASYNC_FEATURE_EXTRACTION
         this->lastStoreTime = juce::Time::currentTimeMillis();
@@ -390,7 +392,7 @@ private:
     void initModule()
     {
         this->sampleRate = tIDLib::SAMPLERATEDEFAULT;
-        this->blockSize = tIDLib::BLOCKSIZEDEFAULT;
+        this->blockSize = Sizes::defaultBlockSize;
         this->windowFunction = tIDLib::WindowFunctionType::blackman;
         this->spectrumTypeUsed = tIDLib::SpectrumType::magnitudeSpectrum;
         this->cepstrumTypeUsed = tIDLib::CepstrumType::magnitudeCepstrum;
@@ -406,26 +408,18 @@ private:
         for (unsigned long int i = 0; i < (this->analysisWindowSize + this->blockSize); ++i)
             this->signalBuffer[i] = 0.0f;
 
-        this->blackman.resize(this->analysisWindowSize);
-        this->cosine.resize(this->analysisWindowSize);
-        this->hamming.resize(this->analysisWindowSize);
-        this->hann.resize(this->analysisWindowSize);
-
-        // initialize signal windowing functions
-        tIDLib::initBlackmanWindow(this->blackman);
-        tIDLib::initCosineWindow(this->cosine);
-        tIDLib::initHammingWindow(this->hamming);
-        tIDLib::initHannWindow(this->hann);
+        // window table shared with the other instances of the same size
+        this->windowTable.acquire(this->windowFunction, this->analysisWindowSize);
 
         // set up the FFTW output buffer.
-        this->fftwOut = (fftwf_complex *)fftwf_alloc_complex(this->analysisWindowSize * 0.5f + 1);
+        this->fftwOut = fft::resizeComplex(this->fftwOutBuffer, this->analysisWindowSize * 0.5f + 1);
 
         // Forward DFT plan
         float* fftwIn = &(this->fftwInputVector[0]);
-        this->fftwForwardPlan = fftwf_plan_dft_r2c_1d(this->analysisWindowSize, fftwIn, this->fftwOut, FFTWPLANNERFLAG);
+        this->fftwForwardPlan.createRealToComplex(this->analysisWindowSize, fftwIn, this->fftwOut);
 
         // Backward DFT plan
-        this->fftwBackwardPlan = fftwf_plan_dft_c2r_1d(this->analysisWindowSize, this->fftwOut, fftwIn, FFTWPLANNERFLAG);
+        this->fftwBackwardPlan.createComplexToReal(this->analysisWindowSize, this->fftwOut, fftwIn);
 
         // we're supposed to initialize the input array after we create the plan
         for (unsigned long int i = 0; i < this->analysisWindowSize; ++i)
@@ -438,9 +432,8 @@ private:
     void freeMem()
     {
         // free FFTW stuff
-        fftwf_free(this->fftwOut);
-        fftwf_destroy_plan(this->fftwForwardPlan);
-        fftwf_destroy_plan(this->fftwBackwardPlan);
+        this->fftwForwardPlan.reset();
+        this->fftwBackwardPlan.reset();
     }
 
     //==========================================================================
@@ -459,17 +452,15 @@ private:
     uint32 lastStoreTime; // replaces x_lastDspTime
    #endif
 
-    std::vector<SampleType> signalBuffer;
+    typename Sizes::template SignalBuffer<SampleType> signalBuffer;
 
-    std::vector<float> fftwInputVector;
-    fftwf_complex *fftwOut;
-    fftwf_plan fftwForwardPlan;
-    fftwf_plan fftwBackwardPlan;
+    typename Sizes::WindowBuffer fftwInputVector;
+    fft::Complex *fftwOut;              // in fftwOutBuffer
+    typename Sizes::SpectrumBuffer fftwOutBuffer;
+    FftPlan fftwForwardPlan;
+    FftPlan fftwBackwardPlan;
 
-    std::vector<float> blackman;
-    std::vector<float> cosine;
-    std::vector<float> hamming;
-    std::vector<float> hann;
+    typename Sizes::Window windowTable;   // shared, read-only table of windowFunction (computed at compile time with a fixed window size, none for rectangular)
 
     std::vector<float> listOut;
 };
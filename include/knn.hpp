@@ -23,7 +23,11 @@ You should have received a copy of the GNU General Public License along with thi
 */
 #pragma once
 
+#include "tidJuceCompat.hpp"
 #include "tIDLib.hpp"
+#include "tidProfiler.hpp"
+#include "tidRTLog.hpp"
+#include "tidNpy.hpp"
 #include <tuple>
 
 namespace tid   /* TimbreID namespace*/
@@ -139,6 +143,7 @@ public:
             bestDist = FLT_MAX;
             secondBestDist = FLT_MAX;
 
+            TID_PROFILE_BEGIN(knn, knnDistance);
             for (t_instanceIdx i = 0; i < this->numInstances; ++i)
             {
                 dist = this->getInputDist(i);
@@ -149,9 +154,12 @@ public:
 
                 this->instances[i].knnInfo.dist = this->instances[i].knnInfo.safeDist = dist; // store the distance
             }
+            TID_PROFILE_END(knn, knnDistance);
 
             // a reduced sort, so that the first k elements in this->instances will be the ones with lowest distances to the input feature in the list, and in order to boot. NOTE: tIDLib::sortKnnInfo() does not operate on the primary instance data, just each instance's knnInfo member.
+            TID_PROFILE_BEGIN(knn, knnTopK);
             tIDLib::sortKnnInfo(this->kValue, this->numInstances, UINT_MAX, this->instances); // pass a prevMatch value of UINT_MAX as a flag that it's unused here
+            TID_PROFILE_END(knn, knnTopK);
 
             // store instance's cluster id
             for (t_instanceIdx i = 0; i < this->kValue; ++i)
@@ -353,6 +361,7 @@ public:
                     searchStart = this->numInstances-1;
             }
 
+            TID_PROFILE_BEGIN(knn, knnDistance);
             for (j = 0, i = searchStart; j < this->neighborhood; ++j)
             {
                 dist = this->getInputDist(i);
@@ -373,12 +382,15 @@ public:
                         break;
                 }
             }
+            TID_PROFILE_END(knn, knnDistance);
 
             // a reduced sort, so that the first maxMatches elements in this->instances will have the lowest distances in their knnInfo.safeDist, and in order to boot.
             // pass this->prevMatch to make sure we don't output the same match two times in a row (to prevent one grain being played back several
             // times in sequence.
             // this is wasteful in restricted searches because we don't need to look through all this->numInstances
+            TID_PROFILE_BEGIN(knn, knnTopK);
             tIDLib::sortKnnInfo(this->maxMatches, this->numInstances, this->prevMatch, this->instances);
+            TID_PROFILE_END(knn, knnTopK);
 
             if (this->prevMatch == UINT_MAX)
             {
@@ -1783,6 +1795,214 @@ public:
         fclose(filePtr);
     }
 
+    /**
+     * Writes the database in the NPY format, as a float32 matrix with one
+     * (non-normalized) instance per row, e.g. X = np.load("feature-db.npy").
+     * This is much faster and smaller than the text format and can be read
+     * without parsing. All the instances must have the same length, use
+     * writeNpzData otherwise
+     * eg. writeNpyData("./data/feature-db.npy")
+     * @see readNpyData
+    */
+    bool writeNpyData(std::string filename)
+    {
+        std::vector<float> matrix;
+        std::vector<uint32_t> lengths;
+        t_attributeIdx numCols = this->getInstanceMatrix(matrix, lengths);
+
+        for (t_instanceIdx i = 0; i < this->numInstances; ++i)
+            if (lengths[i] != numCols)
+            {
+                rtlogger.logInfo("Instances have different lengths, use writeNpzData for ",filename.c_str());
+                return false;
+            }
+
+        try
+        {
+            tid::npy::writeNpy(filename, matrix, {(size_t)this->numInstances, (size_t)numCols});
+        }
+        catch (const std::exception& e)
+        {
+            rtlogger.logInfo(e.what());
+            return false;
+        }
+
+        char message[tid::RealTimeLogger::LogEntry::MESSAGE_LENGTH+1];
+        snprintf(message,sizeof(message),"Wrote %u non-normalized instances to %s.",this->numInstances,filename.c_str());
+        rtlogger.logInfo(message);
+        return true;
+    }
+
+    /**
+     * Reads a 2D NPY matrix, one instance per row (e.g. np.save("feature-db.npy", X)).
+     * The file is memory-mapped and copied once into the database. Any numeric
+     * type is accepted and converted to float.
+     * eg. readNpyData("./data/feature-db.npy")
+    */
+    bool readNpyData(std::string filename)
+    {
+        try
+        {
+            const tid::npy::Array matrix = tid::npy::loadNpy(filename);
+            if (matrix.getShape().size() != 2)
+            {
+                rtlogger.logInfo(filename.c_str()," does not contain a 2D matrix. read failed.");
+                return false;
+            }
+            this->setInstanceMatrix(matrix, nullptr);
+        }
+        catch (const std::exception& e)
+        {
+            rtlogger.logInfo(e.what());
+            return false;
+        }
+
+        char message[tid::RealTimeLogger::LogEntry::MESSAGE_LENGTH+1];
+        snprintf(message,sizeof(message),"Read %u instances from %s.",this->numInstances,filename.c_str());
+        rtlogger.logInfo(message);
+        return true;
+    }
+
+    /**
+     * Writes the database and the clustering in an NPZ archive with the arrays
+     * "features" (float32, one non-normalized instance per row, shorter
+     * instances padded with zeros), "lengths" (uint32, length of each instance)
+     * and "labels" (uint32, cluster of each instance).
+     * eg. writeNpzData("./data/feature-db.npz")
+     * @see readNpzData
+    */
+    bool writeNpzData(std::string filename)
+    {
+        std::vector<float> matrix;
+        std::vector<uint32_t> lengths;
+        t_attributeIdx numCols = this->getInstanceMatrix(matrix, lengths);
+
+        std::vector<uint32_t> labels(this->numInstances);
+        for (t_instanceIdx i = 0; i < this->numInstances; ++i)
+            labels[i] = this->instances[i].clusterMembership;
+
+        try
+        {
+            tid::npy::NpzWriter npz(filename);
+            npz.add("features", matrix, {(size_t)this->numInstances, (size_t)numCols});
+            npz.add("lengths", lengths, {(size_t)this->numInstances});
+            npz.add("labels", labels, {(size_t)this->numInstances});
+            npz.close();
+        }
+        catch (const std::exception& e)
+        {
+            rtlogger.logInfo(e.what());
+            return false;
+        }
+
+        char message[tid::RealTimeLogger::LogEntry::MESSAGE_LENGTH+1];
+        snprintf(message,sizeof(message),"Wrote %u non-normalized instances and %u clusters to %s.",this->numInstances,this->numClusters,filename.c_str());
+        rtlogger.logInfo(message);
+        return true;
+    }
+
+    /**
+     * Reads an NPZ archive written by writeNpzData or by
+     * np.savez("feature-db.npz", features=X, labels=y). "lengths" and "labels"
+     * are optional: without them all the instances are as long as the rows of
+     * "features" and unclustered.
+     * eg. readNpzData("./data/feature-db.npz")
+    */
+    bool readNpzData(std::string filename)
+    {
+        try
+        {
+            const tid::npy::NpzFile npz(filename);
+            const tid::npy::Array matrix = npz.get("features");
+            if (matrix.getShape().size() != 2)
+            {
+                rtlogger.logInfo(filename.c_str()," does not contain a 2D features matrix. read failed.");
+                return false;
+            }
+
+            std::vector<int64_t> lengths;
+            if (npz.contains("lengths"))
+            {
+                lengths = npz.get("lengths").toVector<int64_t>();
+                if (lengths.size() != matrix.getNumRows())
+                {
+                    rtlogger.logInfo(filename.c_str()," has a wrong number of instance lengths. read failed.");
+                    return false;
+                }
+                for (int64_t length : lengths)
+                    if (length < 1 || (size_t)length > matrix.getNumCols())
+                    {
+                        rtlogger.logInfo(filename.c_str()," contains invalid instance lengths. read failed.");
+                        return false;
+                    }
+            }
+            this->setInstanceMatrix(matrix, lengths.empty() ? nullptr : lengths.data());
+
+            if (npz.contains("labels") && !this->setClusterLabels(npz.get("labels").toVector<int64_t>(), filename))
+                return false;
+        }
+        catch (const std::exception& e)
+        {
+            rtlogger.logInfo(e.what());
+            return false;
+        }
+
+        char message[tid::RealTimeLogger::LogEntry::MESSAGE_LENGTH+1];
+        snprintf(message,sizeof(message),"Read %u instances and %u clusters from %s.",this->numInstances,this->numClusters,filename.c_str());
+        rtlogger.logInfo(message);
+        return true;
+    }
+
+    /**
+     * Writes the cluster of each instance as a uint32 NPY vector (the labels y
+     * of a training set in Python). This is a smaller alternative to
+     * writeClusters, the member lists are rebuilt by readClustersNpy
+     * eg. writeClustersNpy("./data/cluster.npy")
+    */
+    void writeClustersNpy(std::string filename)
+    {
+        std::vector<uint32_t> labels(this->numInstances);
+        for (t_instanceIdx i = 0; i < this->numInstances; ++i)
+            labels[i] = this->instances[i].clusterMembership;
+
+        try
+        {
+            tid::npy::writeNpy(filename, labels, {(size_t)this->numInstances});
+        }
+        catch (const std::exception& e)
+        {
+            rtlogger.logInfo(e.what());
+            return;
+        }
+
+        char message[tid::RealTimeLogger::LogEntry::MESSAGE_LENGTH+1];
+        snprintf(message,sizeof(message),"Wrote %u clusters to %s.",this->numClusters,filename.c_str());
+        rtlogger.logInfo(message);
+    }
+
+    /**
+     * Reads one integer cluster label per database instance from an NPY
+     * vector. Labels must be 0 to numClusters-1, with no empty cluster
+     * eg. readClustersNpy("./data/cluster.npy")
+    */
+    void readClustersNpy(std::string filename)
+    {
+        try
+        {
+            if (!this->setClusterLabels(tid::npy::loadNpy(filename).toVector<int64_t>(), filename))
+                return;
+        }
+        catch (const std::exception& e)
+        {
+            rtlogger.logInfo(e.what());
+            return;
+        }
+
+        char message[tid::RealTimeLogger::LogEntry::MESSAGE_LENGTH+1];
+        snprintf(message,sizeof(message),"Read %u clusters from %s.",this->numClusters,filename.c_str());
+        rtlogger.logInfo(message);
+    }
+
     /**
      * Return a string containing the main parameters of the module.
      * Refer to the PD helper files of the original timbreID library to know more:
@@ -2386,6 +2606,138 @@ private:
         return(dist);
     }
 
+    /**
+     * Copies the non-normalized instances to a row-major matrix as long as the
+     * longest instance (shorter ones are padded with zeros)
+     * @return number of columns
+    */
+    t_attributeIdx getInstanceMatrix(std::vector<float>& matrix, std::vector<uint32_t>& lengths) const
+    {
+        t_attributeIdx numCols = 0;
+        for (t_instanceIdx i = 0; i < this->numInstances; ++i)
+            numCols = std::max(numCols, this->instances[i].length);
+
+        matrix.assign((size_t)this->numInstances * numCols, 0.0f);
+        lengths.resize(this->numInstances);
+        for (t_instanceIdx i = 0; i < this->numInstances; ++i)
+        {
+            lengths[i] = this->instances[i].length;
+            std::copy(this->instances[i].data.begin(), this->instances[i].data.begin() + this->instances[i].length,
+                      matrix.begin() + (size_t)i * numCols);
+        }
+        return numCols;
+    }
+
+    /**
+     * Replaces the database with the rows of matrix, unclustered, as readData does.
+     * @param lengths length of each instance, or nullptr for the whole rows
+    */
+    void setInstanceMatrix(const tid::npy::Array& matrix, const int64_t* lengths)
+    {
+        const size_t numRows = matrix.getNumRows(), numCols = matrix.getNumCols();
+        if (numRows > UINT_MAX || numCols > UINT_MAX || numCols == 0)
+            throw std::invalid_argument("tid::npy: unsupported database size");
+
+        // feature data is used in place when it is float32, converted otherwise
+        std::vector<float> converted;
+        const float* data;
+        if (matrix.hasType<float>())
+            data = matrix.data<float>();
+        else
+        {
+            converted = matrix.toVector<float>();
+            data = converted.data();
+        }
+
+        // erase old instances & clusters and resize to 0. this also does a sub-call to this->attributeDataResize()
+        this->clearAll();
+
+        this->numInstances = (t_instanceIdx)numRows;
+        this->instances.resize(this->numInstances);
+        this->clusters.resize(this->numInstances);
+
+        t_attributeIdx maxLength = 0;
+        t_attributeIdx minLength = INT_MAX;
+
+        for (t_instanceIdx i = 0; i < this->numInstances; ++i)
+        {
+            this->instances[i].length = lengths ? (t_attributeIdx)lengths[i] : (t_attributeIdx)numCols;
+            maxLength = std::max(maxLength, this->instances[i].length);
+            minLength = std::min(minLength, this->instances[i].length);
+
+            const float* row = data + (size_t)i * numCols;
+            this->instances[i].data.assign(row, row + this->instances[i].length);
+
+            // after loading a database, instances are unclustered
+            this->clusters[i].numMembers = 2;
+            this->clusters[i].members.resize(this->clusters[i].numMembers);
+            this->clusters[i].members[0] = i; // first member of the cluster is the instance index
+            this->clusters[i].members[1] = UINT_MAX; // terminate with UINT_MAX
+            this->instances[i].clusterMembership = i;
+        }
+
+        this->minFeatureLength = minLength;
+        this->maxFeatureLength = maxLength;
+        this->neighborhood = this->numInstances;
+        this->numClusters = this->numInstances;
+
+        // update this->attributeData based on new this->maxFeatureLength. turn postFlag argument TRUE
+        this->attributeDataResize(this->maxFeatureLength, 1);
+    }
+
+    /**
+     * Clusters the database according to one label per instance, rebuilding
+     * the UINT_MAX terminated member lists.
+     * @return false (and logs) if the labels do not match the database
+    */
+    bool setClusterLabels(const std::vector<int64_t>& labels, const std::string& filename)
+    {
+        if (labels.size() != this->numInstances)
+        {
+            rtlogger.logInfo(filename.c_str()," does not contain one label per database instance. read failed.");
+            return false;
+        }
+
+        int64_t maxLabel = -1;
+        for (int64_t label : labels)
+        {
+            if (label < 0 || label >= (int64_t)this->numInstances)
+            {
+                rtlogger.logInfo(filename.c_str()," contains labels out of the range of database instances. read failed.");
+                return false;
+            }
+            maxLabel = std::max(maxLabel, label);
+        }
+
+        std::vector<std::vector<t_instanceIdx>> members((size_t)(maxLabel + 1));
+        for (t_instanceIdx i = 0; i < this->numInstances; ++i)
+            members[(size_t)labels[i]].push_back(i);
+
+        for (const std::vector<t_instanceIdx>& m : members)
+            if (m.empty())
+            {
+                rtlogger.logInfo(filename.c_str()," contains empty clusters. read failed.");
+                return false;
+            }
+
+        this->numClusters = (t_instanceIdx)members.size();
+
+        for (t_instanceIdx i = 0; i < this->numInstances; ++i)
+        {
+            if (i < this->numClusters)
+            {
+                this->clusters[i].members = members[i];
+                this->clusters[i].members.push_back(UINT_MAX); // terminate with UINT_MAX
+            }
+            else // fill out any remaining with the default setup
+                this->clusters[i].members = {i, UINT_MAX};
+
+            this->clusters[i].numMembers = (t_instanceIdx)this->clusters[i].members.size();
+            this->instances[i].clusterMembership = (t_instanceIdx)labels[i];
+        }
+        return true;
+    }
+
     void attributeDataResize(t_attributeIdx newSize, bool postFlag)
     {
         this->attributeData.resize(newSize);
@@ -23,22 +23,29 @@ You should have received a copy of the GNU General Public License along with thi
 */
 #pragma once
 
+#include "tidJuceCompat.hpp"
 #include "tIDLib.hpp"
-#include "fftw3.h"
+#include "tidProfiler.hpp"
+#include "tidFft.hpp"
+#include "tidWindowTable.hpp"
+#include "tidFixedSize.hpp"
+#include "tidFilterbank.hpp"
 #include <stdexcept>
 
 namespace tid   /* TimbreID namespace*/
 {
 
-template <typename SampleType>
+template <typename SampleType, unsigned long int WINDOW_SIZE = dynamicSize, unsigned int BLOCK_SIZE = dynamicSize>
 class Mfcc
 {
 public:
+    /** Storage and kernels for the window and block sizes, fixed or dynamicSize (see tidFixedSize.hpp) */
+    using Sizes = AnalysisSizes<WINDOW_SIZE, BLOCK_SIZE>;
 
     /** Creates a Mfcc module with default parameters. */
     Mfcc()
     {
-        this->analysisWindowSize = tIDLib::WINDOWSIZEDEFAULT;
+        this->analysisWindowSize = Sizes::defaultWindowSize;
         this->melSpacing = tIDLib::MELSPACINGDEFAULT;
         initModule();
     }
@@ -52,6 +59,7 @@ public:
     {
         if (analysisWindowSize < tIDLib::MINWINDOWSIZE)
             throw std::invalid_argument("Window size must be "+std::to_string(tIDLib::MINWINDOWSIZE)+" or greater.");
+        Sizes::checkWindowSize(analysisWindowSize);
 
         this->analysisWindowSize = analysisWindowSize;
         this->melSpacing = tIDLib::MELSPACINGDEFAULT;
@@ -69,6 +77,7 @@ public:
     {
         if (analysisWindowSize < tIDLib::MINWINDOWSIZE)
             throw std::invalid_argument("Window size must be "+std::to_string(tIDLib::MINWINDOWSIZE)+" or greater.");
+        Sizes::checkWindowSize(analysisWindowSize);
         if (melSpacing < tIDLib::MINMELSPACING || melSpacing > tIDLib::MAXMELSPACING)
             throw std::invalid_argument("Mel spacing must be between "+std::to_string(tIDLib::MINMELSPACING)+" and "+std::to_string(tIDLib::MAXMELSPACING)+" Mels");
 
@@ -93,11 +102,18 @@ public:
      * Prepares the module to play by clearing buffers and setting audio buffers
      * standard parameters
      * @param sampleRate The sample rate of the buffer
-     * @param blockSize The size of the individual audio blocks
+     * @param blockSize The size of the individual audio blocks (the fixed one, with a fixed block size)
+     * A new sample rate acquires the filterbank for it, which can throw.
     */
-    void prepare (unsigned long int sampleRate, unsigned int blockSize) noexcept
+    void prepare (unsigned long int sampleRate, unsigned int blockSize)
     {
-        this->sampleRate = sampleRate;
+        Sizes::checkBlockSize(blockSize);
+        if ((float)sampleRate != this->sampleRate)
+        {
+            // the filterbank depends on the sample rate
+            this->sampleRate = sampleRate;
+            createFilterbank(this->melSpacing);
+        }
         if (blockSize != this->blockSize)
         {
             this->blockSize = blockSize;
@@ -124,25 +140,11 @@ public:
         if(melSpacing < tIDLib::MINMELSPACING || melSpacing > tIDLib::MAXMELSPACING)
             throw std::invalid_argument("Mel spacing must be between "+std::to_string(tIDLib::MINMELSPACING)+" and "+std::to_string(tIDLib::MAXMELSPACING)+" mels");
 
-        // temporary copies created to ensure strong exc safety when tIDLib::createFilterbank throws
-        float temp_melSpacing = melSpacing;
-        t_filterIdx temp_numFilters = 0;
-        t_filterIdx temp_sizeFilterFreqs;
-        std::vector<float> temp_filterFreqs;
-
-        temp_sizeFilterFreqs = tIDLib::getMelBoundFreqs(temp_filterFreqs, temp_melSpacing, this->sampleRate);
-        jassert(temp_sizeFilterFreqs == temp_filterFreqs.size());
-
-        // sizeFilterFreqs-2 is the correct number of filters, since we don't count the start point of the first filter, or the finish point of the last filter
-        temp_numFilters = temp_sizeFilterFreqs-2;
-        // critical call, it can throw std::logic_error
-        tIDLib::createFilterbank(temp_filterFreqs, this->filterbank, temp_numFilters, this->analysisWindowSize, this->sampleRate);
-        // copy back temporary objects if tIDLib::createFilterbank did not throw
-        this->melSpacing = temp_melSpacing;
-        this->numFilters = temp_numFilters;
-        this->sizeFilterFreqs = temp_sizeFilterFreqs;
-        std::swap(this->filterFreqs,temp_filterFreqs);
-        jassert(this->sizeFilterFreqs == this->filterFreqs.size());
+        // critical call, it can throw std::logic_error (the handle keeps the previous filterbank)
+        this->filterbank.acquire(FilterbankScale::mel, melSpacing, this->analysisWindowSize, this->sampleRate);
+        this->melSpacing = melSpacing;
+        this->numFilters = this->filterbank.getNumFilters();
+        this->bandEnergies.resize(this->numFilters);
 
         this->coefficientsVector.resize(this->numFilters);
         this->dctPlan.precomputeBasis(this->numFilters);
@@ -170,14 +172,24 @@ public:
         return storeAudioBlock(buffer.getReadPointer(channel), buffer.getNumSamples());
     }
 
+    /**
+     * Stores an audio block into the buffer of the module
+     * Raw pointer version of store(), for use without JUCE buffers.
+     * @param input samples of the audio block
+     * @param n number of samples, it has to match the block size given to prepare()
+    */
+    void store (const SampleType* input, size_t n)
+    {
+        storeAudioBlock(input, n);
+    }
+
     /**
      * Compute the mel frequency cepstral coefficients
      * @return cepstral coefficients
     */
     std::vector<float>& compute()
     {
-        std::vector<float> *windowFuncPtr;
-        unsigned long int windowHalf = this->analysisWindowSize * 0.5;
+        const unsigned long int windowHalf = Sizes::getWindowHalf(this->analysisWindowSize);
 
        #if ASYNC_FEATURE_EXTRACTION
         uint32 currentTime = tid::Time::getTimeSince(this->lastStoreTime);
@@ -186,67 +198,68 @@ public:
         if(offsetSample >= this->blockSize)
             offsetSample = this->blockSize-1;
        #else
-        if ((tIDLib::FEATURE_EXTRACTION_OFFSET < 0.0f) || (tIDLib::FEATURE_EXTRACTION_OFFSET > 1.0f)) throw new std::logic_error("FEATURE_EXTRACTION_OFFSET must be between 0.0 and 1.0 (found "+std::to_string(tIDLib::FEATURE_EXTRACTION_OFFSET)+" instead)");
         uint32 offsetSample = (uint32)(tIDLib::FEATURE_EXTRACTION_OFFSET * (double)this->blockSize);
        #endif
 
+        TID_PROFILE_BEGIN(mfcc, windowCopy);
         // construct analysis window using offsetSample as the end of the window
-        for(unsigned long int i = 0, j = offsetSample; i < this->analysisWindowSize; ++i, ++j)
-            this->fftwInputVector[i] = this->signalBuffer[j];
+        Sizes::windowCopy(&this->signalBuffer[offsetSample], this->windowTable.data(), &this->fftwInputVector[0], this->analysisWindowSize);
+        TID_PROFILE_END(mfcc, windowCopy);
 
-        switch(this->windowFunction)
-        {
-            case tIDLib::WindowFunctionType::rectangular:
-                break;
-            case tIDLib::WindowFunctionType::blackman:
-                windowFuncPtr = &this->blackman;
-                break;
-            case tIDLib::WindowFunctionType::cosine:
-                windowFuncPtr = &this->cosine;
-                break;
-            case tIDLib::WindowFunctionType::hamming:
-                windowFuncPtr = &this->hamming;
-                break;
-            case tIDLib::WindowFunctionType::hann:
-                windowFuncPtr = &this->hann;
-                break;
-            default:
-                windowFuncPtr = &this->blackman;
-                break;
-        };
-
-        // if windowFunction == 0, skip the windowing (rectangular)
-        if (this->windowFunction != tIDLib::WindowFunctionType::rectangular)
-            for (unsigned long int i=0; i<this->analysisWindowSize; ++i)
-                this->fftwInputVector[i] *= windowFuncPtr->at(i);
-
-        fftwf_execute(this->fftwPlan);
+        TID_PROFILE_BEGIN(mfcc, fft);
+        this->fftwPlan.execute();
+        TID_PROFILE_END(mfcc, fft);
 
         // put the result of power calc back in fftwIn
-        tIDLib::power(windowHalf+1, this->fftwOut, &(this->fftwInputVector[0]));
+        Sizes::power(windowHalf + 1, this->fftwOut, &(this->fftwInputVector[0]));
 
         if (this->spectrumTypeUsed != tIDLib::SpectrumType::powerSpectrum)
-            tIDLib::mag(windowHalf+1, &(this->fftwInputVector[0]));
+            Sizes::mag(windowHalf + 1, &(this->fftwInputVector[0]));
 
+        TID_PROFILE_BEGIN(mfcc, filterbank);
         switch(this->filterState)
         {
             case tIDLib::FilterState::filterDisabled: // like the old x_specBandAvg == true
-                tIDLib::specFilterBands(windowHalf+1, this->numFilters, &(this->fftwInputVector[0]), this->filterbank, this->normalize);
+                tIDLib::specFilterBands(windowHalf+1, this->numFilters, &(this->fftwInputVector[0]), &this->bandEnergies[0], this->filterbank.getFilters(), this->normalize);
                 break;
             case tIDLib::FilterState::filterEnabled:
-                tIDLib::filterbankMultiply(&(this->fftwInputVector[0]), this->normalize, this->filterOperation, this->filterbank, this->numFilters);
+                tIDLib::filterbankMultiply(&(this->fftwInputVector[0]), &this->bandEnergies[0], this->normalize, this->filterOperation, this->filterbank.getFilters(), this->numFilters);
                 break;
             default:
                 throw std::logic_error("Filter option not available");
                 break;
         }
+        TID_PROFILE_END(mfcc, filterbank);
 
         // FFTW DCT-II
-        this->dctPlan.compute(fftwInputVector,coefficientsVector,this->numFilters);
+        TID_PROFILE_BEGIN(mfcc, dct);
+        this->dctPlan.compute(this->bandEnergies,coefficientsVector,this->numFilters);
+        TID_PROFILE_END(mfcc, dct);
 
         return this->coefficientsVector;
     }
 
+    /**
+     * Compute the mel frequency cepstral coefficients of many frames at once (offline)
+     * Frame f is input[f*hop, f*hop+analysisWindowSize), windowed like in compute().
+     * The FFT is computed frame by frame, then the filterbank and the DCT run as
+     * batched matrix products over all the frames (tIDLib::cepstralCoefficientsBatch),
+     * with the same results of compute() on the same windows.
+     * It allocates memory, do not call it from a real-time thread.
+     * @param input signal, at least (numFrames-1)*hop+analysisWindowSize samples
+     * @param numFrames number of frames
+     * @param hop distance between the start of two frames, in samples
+     * @return coefficients of the frames, numFrames rows of getNumFilters() values (row-major)
+    */
+    std::vector<float> computeFrames(const SampleType* input, size_t numFrames, size_t hop)
+    {
+        return tIDLib::cepstralCoefficientsBatch(input, numFrames, hop, this->analysisWindowSize, this->windowTable.data(),
+                                                 &this->fftwInputVector[0], this->fftwPlan, this->fftwOut,
+                                                 this->spectrumTypeUsed, this->filterState, this->normalize,
+                                                 this->filterOperation, this->filterbank.getFilters(), this->numFilters,
+                                                 this->dctPlan);
+    }
+
     /*--------------------------- Setters/getters ----------------------------*/
 
     /**
@@ -254,9 +267,10 @@ public:
      * Sets the window function (options in tIDLib header file)
      * @param func window fuction used
     */
-    void setWindowFunction(tIDLib::WindowFunctionType func) noexcept
+    void setWindowFunction(tIDLib::WindowFunctionType func)
     {
         this->windowFunction = func;
+        this->windowTable.acquire(func, this->analysisWindowSize);
     }
 
     /**
@@ -306,27 +320,26 @@ public:
     */
     void setWindowSize(uint32 windowSize)
     {
+        Sizes::checkWindowSize(windowSize);
         if (windowSize < tIDLib::MINWINDOWSIZE)
             throw std::invalid_argument("Window size must be "+std::to_string(tIDLib::MINWINDOWSIZE)+" or greater");
 
-        tIDLib::createFilterbank(this->filterFreqs, this->filterbank, this->numFilters, windowSize, this->sampleRate);
+        this->filterbank.acquire(FilterbankScale::mel, this->melSpacing, windowSize, this->sampleRate);
 
         this->analysisWindowSize = windowSize;
 
         this->signalBuffer.resize(this->analysisWindowSize + this->blockSize);
         this->fftwInputVector.resize(this->analysisWindowSize);
 
-        // free the FFTW output buffer, and re-malloc according to new window
-        fftwf_free(this->fftwOut);
 
-        // destroy old DFT plan, which depended on this->analysisWindowSize
-        fftwf_destroy_plan(this->fftwPlan);
+        // release old DFT plan, which depended on this->analysisWindowSize
+        this->fftwPlan.reset();
 
-        // allocate new fftwf_complex memory for the plan based on new window size
-        this->fftwOut = (fftwf_complex *) fftwf_alloc_complex(this->analysisWindowSize * 0.5 + 1);
+        // allocate new complex spectrum memory for the plan based on new window size
+        this->fftwOut = fft::resizeComplex(this->fftwOutBuffer, this->analysisWindowSize * 0.5 + 1);
 
-        // create a new DFT plan based on new window size
-        this->fftwPlan = fftwf_plan_dft_r2c_1d(this->analysisWindowSize, &(this->fftwInputVector[0]), this->fftwOut, FFTWPLANNERFLAG);
+        // get a DFT plan for the new window size from the shared cache
+        this->fftwPlan.createRealToComplex(this->analysisWindowSize, &(this->fftwInputVector[0]), this->fftwOut);
 
         // we're supposed to initialize the input array after we create the plan
         for(unsigned long int i = 0; i < this->analysisWindowSize; ++i)
@@ -336,16 +349,8 @@ public:
         for(unsigned long int i = 0; i < this->analysisWindowSize + this->blockSize; ++i)
             this->signalBuffer[i] = 0.0;
 
-        this->blackman.resize(this->analysisWindowSize);
-        this->cosine.resize(this->analysisWindowSize);
-        this->hamming.resize(this->analysisWindowSize);
-        this->hann.resize(this->analysisWindowSize);
-
-        // initialize signal windowing functions
-        tIDLib::initBlackmanWindow(this->blackman);
-        tIDLib::initCosineWindow(this->cosine);
-        tIDLib::initHammingWindow(this->hamming);
-        tIDLib::initHannWindow(this->hann);
+        // window table shared with the other instances of the same size
+        this->windowTable.acquire(this->windowFunction, this->analysisWindowSize);
     }
 
     /**
@@ -357,6 +362,24 @@ public:
         this->normalize = norm;
     }
 
+    /**
+     * Get the analysis window size (in samples)
+     * @return analysis window size
+    */
+    unsigned long int getWindowSize() const noexcept
+    {
+        return this->analysisWindowSize;
+    }
+
+    /**
+     * Get the number of filters (equal to the number of coefficients)
+     * @return number of filters
+    */
+    t_filterIdx getNumFilters() const noexcept
+    {
+        return this->numFilters;
+    }
+
     /**
      * Return a string containing the main parameters of the module.
      * Refer to the PD helper files of the original timbreID library to know more:
@@ -420,6 +443,25 @@ public:
         return res;
     }
 
+    /**
+     * Place the buffers used at every block in an arena, in the order in
+     * which they are accessed (see tid::Arena)
+    */
+    void layoutBuffers(Arena& arena)
+    {
+        arena.place(this->signalBuffer);
+        arena.place(this->fftwInputVector);
+        arena.place(this->fftwOutBuffer);
+        arena.place(this->bandEnergies);
+        this->dctPlan.layoutBuffers(arena);
+        if (arena.isPlacing())
+        {
+            // the plan runs on the new arrays
+            this->fftwOut = reinterpret_cast<fft::Complex*>(this->fftwOutBuffer.data());
+            this->fftwPlan.createRealToComplex(this->analysisWindowSize, this->fftwInputVector.data(), this->fftwOut);
+        }
+    }
+
 private:
 
     /**
@@ -428,14 +470,13 @@ private:
     void initModule()
     {
         this->sampleRate = tIDLib::SAMPLERATEDEFAULT;
-        this->blockSize = tIDLib::BLOCKSIZEDEFAULT;
+        this->blockSize = Sizes::defaultBlockSize;
         this->windowFunction = tIDLib::WindowFunctionType::blackman;
         this->normalize = true;
         this->spectrumTypeUsed = tIDLib::SpectrumType::magnitudeSpectrum;
        #if ASYNC_FEATURE_EXTRACTION
         this->lastStoreTime = juce::Time::currentTimeMillis();
        #endif
-        this->sizeFilterFreqs = 0;
         this->numFilters = 0; // this is just an init size that will be updated in createFilterbank anyway.
         this->filterState = tIDLib::FilterState::filterEnabled;
         this->filterOperation = tIDLib::FilterOperation::sumFilterEnergy;
@@ -447,34 +488,23 @@ private:
         for(unsigned long int i = 0; i < this->analysisWindowSize + this->blockSize; ++i)
             this->signalBuffer[i] = 0.0;
 
-        this->blackman.resize(this->analysisWindowSize);
-        this->cosine.resize(this->analysisWindowSize);
-        this->hamming.resize(this->analysisWindowSize);
-        this->hann.resize(this->analysisWindowSize);
-
-        // initialize signal windowing functions
-        tIDLib::initBlackmanWindow(this->blackman);
-        tIDLib::initCosineWindow(this->cosine);
-        tIDLib::initHammingWindow(this->hamming);
-        tIDLib::initHannWindow(this->hann);
+        // window table shared with the other instances of the same size
+        this->windowTable.acquire(this->windowFunction, this->analysisWindowSize);
 
         // set up the FFTW output buffer
-        this->fftwOut = (fftwf_complex *)fftwf_alloc_complex(this->analysisWindowSize * 0.5 + 1);
+        this->fftwOut = fft::resizeComplex(this->fftwOutBuffer, this->analysisWindowSize * 0.5 + 1);
 
-        // DFT plan
-        this->fftwPlan = fftwf_plan_dft_r2c_1d(this->analysisWindowSize, &fftwInputVector[0], this->fftwOut, FFTWPLANNERFLAG);
+        // DFT plan (shared with the other instances of the same size)
+        this->fftwPlan.createRealToComplex(this->analysisWindowSize, &fftwInputVector[0], this->fftwOut);
 
         // we're supposed to initialize the input array after we create the plan
         for(unsigned long int i = 0; i < this->analysisWindowSize; ++i)
             this->fftwInputVector[i] = 0.0;
 
-        this->sizeFilterFreqs = tIDLib::getMelBoundFreqs(this->filterFreqs, this->melSpacing, this->sampleRate);
-        jassert(this->sizeFilterFreqs == this->filterFreqs.size());
-
-        // sizeFilterFreqs-2 is the correct number of filters, since we don't count the start point of the first filter, or the finish point of the last filter
-        this->numFilters = this->sizeFilterFreqs-2;
-
-        tIDLib::createFilterbank(this->filterFreqs, this->filterbank, this->numFilters, this->analysisWindowSize, this->sampleRate);
+        // filterbank shared with the other instances with the same spacing, window size and sample rate
+        this->filterbank.acquire(FilterbankScale::mel, this->melSpacing, this->analysisWindowSize, this->sampleRate);
+        this->numFilters = this->filterbank.getNumFilters();
+        this->bandEnergies.resize(this->numFilters);
 
         this->coefficientsVector.resize(this->numFilters);
         this->dctPlan.precomputeBasis(this->numFilters);
@@ -487,13 +517,9 @@ private:
     */
     void storeAudioBlock(const SampleType* input, size_t n) noexcept
     {
-        // shift signal buffer contents back.
-        for(unsigned long int i = 0; i < this->analysisWindowSize; ++i)
-            this->signalBuffer[i] = this->signalBuffer[i + n];
-
-        // write new block to end of signal buffer.
-        for(unsigned long int i = 0; i < n; ++i)
-            this->signalBuffer[this->analysisWindowSize + i] = input[i];
+        TID_PROFILE_SCOPE(mfcc, storeAudioBlock);
+        // shift signal buffer contents back and write the new block at its end
+        Sizes::storeBlock(this->signalBuffer.data(), this->analysisWindowSize, input, n);
 
        #if ASYNC_FEATURE_EXTRACTION
         this->lastStoreTime = juce::Time::currentTimeMillis();
@@ -506,8 +532,7 @@ private:
     void freeMem()
     {
         // free FFTW stuff
-        fftwf_free(this->fftwOut);
-        fftwf_destroy_plan(this->fftwPlan);
+        this->fftwPlan.reset();
     }
 
     //==========================================================================
@@ -524,24 +549,21 @@ private:
     uint32 lastStoreTime; // replaces x_lastDspTime
    #endif
 
-    std::vector<SampleType> signalBuffer;
+    typename Sizes::template SignalBuffer<SampleType> signalBuffer;
 
-    std::vector<float> fftwInputVector;
-    fftwf_complex *fftwOut;
-    fftwf_plan fftwPlan;
-    tIDLib::DiscreteCosineTransform<SampleType> dctPlan;
+    typename Sizes::WindowBuffer fftwInputVector;
+    fft::Complex *fftwOut;              // in fftwOutBuffer
+    typename Sizes::SpectrumBuffer fftwOutBuffer;
+    FftPlan fftwPlan;
+    tIDLib::DiscreteCosineTransform<float> dctPlan; // Operates on the float spectrum, whatever the SampleType
 
-    std::vector<float> blackman;
-    std::vector<float> cosine;
-    std::vector<float> hamming;
-    std::vector<float> hann;
+    typename Sizes::Window windowTable;   // shared, read-only table of windowFunction (computed at compile time with a fixed window size, none for rectangular)
 
-    t_filterIdx sizeFilterFreqs;
     t_filterIdx numFilters;
 
     float melSpacing;
-    std::vector<float> filterFreqs;
-    std::vector<tIDLib::t_filter> filterbank;
+    SharedFilterbank filterbank;  // shared, read-only
+    ArenaVector<float> bandEnergies;  // output of the filterbank
 
     tIDLib::FilterState filterState;         // replaces x_specBandAvg
     tIDLib::FilterOperation filterOperation; // replaces x_filterAvg
@@ -22,7 +22,13 @@ You should have received a copy of the GNU General Public License along with thi
 */
 #pragma once
 
+#include "tidJuceCompat.hpp"
 #include "tIDLib.hpp"
+#include "tidProfiler.hpp"
+#include "tidSlidingWindow.hpp"
+#include "tidMultiChannel.hpp"
+#include <algorithm>
+#include <cmath>
 #include <vector>
 
 #include <cfloat>   // FLT_MAX
@@ -69,8 +75,12 @@ public:
     /** Resets the processing pipeline. */
     void reset() noexcept
     {
-        std::fill(signalBuffer.begin(), signalBuffer.end(), SampleType{0});
-        std::fill(analysisBuffer.begin(), analysisBuffer.end(), 0.0f);
+        // the signal buffer starts filled with zeros, as in the original module
+        this->peakTracker.clear();
+        std::fill(this->history.begin(), this->history.end(), 0.0f);
+        this->numSamples = (int64)(this->analysisWindowSize + this->blockSize);
+        for (int64 t = std::max<int64>(0, this->numSamples - (int64)this->peakLag - (int64)this->analysisWindowSize); t + (int64)this->peakLag < this->numSamples; ++t)
+            this->peakTracker.push(t, 0.0f);
        #if ASYNC_FEATURE_EXTRACTION
         this->lastStoreTime = juce::Time::currentTimeMillis();
        #endif
@@ -88,6 +98,17 @@ public:
             throw std::invalid_argument("Channel index has to be between 0 and "+std::to_string(numChannels-1)+" (found "+std::to_string(channel)+" instead)");
         storeAudioBlock(buffer.getReadPointer(channel), buffer.getNumSamples());
     }
+
+    /**
+     * Stores an audio block into the buffer of the module
+     * Raw pointer version of store(), for use without JUCE buffers.
+     * @param input samples of the audio block
+     * @param n number of samples, it has to match the block size given to prepare()
+    */
+    void store (const SampleType* input, size_t n)
+    {
+        storeAudioBlock(input, n);
+    }
     //==============================================================================
 
     void compute(float &_peak, unsigned long int &_peakIdx)
@@ -103,28 +124,31 @@ public:
         if(offsetSample >= this->blockSize)
             offsetSample = this->blockSize - 1;
        #else
-        if ((tIDLib::FEATURE_EXTRACTION_OFFSET < 0.0f) || (tIDLib::FEATURE_EXTRACTION_OFFSET > 1.0f)) throw new std::logic_error("FEATURE_EXTRACTION_OFFSET must be between 0.0 and 1.0 (found "+std::to_string(tIDLib::FEATURE_EXTRACTION_OFFSET)+" instead)");
         uint32 offsetSample = (uint32)(tIDLib::FEATURE_EXTRACTION_OFFSET * (double)this->blockSize);
        #endif
 
-    	// construct analysis window using offsetSample as the end of the window
-        for(uint64 i = 0, j = offsetSample; i < this->analysisWindowSize; ++i, ++j)
-            this->analysisBuffer[i] = (float)this->signalBuffer[j];
-
-        jassert(this->analysisBuffer.size() == this->analysisWindowSize);
+        // the analysis window of the original module is signalBuffer[offsetSample ... offsetSample+analysisWindowSize-1]
+        const int64 lastSample = this->numSamples - 1;
+        const int64 windowEnd = lastSample - (int64)this->blockSize + (int64)offsetSample;
+        const int64 windowStart = windowEnd - (int64)this->analysisWindowSize + 1;
 
     	_peak = -FLT_MAX;
     	_peakIdx = ULONG_MAX;
 
-        for(int i = 0; i < analysisWindowSize; ++i)
-    	{
-    		float thisSample = fabs(this->analysisBuffer[i]);
-    		if(thisSample > _peak)
-    		{
-    			_peak = thisSample;
-    			_peakIdx = i;
-    		}
-    	}
+        // The sliding maximum is up to date peakLag samples before the last one, the rest
+        // of the window (only when offsetSample varies) is scanned
+        int64 peakTime = -1;
+        if (this->analysisWindowSize > 0)
+            this->peakTracker.getMax(windowStart, peakTime, _peak);
+        for (int64 t = std::max(lastSample - (int64)this->peakLag + 1, windowStart); t <= windowEnd; ++t)
+            if (historyAt(t) > _peak)
+            {
+                _peak = historyAt(t);
+                peakTime = t;
+            }
+
+        if (peakTime >= 0)
+            _peakIdx = (unsigned long int)(peakTime - windowStart);
     }
 
     /**
@@ -143,6 +167,7 @@ public:
     {
         this->analysisWindowSize = windowSize;
         resizeBuffers();
+        reset();
     }
 
     uint32 getWindowSize() const
@@ -172,25 +197,48 @@ public:
         return res;
     }
 
+    /**
+     * Place the buffers used at every block in an arena, in the order in
+     * which they are accessed (see tid::Arena)
+    */
+    void layoutBuffers(Arena& arena)
+    {
+        arena.place(this->history);
+        this->peakTracker.layoutBuffers(arena);
+    }
+
 private:
 
     void resizeBuffers()
     {
-        signalBuffer.resize(analysisWindowSize + blockSize,SampleType{0});
-        analysisBuffer.resize(analysisWindowSize,0.0f);
+       #if ASYNC_FEATURE_EXTRACTION
+        this->peakLag = this->blockSize;
+       #else
+        this->peakLag = this->blockSize - (uint32)(tIDLib::FEATURE_EXTRACTION_OFFSET * (double)this->blockSize);
+       #endif
+        this->history.assign(2 * this->blockSize + 2, 0.0f);
+        this->peakTracker.setWindowLength(this->analysisWindowSize);
+    }
+
+    float historyAt(int64 time) const noexcept
+    {
+        return this->history[(size_t)(time % (int64)this->history.size())];
     }
 
     void storeAudioBlock (const SampleType* input, size_t n) noexcept
     {
+        TID_PROFILE_SCOPE(peakSample, storeAudioBlock);
         jassert(n ==  this->blockSize);
 
-        // shift signal buffer contents N positions back
-    	for(uint64 i=0; i<analysisWindowSize; ++i)
-    		signalBuffer[i] = signalBuffer[i+n];
+        for (size_t i = 0; i < n; ++i)
+        {
+            const int64 time = this->numSamples++;
+            this->history[(size_t)(time % (int64)this->history.size())] = fabsf((float)input[i]);
 
-    	// write new block to end of signal buffer.
-    	for(size_t i=0; i<n; ++i)
-    		signalBuffer[analysisWindowSize+i] = input[i];
+            // the sliding maximum follows peakLag samples behind, at the end of the analysis window
+            if (time >= (int64)this->peakLag)
+                this->peakTracker.push(time - (int64)this->peakLag, historyAt(time - (int64)this->peakLag));
+        }
 
        #if ASYNC_FEATURE_EXTRACTION
         this->lastStoreTime = juce::Time::currentTimeMillis();
@@ -202,8 +250,14 @@ private:
     uint32 blockSize = tIDLib::BLOCKSIZEDEFAULT;    // x_n field in Original PD library library
     uint64 analysisWindowSize = tIDLib::WINDOWSIZEDEFAULT;   // x_window in Original PD library
 
-    std::vector<SampleType> signalBuffer;
-    std::vector<float> analysisBuffer;
+    /** Number of samples stored since reset(), including the zeros of the initial signal buffer */
+    int64 numSamples = 0;
+    /** Magnitude of the last samples, indexed by sample time */
+    ArenaVector<float> history;
+    /** Sliding maximum of the analysis window */
+    SlidingMax peakTracker;
+    /** Samples between the last one stored and the last one in peakTracker */
+    uint32 peakLag = 0;
 
    #if ASYNC_FEATURE_EXTRACTION
     uint32 lastStoreTime = juce::Time::currentTimeMillis(); // x_lastDspTime in Original PD library
@@ -213,4 +267,226 @@ private:
     JUCE_LEAK_DETECTOR (PeakSample)
 };
 
+/**
+ * Peak sample of up to tIDLib::INTERLEAVEDLANES channels (e.g. hexaphonic pickups)
+ * Same results of a PeakSample per channel. The magnitudes are stored
+ * interleaved and the peak of every stored chunk (one block long) is found
+ * for all the channels at once, one SIMD lane per channel
+ * (tIDLib::peakInterleaved), so compute() merges the chunk peaks and scans
+ * only the partial chunks at the ends of the analysis window.
+*/
+template <typename SampleType>
+class MultiPeakSample
+{
+public:
+    static constexpr unsigned int LANES = tIDLib::INTERLEAVEDLANES;
+
+    /**
+     * MultiPeakSample constructor
+     * @param numChannels number of channels analysed (1 to tIDLib::INTERLEAVEDLANES)
+     * @param windowSize size of the analysis window
+    */
+    MultiPeakSample(unsigned int numChannels, unsigned long int windowSize = tIDLib::WINDOWSIZEDEFAULT)
+    {
+        InterleavedBlock::checkNumChannels(numChannels);
+        this->numChannels = numChannels;
+        this->analysisWindowSize = windowSize;
+        resizeBuffers();
+        reset();
+    }
+
+    /** Initialization of the module (it allocates) */
+    void prepare (double sampleRate, uint32 blockSize)
+    {
+        this->sampleRate = sampleRate;
+        this->blockSize = blockSize;
+        resizeBuffers();
+        reset();
+    }
+
+    /** Resets the processing pipeline. */
+    void reset() noexcept
+    {
+        // the signal buffers start filled with zeros, as in PeakSample
+        std::fill(this->history.begin(), this->history.end(), 0.0f);
+        std::fill(this->chunkPeaks.begin(), this->chunkPeaks.end(), 0.0f);
+        std::fill(this->chunkPeakIdx.begin(), this->chunkPeakIdx.end(), 0u);
+        this->numSamples = this->firstSample;
+    }
+
+    /**
+     * Stores the channels firstChannel ... firstChannel+getNumChannels()-1 of an audio block
+     * @param buffer audio buffer
+     * @param firstChannel index of the first channel analysed
+    */
+    template <typename OtherSampleType>
+    void store (AudioBuffer<OtherSampleType>& buffer, short firstChannel = 0)
+    {
+        static_assert (std::is_same<OtherSampleType, SampleType>::value,
+                       "The sample-type of the PeakSample module must match the sample-type supplied to this store callback");
+        this->block.interleave(buffer, firstChannel);
+        store(this->block);
+    }
+
+    /**
+     * Stores an audio block of every channel
+     * @param channels getNumChannels() pointers to n samples
+     * @param n number of samples, it has to match the block size given to prepare()
+    */
+    void store (const SampleType* const* channels, size_t n)
+    {
+        this->block.interleave(channels, n);
+        store(this->block);
+    }
+
+    /** Stores an audio block already interleaved (at least getNumChannels() channels) */
+    void store (const InterleavedBlock& interleaved)
+    {
+        if (interleaved.getNumChannels() < this->numChannels)
+            throw std::invalid_argument("The interleaved block has "+std::to_string(interleaved.getNumChannels())+" channels, "+std::to_string(this->numChannels)+" are analysed");
+        TID_PROFILE_SCOPE(peakSample, storeAudioBlock);
+        jassert(interleaved.getNumFrames() == this->blockSize);
+
+        const float* frames = interleaved.getFrames();
+        for (size_t n = interleaved.getNumFrames(); n > 0;)
+        {
+            // one chunk at a time, the chunks are contiguous in the history
+            const int64 chunk = chunkOf(this->numSamples);
+            const size_t offset = (size_t)(this->numSamples - this->firstSample - chunk * (int64)this->blockSize);
+            const size_t count = std::min<size_t>(n, this->blockSize - offset);
+            float* magnitudes = framesAt(this->numSamples);
+            for (size_t i = 0; i < count * LANES; ++i)
+                magnitudes[i] = fabsf(frames[i]);
+
+            float* peaks = &this->chunkPeaks[slotOf(chunk) * LANES];
+            unsigned int* peakIdx = &this->chunkPeakIdx[slotOf(chunk) * LANES];
+            if (offset == 0)
+                std::fill(peaks, peaks + LANES, -FLT_MAX);
+            unsigned int newIdx[LANES];
+            std::fill(newIdx, newIdx + LANES, UINT_MAX);
+            tIDLib::peakInterleaved(magnitudes, count, peaks, newIdx);
+            for (unsigned int c = 0; c < LANES; ++c)
+                if (newIdx[c] != UINT_MAX)
+                    peakIdx[c] = (unsigned int)offset + newIdx[c];
+
+            frames += count * LANES;
+            this->numSamples += (int64)count;
+            n -= count;
+        }
+    }
+
+    /**
+     * Compute the peak of all the channels
+     * @param peaks returns getNumChannels() peak magnitudes
+     * @param peakIdx returns getNumChannels() peak positions in the analysis window
+    */
+    void compute(float* peaks, unsigned long int* peakIdx) noexcept
+    {
+        const int64 windowEnd = this->numSamples - 1 - (int64)getFeatureExtractionLag(this->blockSize);
+        const int64 windowStart = windowEnd - (int64)this->analysisWindowSize + 1;
+
+        float best[LANES];
+        int64 bestTime[LANES];
+        std::fill(best, best + LANES, -FLT_MAX);
+        std::fill(bestTime, bestTime + LANES, (int64)-1);
+
+        // chunks in time order, the first maximum wins (strict greater-than, as in PeakSample)
+        for (int64 chunk = chunkOf(windowStart); chunk <= chunkOf(windowEnd); ++chunk)
+        {
+            const int64 chunkStart = this->firstSample + chunk * (int64)this->blockSize;
+            const int64 lo = std::max(windowStart, chunkStart);
+            const int64 hi = std::min(windowEnd, chunkStart + (int64)this->blockSize - 1);
+
+            float candidates[LANES];
+            unsigned int candidateIdx[LANES];
+            int64 candidateStart;
+            if (lo == chunkStart && hi == chunkStart + (int64)this->blockSize - 1)
+            {
+                std::copy_n(&this->chunkPeaks[slotOf(chunk) * LANES], LANES, candidates);
+                std::copy_n(&this->chunkPeakIdx[slotOf(chunk) * LANES], LANES, candidateIdx);
+                candidateStart = chunkStart;
+            }
+            else
+            {
+                std::fill(candidates, candidates + LANES, -FLT_MAX);
+                std::fill(candidateIdx, candidateIdx + LANES, 0u);
+                tIDLib::peakInterleaved(framesAt(lo), (size_t)(hi - lo + 1), candidates, candidateIdx);
+                candidateStart = lo;
+            }
+
+            for (unsigned int c = 0; c < this->numChannels; ++c)
+                if (candidates[c] > best[c])
+                {
+                    best[c] = candidates[c];
+                    bestTime[c] = candidateStart + (int64)candidateIdx[c];
+                }
+        }
+
+        for (unsigned int c = 0; c < this->numChannels; ++c)
+        {
+            peaks[c] = best[c];
+            peakIdx[c] = bestTime[c] >= 0 ? (unsigned long int)(bestTime[c] - windowStart) : ULONG_MAX;
+        }
+    }
+
+    void setWindowSize(uint32 windowSize)
+    {
+        this->analysisWindowSize = windowSize;
+        resizeBuffers();
+        reset();
+    }
+
+    uint32 getWindowSize() const noexcept { return (uint32)this->analysisWindowSize; }
+    unsigned int getNumChannels() const noexcept { return this->numChannels; }
+
+private:
+    void resizeBuffers()
+    {
+        // the analysis window is in the last analysisWindowSize + blockSize samples, split in chunks of one block
+        this->firstSample = (int64)(this->analysisWindowSize + this->blockSize);
+        this->numChunks = (this->analysisWindowSize + this->blockSize + this->blockSize - 1) / this->blockSize + 1;
+        this->history.assign(this->numChunks * this->blockSize * LANES, 0.0f);
+        this->chunkPeaks.assign(this->numChunks * LANES, 0.0f);
+        this->chunkPeakIdx.assign(this->numChunks * LANES, 0u);
+        this->block.prepare(this->numChannels, this->blockSize);
+    }
+
+    /** Chunk of a sample time, chunk 0 starts with the first sample stored after reset() */
+    int64 chunkOf(int64 time) const noexcept
+    {
+        const int64 relative = time - this->firstSample;
+        const int64 size = (int64)this->blockSize;
+        return relative >= 0 ? relative / size : -((-relative + size - 1) / size);
+    }
+
+    size_t slotOf(int64 chunk) const noexcept
+    {
+        const int64 slots = (int64)this->numChunks;
+        return (size_t)(((chunk % slots) + slots) % slots);
+    }
+
+    float* framesAt(int64 time) noexcept
+    {
+        const int64 chunk = chunkOf(time);
+        const int64 offset = time - this->firstSample - chunk * (int64)this->blockSize;
+        return &this->history[(slotOf(chunk) * this->blockSize + (size_t)offset) * LANES];
+    }
+
+    double sampleRate = tIDLib::SAMPLERATEDEFAULT;
+    uint32 blockSize = tIDLib::BLOCKSIZEDEFAULT;
+    uint64 analysisWindowSize = tIDLib::WINDOWSIZEDEFAULT;
+    unsigned int numChannels = 1;
+
+    /** Number of samples stored since reset(), including the zeros of the initial signal buffer */
+    int64 numSamples = 0;
+    int64 firstSample = 0;
+    size_t numChunks = 1;
+    /** Magnitudes of the last chunks, interleaved */
+    std::vector<float> history;
+    /** Peak of each chunk and its position in the chunk, interleaved */
+    std::vector<float> chunkPeaks;
+    std::vector<unsigned int> chunkPeakIdx;
+    InterleavedBlock block;
+};
+
 } // namespace tid
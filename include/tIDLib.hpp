@@ -1,10 +1,11 @@
 #pragma once
 
 #include <vector>
-#include "fftw3.h"
 #include <cmath>
 #include <string>
 #include <stdexcept>
+#include <type_traits>
+#include "tidArena.hpp"
 
 typedef unsigned long int t_binIdx; // 0 to 18,446,744,073,709,551,615
 typedef unsigned short int t_filterIdx;
@@ -56,12 +57,33 @@ typedef unsigned int t_instanceIdx;
 */
 namespace tIDLib
 {
-    static const double FEATURE_EXTRACTION_OFFSET = 1.0;
+    constexpr double FEATURE_EXTRACTION_OFFSET = 1.0;
+    static_assert(FEATURE_EXTRACTION_OFFSET >= 0.0 && FEATURE_EXTRACTION_OFFSET <= 1.0, "FEATURE_EXTRACTION_OFFSET must be between 0.0 and 1.0");
 }
 #endif
 
-// choose either FFTW_MEASURE or FFTW_ESTIMATE here.
+/** TID_FFT_BACKEND
+ * FFT used by the spectral modules (see tidFft.hpp), chosen at compile time:
+ *  - TID_FFT_BACKEND_FFTW:    FFTW3 single precision (default)
+ *  - TID_FFT_BACKEND_BUILTIN: built-in real FFT (tidRealFft.hpp), no external dependency
+ */
+#define TID_FFT_BACKEND_FFTW 1
+#define TID_FFT_BACKEND_BUILTIN 2
+#ifndef TID_FFT_BACKEND
+#define TID_FFT_BACKEND TID_FFT_BACKEND_FFTW
+#endif
+
+#if TID_FFT_BACKEND == TID_FFT_BACKEND_FFTW
+#include "fftw3.h"
+
+// Default planner flags of tid::FftwPlanCache (tidFftw.hpp), choose either FFTW_MEASURE or FFTW_ESTIMATE here.
+// They can be changed at run time with FftwPlanCache::setPlannerFlags(), together with importWisdom()/exportWisdom().
+#ifndef FFTWPLANNERFLAG
 #define FFTWPLANNERFLAG (FFTW_ESTIMATE | FFTW_CONSERVE_MEMORY)
+#endif
+#elif TID_FFT_BACKEND != TID_FFT_BACKEND_BUILTIN
+#error "Unknown TID_FFT_BACKEND"
+#endif
 
 #ifndef M_PI
 #define M_PI 3.1415926535897932384626433832795
@@ -114,14 +136,29 @@ enum WindowFunctionType
 
 typedef struct filter
 {
-	std::vector<float> filter;
+	const float *filter;    // size weights, in the packed weights of the Filterbank
 	t_binIdx size;
 	t_binIdx indices[2];
 	float filterFreqs[2];
-
-    float tmpValue; // Temp value used to avoid memory allocation in real time-operations
 } t_filter;
 
+/**
+ * Triangular filterbank built by createFilterbank
+ * The weights of all the filters are packed in one array (filters[i].filter
+ * points into weights), so it is neither copyable nor movable.
+ * It is read-only once built, and shared by the modules through
+ * tid::FilterbankCache (tidFilterbank.hpp).
+*/
+struct Filterbank
+{
+    Filterbank() = default;
+    Filterbank(const Filterbank&) = delete;
+    Filterbank& operator=(const Filterbank&) = delete;
+
+    std::vector<t_filter> filters;
+    std::vector<float> weights;
+};
+
 /**
  *  State of the triangular filters (enabled or disabled)
 */
@@ -221,17 +258,70 @@ void sortKnnInfo(unsigned short int k, t_instanceIdx numInstances, t_instanceIdx
 
 
 /* ---------------- filterbank functions ---------------------- */
+/*  Index of the frequency of binFreqs (n values in ascending order) nearest to target, the lowest one on ties (binary search) */
 t_binIdx nearestBinIndex(float target, const float *binFreqs, t_binIdx n);
 t_binIdx nearestBinIndex(float target, const std::vector<float> &binFreqs, t_binIdx n);
 t_filterIdx getBarkBoundFreqs(std::vector<float> &filterFreqs, float spacing, float sr);
 t_filterIdx getMelBoundFreqs(std::vector<float> &filterFreqs, float spacing, float sr);
-void createFilterbank(const std::vector<float> &filterFreqs, std::vector<t_filter> &filterbank, t_filterIdx newNumFilters, float window, float sr);
-/*  In the next 2 functions filterBank is not const in order to use the tmpValue field of the filters to avoid local memory allocation */
-void specFilterBands(t_binIdx n, t_filterIdx numFilters, float *spectrum, std::vector<t_filter> &filterbank, bool normalize);
-void filterbankMultiply(float *spectrum, bool normalize, bool filterAvg, std::vector<t_filter> &filterbank, t_filterIdx numFilters);
+void createFilterbank(const std::vector<float> &filterFreqs, Filterbank &filterbank, t_filterIdx newNumFilters, float window, float sr);
+/*  In the next 2 functions the filter energies are written to output (numFilters values, it must not overlap spectrum),
+    the filterbank is read-only since it is shared between modules */
+void specFilterBands(t_binIdx n, t_filterIdx numFilters, const float *spectrum, float *output, const std::vector<t_filter> &filterbank, bool normalize);
+void filterbankMultiply(const float *spectrum, float *output, bool normalize, bool filterAvg, const std::vector<t_filter> &filterbank, t_filterIdx numFilters);
 /* ---------------- END filterbank functions ---------------------- */
 
 
+/* ---------------- onset detection functions ---------------------- */
+/*  Largest mask period count of growthMaskUpdate (the counters saturate there) */
+static const unsigned short MAXMASKPERIODS = 32767;
+/*  Growth pass of bark~ fused in one branch-free loop (SIMD, 4 bands at a time):
+    each band energy is weighted (energy[i]*weights[i]), its growth against the mask is stored in growth[i]
+    (0 if the energy is not above the mask), the positive growth of the bands with bandRange[i] = 1 is summed
+    in totalGrowth, the weighted energy in totalVel, then the mask is updated: it follows the energy when
+    above it, otherwise it decays by maskDecay once its counter reaches maskPeriods (at most MAXMASKPERIODS). */
+void growthMaskUpdate(t_filterIdx numFilters, const float *energy, const float *weights, const float *bandRange,
+                      float *mask, unsigned short *maskCounters, unsigned short maskPeriods, float maskDecay,
+                      float *growth, float &totalGrowth, float &totalVel);
+/* ---------------- END onset detection functions ---------------------- */
+
+
+/* ---------------- batched (offline) functions ---------------------- */
+/*  Multi-frame versions of the per-frame functions above, for offline extraction over whole files.
+    Frames are the rows of row-major matrices (a stride is the distance between two rows, in floats).
+    They run as blocked matrix products over tiles of BATCHTILEFRAMES frames (SIMD on the frames of a tile),
+    or with a CBLAS sgemm if the library is compiled with TID_USE_CBLAS=1.
+    Without CBLAS the results are identical to the per-frame functions (same summation order), with CBLAS they
+    are equal within float rounding.
+    They allocate memory, do not call them from a real-time thread. */
+static const size_t BATCHTILEFRAMES = 8;
+/*  filterbankMultiply on numFrames spectra, output[f][i] is the energy of filter i in frame f */
+void filterbankMultiplyBatch(const float *spectra, size_t numFrames, size_t spectrumStride, float *output, size_t outputStride, bool normalize, bool filterAvg, const std::vector<t_filter> &filterbank, t_filterIdx numFilters);
+/*  output[f][i] = sum_k input[f][k] * matrix[i][k], i.e. output = input * transpose(matrix), matrix is numRows x numCols (contiguous) */
+void matrixMultiplyBatch(const float *input, size_t numFrames, size_t inputStride, const float *matrix, size_t numRows, size_t numCols, float *output, size_t outputStride);
+/* ---------------- END batched (offline) functions ---------------------- */
+
+
+/* ---------------- multi-channel (interleaved) functions ---------------------- */
+/*  Functions on channel-interleaved data, for the multi-channel (e.g. hexaphonic) modules: value v of
+    channel c is at [v*INTERLEAVEDLANES + c], so that each SIMD lane processes one channel.
+    Up to INTERLEAVEDLANES channels, the unused lanes are computed too and ignored by the caller.
+    For each channel the results are identical to the single-channel code (same operations, same order).
+    They do not allocate and can be called from a real-time thread. */
+static const unsigned int INTERLEAVEDLANES = 8;
+/*  filterbankMultiply on interleaved spectra (bins x INTERLEAVEDLANES), output is numFilters x INTERLEAVEDLANES */
+void filterbankMultiplyInterleaved(const float *spectra, float *output, bool normalize, bool filterAvg, const std::vector<t_filter> &filterbank, t_filterIdx numFilters);
+/*  output[i][c] = sum_k input[k][c] * matrix[i][k] (e.g. the DCT of DiscreteCosineTransform::compute), matrix is numRows x numCols (contiguous) */
+void matrixMultiplyInterleaved(const float *input, const float *matrix, size_t numRows, size_t numCols, float *output);
+/*  Running sums of |signum(x[t]) - signum(x[t-1])| (twice the zero crossings) over numFrames frames:
+    sums[c] is updated frame by frame and its value after frame t is written to output[t][c].
+    lastSigns[c] is the sign of the sample before the first one (updated too). Sums wrap around, their differences stay exact. */
+void signChangeSumsInterleaved(const float *input, size_t numFrames, int *lastSigns, unsigned int *sums, unsigned int *output);
+/*  First maximum of each channel over numFrames frames: where input[t][c] > peaks[c] (strict, as in peakSample),
+    peaks[c] becomes input[t][c] and peakIdx[c] becomes t. Initialize peaks and peakIdx before the first call. */
+void peakInterleaved(const float *input, size_t numFrames, float *peaks, unsigned int *peakIdx);
+/* ---------------- END multi-channel (interleaved) functions ---------------------- */
+
+
 /* ---------------- stat computation functions ---------------------- */
 /* ---------------- END stat computation functions ---------------------- */
 
@@ -241,6 +331,24 @@ void initBlackmanWindow(std::vector<float> &window);
 void initCosineWindow(std::vector<float> &window);
 void initHammingWindow(std::vector<float> &window);
 void initHannWindow(std::vector<float> &window);
+
+/**
+ * Copy n samples multiplied by a window (copy and windowing of the analysis window in one pass)
+ * @param window n values, nullptr for the rectangular window (plain copy)
+*/
+void windowCopy(const float *input, const float *window, float *output, unsigned long int n);
+
+/** windowCopy for other sample types, converted to float before the windowing */
+template <typename SampleType>
+inline void windowCopy(const SampleType *input, const float *window, float *output, unsigned long int n)
+{
+    if(window == nullptr)
+        for(unsigned long int i = 0; i < n; ++i)
+            output[i] = (float)input[i];
+    else
+        for(unsigned long int i = 0; i < n; ++i)
+            output[i] = (float)input[i] * window[i];
+}
 /* ---------------- END windowing buffer functions ---------------------- */
 
 
@@ -312,7 +420,8 @@ public:
     /** Compute the dct transform (DCT-II)
      * This is optimized and safe to be called from a real-time thread
     */
-    void compute(const std::vector<FloatType>& input, std::vector<FloatType>& output)
+    template <typename InputVector, typename OutputVector>
+    void compute(const InputVector& input, OutputVector& output)
     {
         if (output.size() != basis.size())
             throw std::logic_error("Output vector size must match the size of the basis");
@@ -329,7 +438,8 @@ public:
      * transformSize determines how many elements to consider.
      * It should still match the size specified during precomputation
     */
-    void compute(const std::vector<FloatType>& input, std::vector<FloatType>& output, size_t transformSize)
+    template <typename InputVector, typename OutputVector>
+    void compute(const InputVector& input, OutputVector& output, size_t transformSize)
     {
         if (transformSize != basis.size())
             throw std::logic_error("transformSize vector size must match the size of the basis");
@@ -341,6 +451,43 @@ public:
                 output[i] += input[k] * basis.at(i,k);
         }
     }
+
+    /** Compute the dct transform (DCT-II) of many frames at once (offline)
+     * input and output are row-major numFrames x transformSize matrices, with
+     * the given row strides. It is computed as a single matrix product (see
+     * matrixMultiplyBatch), with the same results of compute() on each frame.
+     * It allocates memory, do not call it from a real-time thread.
+    */
+    void computeBatch(const FloatType* input, size_t numFrames, size_t inputStride, FloatType* output, size_t outputStride)
+    {
+        if constexpr (std::is_same<FloatType, float>::value)
+            matrixMultiplyBatch(input, numFrames, inputStride, basis.data(), basis.size(), basis.size(), output, outputStride);
+        else
+            for(size_t f=0; f<numFrames; ++f)
+                for(size_t i=0; i<basis.size(); ++i)
+                {
+                    output[f*outputStride + i] = 0;
+                    for(size_t k=0; k<basis.size(); ++k)
+                        output[f*outputStride + i] += input[f*inputStride + k] * basis.at(i,k);
+                }
+    }
+
+    /** Compute the dct transform (DCT-II) of the interleaved channels of a multi-channel module
+     * input and output are transformSize x INTERLEAVEDLANES (see matrixMultiplyInterleaved),
+     * with the same results of compute() on each channel.
+     * This is safe to be called from a real-time thread
+    */
+    void computeInterleaved(const float* input, float* output)
+    {
+        static_assert(std::is_same<FloatType, float>::value, "The interleaved transform works on float values");
+        matrixMultiplyInterleaved(input, basis.data(), basis.size(), basis.size(), output);
+    }
+
+    /** Place the basis in an arena (see tid::Arena) */
+    void layoutBuffers(tid::Arena& arena)
+    {
+        basis.layoutBuffers(arena);
+    }
 private:
     /** Matrix for the dct basis */
     class Basis
@@ -352,20 +499,79 @@ private:
         */
         void resize(size_t newSize)
         {
-            values.resize(newSize);
-            for(std::vector<FloatType>& subvec : values)
-                subvec.resize(newSize);
+            n = newSize;
+            values.resize(newSize*newSize);
         }
         /** Access a cell of the basis matrix */
-        FloatType& at(size_t i, size_t k) { return values[i][k]; }
+        FloatType& at(size_t i, size_t k) { return values[i*n + k]; }
         /** Return the size of the square matrix */
-        size_t size() { return values.size(); }
+        size_t size() { return n; }
+        /** Contiguous row-major values, for the batched transform */
+        const FloatType* data() const { return values.data(); }
+        void layoutBuffers(tid::Arena& arena) { arena.place(values); }
     private:
-        std::vector<std::vector<FloatType>> values;
+        size_t n = 0;
+        tid::ArenaVector<FloatType> values;
     };
 
     Basis basis; // basis of the DCT transform
 };
 
+/**
+ * Cepstral coefficients of many frames at once (offline), the pipeline of
+ * Bfcc::computeFrames and Mfcc::computeFrames.
+ * Frame f is input[f*hop, f*hop+windowSize), windowed and transformed frame by
+ * frame with plan (input fftInput, output fftOut) as in compute(), then the
+ * filterbank and the DCT run as batched matrix products over all the frames
+ * (filterbankMultiplyBatch, DiscreteCosineTransform::computeBatch), with the
+ * same results of compute() on the same windows.
+ * It allocates memory, do not call it from a real-time thread.
+ * @return numFrames rows of numFilters coefficients (row-major)
+*/
+template <typename SampleType, typename FftPlan>
+std::vector<float> cepstralCoefficientsBatch(const SampleType* input, size_t numFrames, size_t hop, unsigned long int windowSize,
+                                             const float* window, float* fftInput, FftPlan& plan, void* fftOut,
+                                             SpectrumType spectrumType, FilterState filterState, bool normalize,
+                                             FilterOperation filterOperation, const std::vector<t_filter>& filterbank,
+                                             t_filterIdx numFilters, DiscreteCosineTransform<float>& dct)
+{
+    if (hop < 1)
+        throw std::invalid_argument("hop must be greater than 1 sample.");
+    const size_t spectrumSize = (unsigned long int)(windowSize * 0.5) + 1;
+
+    // Spectra of all the frames, one row per frame
+    std::vector<float> spectra(numFrames * spectrumSize);
+    for (size_t f = 0; f < numFrames; ++f)
+    {
+        windowCopy(input + f * hop, window, fftInput, windowSize);
+        plan.execute();
+
+        float* spectrum = &spectra[f * spectrumSize];
+        power(spectrumSize, fftOut, spectrum);
+        if (spectrumType != SpectrumType::powerSpectrum)
+            mag(spectrumSize, spectrum);
+    }
+
+    std::vector<float> bands(numFrames * numFilters);
+    switch(filterState)
+    {
+        case FilterState::filterDisabled: // Not a matrix product, frame by frame
+            for (size_t f = 0; f < numFrames; ++f)
+                specFilterBands(spectrumSize, numFilters, &spectra[f * spectrumSize], &bands[f * numFilters], filterbank, normalize);
+            break;
+        case FilterState::filterEnabled:
+            filterbankMultiplyBatch(spectra.data(), numFrames, spectrumSize, bands.data(), numFilters,
+                                    normalize, filterOperation, filterbank, numFilters);
+            break;
+        default:
+            throw std::logic_error("Filter option not available");
+            break;
+    }
+
+    std::vector<float> coefficients(numFrames * numFilters);
+    dct.computeBatch(bands.data(), numFrames, numFilters, coefficients.data(), numFilters);
+    return coefficients;
+}
+
 
 }
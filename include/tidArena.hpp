@@ -0,0 +1,211 @@
+/*
+
+tidArena - One contiguous block for the buffers of a group of modules
+Author: Domenico Stefani (domenico.stefani96@gmail.com)
+
+The buffers that the modules read and write at every block (signal buffers,
+FFT input and output, band energies, DCT basis, sliding-window queues) are
+ArenaVectors: std::vectors whose allocator takes the memory from an Arena,
+or from the heap (64-byte aligned) when they are not placed in one.
+A group of modules (e.g. a WFE::FeatureExtractors instance) is laid out in
+two passes, after the modules have been prepared:
+ 1. layout:    beginLayout(), then every module calls place() on its buffers,
+               which only counts their sizes
+ 2. placement: beginPlacement() allocates one 64-byte aligned block of that
+               size, and the same place() calls move the buffers into it, one
+               after the other in the order of the calls (the order in which
+               the modules access them at every block); endPlacement() frees
+               the previous block
+
+Placed buffers that grow afterwards (e.g. the window size is changed) take
+the rest of the block if it is large enough, or the heap (reported by
+getOverflowBytes()) until the next layout.
+Nothing is freed from the block: a deallocation only returns the memory to
+the arena at the next placement.
+The arena must outlive the buffers placed into it.
+
+*/
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <vector>
+
+namespace tid   /* TimbreID namespace*/
+{
+
+template <typename T, size_t N>
+class FixedBuffer;
+
+class Arena
+{
+public:
+    static constexpr size_t ALIGNMENT = 64;
+
+    Arena() = default;
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    /** Start the layout pass: place() only counts the buffers */
+    void beginLayout() noexcept
+    {
+        this->placing = false;
+        this->layoutBytes = 0;
+    }
+
+    /**
+     * Allocate one block for the buffers counted in the layout pass, and start
+     * the placement pass. The previous block is kept until endPlacement(),
+     * since the buffers are copied from it.
+    */
+    void beginPlacement()
+    {
+        this->previous = std::move(this->block);
+        this->previousCapacity = this->capacity;
+        this->block.reset(this->layoutBytes > 0 ? static_cast<char*>(::operator new[](this->layoutBytes, std::align_val_t(ALIGNMENT))) : nullptr);
+        this->capacity = this->layoutBytes;
+        this->used = 0;
+        this->overflowBytes = 0;
+        this->placing = true;
+    }
+
+    /** End the placement pass, freeing the previous block (every buffer in it must have been placed again) */
+    void endPlacement() noexcept
+    {
+        this->previous.reset();
+        this->previousCapacity = 0;
+    }
+
+    bool isPlacing() const noexcept { return this->placing; }
+
+    /**
+     * Count (layout pass) or move into the block (placement pass) a buffer.
+     * The contents are kept, the capacity becomes the size.
+    */
+    template <typename T, typename Allocator>
+    void place(std::vector<T, Allocator>& buffer)
+    {
+        if (!this->placing)
+        {
+            this->layoutBytes += roundUp(buffer.size() * sizeof(T));
+            return;
+        }
+        std::vector<T, Allocator> placed(Allocator(this));
+        placed.reserve(buffer.size());
+        placed.assign(buffer.begin(), buffer.end());
+        buffer = std::move(placed);
+    }
+
+    /** Buffers with a size fixed at compile time are already inside their module (tidFixedSize.hpp) */
+    template <typename T, size_t N>
+    void place(FixedBuffer<T, N>&) noexcept {}
+
+    /** Bytes counted in the last layout pass */
+    size_t getLayoutBytes() const noexcept { return this->layoutBytes; }
+    /** Size of the block */
+    size_t getCapacity() const noexcept { return this->capacity; }
+    /** Bytes of the block in use (placed buffers and the ones that grew into it) */
+    size_t getUsedBytes() const noexcept { return this->used; }
+    /** Bytes allocated on the heap since the placement because the block was full */
+    size_t getOverflowBytes() const noexcept { return this->overflowBytes; }
+
+    /** Used by ArenaAllocator */
+    void* allocate(size_t bytes)
+    {
+        const size_t size = roundUp(bytes);
+        if (this->placing && this->used + size <= this->capacity)
+        {
+            void* memory = this->block.get() + this->used;
+            this->used += size;
+            return memory;
+        }
+        if (this->placing)
+            this->overflowBytes += size;
+        return ::operator new(size, std::align_val_t(ALIGNMENT));
+    }
+
+    /** Used by ArenaAllocator */
+    void deallocate(void* memory) noexcept
+    {
+        if (!inBlock(memory, this->block.get(), this->capacity) && !inBlock(memory, this->previous.get(), this->previousCapacity))
+            ::operator delete(memory, std::align_val_t(ALIGNMENT));
+    }
+
+private:
+    struct BlockDelete
+    {
+        void operator()(char* memory) const noexcept { ::operator delete[](memory, std::align_val_t(ALIGNMENT)); }
+    };
+
+    static size_t roundUp(size_t bytes) noexcept { return (bytes + ALIGNMENT - 1) / ALIGNMENT * ALIGNMENT; }
+
+    static bool inBlock(const void* memory, const char* start, size_t size) noexcept
+    {
+        const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(memory), begin = reinterpret_cast<std::uintptr_t>(start);
+        return start != nullptr && address >= begin && address < begin + size;
+    }
+
+    std::unique_ptr<char[], BlockDelete> block, previous;
+    size_t capacity = 0, previousCapacity = 0;
+    size_t used = 0;
+    size_t layoutBytes = 0;
+    size_t overflowBytes = 0;
+    bool placing = false;
+};
+
+/**
+ * Allocator of the ArenaVectors: memory from the arena the vector has been
+ * placed in, or 64-byte aligned heap memory.
+ * The arena moves with the vector contents (move assignment and swap), a
+ * copy of the vector is on the heap.
+*/
+template <typename T>
+class ArenaAllocator
+{
+public:
+    using value_type = T;
+    using propagate_on_container_move_assignment = std::true_type;
+    using propagate_on_container_swap = std::true_type;
+    using is_always_equal = std::false_type;
+
+    ArenaAllocator() noexcept = default;
+    explicit ArenaAllocator(Arena* arena) noexcept : arena(arena) {}
+    template <typename U>
+    ArenaAllocator(const ArenaAllocator<U>& other) noexcept : arena(other.getArena()) {}
+
+    T* allocate(size_t n)
+    {
+        if (this->arena != nullptr)
+            return static_cast<T*>(this->arena->allocate(n * sizeof(T)));
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Arena::ALIGNMENT)));
+    }
+
+    void deallocate(T* memory, size_t) noexcept
+    {
+        if (this->arena != nullptr)
+            this->arena->deallocate(memory);
+        else
+            ::operator delete(memory, std::align_val_t(Arena::ALIGNMENT));
+    }
+
+    ArenaAllocator select_on_container_copy_construction() const noexcept { return ArenaAllocator(); }
+
+    Arena* getArena() const noexcept { return this->arena; }
+
+    template <typename U>
+    bool operator==(const ArenaAllocator<U>& other) const noexcept { return this->arena == other.getArena(); }
+    template <typename U>
+    bool operator!=(const ArenaAllocator<U>& other) const noexcept { return this->arena != other.getArena(); }
+
+private:
+    Arena* arena = nullptr;
+};
+
+/** Buffer used at every block, that can be placed in an Arena */
+template <typename T>
+using ArenaVector = std::vector<T, ArenaAllocator<T>>;
+
+} // namespace tid
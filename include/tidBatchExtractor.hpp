@@ -0,0 +1,484 @@
+/*
+
+tidBatchExtractor - Parallel offline feature extraction over audio files
+Author: Domenico Stefani (domenico.stefani96@gmail.com)
+
+Extracts the feature matrices of a corpus of WAV files with the same
+WFE::FeatureExtractors used by the plugins, without a host and faster than
+real time.
+Files are independent jobs, distributed to the workers of a work-stealing
+pool. Inside a file the block loop of the real-time processBlock() is
+replayed exactly (store every block, post-onset delay counted in blocks,
+zero padding of computeFeatureVectors()), so the matrices are identical to
+the ones computed by the plugin on the same audio.
+
+Onsets are either given (times in seconds, e.g. from an annotation) or
+detected with a Bark module configured like the guitar classifier demo.
+Bark's debounce runs on the sample clock, so the detected onsets do not
+depend on the processing speed, and its onset events are popped right after
+every store(): it works the same in JUCE and headless builds.
+
+*/
+#pragma once
+
+#include "tidJuceCompat.hpp"
+#include "bark.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <fstream>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace tid   /* TimbreID namespace*/
+{
+namespace batch
+{
+
+//==============================================================================
+/** Audio read from a file, one vector of samples per channel */
+struct AudioFile
+{
+    double sampleRate = 0.0;
+    std::vector<std::vector<float>> channels;
+
+    size_t getNumSamples() const noexcept { return this->channels.empty() ? 0 : this->channels[0].size(); }
+};
+
+/**
+ * Read a WAV file (PCM 8/16/24/32 bit or IEEE float 32/64 bit, also in the
+ * WAVE_FORMAT_EXTENSIBLE variant).
+ * Samples are converted to float in [-1,1) with the same scaling used by JUCE
+ * (e.g. 1/32768 for 16 bit), so they match the buffers of a plugin host.
+ * @throws std::invalid_argument if the file can't be read or the format is not supported
+*/
+inline AudioFile readWav(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        throw std::invalid_argument("Cannot open '" + path + "'");
+    std::vector<unsigned char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    auto readU16 = [&bytes](size_t pos) { return (uint32_t)bytes[pos] | ((uint32_t)bytes[pos + 1] << 8); };
+    auto readU32 = [&bytes](size_t pos) { return (uint32_t)bytes[pos] | ((uint32_t)bytes[pos + 1] << 8) |
+                                                 ((uint32_t)bytes[pos + 2] << 16) | ((uint32_t)bytes[pos + 3] << 24); };
+
+    if (bytes.size() < 12 || std::memcmp(bytes.data(), "RIFF", 4) != 0 || std::memcmp(bytes.data() + 8, "WAVE", 4) != 0)
+        throw std::invalid_argument("'" + path + "' is not a RIFF/WAVE file");
+
+    uint32_t formatTag = 0, numChannels = 0, sampleRate = 0, bitsPerSample = 0;
+    size_t dataStart = 0, dataSize = 0;
+    bool foundFormat = false, foundData = false;
+    for (size_t pos = 12; pos + 8 <= bytes.size();)
+    {
+        const uint32_t chunkSize = readU32(pos + 4);
+        const size_t chunkStart = pos + 8;
+        const size_t available = std::min<size_t>(chunkSize, bytes.size() - chunkStart);
+        if (std::memcmp(bytes.data() + pos, "fmt ", 4) == 0 && available >= 16)
+        {
+            formatTag = readU16(chunkStart);
+            numChannels = readU16(chunkStart + 2);
+            sampleRate = readU32(chunkStart + 4);
+            bitsPerSample = readU16(chunkStart + 14);
+            if (formatTag == 0xFFFE && available >= 26) // WAVE_FORMAT_EXTENSIBLE, the subformat GUID starts with the tag
+                formatTag = readU16(chunkStart + 24);
+            foundFormat = true;
+        }
+        else if (std::memcmp(bytes.data() + pos, "data", 4) == 0)
+        {
+            dataStart = chunkStart;
+            dataSize = available; // Truncated files are read up to their end
+            foundData = true;
+        }
+        pos = chunkStart + chunkSize + (chunkSize & 1); // Chunks are padded to an even size
+    }
+
+    if (!foundFormat || !foundData)
+        throw std::invalid_argument("'" + path + "' has no fmt or data chunk");
+    const bool isPcm = formatTag == 1 && (bitsPerSample == 8 || bitsPerSample == 16 || bitsPerSample == 24 || bitsPerSample == 32);
+    const bool isFloat = formatTag == 3 && (bitsPerSample == 32 || bitsPerSample == 64);
+    if (!isPcm && !isFloat)
+        throw std::invalid_argument("'" + path + "' has an unsupported sample format (tag " + std::to_string(formatTag) +
+                                    ", " + std::to_string(bitsPerSample) + " bits)");
+    if (numChannels == 0 || sampleRate == 0)
+        throw std::invalid_argument("'" + path + "' has an invalid fmt chunk");
+
+    const size_t bytesPerSample = bitsPerSample / 8;
+    const size_t numFrames = dataSize / (bytesPerSample * numChannels);
+
+    AudioFile audio;
+    audio.sampleRate = sampleRate;
+    audio.channels.assign(numChannels, std::vector<float>(numFrames));
+    const unsigned char* data = bytes.data() + dataStart;
+    for (size_t frame = 0; frame < numFrames; ++frame)
+    {
+        for (size_t channel = 0; channel < numChannels; ++channel, data += bytesPerSample)
+        {
+            float value;
+            if (isFloat && bitsPerSample == 32)
+            {
+                const uint32_t bits = (uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+                std::memcpy(&value, &bits, sizeof(value));
+            }
+            else if (isFloat)
+            {
+                uint64_t bits = 0;
+                for (int b = 7; b >= 0; --b)
+                    bits = (bits << 8) | data[b];
+                double doubleValue;
+                std::memcpy(&doubleValue, &bits, sizeof(doubleValue));
+                value = (float)doubleValue;
+            }
+            else if (bitsPerSample == 8)
+                value = ((int)data[0] - 128) * (1.0f / 128.0f); // 8 bit PCM is unsigned
+            else if (bitsPerSample == 16)
+                value = (int16_t)(data[0] | (data[1] << 8)) * (1.0f / 32768.0f);
+            else if (bitsPerSample == 24)
+                value = ((int32_t)(((uint32_t)data[0] << 8) | ((uint32_t)data[1] << 16) | ((uint32_t)data[2] << 24)) >> 8) * (1.0f / 8388608.0f);
+            else
+                value = (float)((int32_t)((uint32_t)data[0] | ((uint32_t)data[1] << 8) | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24)) * (1.0 / 2147483648.0));
+            audio.channels[channel][frame] = value;
+        }
+    }
+    return audio;
+}
+
+//==============================================================================
+/**
+ * Pool of workers with one task deque each.
+ * Tasks are split in contiguous ranges among the workers; a worker takes tasks
+ * from the front of its own deque and, when that is empty, steals from the
+ * back of the others, so that long files do not leave workers idle.
+ * The calling thread takes part in run() as worker 0.
+*/
+class WorkStealingPool
+{
+public:
+    explicit WorkStealingPool(size_t numWorkers)
+        : numWorkers(std::max<size_t>(1, numWorkers)), queues(this->numWorkers)
+    {
+    }
+
+    size_t getNumWorkers() const noexcept { return this->numWorkers; }
+
+    /**
+     * Run numTasks tasks and wait for all of them.
+     * @param task called as task(taskIndex, workerIndex), it must not throw
+    */
+    void run(size_t numTasks, const std::function<void(size_t, size_t)>& task)
+    {
+        for (size_t w = 0; w < this->numWorkers; ++w)
+        {
+            std::lock_guard<std::mutex> lock(this->queues[w].mutex);
+            this->queues[w].tasks.clear();
+            for (size_t t = w * numTasks / this->numWorkers; t < (w + 1) * numTasks / this->numWorkers; ++t)
+                this->queues[w].tasks.push_back(t);
+        }
+
+        std::vector<std::thread> threads;
+        for (size_t w = 1; w < this->numWorkers; ++w)
+            threads.emplace_back([this, w, &task] { this->workerLoop(w, task); });
+        this->workerLoop(0, task);
+        for (std::thread& thread : threads)
+            thread.join();
+    }
+
+private:
+    struct alignas(64) TaskQueue
+    {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+
+    size_t numWorkers;
+    std::vector<TaskQueue> queues;
+
+    bool popOwn(size_t worker, size_t& task)
+    {
+        std::lock_guard<std::mutex> lock(this->queues[worker].mutex);
+        if (this->queues[worker].tasks.empty())
+            return false;
+        task = this->queues[worker].tasks.front();
+        this->queues[worker].tasks.pop_front();
+        return true;
+    }
+
+    bool steal(size_t thief, size_t& task)
+    {
+        for (size_t i = 1; i < this->numWorkers; ++i)
+        {
+            TaskQueue& victim = this->queues[(thief + i) % this->numWorkers];
+            std::lock_guard<std::mutex> lock(victim.mutex);
+            if (!victim.tasks.empty())
+            {
+                task = victim.tasks.back();
+                victim.tasks.pop_back();
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // No task is added during run(), so a worker that finds every deque empty is done
+    void workerLoop(size_t worker, const std::function<void(size_t, size_t)>& task)
+    {
+        size_t taskIndex;
+        while (this->popOwn(worker, taskIndex) || this->steal(worker, taskIndex))
+            task(taskIndex, worker);
+    }
+};
+
+//==============================================================================
+/** Parameters of the Bark onset detector (defaults of the guitar classifier demo) */
+struct OnsetDetectorSettings
+{
+    unsigned long int windowSize = 1024;
+    unsigned long int hop = 128;
+    float barkSpacing = 0.5f;
+    float threshLo = -1.0f;
+    float threshHi = 30.0f;
+    int debounceMillis = 200;
+    unsigned int maskPeriods = 4;
+    float maskDecay = 0.75f;
+    float filterRangeLo = 0.0f;
+    float filterRangeHi = 49.0f;
+};
+
+struct Settings
+{
+    /** Sample rate of the corpus, files with a different rate are reported as errors (no resampling) */
+    double sampleRate = 48000.0;
+    /**
+     * Delay between the onset and the extraction, as POST_ONSET_DELAY_MS in the demos (DO_DELAY_ONSET).
+     * With a value <= 0 the features are computed in the same block of the onset, after storing it.
+    */
+    double postOnsetDelayMs = 0.0;
+    /** Channel of the file to analyse */
+    unsigned int channel = 0;
+    /** Detect the onsets with Bark for the jobs that have no onset times */
+    bool detectOnsets = false;
+    OnsetDetectorSettings onsetDetector;
+};
+
+/** A file to analyse */
+struct Job
+{
+    std::string path;
+    /** Onset times in seconds, empty to detect them (Settings::detectOnsets) */
+    std::vector<double> onsetTimes;
+};
+
+struct Result
+{
+    std::string path;
+    /** Block in which each onset that produced a feature matrix was reported */
+    std::vector<unsigned long int> onsetBlocks;
+    /** Block at which each feature matrix was computed (the features include the audio before this block) */
+    std::vector<unsigned long int> extractionBlocks;
+    /** Onsets ignored because they arrived while waiting for the post-onset delay, as in the real-time path */
+    unsigned long int ignoredOnsets = 0;
+    /** Feature matrices, one flat matrix of getFeatureVectorSize() values per row */
+    std::vector<float> features;
+    /** Empty on success */
+    std::string error;
+
+    size_t getNumRows() const noexcept { return this->extractionBlocks.size(); }
+};
+
+//==============================================================================
+/**
+ * Offline extraction engine.
+ * @tparam FeatureExtractorsType a WFE::FeatureExtractors instantiation, with the same template
+ *                               parameters of the plugin that must be reproduced
+*/
+template <class FeatureExtractorsType>
+class BatchExtractor
+{
+public:
+    /**
+     * @param settings   extraction settings
+     * @param numWorkers number of threads (the calling thread is one of them), 0 for all the cores
+    */
+    explicit BatchExtractor(const Settings& settings, size_t numWorkers = 0)
+        : settings(settings),
+          pool(numWorkers > 0 ? numWorkers : std::max(1u, std::thread::hardware_concurrency()))
+    {
+        if (settings.sampleRate <= 0)
+            throw std::invalid_argument("The sample rate must be positive");
+
+        // Every worker has its own extractors, their FFT plans are shared through tid::FftwPlanCache
+        for (size_t w = 0; w < this->pool.getNumWorkers(); ++w)
+        {
+            this->extractors.push_back(std::make_unique<FeatureExtractorsType>());
+            this->extractors.back()->prepare(settings.sampleRate, (unsigned int)FeatureExtractorsType::getBlockSize());
+        }
+    }
+
+    static constexpr size_t getFeatureVectorSize() { return FeatureExtractorsType::getFeVectorSize(); }
+
+    std::vector<std::string> getHeader() { return this->extractors[0]->getHeader(); }
+
+    size_t getNumWorkers() const noexcept { return this->pool.getNumWorkers(); }
+
+    /** Process all the jobs in parallel, results are in the same order of the jobs */
+    std::vector<Result> process(const std::vector<Job>& jobs)
+    {
+        std::vector<Result> results(jobs.size());
+        this->pool.run(jobs.size(), [this, &jobs, &results](size_t job, size_t worker) {
+            results[job] = this->processFile(jobs[job], worker);
+        });
+        return results;
+    }
+
+    /** Read and process a single file with the extractors of a worker (errors are returned in Result::error) */
+    Result processFile(const Job& job, size_t worker = 0)
+    {
+        Result result;
+        try
+        {
+            const AudioFile audio = readWav(job.path);
+            if (audio.sampleRate != this->settings.sampleRate)
+                throw std::invalid_argument("Sample rate is " + std::to_string(audio.sampleRate) + " instead of " +
+                                            std::to_string(this->settings.sampleRate));
+            if (this->settings.channel >= audio.channels.size())
+                throw std::invalid_argument("Channel " + std::to_string(this->settings.channel) + " not found (" +
+                                            std::to_string(audio.channels.size()) + " channels)");
+            const std::vector<float>& samples = audio.channels[this->settings.channel];
+            result = this->processSamples(samples.data(), samples.size(), job.onsetTimes, worker);
+        }
+        catch (const std::exception& e)
+        {
+            result = Result();
+            result.error = e.what();
+        }
+        result.path = job.path;
+        return result;
+    }
+
+    /**
+     * Process a mono signal at the sample rate of the settings, replaying the block loop of the plugin:
+     *   1. compute the features if the post-onset delay expired
+     *   2. store the block in the extractors
+     *   3. store the block in the onset detector (or check the given onsets), start the delay or compute immediately
+     *   4. count the block for the post-onset delay
+     * The last block is padded with zeros, and zero blocks are added after the end if an extraction is pending.
+    */
+    Result processSamples(const float* samples, size_t numSamples, const std::vector<double>& onsetTimes, size_t worker = 0)
+    {
+        const size_t blockSize = FeatureExtractorsType::getBlockSize();
+        FeatureExtractorsType& featexts = *this->extractors.at(worker);
+        featexts.reset();
+
+        const bool useDetector = onsetTimes.empty() && this->settings.detectOnsets;
+        std::unique_ptr<tid::Bark<float>> bark;
+        if (useDetector)
+            bark = this->createOnsetDetector();
+
+        std::vector<unsigned long int> givenOnsetBlocks;
+        for (double time : onsetTimes)
+            givenOnsetBlocks.push_back((unsigned long int)std::max(0.0, std::floor(time * this->settings.sampleRate)) / blockSize);
+        std::sort(givenOnsetBlocks.begin(), givenOnsetBlocks.end());
+        size_t nextOnset = 0;
+
+        const bool delayOnset = this->settings.postOnsetDelayMs > 0;
+        const long long deadline = (long long)std::round((this->settings.postOnsetDelayMs / 1000.0) * this->settings.sampleRate / blockSize);
+        bool timerStarted = false;
+        long long timerCounter = 0;
+        unsigned long int pendingOnsetBlock = 0;
+
+        Result result;
+        auto computeFeatures = [&](unsigned long int onsetBlock, unsigned long int block) {
+            result.features.resize(result.features.size() + getFeatureVectorSize());
+            featexts.computeFeatureVectors(result.features.data() + result.features.size() - getFeatureVectorSize());
+            result.onsetBlocks.push_back(onsetBlock);
+            result.extractionBlocks.push_back(block);
+        };
+
+        std::vector<float> block(blockSize);
+        float* channels[1] = {block.data()};
+        AudioBuffer<float> buffer(channels, 1, (int)blockSize);
+
+        const size_t numBlocks = (numSamples + blockSize - 1) / blockSize;
+        for (unsigned long int b = 0; b < numBlocks || timerStarted; ++b)
+        {
+            if (timerStarted && timerCounter >= deadline)
+            {
+                timerStarted = false;
+                computeFeatures(pendingOnsetBlock, b);
+            }
+
+            const size_t start = std::min(numSamples, (size_t)b * blockSize);
+            const size_t count = std::min(blockSize, numSamples - start);
+            std::copy(samples + start, samples + start + count, block.begin());
+            std::fill(block.begin() + count, block.end(), 0.0f);
+
+            featexts.storeAndCompute(buffer, 0);
+
+            bool onset = false;
+            if (useDetector)
+            {
+                bark->store(block.data(), blockSize);
+                tid::Bark<float>::OnsetEvent event;
+                while (bark->popOnsetEvent(event))
+                    onset = true;
+            }
+            else
+            {
+                // More onsets in the same block are reported once, like a detector with a hop of one block
+                while (nextOnset < givenOnsetBlocks.size() && givenOnsetBlocks[nextOnset] == b)
+                {
+                    onset = true;
+                    ++nextOnset;
+                }
+            }
+
+            if (onset)
+            {
+                if (!delayOnset)
+                    computeFeatures(b, b);
+                else if (!timerStarted)
+                {
+                    timerStarted = true;
+                    timerCounter = 0;
+                    pendingOnsetBlock = b;
+                }
+                else
+                    ++result.ignoredOnsets;
+            }
+
+            if (timerStarted)
+                ++timerCounter;
+        }
+        return result;
+    }
+
+private:
+    // A new detector for every file, so that no growth history or running debounce is carried over
+    std::unique_ptr<tid::Bark<float>> createOnsetDetector()
+    {
+        const OnsetDetectorSettings& ods = this->settings.onsetDetector;
+        auto bark = std::make_unique<tid::Bark<float>>(ods.windowSize, ods.hop, ods.barkSpacing);
+        bark->prepare((unsigned long int)this->settings.sampleRate, (unsigned int)FeatureExtractorsType::getBlockSize());
+        bark->setDebounce(ods.debounceMillis);
+        bark->setMask(ods.maskPeriods, ods.maskDecay);
+        bark->setFilterRange(ods.filterRangeLo, ods.filterRangeHi);
+        bark->setThresh(ods.threshLo, ods.threshHi);
+        return bark;
+    }
+
+    Settings settings;
+    WorkStealingPool pool;
+    std::vector<std::unique_ptr<FeatureExtractorsType>> extractors;
+};
+
+} // namespace batch
+} // namespace tid
@@ -0,0 +1,118 @@
+/*
+
+tidFft - FFT backend of the spectral modules
+Author: Domenico Stefani (domenico.stefani96@gmail.com)
+
+The modules use tid::FftPlan and the tid::fft::Complex spectrum buffers
+declared here, whatever the backend selected with TID_FFT_BACKEND (tIDLib.hpp):
+ - TID_FFT_BACKEND_FFTW:    FftPlan is FftwPlan, plans shared by FftwPlanCache (tidFftw.hpp)
+ - TID_FFT_BACKEND_BUILTIN: FftPlan is BuiltinFftPlan, on tid::fft::RealFft (tidRealFft.hpp),
+                            and the library does not need FFTW
+
+Both have the same spectrum layout (n/2+1 interleaved complex values) and the
+same unnormalized inverse, so module code does not change with the backend.
+
+*/
+#pragma once
+
+#include "tIDLib.hpp"
+#include "tidJuceCompat.hpp"
+#include "tidRealFft.hpp"
+#if TID_FFT_BACKEND == TID_FFT_BACKEND_FFTW
+#include "tidFftw.hpp"
+#endif
+
+namespace tid   /* TimbreID namespace*/
+{
+namespace fft
+{
+
+#if TID_FFT_BACKEND == TID_FFT_BACKEND_FFTW
+typedef fftwf_complex Complex;
+
+/** Allocate a spectrum buffer of n complex values (not real-time safe) */
+inline Complex* allocComplex(size_t n) { return fftwf_alloc_complex(n); }
+inline void freeComplex(Complex* buffer) { fftwf_free(buffer); }
+#else
+typedef float Complex[2];
+
+/** Allocate a spectrum buffer of n complex values (not real-time safe) */
+inline Complex* allocComplex(size_t n) { return new Complex[n]; }
+inline void freeComplex(Complex* buffer) { delete[] buffer; }
+#endif
+
+/**
+ * Spectrum buffer of n complex values in an ArenaVector (2n floats, zeroed),
+ * that can be placed in an arena with the other buffers of the module (not real-time safe)
+*/
+inline Complex* resizeComplex(ArenaVector<float>& buffer, size_t n)
+{
+    buffer.assign(2 * n, 0.0f);
+    return reinterpret_cast<Complex*>(buffer.data());
+}
+
+} // namespace fft
+
+/**
+ * Plan of the built-in backend, with the interface of FftwPlan.
+ * Every plan has its own tables and work buffers.
+*/
+class BuiltinFftPlan
+{
+public:
+    /** Forward real to complex DFT of size n, from real (n values) to complex (n/2+1 values) */
+    void createRealToComplex(int n, float* real, fft::Complex* complex)
+    {
+        create(true, n, real, complex);
+    }
+
+    /** Backward complex to real DFT of size n, from complex (n/2+1 values) to real (n values) */
+    void createComplexToReal(int n, fft::Complex* complex, float* real)
+    {
+        create(false, n, real, complex);
+    }
+
+    /** Execute the transform on the arrays given at creation */
+    void execute() noexcept
+    {
+        jassert(this->valid);
+        if (this->forward)
+            this->realFft.forward(this->real, &this->complex[0][0]);
+        else
+            this->realFft.inverse(&this->complex[0][0], this->real);
+    }
+
+    void reset()
+    {
+        this->realFft = fft::RealFft();
+        this->valid = false;
+    }
+
+    bool isValid() const noexcept { return this->valid; }
+
+private:
+    void create(bool isForward, int n, float* newReal, fft::Complex* newComplex)
+    {
+        if (n < 1)
+            throw std::invalid_argument("FFT size must be 1 or greater");
+        this->realFft.prepare((size_t)n);
+        this->forward = isForward;
+        this->real = newReal;
+        this->complex = newComplex;
+        this->valid = true;
+    }
+
+    fft::RealFft realFft;
+    bool forward = true;
+    bool valid = false;
+    float* real = nullptr;
+    fft::Complex* complex = nullptr;
+};
+
+#if TID_FFT_BACKEND == TID_FFT_BACKEND_FFTW
+using FftPlan = FftwPlan;
+#else
+using FftPlan = BuiltinFftPlan;
+#endif
+
+} // namespace tid
@@ -0,0 +1,275 @@
+/*
+
+tidFftw - Process-wide cache of FFTW plans and wisdom management
+Author: Domenico Stefani (domenico.stefani96@gmail.com)
+
+Every module instance used to create (and destroy) its own FFTW plans, always
+with FFTW_ESTIMATE since planning happens when a plugin is loaded.
+FftwPlanCache creates each plan once per process, keyed by transform kind,
+size, planner flags, in-place-ness and the SIMD alignment of the arrays, and
+modules share it through FftwPlan handles that run the new-array execute
+functions (fftwf_execute_dft_r2c/c2r) on their own buffers.
+
+Plans are created on scratch arrays with the same alignment of the module
+arrays, so that FFTW_MEASURE/FFTW_PATIENT never overwrite module buffers, and
+all the planner calls are serialized by the cache (the FFTW planner is not
+thread-safe). Saving the wisdom with exportWisdom() and loading it with
+importWisdom() at the next start makes measured plans as fast to create as
+estimated ones.
+Plans no longer used by any handle stay in the cache until releaseUnused(),
+see tidWindowTable.hpp for the lifetime of the entries.
+
+*/
+#pragma once
+
+#include "fftw3.h"
+#include "tIDLib.hpp"
+#include "tidJuceCompat.hpp"
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+
+namespace tid   /* TimbreID namespace*/
+{
+
+class FftwPlan;
+
+class FftwPlanCache
+{
+public:
+    enum class Kind
+    {
+        realToComplex,
+        complexToReal
+    };
+
+    static FftwPlanCache& getInstance()
+    {
+        static FftwPlanCache instance;
+        return instance;
+    }
+
+    /**
+     * Set the planner flags used for the plans created from now on
+     * (default FFTWPLANNERFLAG). Plans already in use are not affected.
+     * E.g. FFTW_MEASURE, FFTW_PATIENT, or FFTW_MEASURE | FFTW_WISDOM_ONLY to
+     * use only the plans found in the imported wisdom.
+    */
+    void setPlannerFlags(unsigned int flags)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->plannerFlags = flags;
+    }
+
+    unsigned int getPlannerFlags()
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->plannerFlags;
+    }
+
+    /**
+     * Import FFTW wisdom (single precision) from a file written by exportWisdom() or fftwf-wisdom
+     * Call it before the modules are prepared, so that their plans are found in the wisdom.
+     * @return false if the file is missing or invalid
+    */
+    bool importWisdom(const std::string& filename)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return fftwf_import_wisdom_from_filename(filename.c_str()) != 0;
+    }
+
+    /**
+     * Export the wisdom accumulated by the planner (imported and measured plans) to a file
+     * @return false if the file could not be written
+    */
+    bool exportWisdom(const std::string& filename)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return fftwf_export_wisdom_to_filename(filename.c_str()) != 0;
+    }
+
+    /** Number of plans in the cache, in use or not */
+    size_t getNumPlans()
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->plans.size();
+    }
+
+    /**
+     * Destroy the plans that no FftwPlan uses.
+     * Unused plans are kept otherwise, so that a module created again later
+     * (e.g. the plugin is reloaded) does not plan again.
+    */
+    void releaseUnused()
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        for (auto it = this->plans.begin(); it != this->plans.end();)
+        {
+            if (it->second.useCount == 0)
+            {
+                fftwf_destroy_plan(it->second.plan);
+                it = this->plans.erase(it);
+            }
+            else
+                ++it;
+        }
+    }
+
+    FftwPlanCache(const FftwPlanCache&) = delete;
+    FftwPlanCache& operator=(const FftwPlanCache&) = delete;
+
+private:
+    friend class FftwPlan;
+
+    // kind, size, flags, in-place, alignment of the real array, alignment of the complex array
+    using Key = std::tuple<Kind, int, unsigned int, bool, int, int>;
+
+    struct Entry
+    {
+        fftwf_plan plan;
+        size_t useCount;
+    };
+
+    FftwPlanCache() : plannerFlags(FFTWPLANNERFLAG) {}
+
+    ~FftwPlanCache()
+    {
+        for (auto& keyAndEntry : this->plans)
+            fftwf_destroy_plan(keyAndEntry.second.plan);
+    }
+
+    Key acquire(Kind kind, int n, float* real, fftwf_complex* complex, fftwf_plan& plan)
+    {
+        if (n < 1)
+            throw std::invalid_argument("FFT size must be 1 or greater");
+
+        std::lock_guard<std::mutex> lock(this->mutex);
+        const bool inPlace = (void*)real == (void*)complex;
+        const Key key{kind, n, this->plannerFlags, inPlace,
+                      fftwf_alignment_of(real), fftwf_alignment_of(reinterpret_cast<float*>(complex))};
+
+        auto it = this->plans.find(key);
+        if (it == this->plans.end())
+        {
+            const fftwf_plan newPlan = createPlan(kind, n, inPlace, std::get<4>(key), std::get<5>(key));
+            if (newPlan == nullptr)
+                throw std::runtime_error("FFTW could not create a plan of size " + std::to_string(n)
+                                         + " (FFTW_WISDOM_ONLY without wisdom for it?)");
+            it = this->plans.emplace(key, Entry{newPlan, 0}).first;
+        }
+        ++it->second.useCount;
+        plan = it->second.plan;
+        return key;
+    }
+
+    void release(const Key& key)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        auto it = this->plans.find(key);
+        if (it != this->plans.end() && it->second.useCount > 0)
+            --it->second.useCount;
+    }
+
+    /**
+     * Plan on scratch arrays, offset from an aligned allocation to match the
+     * alignment of the arrays that the plan will be executed on
+    */
+    fftwf_plan createPlan(Kind kind, int n, bool inPlace, int realAlignment, int complexAlignment)
+    {
+        const size_t complexSize = sizeof(fftwf_complex) * (n / 2 + 1);
+        const size_t realSize = inPlace ? complexSize : sizeof(float) * n;
+        char* realScratch = (char*)fftwf_malloc(realSize + realAlignment);
+        char* complexScratch = inPlace ? realScratch : (char*)fftwf_malloc(complexSize + complexAlignment);
+        if (realScratch == nullptr || complexScratch == nullptr)
+        {
+            fftwf_free(realScratch);
+            if (!inPlace)
+                fftwf_free(complexScratch);
+            throw std::bad_alloc();
+        }
+
+        float* real = reinterpret_cast<float*>(realScratch + realAlignment);
+        fftwf_complex* complex = reinterpret_cast<fftwf_complex*>(complexScratch + (inPlace ? realAlignment : complexAlignment));
+        const fftwf_plan plan = (kind == Kind::realToComplex) ? fftwf_plan_dft_r2c_1d(n, real, complex, this->plannerFlags)
+                                                              : fftwf_plan_dft_c2r_1d(n, complex, real, this->plannerFlags);
+        fftwf_free(realScratch);
+        if (!inPlace)
+            fftwf_free(complexScratch);
+        return plan;
+    }
+
+    std::mutex mutex;
+    unsigned int plannerFlags;
+    std::map<Key, Entry> plans;
+};
+
+/**
+ * Handle to a shared plan of FftwPlanCache, bound to the arrays of a module.
+ * Create it (not real-time safe) when the buffers are allocated, and execute
+ * it from the audio thread. The arrays must not be reallocated afterwards
+ * without creating the plan again.
+*/
+class FftwPlan
+{
+public:
+    FftwPlan() = default;
+    ~FftwPlan() { reset(); }
+
+    FftwPlan(const FftwPlan&) = delete;
+    FftwPlan& operator=(const FftwPlan&) = delete;
+
+    /** Forward real to complex DFT of size n, from real (n values) to complex (n/2+1 values) */
+    void createRealToComplex(int n, float* real, fftwf_complex* complex)
+    {
+        create(FftwPlanCache::Kind::realToComplex, n, real, complex);
+    }
+
+    /** Backward complex to real DFT of size n, from complex (n/2+1 values, overwritten) to real (n values) */
+    void createComplexToReal(int n, fftwf_complex* complex, float* real)
+    {
+        create(FftwPlanCache::Kind::complexToReal, n, real, complex);
+    }
+
+    /** Execute the transform on the arrays given at creation */
+    void execute() noexcept
+    {
+        jassert(this->plan != nullptr);
+        if (this->kind == FftwPlanCache::Kind::realToComplex)
+            fftwf_execute_dft_r2c(this->plan, this->real, this->complex);
+        else
+            fftwf_execute_dft_c2r(this->plan, this->complex, this->real);
+    }
+
+    /** Release the plan (it stays in the cache) */
+    void reset()
+    {
+        if (this->plan == nullptr)
+            return;
+        FftwPlanCache::getInstance().release(this->key);
+        this->plan = nullptr;
+    }
+
+    bool isValid() const noexcept { return this->plan != nullptr; }
+
+private:
+    void create(FftwPlanCache::Kind newKind, int n, float* newReal, fftwf_complex* newComplex)
+    {
+        reset();
+        this->key = FftwPlanCache::getInstance().acquire(newKind, n, newReal, newComplex, this->plan);
+        this->kind = newKind;
+        this->real = newReal;
+        this->complex = newComplex;
+    }
+
+    fftwf_plan plan = nullptr;
+    FftwPlanCache::Key key;
+    FftwPlanCache::Kind kind = FftwPlanCache::Kind::realToComplex;
+    float* real = nullptr;
+    fftwf_complex* complex = nullptr;
+};
+
+} // namespace tid
@@ -0,0 +1,206 @@
+/*
+
+tidFilterbank - Process-wide cache of triangular filterbanks
+Author: Domenico Stefani (domenico.stefani96@gmail.com)
+
+Every spectral module used to build its own filterbank, although modules with
+the same scale, spacing, window size and sample rate (e.g. BarkSpec, Bfcc and
+Bark at 0.5 Barks in the same plugin) have identical ones.
+FilterbankCache builds each filterbank once per process, keyed by
+(scale, spacing, window size, sample rate), with the weights of all the
+filters packed in one array (tIDLib::Filterbank), and modules share it,
+read-only, through SharedFilterbank handles. Changing the spacing back to a
+value used before does not build the filterbank again.
+
+Filterbanks no longer used by any handle stay in the cache until
+releaseUnused(), see tidWindowTable.hpp for the lifetime of the entries.
+
+*/
+#pragma once
+
+#include "tIDLib.hpp"
+#include "tidJuceCompat.hpp"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+
+namespace tid   /* TimbreID namespace*/
+{
+
+/** Frequency scale of the filter boundaries */
+enum class FilterbankScale
+{
+    bark,   // spacing in Barks (tIDLib::getBarkBoundFreqs)
+    mel     // spacing in mels (tIDLib::getMelBoundFreqs)
+};
+
+class SharedFilterbank;
+
+class FilterbankCache
+{
+public:
+    static FilterbankCache& getInstance()
+    {
+        static FilterbankCache instance;
+        return instance;
+    }
+
+    /** Number of filterbanks in the cache, in use or not */
+    size_t getNumFilterbanks()
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->filterbanks.size();
+    }
+
+    /** Bytes of the weights, filters and boundaries of all the filterbanks in the cache */
+    size_t getNumBytes()
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        size_t bytes = 0;
+        for (const auto& keyAndEntry : this->filterbanks)
+            bytes += keyAndEntry.second->filterbank.weights.size() * sizeof(float)
+                     + keyAndEntry.second->filterbank.filters.size() * sizeof(tIDLib::t_filter)
+                     + keyAndEntry.second->filterFreqs.size() * sizeof(float);
+        return bytes;
+    }
+
+    /**
+     * Free the filterbanks that no SharedFilterbank uses.
+     * Call it only when no module is processing audio with a filterbank it
+     * has just replaced (e.g. when the plugin is released).
+    */
+    void releaseUnused()
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        for (auto it = this->filterbanks.begin(); it != this->filterbanks.end();)
+        {
+            if (it->second->useCount == 0)
+                it = this->filterbanks.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    FilterbankCache(const FilterbankCache&) = delete;
+    FilterbankCache& operator=(const FilterbankCache&) = delete;
+
+private:
+    friend class SharedFilterbank;
+
+    // scale, spacing, window size, sample rate
+    using Key = std::tuple<FilterbankScale, float, unsigned long int, float>;
+
+    struct Entry
+    {
+        tIDLib::Filterbank filterbank;
+        std::vector<float> filterFreqs;   // filter boundaries, numFilters+2 values
+        size_t useCount = 0;
+    };
+
+    FilterbankCache() = default;
+
+    const Entry* acquire(const Key& key)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        auto it = this->filterbanks.find(key);
+        if (it == this->filterbanks.end())
+            it = this->filterbanks.emplace(key, createEntry(key)).first;
+        ++it->second->useCount;
+        return it->second.get();
+    }
+
+    void release(const Key& key)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        auto it = this->filterbanks.find(key);
+        if (it != this->filterbanks.end() && it->second->useCount > 0)
+            --it->second->useCount;
+    }
+
+    /** It throws like tIDLib::createFilterbank, before anything is added to the cache */
+    static std::unique_ptr<Entry> createEntry(const Key& key)
+    {
+        std::unique_ptr<Entry> entry(new Entry());
+        const float spacing = std::get<1>(key), sampleRate = std::get<3>(key);
+        const t_filterIdx sizeFilterFreqs = (std::get<0>(key) == FilterbankScale::bark)
+                                                ? tIDLib::getBarkBoundFreqs(entry->filterFreqs, spacing, sampleRate)
+                                                : tIDLib::getMelBoundFreqs(entry->filterFreqs, spacing, sampleRate);
+        // sizeFilterFreqs-2 filters, since we don't count the start point of the first filter, or the finish point of the last filter
+        tIDLib::createFilterbank(entry->filterFreqs, entry->filterbank, sizeFilterFreqs-2, (float)std::get<2>(key), sampleRate);
+        return entry;
+    }
+
+    std::mutex mutex;
+    std::map<Key, std::unique_ptr<Entry>> filterbanks;
+};
+
+/**
+ * Handle to a shared, read-only filterbank of FilterbankCache.
+ * Acquire it (not real-time safe) when the spacing, window size or sample rate
+ * change, and use it from the audio thread.
+*/
+class SharedFilterbank
+{
+public:
+    SharedFilterbank() = default;
+    ~SharedFilterbank() { reset(); }
+
+    SharedFilterbank(const SharedFilterbank&) = delete;
+    SharedFilterbank& operator=(const SharedFilterbank&) = delete;
+
+    /**
+     * Use the filterbank of a scale, spacing, window size and sample rate.
+     * If it throws (invalid spacing, too many filters for the window size),
+     * the handle keeps the previous filterbank.
+    */
+    void acquire(FilterbankScale scale, float spacing, unsigned long int windowSize, float sampleRate)
+    {
+        const FilterbankCache::Key newKey{scale, spacing, windowSize, sampleRate};
+        if (this->entry != nullptr && this->key == newKey)
+            return;
+
+        const FilterbankCache::Entry* newEntry = FilterbankCache::getInstance().acquire(newKey);
+        reset();
+        this->key = newKey;
+        this->entry = newEntry;
+    }
+
+    /** Release the filterbank (it stays in the cache) */
+    void reset()
+    {
+        if (this->entry == nullptr)
+            return;
+        FilterbankCache::getInstance().release(this->key);
+        this->entry = nullptr;
+    }
+
+    bool isValid() const noexcept { return this->entry != nullptr; }
+
+    /** The filters, for tIDLib::filterbankMultiply and the other filterbank functions */
+    const std::vector<tIDLib::t_filter>& getFilters() const noexcept
+    {
+        jassert(isValid());
+        return this->entry->filterbank.filters;
+    }
+
+    t_filterIdx getNumFilters() const noexcept
+    {
+        return isValid() ? (t_filterIdx)this->entry->filterbank.filters.size() : 0;
+    }
+
+    /** Filter boundaries in Hz, getNumFilters()+2 values */
+    const std::vector<float>& getFilterFreqs() const noexcept
+    {
+        jassert(isValid());
+        return this->entry->filterFreqs;
+    }
+
+private:
+    FilterbankCache::Key key{FilterbankScale::bark, 0.0f, 0, 0.0f};
+    const FilterbankCache::Entry* entry = nullptr;
+};
+
+} // namespace tid
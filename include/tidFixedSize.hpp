@@ -0,0 +1,349 @@
+/*
+
+tidFixedSize - Spectral modules with the window and block sizes fixed at compile time
+Author: Domenico Stefani (domenico.stefani96@gmail.com)
+
+The spectral modules (BarkSpec, BarkSpecBrightness, Bfcc, Cepstrum, Mfcc)
+take the window size and the block size as optional template parameters:
+    tid::Bfcc<float>            sizes given to the constructor and prepare()
+    tid::Bfcc<float, 1024, 64>  1024-sample window, 64-sample blocks
+    tid::Bfcc<float, 1024>      1024-sample window, block size given to prepare()
+With a fixed size (anything but tid::dynamicSize), AnalysisSizes gives the
+module:
+ - std::array storage (FixedBuffer, 64-byte aligned, inside the module) for
+   the signal buffer, the FFT input and the spectrum
+ - window tables computed at compile time (FixedWindowTable), with the same
+   values of the tables of WindowTableCache
+ - kernels (block store, windowing, power and magnitude spectrum) with
+   constant trip counts, that the compiler unrolls and vectorizes
+The window size given to the constructor and the block size given to
+prepare() must match the fixed ones (std::invalid_argument otherwise), and
+setWindowSize() only accepts the fixed window size.
+The filterbank still depends on the sample rate, known at prepare(), so the
+filter boundaries stay run-time values; the number of bins they index is fixed.
+
+*/
+#pragma once
+
+#include "tIDLib.hpp"
+#include "tidJuceCompat.hpp"
+#include "tidArena.hpp"
+#include "tidFft.hpp"
+#include "tidWindowTable.hpp"
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+
+namespace tid   /* TimbreID namespace*/
+{
+
+/** Size given at run time (default template argument of the spectral modules) */
+constexpr unsigned long int dynamicSize = 0;
+
+/**
+ * Buffer of N values inside the object (64-byte aligned), with the part of the
+ * std::vector interface used by the modules. Its size cannot change.
+*/
+template <typename T, size_t N>
+class FixedBuffer
+{
+public:
+    FixedBuffer() noexcept { this->values.fill(T{0}); }
+
+    static constexpr size_t size() noexcept { return N; }
+
+    /** The size is fixed, n has to be N */
+    void resize(size_t n) noexcept
+    {
+        jassert(n == N);
+        (void)n;
+    }
+
+    void assign(size_t n, const T& value) noexcept
+    {
+        resize(n);
+        this->values.fill(value);
+    }
+
+    T* data() noexcept { return this->values.data(); }
+    const T* data() const noexcept { return this->values.data(); }
+    T& operator[](size_t i) noexcept { return this->values[i]; }
+    const T& operator[](size_t i) const noexcept { return this->values[i]; }
+    T* begin() noexcept { return this->values.data(); }
+    T* end() noexcept { return this->values.data() + N; }
+
+private:
+    alignas(Arena::ALIGNMENT) std::array<T, N> values;
+};
+
+namespace fft
+{
+/** Spectrum buffer of a fixed-size module (2n floats, zeroed) */
+template <size_t N>
+inline Complex* resizeComplex(FixedBuffer<float, N>& buffer, size_t n)
+{
+    buffer.assign(2 * n, 0.0f);
+    return reinterpret_cast<Complex*>(buffer.data());
+}
+} // namespace fft
+
+namespace fixed
+{
+/**
+ * Cosine and sine for the window tables, evaluated at compile time.
+ * The argument (0 to 4*pi) is reduced to [-pi/4, pi/4] with pi/2 split in two
+ * parts, and the Taylor series are summed to the double precision.
+*/
+constexpr double PIO2_HI = 1.57079632673412561417e+00;   // first 33 bits of pi/2
+constexpr double PIO2_LO = 6.07710050650619224932e-11;   // pi/2 - PIO2_HI
+
+constexpr double sinSeries(double r)
+{
+    const double r2 = r * r;
+    double term = r, sum = r;
+    for (int k = 1; k <= 12; ++k)
+    {
+        term *= -r2 / ((2.0 * k) * (2.0 * k + 1.0));
+        sum += term;
+    }
+    return sum;
+}
+
+constexpr double cosSeries(double r)
+{
+    const double r2 = r * r;
+    double term = 1.0, sum = 1.0;
+    for (int k = 1; k <= 12; ++k)
+    {
+        term *= -r2 / ((2.0 * k - 1.0) * (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+/** cos(x) for x >= 0 */
+constexpr double cos(double x)
+{
+    const long q = (long)(x / (PIO2_HI + PIO2_LO) + 0.5);
+    const double r = (x - q * PIO2_HI) - q * PIO2_LO;
+    switch (q % 4)
+    {
+        case 0:  return cosSeries(r);
+        case 1:  return -sinSeries(r);
+        case 2:  return -cosSeries(r);
+        default: return sinSeries(r);
+    }
+}
+
+/** sin(x) for x >= 0 */
+constexpr double sin(double x)
+{
+    const long q = (long)(x / (PIO2_HI + PIO2_LO) + 0.5);
+    const double r = (x - q * PIO2_HI) - q * PIO2_LO;
+    switch (q % 4)
+    {
+        case 0:  return sinSeries(r);
+        case 1:  return cosSeries(r);
+        case 2:  return -sinSeries(r);
+        default: return -cosSeries(r);
+    }
+}
+
+/** Window table of size N, with the expressions of tIDLib::initBlackmanWindow and the others */
+template <unsigned long int N>
+constexpr std::array<float, N> makeWindowTable(tIDLib::WindowFunctionType type)
+{
+    std::array<float, N> table{};
+    for (unsigned long int i = 0; i < N; ++i)
+    {
+        switch (type)
+        {
+            case tIDLib::WindowFunctionType::blackman:
+                table[i] = (float)(0.42f - (0.5f * fixed::cos(2.0f*M_PI*i/N)) + (0.08f * fixed::cos(4.0f*M_PI*i/N)));
+                break;
+            case tIDLib::WindowFunctionType::cosine:
+                table[i] = (float)fixed::sin(M_PI*i/N);
+                break;
+            case tIDLib::WindowFunctionType::hamming:
+                table[i] = (float)(0.5f - (0.46f * fixed::cos(2.0f*M_PI*i/N)));
+                break;
+            case tIDLib::WindowFunctionType::hann:
+                table[i] = (float)(0.5f * (1.0f - fixed::cos(2.0f*M_PI*i/N)));
+                break;
+            default:
+                table[i] = 1.0f;
+                break;
+        }
+    }
+    return table;
+}
+
+template <tIDLib::WindowFunctionType TYPE, unsigned long int N>
+struct WindowValues
+{
+    alignas(Arena::ALIGNMENT) static constexpr std::array<float, N> table = makeWindowTable<N>(TYPE);
+};
+
+/** Table of a window function computed at compile time, nullptr for the rectangular window */
+template <unsigned long int N>
+const float* getWindowTable(tIDLib::WindowFunctionType type)
+{
+    switch (type)
+    {
+        case tIDLib::WindowFunctionType::blackman: return WindowValues<tIDLib::WindowFunctionType::blackman, N>::table.data();
+        case tIDLib::WindowFunctionType::cosine:   return WindowValues<tIDLib::WindowFunctionType::cosine, N>::table.data();
+        case tIDLib::WindowFunctionType::hamming:  return WindowValues<tIDLib::WindowFunctionType::hamming, N>::table.data();
+        case tIDLib::WindowFunctionType::hann:     return WindowValues<tIDLib::WindowFunctionType::hann, N>::table.data();
+        case tIDLib::WindowFunctionType::rectangular: return nullptr;
+        default: throw std::invalid_argument("Invalid window function");
+    }
+}
+} // namespace fixed
+
+/** Window table of a fixed-size module, with the interface of WindowTable */
+template <unsigned long int N>
+class FixedWindowTable
+{
+public:
+    /** Use the table of a window function (size has to be N) */
+    void acquire(tIDLib::WindowFunctionType type, unsigned long int size)
+    {
+        if (size != N)
+            throw std::invalid_argument("The window size of this module is fixed to "+std::to_string(N)+" (found "+std::to_string(size)+" instead)");
+        this->table = fixed::getWindowTable<N>(type);
+        this->type = type;
+    }
+
+    void reset() noexcept { this->table = nullptr; }
+
+    /** Window values, nullptr for the rectangular window */
+    const float* data() const noexcept { return this->table; }
+
+    tIDLib::WindowFunctionType getType() const noexcept { return this->type; }
+    unsigned long int getSize() const noexcept { return N; }
+
+private:
+    tIDLib::WindowFunctionType type = tIDLib::WindowFunctionType::rectangular;
+    const float* table = nullptr;
+};
+
+/**
+ * Storage and kernels of a spectral module, for a window size and a block
+ * size that are either fixed (template arguments) or tid::dynamicSize.
+ * With dynamic sizes the kernels are the ones of tIDLib, on ArenaVectors.
+*/
+template <unsigned long int WINDOW_SIZE, unsigned int BLOCK_SIZE>
+struct AnalysisSizes
+{
+    static constexpr bool fixedWindow = WINDOW_SIZE != dynamicSize;
+    static constexpr bool fixedBlock = BLOCK_SIZE != dynamicSize;
+
+    static_assert(!fixedWindow || WINDOW_SIZE >= tIDLib::MINWINDOWSIZE, "The window size must be tIDLib::MINWINDOWSIZE or greater");
+
+    /** Window size of a module constructed without one */
+    static constexpr unsigned long int defaultWindowSize = fixedWindow ? WINDOW_SIZE : tIDLib::WINDOWSIZEDEFAULT;
+    /** Block size of a module not prepared yet */
+    static constexpr unsigned int defaultBlockSize = fixedBlock ? BLOCK_SIZE : tIDLib::BLOCKSIZEDEFAULT;
+
+    /** Signal buffer: window plus one block */
+    template <typename SampleType>
+    using SignalBuffer = typename std::conditional<fixedWindow && fixedBlock, FixedBuffer<SampleType, WINDOW_SIZE + BLOCK_SIZE>, ArenaVector<SampleType>>::type;
+    /** FFT input: one window */
+    using WindowBuffer = typename std::conditional<fixedWindow, FixedBuffer<float, WINDOW_SIZE>, ArenaVector<float>>::type;
+    /** FFT output: window/2+1 interleaved complex values */
+    using SpectrumBuffer = typename std::conditional<fixedWindow, FixedBuffer<float, 2 * (WINDOW_SIZE / 2 + 1)>, ArenaVector<float>>::type;
+    using Window = typename std::conditional<fixedWindow, FixedWindowTable<WINDOW_SIZE>, WindowTable>::type;
+
+    /** Throws if the window size does not match the fixed one */
+    static void checkWindowSize(unsigned long int windowSize)
+    {
+        if (fixedWindow && windowSize != WINDOW_SIZE)
+            throw std::invalid_argument("The window size of this module is fixed to "+std::to_string(WINDOW_SIZE)+" (found "+std::to_string(windowSize)+" instead)");
+    }
+
+    /** Throws if the block size does not match the fixed one */
+    static void checkBlockSize(unsigned int blockSize)
+    {
+        if (fixedBlock && blockSize != BLOCK_SIZE)
+            throw std::invalid_argument("The block size of this module is fixed to "+std::to_string(BLOCK_SIZE)+" (found "+std::to_string(blockSize)+" instead)");
+    }
+
+    /** Half the window size (the spectrum has getWindowHalf()+1 bins) */
+    static unsigned long int getWindowHalf(unsigned long int windowSize) noexcept
+    {
+        return fixedWindow ? WINDOW_SIZE / 2 : (unsigned long int)(windowSize * 0.5f);
+    }
+
+    /** Shift the signal buffer back by n samples and write the block at its end */
+    template <typename SampleType>
+    static void storeBlock(SampleType* signal, unsigned long int windowSize, const SampleType* input, size_t n) noexcept
+    {
+        if (fixedWindow && fixedBlock && n == BLOCK_SIZE)
+        {
+            std::copy(signal + BLOCK_SIZE, signal + BLOCK_SIZE + WINDOW_SIZE, signal);
+            std::copy(input, input + BLOCK_SIZE, signal + WINDOW_SIZE);
+            return;
+        }
+        if (fixedWindow)
+        {
+            std::copy(signal + n, signal + n + WINDOW_SIZE, signal);
+            std::copy(input, input + n, signal + WINDOW_SIZE);
+            return;
+        }
+        for (unsigned long int i = 0; i < windowSize; ++i)
+            signal[i] = signal[i + n];
+        for (unsigned long int i = 0; i < n; ++i)
+            signal[windowSize + i] = input[i];
+    }
+
+    /** tIDLib::windowCopy */
+    template <typename SampleType>
+    static void windowCopy(const SampleType* input, const float* window, float* output, unsigned long int n) noexcept
+    {
+        if (!fixedWindow)
+        {
+            tIDLib::windowCopy(input, window, output, n);
+            return;
+        }
+        jassert(n == WINDOW_SIZE);
+        if (window == nullptr)
+        {
+            for (unsigned long int i = 0; i < WINDOW_SIZE; ++i)
+                output[i] = (float)input[i];
+            return;
+        }
+        for (unsigned long int i = 0; i < WINDOW_SIZE; ++i)
+            output[i] = (float)input[i] * window[i];
+    }
+
+    /** tIDLib::power */
+    static void power(t_binIdx n, const fft::Complex* spectrum, float* powBuf) noexcept
+    {
+        if (!fixedWindow)
+        {
+            tIDLib::power(n, (void*)spectrum, powBuf);
+            return;
+        }
+        jassert(n == WINDOW_SIZE / 2 + 1);
+        const float* values = reinterpret_cast<const float*>(spectrum);
+        for (t_binIdx i = 0; i < WINDOW_SIZE / 2 + 1; ++i)
+            powBuf[i] = (values[2 * i] * values[2 * i]) + (values[2 * i + 1] * values[2 * i + 1]);
+    }
+
+    /** tIDLib::mag */
+    static void mag(t_binIdx n, float* input) noexcept
+    {
+        if (!fixedWindow)
+        {
+            tIDLib::mag(n, input);
+            return;
+        }
+        jassert(n == WINDOW_SIZE / 2 + 1);
+        for (t_binIdx i = 0; i < WINDOW_SIZE / 2 + 1; ++i)
+            input[i] = std::sqrt(input[i]);
+    }
+};
+
+} // namespace tid
@@ -0,0 +1,176 @@
+/*
+
+tidJuceCompat - JUCE dependency of the timbreID modules
+Author: Domenico Stefani (domenico.stefani96@gmail.com)
+
+By default the modules are compiled in a JUCE project and this header only
+includes <JuceHeader.h>.
+When TID_HEADLESS is defined to 1 (the CMake core library target does it),
+JUCE is not used at all and the small subset of its API that the modules
+use (integer typedefs, jassert, AudioBuffer, Time, ListenerList) is defined
+here, so that the same code runs in headless batch workers, unit tests and
+sanitizer builds. Bark uses tid::SampleClockTimer instead of juce::Timer.
+
+*/
+#pragma once
+
+#ifndef TID_HEADLESS
+#define TID_HEADLESS 0
+#endif
+
+#if !TID_HEADLESS
+
+#include <JuceHeader.h>
+
+#else
+
+#include <algorithm>
+#include <cassert>
+#include <chrono>
+#include <cstdint>
+#include <vector>
+
+namespace juce
+{
+
+using int8 = int8_t;
+using uint8 = uint8_t;
+using int16 = int16_t;
+using uint16 = uint16_t;
+using int32 = int32_t;
+using uint32 = uint32_t;
+using int64 = int64_t;
+using uint64 = uint64_t;
+
+#ifndef jassert
+#define jassert(expression) assert(expression)
+#endif
+#ifndef jassertfalse
+#define jassertfalse assert(false)
+#endif
+#ifndef JUCE_LEAK_DETECTOR
+#define JUCE_LEAK_DETECTOR(OwnerClass)
+#endif
+
+/** Multi-channel audio buffer, same interface as the subset of juce::AudioBuffer used by the modules */
+template <typename Type>
+class AudioBuffer
+{
+public:
+    AudioBuffer() {}
+
+    AudioBuffer(int numChannels, int numSamples)
+    {
+        setSize(numChannels, numSamples);
+    }
+
+    /** Non-owning buffer that refers to existing channel data */
+    AudioBuffer(Type* const* dataToReferTo, int numChannels, int numSamples)
+        : numChannels(numChannels), numSamples(numSamples), channels(dataToReferTo, dataToReferTo + numChannels)
+    {
+    }
+
+    void setSize(int newNumChannels, int newNumSamples)
+    {
+        this->numChannels = newNumChannels;
+        this->numSamples = newNumSamples;
+        this->allocatedData.assign((size_t)(newNumChannels * newNumSamples), Type(0));
+        this->channels.resize((size_t)newNumChannels);
+        for (int c = 0; c < newNumChannels; ++c)
+            this->channels[(size_t)c] = this->allocatedData.data() + (size_t)(c * newNumSamples);
+    }
+
+    int getNumChannels() const noexcept { return this->numChannels; }
+    int getNumSamples() const noexcept { return this->numSamples; }
+
+    const Type* getReadPointer(int channel) const noexcept
+    {
+        jassert(channel >= 0 && channel < this->numChannels);
+        return this->channels[(size_t)channel];
+    }
+
+    const Type* getReadPointer(int channel, int sampleIndex) const noexcept
+    {
+        jassert(sampleIndex >= 0 && sampleIndex < this->numSamples);
+        return getReadPointer(channel) + sampleIndex;
+    }
+
+    Type* getWritePointer(int channel, int sampleIndex = 0) noexcept
+    {
+        jassert(channel >= 0 && channel < this->numChannels);
+        return this->channels[(size_t)channel] + sampleIndex;
+    }
+
+    void clear() noexcept
+    {
+        for (int c = 0; c < this->numChannels; ++c)
+            std::fill(this->channels[(size_t)c], this->channels[(size_t)c] + this->numSamples, Type(0));
+    }
+
+private:
+    int numChannels = 0, numSamples = 0;
+    std::vector<Type*> channels;
+    std::vector<Type> allocatedData;
+};
+
+class Time
+{
+public:
+    /** Milliseconds since the epoch (not steady, like the JUCE version) */
+    static int64 currentTimeMillis() noexcept
+    {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::system_clock::now().time_since_epoch()).count();
+    }
+
+    static int64 getHighResolutionTicks() noexcept
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static int64 getHighResolutionTicksPerSecond() noexcept
+    {
+        return 1000000000;
+    }
+
+    static double getMillisecondCounterHiRes() noexcept
+    {
+        return getHighResolutionTicks() * 1.0e-6;
+    }
+};
+
+/** Listener list without the iteration safety of the JUCE version (listeners must not be removed during call()) */
+template <class ListenerClass>
+class ListenerList
+{
+public:
+    void add(ListenerClass* listenerToAdd)
+    {
+        if (listenerToAdd != nullptr && std::find(listeners.begin(), listeners.end(), listenerToAdd) == listeners.end())
+            listeners.push_back(listenerToAdd);
+    }
+
+    void remove(ListenerClass* listenerToRemove)
+    {
+        listeners.erase(std::remove(listeners.begin(), listeners.end(), listenerToRemove), listeners.end());
+    }
+
+    int size() const noexcept { return (int)listeners.size(); }
+
+    template <typename Callback>
+    void call(Callback&& callback)
+    {
+        for (ListenerClass* l : listeners)
+            callback(*l);
+    }
+
+private:
+    std::vector<ListenerClass*> listeners;
+};
+
+} // namespace juce
+
+using namespace juce;
+
+#endif
@@ -0,0 +1,394 @@
+/*
+
+tidMultiChannel - Shared building blocks of the multi-channel modules
+Author: Domenico Stefani (domenico.stefani96@gmail.com)
+
+The multi-channel modules (MultiBark, MultiBarkSpec, MultiBfcc,
+MultiZeroCrossing, MultiPeakSample) analyse up to tIDLib::INTERLEAVEDLANES
+channels (e.g. the six strings of a hexaphonic pickup) with one instance.
+Signals are stored channel-interleaved, sample t of channel c at
+[t*INTERLEAVEDLANES + c], so that the time-domain features and the
+filterbank run on all the channels at once, one SIMD lane per channel
+(tIDLib "multi-channel (interleaved) functions").
+The read-only tables (window function, filterbank, DCT basis, FFT tables)
+and the work buffers are shared by the channels of an instance. With the
+built-in FFT backend, power-of-two windows and at least
+MultiChannelBarkBands::MININTERLEAVEDFFTCHANNELS channels, the FFT runs on
+all the channels at once too (tid::fft::InterleavedRealFft), otherwise once
+per channel.
+
+ - InterleavedBlock:      interleaves the channels of an audio block once, to
+                          be stored into several modules
+ - InterleavedHistory:    the last samples of the channels, interleaved
+ - MultiChannelBarkBands: window, FFT and Bark filterbank of all the channels
+
+*/
+#pragma once
+
+#include "tidJuceCompat.hpp"
+#include "tIDLib.hpp"
+#include "tidFft.hpp"
+#include "tidWindowTable.hpp"
+#include "tidFilterbank.hpp"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static_assert(tid::fft::InterleavedRealFft::LANES == tIDLib::INTERLEAVEDLANES, "The interleaved FFT works on the lanes of the multi-channel modules");
+
+#if ASYNC_FEATURE_EXTRACTION
+#error "The multi-channel modules compute at FEATURE_EXTRACTION_OFFSET, they do not support ASYNC_FEATURE_EXTRACTION"
+#endif
+
+namespace tid   /* TimbreID namespace*/
+{
+
+/**
+ * Samples between the end of the analysis window of compute() and the last
+ * sample stored, as in the single-channel modules (FEATURE_EXTRACTION_OFFSET)
+*/
+inline size_t getFeatureExtractionLag(unsigned int blockSize) noexcept
+{
+    return blockSize - (unsigned int)(tIDLib::FEATURE_EXTRACTION_OFFSET * (double)blockSize);
+}
+
+/**
+ * Audio block of up to tIDLib::INTERLEAVEDLANES channels, interleaved.
+ * Fill it once per block and pass it to the store() of every multi-channel module.
+*/
+class InterleavedBlock
+{
+public:
+    static constexpr unsigned int LANES = tIDLib::INTERLEAVEDLANES;
+
+    /** Allocate the block (not real-time safe) */
+    void prepare(unsigned int numChannels, size_t blockSize)
+    {
+        checkNumChannels(numChannels);
+        this->numChannels = numChannels;
+        this->frames.assign(blockSize * LANES, 0.0f);
+        this->numFrames = 0;
+    }
+
+    /**
+     * Interleave n samples of each channel, channels[0 ... getNumChannels()-1]
+     * @param n number of samples, at most the block size given to prepare()
+    */
+    template <typename SampleType>
+    void interleave(const SampleType* const* channels, size_t n) noexcept
+    {
+        jassert(n * LANES <= this->frames.size());
+        n = std::min(n, this->frames.size() / LANES);
+        for (unsigned int c = 0; c < this->numChannels; ++c)
+        {
+            const SampleType* input = channels[c];
+            for (size_t t = 0; t < n; ++t)
+                this->frames[t * LANES + c] = (float)input[t];
+        }
+        this->numFrames = n;
+    }
+
+    /** Interleave the channels firstChannel ... firstChannel+getNumChannels()-1 of an audio buffer */
+    template <typename SampleType>
+    void interleave(const AudioBuffer<SampleType>& buffer, int firstChannel)
+    {
+        if (firstChannel < 0 || firstChannel + (int)this->numChannels > buffer.getNumChannels())
+            throw std::invalid_argument("Channels " + std::to_string(firstChannel) + " to " + std::to_string(firstChannel + (int)this->numChannels - 1)
+                                        + " are not in the buffer (" + std::to_string(buffer.getNumChannels()) + " channels)");
+        const SampleType* channels[LANES];
+        for (unsigned int c = 0; c < this->numChannels; ++c)
+            channels[c] = buffer.getReadPointer(firstChannel + (int)c);
+        interleave(channels, (size_t)buffer.getNumSamples());
+    }
+
+    const float* getFrames() const noexcept { return this->frames.data(); }
+    size_t getNumFrames() const noexcept { return this->numFrames; }
+    unsigned int getNumChannels() const noexcept { return this->numChannels; }
+
+    static void checkNumChannels(unsigned int numChannels)
+    {
+        if (numChannels < 1 || numChannels > LANES)
+            throw std::invalid_argument("Number of channels must be between 1 and " + std::to_string(LANES) + " (found " + std::to_string(numChannels) + " instead)");
+    }
+
+private:
+    unsigned int numChannels = 1;
+    size_t numFrames = 0;
+    std::vector<float> frames;
+};
+
+/**
+ * The last samples of up to tIDLib::INTERLEAVEDLANES channels, in a circular
+ * buffer of interleaved frames. Nothing allocates after setLength().
+*/
+class InterleavedHistory
+{
+public:
+    static constexpr unsigned int LANES = tIDLib::INTERLEAVEDLANES;
+
+    /** Keep the last length frames (not real-time safe), all zeros */
+    void setLength(size_t length)
+    {
+        this->frames.assign(std::max<size_t>(length, 1) * LANES, 0.0f);
+        this->writeIndex = 0;
+    }
+
+    size_t getLength() const noexcept { return this->frames.size() / LANES; }
+
+    void clear() noexcept
+    {
+        std::fill(this->frames.begin(), this->frames.end(), 0.0f);
+        this->writeIndex = 0;
+    }
+
+    /** Append n interleaved frames (n at most getLength()) */
+    void push(const float* input, size_t n) noexcept
+    {
+        jassert(n <= getLength());
+        const size_t length = getLength();
+        while (n > 0)
+        {
+            const size_t count = std::min(n, length - this->writeIndex);
+            std::copy(input, input + count * LANES, this->frames.begin() + this->writeIndex * LANES);
+            input += count * LANES;
+            n -= count;
+            this->writeIndex = (this->writeIndex + count) % length;
+        }
+    }
+
+    /**
+     * Copy the first numLanes lanes of the numSamples frames that end lag
+     * frames before the last one pushed (lag + numSamples at most getLength()),
+     * multiplied by a window
+     * @param window numSamples values, nullptr for the rectangular window
+     * @param output numSamples x numLanes interleaved values
+    */
+    void copyFrames(size_t lag, size_t numSamples, const float* window, float* output, size_t numLanes) const noexcept
+    {
+        jassert(lag + numSamples <= getLength() && numLanes <= LANES);
+        const size_t length = getLength();
+        size_t index = (this->writeIndex + length - (lag + numSamples) % length) % length;
+        for (size_t i = 0; i < numSamples;)
+        {
+            const size_t count = std::min(numSamples - i, length - index);
+            const float* source = this->frames.data() + index * LANES;
+            float* destination = output + i * numLanes;
+            for (size_t k = 0; k < count; ++k)
+            {
+                const float gain = (window != nullptr) ? window[i + k] : 1.0f;
+                for (size_t c = 0; c < numLanes; ++c)
+                    destination[k * numLanes + c] = source[k * LANES + c] * gain;
+            }
+            i += count;
+            index = 0;
+        }
+    }
+
+    /**
+     * Copy one channel of the numSamples frames that end lag frames before the
+     * last one pushed (lag + numSamples at most getLength()), multiplied by a window
+     * @param window numSamples values, nullptr for the rectangular window
+    */
+    void copyChannel(unsigned int channel, size_t lag, size_t numSamples, const float* window, float* output) const noexcept
+    {
+        jassert(lag + numSamples <= getLength());
+        const size_t length = getLength();
+        size_t index = (this->writeIndex + length - (lag + numSamples) % length) % length;
+        for (size_t i = 0; i < numSamples;)
+        {
+            const size_t count = std::min(numSamples - i, length - index);
+            const float* source = this->frames.data() + index * LANES + channel;
+            if (window != nullptr)
+                for (size_t k = 0; k < count; ++k)
+                    output[i + k] = source[k * LANES] * window[i + k];
+            else
+                for (size_t k = 0; k < count; ++k)
+                    output[i + k] = source[k * LANES];
+            i += count;
+            index = 0;
+        }
+    }
+
+private:
+    std::vector<float> frames;
+    size_t writeIndex = 0;  // frame written by the next push
+};
+
+/**
+ * Window, FFT and Bark spaced triangular filterbank of the same analysis
+ * window in all the channels.
+ * One window table, FFT, spectrum buffer and filterbank serve all the
+ * channels. With the built-in backend, a power-of-two window and at least
+ * MININTERLEAVEDFFTCHANNELS channels, the interleaved frames are windowed
+ * and transformed together, one SIMD lane per channel
+ * (tid::fft::InterleavedRealFft, with the arithmetic of the backend), into
+ * an interleaved matrix of spectra. Otherwise each channel is transformed in
+ * turn by the FFT backend (FFTW has its own SIMD transforms, and one or two
+ * channels would leave most of the lanes of the interleaved FFT empty).
+ * The filterbank runs on all the channels at once
+ * (tIDLib::filterbankMultiplyInterleaved).
+*/
+class MultiChannelBarkBands
+{
+public:
+    static constexpr unsigned int LANES = tIDLib::INTERLEAVEDLANES;
+    static constexpr unsigned int MININTERLEAVEDFFTCHANNELS = 3;
+
+    MultiChannelBarkBands() = default;
+    ~MultiChannelBarkBands() { freeMem(); }
+
+    MultiChannelBarkBands(const MultiChannelBarkBands&) = delete;
+    MultiChannelBarkBands& operator=(const MultiChannelBarkBands&) = delete;
+
+    /**
+     * Allocate the buffers, the tables and the plan (not real-time safe)
+     * @param historyLength frames kept in the history, at least analysisWindowSize
+    */
+    void setup(unsigned int numChannels, unsigned long int analysisWindowSize, float barkSpacing, double sampleRate, size_t historyLength)
+    {
+        InterleavedBlock::checkNumChannels(numChannels);
+        if (analysisWindowSize < tIDLib::MINWINDOWSIZE)
+            throw std::invalid_argument("Window size must be "+std::to_string(tIDLib::MINWINDOWSIZE)+" or greater.");
+        if (barkSpacing < tIDLib::MINBARKSPACING || barkSpacing > tIDLib::MAXBARKSPACING)
+            throw std::invalid_argument("Bark spacing must be between "+std::to_string(tIDLib::MINBARKSPACING)+" and "+std::to_string(tIDLib::MAXBARKSPACING)+" Barks");
+
+        this->numChannels = numChannels;
+        this->analysisWindowSize = analysisWindowSize;
+        this->barkSpacing = barkSpacing;
+        this->sampleRate = sampleRate;
+        this->history.setLength(std::max<size_t>(historyLength, analysisWindowSize));
+
+        freeMem();
+        this->interleavedFft = (TID_FFT_BACKEND == TID_FFT_BACKEND_BUILTIN) && numChannels >= MININTERLEAVEDFFTCHANNELS
+                               && fft::InterleavedRealFft::isSupportedSize(analysisWindowSize);
+        if (this->interleavedFft)
+        {
+            this->multiFft.prepare(analysisWindowSize, numChannels);
+            this->fftFrames.assign(analysisWindowSize * this->multiFft.getNumLanes(), 0.0f);
+            this->fftIn.clear();
+        }
+        else
+        {
+            this->fftFrames.clear();
+            this->fftIn.assign(analysisWindowSize, 0.0f);
+            this->fftOut = fft::allocComplex(analysisWindowSize/2 + 1);
+            this->fftPlan.createRealToComplex((int)analysisWindowSize, this->fftIn.data(), this->fftOut);
+            std::fill(this->fftIn.begin(), this->fftIn.end(), 0.0f);
+        }
+        this->spectra.assign((analysisWindowSize/2 + 1) * LANES, 0.0f);
+
+        initWindow();
+
+        this->filterbank.acquire(FilterbankScale::bark, barkSpacing, analysisWindowSize, (float)sampleRate);
+        this->numFilters = this->filterbank.getNumFilters();
+        this->bands.assign((size_t)this->numFilters * LANES, 0.0f);
+    }
+
+    /** Set the window function (allocates the table of the new function) */
+    void setWindowFunction(tIDLib::WindowFunctionType func)
+    {
+        this->windowFunction = func;
+        initWindow();
+    }
+
+    void setSpectrumType(tIDLib::SpectrumType spec) noexcept { this->spectrumType = spec; }
+    void setNormalize(bool norm) noexcept { this->normalize = norm; }
+    void setFilterOperation(tIDLib::FilterOperation operationType) noexcept { this->filterOperation = operationType; }
+
+    tIDLib::WindowFunctionType getWindowFunction() const noexcept { return this->windowFunction; }
+    tIDLib::SpectrumType getSpectrumType() const noexcept { return this->spectrumType; }
+    bool getNormalize() const noexcept { return this->normalize; }
+    tIDLib::FilterOperation getFilterOperation() const noexcept { return this->filterOperation; }
+
+    unsigned int getNumChannels() const noexcept { return this->numChannels; }
+    unsigned long int getWindowSize() const noexcept { return this->analysisWindowSize; }
+    float getBarkSpacing() const noexcept { return this->barkSpacing; }
+    t_filterIdx getNumFilters() const noexcept { return this->numFilters; }
+    const std::vector<float>& getFilterFreqs() const noexcept { return this->filterbank.getFilterFreqs(); }
+
+    /** Zeros in the history of all the channels */
+    void clear() noexcept { this->history.clear(); }
+
+    /** Append n interleaved frames to the history */
+    void push(const float* frames, size_t n) noexcept { this->history.push(frames, n); }
+
+    /**
+     * Band energies of the analysis window that ends lag frames before the last
+     * frame pushed, in all the channels
+     * @return numFilters x LANES interleaved energies, valid until the next call
+    */
+    const float* compute(size_t lag) noexcept
+    {
+        const unsigned long int windowHalf = this->analysisWindowSize/2;
+        const float* window = this->windowTable.data();
+        const bool magnitude = (this->spectrumType == tIDLib::SpectrumType::magnitudeSpectrum);
+
+        if (this->interleavedFft)
+        {
+            // windowing fused with the copy of the frames, then the FFT of all the channels
+            this->history.copyFrames(lag, this->analysisWindowSize, window, this->fftFrames.data(), this->multiFft.getNumLanes());
+            this->multiFft.forwardPower(this->fftFrames.data(), this->spectra.data(), magnitude);
+        }
+        else
+        {
+            float* in = this->fftIn.data();
+            for (unsigned int c = 0; c < this->numChannels; ++c)
+            {
+                // windowing fused with the copy of the channel
+                this->history.copyChannel(c, lag, this->analysisWindowSize, window, in);
+                this->fftPlan.execute();
+
+                tIDLib::power(windowHalf+1, this->fftOut, in);
+                if (magnitude)
+                    tIDLib::mag(windowHalf+1, in);
+
+                for (unsigned long int j = 0; j <= windowHalf; ++j)
+                    this->spectra[j * LANES + c] = in[j];
+            }
+        }
+
+        tIDLib::filterbankMultiplyInterleaved(this->spectra.data(), this->bands.data(), this->normalize,
+                                              this->filterOperation, this->filterbank.getFilters(), this->numFilters);
+        return this->bands.data();
+    }
+
+private:
+    void initWindow()
+    {
+        this->windowTable.acquire(this->windowFunction, this->analysisWindowSize);
+    }
+
+    void freeMem()
+    {
+        this->fftPlan.reset();
+        if (this->fftOut != nullptr)
+            fft::freeComplex(this->fftOut);
+        this->fftOut = nullptr;
+    }
+
+    unsigned int numChannels = 1;
+    unsigned long int analysisWindowSize = tIDLib::WINDOWSIZEDEFAULT;
+    float barkSpacing = tIDLib::BARKSPACINGDEFAULT;
+    double sampleRate = tIDLib::SAMPLERATEDEFAULT;
+
+    tIDLib::WindowFunctionType windowFunction = tIDLib::WindowFunctionType::blackman;
+    tIDLib::SpectrumType spectrumType = tIDLib::SpectrumType::powerSpectrum;
+    tIDLib::FilterOperation filterOperation = tIDLib::FilterOperation::sumFilterEnergy;
+    bool normalize = false;
+
+    InterleavedHistory history;
+    WindowTable windowTable;            // shared table of the window function in use
+    bool interleavedFft = false;        // all the channels in one FFT (see the class comment)
+    std::vector<float> fftFrames;       // windowed frames, windowSize x the lanes of multiFft
+    fft::InterleavedRealFft multiFft;
+    std::vector<float> fftIn;           // other window sizes: shared by the channels, one FFT at a time
+    fft::Complex* fftOut = nullptr;
+    FftPlan fftPlan;
+    std::vector<float> spectra;         // (windowSize/2+1) x LANES
+    SharedFilterbank filterbank;        // shared, read-only
+    t_filterIdx numFilters = 0;
+    std::vector<float> bands;           // numFilters x LANES
+};
+
+} // namespace tid
@@ -0,0 +1,435 @@
+/*
+
+tidNN - Small dependency-free neural network inference for timbreID classifiers
+Author: Domenico Stefani (domenico.stefani96@gmail.com)
+
+Compile-time sized Dense and Conv1D layers with fused activations, meant for
+the small MLP/CNN models used on the feature matrices of the demos.
+- All the sizes are template parameters, weights and intermediate buffers are
+  members of the model, so forward() never allocates (allocate the Model itself
+  on the heap, since it can be large)
+- The inner kernel is a dot product with SSE/AVX (x86) or NEON (ARM) versions
+- Data is channels-last: a 2D input of nRows x nCols is nRows time steps with
+  nCols channels, so a Conv1D output can be fed to a Dense layer as is (Flatten)
+
+Weights are given in Keras order (Dense kernel [in][out], Conv1D kernel
+[kernelSize][in][out]) either with Model::setLayerWeights or with the binary
+format read by Model::loadBinary:
+
+    char     magic[4]      "TIDN"
+    uint32   version       1
+    uint32   numLayers
+    for each layer:
+        uint32  numWeights
+        uint32  numBiases
+        float32 weights[numWeights]   (Keras order)
+        float32 biases[numBiases]
+
+All values are little-endian.
+
+Requires C++17, include it directly (it is not part of juce_timbreID.h).
+
+*/
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <initializer_list>
+#include <istream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#if defined(__AVX__) || defined(__SSE__) || defined(_M_X64)
+#include <immintrin.h>
+#define TIDNN_USE_SSE 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define TIDNN_USE_NEON 1
+#endif
+
+namespace tid   /* TimbreID namespace*/
+{
+namespace nn
+{
+
+//==============================================================================
+// Kernels
+
+/** Scalar dot product, used for the tails and as a reference */
+inline float dotScalar(const float *a, const float *b, std::size_t n)
+{
+    float sum = 0.0f;
+    for (std::size_t i = 0; i < n; ++i)
+        sum += a[i] * b[i];
+    return sum;
+}
+
+/** Dot product of two float arrays of length n (no alignment required) */
+inline float dot(const float *a, const float *b, std::size_t n)
+{
+    std::size_t i = 0;
+#if defined(__AVX__)
+    __m256 acc0 = _mm256_setzero_ps(), acc1 = _mm256_setzero_ps();
+    for (; i + 16 <= n; i += 16)
+    {
+        acc0 = _mm256_add_ps(acc0, _mm256_mul_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i)));
+        acc1 = _mm256_add_ps(acc1, _mm256_mul_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8)));
+    }
+    acc0 = _mm256_add_ps(acc0, acc1);
+    __m128 acc = _mm_add_ps(_mm256_castps256_ps128(acc0), _mm256_extractf128_ps(acc0, 1));
+    for (; i + 4 <= n; i += 4)
+        acc = _mm_add_ps(acc, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    acc = _mm_add_ps(acc, _mm_movehl_ps(acc, acc));
+    acc = _mm_add_ss(acc, _mm_shuffle_ps(acc, acc, 1));
+    float sum = _mm_cvtss_f32(acc);
+#elif defined(TIDNN_USE_SSE)
+    __m128 acc0 = _mm_setzero_ps(), acc1 = _mm_setzero_ps();
+    for (; i + 8 <= n; i += 8)
+    {
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        acc1 = _mm_add_ps(acc1, _mm_mul_ps(_mm_loadu_ps(a + i + 4), _mm_loadu_ps(b + i + 4)));
+    }
+    for (; i + 4 <= n; i += 4)
+        acc0 = _mm_add_ps(acc0, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+    acc0 = _mm_add_ps(acc0, acc1);
+    acc0 = _mm_add_ps(acc0, _mm_movehl_ps(acc0, acc0));
+    acc0 = _mm_add_ss(acc0, _mm_shuffle_ps(acc0, acc0, 1));
+    float sum = _mm_cvtss_f32(acc0);
+#elif defined(TIDNN_USE_NEON)
+    float32x4_t acc0 = vdupq_n_f32(0.0f), acc1 = vdupq_n_f32(0.0f);
+    for (; i + 8 <= n; i += 8)
+    {
+        acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+        acc1 = vmlaq_f32(acc1, vld1q_f32(a + i + 4), vld1q_f32(b + i + 4));
+    }
+    for (; i + 4 <= n; i += 4)
+        acc0 = vmlaq_f32(acc0, vld1q_f32(a + i), vld1q_f32(b + i));
+    acc0 = vaddq_f32(acc0, acc1);
+    float32x2_t half = vadd_f32(vget_low_f32(acc0), vget_high_f32(acc0));
+    float sum = vget_lane_f32(vpadd_f32(half, half), 0);
+#else
+    float sum = 0.0f;
+#endif
+    return sum + dotScalar(a + i, b + i, n - i);
+}
+
+//==============================================================================
+// Activations (applied in place to the output of a layer)
+
+struct Identity
+{
+    static constexpr const char *name = "linear";
+    static void apply(float *, std::size_t) {}
+};
+
+struct ReLU
+{
+    static constexpr const char *name = "relu";
+    static void apply(float *x, std::size_t n)
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            x[i] = x[i] > 0.0f ? x[i] : 0.0f;
+    }
+};
+
+struct Tanh
+{
+    static constexpr const char *name = "tanh";
+    static void apply(float *x, std::size_t n)
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            x[i] = std::tanh(x[i]);
+    }
+};
+
+struct Sigmoid
+{
+    static constexpr const char *name = "sigmoid";
+    static void apply(float *x, std::size_t n)
+    {
+        for (std::size_t i = 0; i < n; ++i)
+            x[i] = 1.0f / (1.0f + std::exp(-x[i]));
+    }
+};
+
+struct Softmax
+{
+    static constexpr const char *name = "softmax";
+    static void apply(float *x, std::size_t n)
+    {
+        const float maxValue = *std::max_element(x, x + n);
+        float sum = 0.0f;
+        for (std::size_t i = 0; i < n; ++i)
+        {
+            x[i] = std::exp(x[i] - maxValue);
+            sum += x[i];
+        }
+        for (std::size_t i = 0; i < n; ++i)
+            x[i] /= sum;
+    }
+};
+
+//==============================================================================
+// Layers
+
+/** Description of a layer, to check an exported model against the compile-time one */
+struct LayerInfo
+{
+    const char *type;         // "dense" or "conv1d"
+    const char *activation;   // name of the activation
+    std::size_t inSize, outSize;
+    std::size_t outChannels;  // units of a Dense layer
+    std::size_t kernelSize;   // 1 for a Dense layer
+};
+
+/**
+ * Fully connected layer: output = activation(W * input + bias)
+ */
+template <std::size_t IN_SIZE, std::size_t OUT_SIZE, typename Activation = Identity>
+class Dense
+{
+public:
+    static constexpr std::size_t inSize = IN_SIZE;
+    static constexpr std::size_t outSize = OUT_SIZE;
+    static constexpr std::size_t numWeights = IN_SIZE * OUT_SIZE;
+    static constexpr std::size_t numBiases = OUT_SIZE;
+
+    static constexpr LayerInfo info() { return {"dense", Activation::name, IN_SIZE, OUT_SIZE, OUT_SIZE, 1}; }
+
+    /** Set weights from a Keras kernel ([IN_SIZE][OUT_SIZE]) and bias ([OUT_SIZE]) */
+    void setWeights(const float *kernel, const float *bias)
+    {
+        // Transposed so that each output is a contiguous dot product
+        for (std::size_t i = 0; i < IN_SIZE; ++i)
+            for (std::size_t o = 0; o < OUT_SIZE; ++o)
+                this->weights[o * IN_SIZE + i] = kernel[i * OUT_SIZE + o];
+        std::copy(bias, bias + OUT_SIZE, this->bias);
+    }
+
+    void forward(const float *input, float *output) const
+    {
+        for (std::size_t o = 0; o < OUT_SIZE; ++o)
+            output[o] = this->bias[o] + dot(&this->weights[o * IN_SIZE], input, IN_SIZE);
+        Activation::apply(output, OUT_SIZE);
+    }
+
+private:
+    alignas(32) float weights[OUT_SIZE * IN_SIZE] = {};
+    alignas(32) float bias[OUT_SIZE] = {};
+};
+
+/**
+ * 1D convolution (valid padding, stride 1) on a channels-last input of
+ * IN_LENGTH x IN_CHANNELS, with output (IN_LENGTH-KERNEL_SIZE+1) x OUT_CHANNELS
+ */
+template <std::size_t IN_LENGTH, std::size_t IN_CHANNELS, std::size_t OUT_CHANNELS, std::size_t KERNEL_SIZE,
+          typename Activation = Identity>
+class Conv1D
+{
+public:
+    static_assert(KERNEL_SIZE <= IN_LENGTH, "Conv1D kernel is longer than the input");
+    static constexpr std::size_t outLength = IN_LENGTH - KERNEL_SIZE + 1;
+    static constexpr std::size_t inSize = IN_LENGTH * IN_CHANNELS;
+    static constexpr std::size_t outSize = outLength * OUT_CHANNELS;
+    static constexpr std::size_t numWeights = KERNEL_SIZE * IN_CHANNELS * OUT_CHANNELS;
+    static constexpr std::size_t numBiases = OUT_CHANNELS;
+
+    static constexpr LayerInfo info() { return {"conv1d", Activation::name, inSize, outSize, OUT_CHANNELS, KERNEL_SIZE}; }
+
+    /** Set weights from a Keras kernel ([KERNEL_SIZE][IN_CHANNELS][OUT_CHANNELS]) and bias ([OUT_CHANNELS]) */
+    void setWeights(const float *kernel, const float *bias)
+    {
+        // Stored as [OUT_CHANNELS][KERNEL_SIZE*IN_CHANNELS]: with channels-last data the receptive
+        // field of an output step is contiguous, so every output value is a single dot product
+        for (std::size_t k = 0; k < KERNEL_SIZE; ++k)
+            for (std::size_t c = 0; c < IN_CHANNELS; ++c)
+                for (std::size_t o = 0; o < OUT_CHANNELS; ++o)
+                    this->weights[o * FIELD_SIZE + k * IN_CHANNELS + c] =
+                        kernel[(k * IN_CHANNELS + c) * OUT_CHANNELS + o];
+        std::copy(bias, bias + OUT_CHANNELS, this->bias);
+    }
+
+    void forward(const float *input, float *output) const
+    {
+        for (std::size_t t = 0; t < outLength; ++t)
+            for (std::size_t o = 0; o < OUT_CHANNELS; ++o)
+                output[t * OUT_CHANNELS + o] =
+                    this->bias[o] + dot(&this->weights[o * FIELD_SIZE], &input[t * IN_CHANNELS], FIELD_SIZE);
+        Activation::apply(output, outSize);
+    }
+
+private:
+    static constexpr std::size_t FIELD_SIZE = KERNEL_SIZE * IN_CHANNELS;
+    alignas(32) float weights[OUT_CHANNELS * FIELD_SIZE] = {};
+    alignas(32) float bias[OUT_CHANNELS] = {};
+};
+
+//==============================================================================
+// Model
+
+/**
+ * Sequential model of compile-time sized layers.
+ * Intermediate results are kept in two preallocated ping-pong buffers.
+ */
+template <typename... Layers>
+class Model
+{
+public:
+    static constexpr std::size_t numLayers = sizeof...(Layers);
+    static_assert(numLayers > 0, "A Model needs at least one layer");
+
+    template <std::size_t I>
+    using LayerType = typename std::tuple_element<I, std::tuple<Layers...>>::type;
+
+    static constexpr std::size_t inSize = LayerType<0>::inSize;
+    static constexpr std::size_t outSize = LayerType<numLayers - 1>::outSize;
+
+    Model() { checkSizes<0>(); }
+
+    template <std::size_t I>
+    LayerType<I> &getLayer() { return std::get<I>(this->layers); }
+
+    /**
+     * Type, activation and sizes of layer layerIdx
+     * @throws std::invalid_argument if the index is out of range
+     */
+    static LayerInfo getLayerInfo(std::size_t layerIdx)
+    {
+        static constexpr LayerInfo infos[] = {Layers::info()...};
+        if (layerIdx >= numLayers)
+            throw std::invalid_argument("tid::nn::Model: layer index " + std::to_string(layerIdx) +
+                                        " out of range (model has " + std::to_string(numLayers) + " layers)");
+        return infos[layerIdx];
+    }
+
+    /** Run inference, input has inSize floats and output has outSize floats. Real-time safe. */
+    void forward(const float *input, float *output)
+    {
+        this->forwardFrom<0>(input, output);
+    }
+
+    /**
+     * Set the weights of layer layerIdx (Keras order, see the layer classes)
+     * @throws std::invalid_argument if the index or the sizes do not match the model
+     */
+    void setLayerWeights(std::size_t layerIdx, const std::vector<float> &weights, const std::vector<float> &biases)
+    {
+        if (layerIdx >= numLayers)
+            throw std::invalid_argument("tid::nn::Model: layer index " + std::to_string(layerIdx) +
+                                        " out of range (model has " + std::to_string(numLayers) + " layers)");
+        this->setLayerWeightsImpl<0>(layerIdx, weights, biases);
+    }
+
+    /**
+     * Load all the weights from the binary format described at the top of tidNN.hpp
+     * @throws std::invalid_argument if the stream is malformed or does not match the model
+     */
+    void loadBinary(std::istream &stream)
+    {
+        char magic[4];
+        stream.read(magic, 4);
+        if (!stream || std::memcmp(magic, "TIDN", 4) != 0)
+            throw std::invalid_argument("tid::nn::Model: not a tidNN binary model");
+        const uint32_t version = readUint32(stream);
+        if (version != 1)
+            throw std::invalid_argument("tid::nn::Model: unsupported binary version " + std::to_string(version));
+        const uint32_t fileLayers = readUint32(stream);
+        if (fileLayers != numLayers)
+            throw std::invalid_argument("tid::nn::Model: binary has " + std::to_string(fileLayers) +
+                                        " layers, model has " + std::to_string(numLayers));
+
+        std::vector<float> weights, biases;
+        for (std::size_t l = 0; l < numLayers; ++l)
+        {
+            // check the counts before allocating, a corrupt file could ask for gigabytes
+            const uint32_t numWeights = readUint32(stream);
+            const uint32_t numBiases = readUint32(stream);
+            checkLayerSizes(l, numWeights, numBiases);
+            weights.resize(numWeights);
+            biases.resize(numBiases);
+            stream.read(reinterpret_cast<char *>(weights.data()), weights.size() * sizeof(float));
+            stream.read(reinterpret_cast<char *>(biases.data()), biases.size() * sizeof(float));
+            if (!stream)
+                throw std::invalid_argument("tid::nn::Model: truncated binary model");
+            this->setLayerWeights(l, weights, biases);
+        }
+    }
+
+private:
+    static constexpr std::size_t maxOf(std::initializer_list<std::size_t> values)
+    {
+        std::size_t res = 0;
+        for (std::size_t v : values)
+            res = v > res ? v : res;
+        return res;
+    }
+    static constexpr std::size_t BUFFER_SIZE = maxOf({Layers::outSize...});
+
+    template <std::size_t I>
+    static constexpr void checkSizes()
+    {
+        if constexpr (I + 1 < numLayers)
+        {
+            static_assert(LayerType<I>::outSize == LayerType<I + 1>::inSize,
+                          "tid::nn::Model: output size of a layer does not match the input of the next one");
+            checkSizes<I + 1>();
+        }
+    }
+
+    template <std::size_t I>
+    void forwardFrom(const float *input, float *output)
+    {
+        if constexpr (I + 1 == numLayers)
+            std::get<I>(this->layers).forward(input, output);
+        else
+        {
+            float *layerOutput = this->buffers[I % 2];
+            std::get<I>(this->layers).forward(input, layerOutput);
+            this->forwardFrom<I + 1>(layerOutput, output);
+        }
+    }
+
+    template <std::size_t I>
+    void setLayerWeightsImpl(std::size_t layerIdx, const std::vector<float> &weights, const std::vector<float> &biases)
+    {
+        if constexpr (I < numLayers)
+        {
+            if (layerIdx != I)
+                return this->setLayerWeightsImpl<I + 1>(layerIdx, weights, biases);
+            checkLayerSizes(I, weights.size(), biases.size());
+            std::get<I>(this->layers).setWeights(weights.data(), biases.data());
+        }
+    }
+
+    /** @throws std::invalid_argument if layer layerIdx has a different number of weights or biases */
+    static void checkLayerSizes(std::size_t layerIdx, std::size_t numWeights, std::size_t numBiases)
+    {
+        static constexpr std::size_t layerWeights[] = {Layers::numWeights...};
+        static constexpr std::size_t layerBiases[] = {Layers::numBiases...};
+        if (numWeights != layerWeights[layerIdx] || numBiases != layerBiases[layerIdx])
+            throw std::invalid_argument("tid::nn::Model: layer " + std::to_string(layerIdx) + " expects " +
+                                        std::to_string(layerWeights[layerIdx]) + " weights and " +
+                                        std::to_string(layerBiases[layerIdx]) + " biases, got " +
+                                        std::to_string(numWeights) + " and " + std::to_string(numBiases));
+    }
+
+    static uint32_t readUint32(std::istream &stream)
+    {
+        unsigned char bytes[4];
+        stream.read(reinterpret_cast<char *>(bytes), 4);
+        if (!stream)
+            throw std::invalid_argument("tid::nn::Model: truncated binary model");
+        return (uint32_t)bytes[0] | ((uint32_t)bytes[1] << 8) | ((uint32_t)bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+    }
+
+    std::tuple<Layers...> layers;
+    alignas(32) float buffers[2][BUFFER_SIZE] = {};
+};
+
+} // namespace nn
+} // namespace tid
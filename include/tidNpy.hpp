@@ -0,0 +1,733 @@
+/*
+
+tidNpy - NPY/NPZ export and memory-mapped import of feature data
+Author: Domenico Stefani (domenico.stefani96@gmail.com)
+
+Exchanges feature databases, cluster labels and feature matrices with numpy
+without going through text files.
+- writeNpy() writes a C-order array in the NPY format (np.load)
+- NpzWriter writes several arrays in an uncompressed NPZ archive, like
+  np.savez (np.savez_compressed archives can not be memory-mapped and are
+  not supported by NpzFile)
+- loadNpy() and NpzFile map the file in memory (POSIX mmap, the whole file
+  is read on other platforms or if mmap fails): an Array is a view of the
+  mapped data, so large datasets are copied at most once, by the caller.
+  Arrays keep the mapping alive and can outlive the NpzFile they come from.
+  Data that is not aligned for its type (e.g. in NPZ files written by
+  numpy) is copied to an aligned buffer.
+
+The data written by this module starts at 64-byte aligned offsets, also
+inside NPZ archives (the NPY header is padded with respect to the start of
+the archive), so it can be used in place with aligned SIMD loads.
+Supported types are float32/64, (u)int8/16/32/64 and, for names, unicode
+strings ('<U'). Only little-endian data is supported. NPZ archives are
+limited to 4 GB (no zip64 when writing, zip64 fields are read).
+
+Requires C++17, include it directly (it is not part of juce_timbreID.h).
+
+*/
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+ #if defined(__unix__) || defined(__APPLE__)
+  #include <fcntl.h>
+  #include <sys/mman.h>
+  #include <sys/stat.h>
+  #include <unistd.h>
+  #define TID_NPY_MMAP 1
+ #else
+  #define TID_NPY_MMAP 0
+ #endif
+
+namespace tid   /* TimbreID namespace*/
+{
+namespace npy
+{
+
+/** NPY type descriptor of T */
+template <typename T> struct DType;
+template <> struct DType<float>    { static constexpr const char* descr = "<f4"; };
+template <> struct DType<double>   { static constexpr const char* descr = "<f8"; };
+template <> struct DType<int8_t>   { static constexpr const char* descr = "|i1"; };
+template <> struct DType<uint8_t>  { static constexpr const char* descr = "|u1"; };
+template <> struct DType<int16_t>  { static constexpr const char* descr = "<i2"; };
+template <> struct DType<uint16_t> { static constexpr const char* descr = "<u2"; };
+template <> struct DType<int32_t>  { static constexpr const char* descr = "<i4"; };
+template <> struct DType<uint32_t> { static constexpr const char* descr = "<u4"; };
+template <> struct DType<int64_t>  { static constexpr const char* descr = "<i8"; };
+template <> struct DType<uint64_t> { static constexpr const char* descr = "<u8"; };
+
+/** Alignment of the data written by this module */
+static const size_t DATA_ALIGNMENT = 64;
+
+namespace detail
+{
+
+inline size_t numElements(const std::vector<size_t>& shape)
+{
+    size_t n = 1;
+    for (size_t d : shape)
+        n *= d;
+    return n;
+}
+
+/** Size in bytes of one element of the given descriptor ('<f4', '<U12', ...) */
+inline size_t itemSize(const std::string& descr)
+{
+    if (descr.size() < 3 || (descr[0] != '<' && descr[0] != '|' && descr[0] != '='))
+        throw std::invalid_argument("tid::npy: unsupported type '" + descr + "' (only little-endian data is supported)");
+    const size_t n = (size_t)std::stoul(descr.substr(2));
+    return (descr[1] == 'U') ? 4 * n : n;
+}
+
+/**
+ * Complete NPY preamble (magic, version, header length, header dictionary)
+ * padded so that the data starts at a multiple of DATA_ALIGNMENT from
+ * startOffset (the position of the preamble in the file)
+*/
+inline std::string makePreamble(const std::string& descr, const std::vector<size_t>& shape, size_t startOffset = 0)
+{
+    std::string dict = "{'descr': '" + descr + "', 'fortran_order': False, 'shape': (";
+    for (size_t i = 0; i < shape.size(); ++i)
+        dict += std::to_string(shape[i]) + ((shape.size() == 1 || i + 1 < shape.size()) ? ", " : "");
+    if (shape.size() == 1)
+        dict.pop_back(); // "(3,)"
+    dict += "), }";
+
+    // version 1.0 has a 2 byte header length, version 2.0 a 4 byte one
+    const bool v2 = (dict.size() + 11 + DATA_ALIGNMENT > 65535);
+    const size_t fixed = v2 ? 12 : 10;
+    size_t total = fixed + dict.size() + 1; // + '\n'
+    const size_t misalignment = (startOffset + total) % DATA_ALIGNMENT;
+    if (misalignment != 0)
+        dict.append(DATA_ALIGNMENT - misalignment, ' ');
+    dict += '\n';
+
+    std::string preamble("\x93NUMPY", 6);
+    preamble += (char)(v2 ? 2 : 1);
+    preamble += (char)0;
+    const uint32_t headerLength = (uint32_t)dict.size();
+    for (size_t b = 0; b < (v2 ? 4u : 2u); ++b)
+        preamble += (char)((headerLength >> (8 * b)) & 0xFF);
+    return preamble + dict;
+}
+
+/** Value of a key in the NPY header dictionary (quotes included for strings) */
+inline std::string dictValue(const std::string& dict, const std::string& key)
+{
+    const size_t k = dict.find("'" + key + "'");
+    if (k == std::string::npos)
+        throw std::invalid_argument("tid::npy: missing '" + key + "' in the NPY header");
+    size_t start = dict.find(':', k);
+    if (start == std::string::npos)
+        throw std::invalid_argument("tid::npy: malformed NPY header");
+    start = dict.find_first_not_of(' ', start + 1);
+    if (start == std::string::npos)
+        throw std::invalid_argument("tid::npy: malformed NPY header");
+    size_t end;
+    if (dict[start] == '(')
+        end = dict.find(')', start) + 1;
+    else if (dict[start] == '\'' || dict[start] == '"')
+        end = dict.find(dict[start], start + 1) + 1;
+    else
+        end = dict.find_first_of(",}", start);
+    if (end == std::string::npos || end == 0)
+        throw std::invalid_argument("tid::npy: malformed NPY header");
+    return dict.substr(start, end - start);
+}
+
+/**
+ * Parses the NPY preamble at the start of bytes.
+ * @return offset of the data from bytes
+*/
+inline size_t parsePreamble(const char* bytes, size_t available, std::string& descr, std::vector<size_t>& shape)
+{
+    if (available < 10 || std::memcmp(bytes, "\x93NUMPY", 6) != 0)
+        throw std::invalid_argument("tid::npy: not a NPY file");
+    const unsigned char major = (unsigned char)bytes[6];
+    if (major < 1 || major > 3)
+        throw std::invalid_argument("tid::npy: unsupported NPY version " + std::to_string(major));
+    const size_t lengthBytes = (major == 1) ? 2 : 4;
+    if (available < 8 + lengthBytes)
+        throw std::invalid_argument("tid::npy: truncated NPY header");
+    size_t headerLength = 0;
+    for (size_t b = 0; b < lengthBytes; ++b)
+        headerLength |= (size_t)(unsigned char)bytes[8 + b] << (8 * b);
+    const size_t dataOffset = 8 + lengthBytes + headerLength;
+    if (dataOffset > available)
+        throw std::invalid_argument("tid::npy: truncated NPY header");
+
+    const std::string dict(bytes + 8 + lengthBytes, headerLength);
+    std::string d = dictValue(dict, "descr");
+    descr = d.substr(1, d.size() - 2);
+    if (dictValue(dict, "fortran_order") != "False")
+        throw std::invalid_argument("tid::npy: Fortran-order arrays are not supported");
+
+    shape.clear();
+    const std::string s = dictValue(dict, "shape");
+    size_t pos = 1;
+    while (pos < s.size())
+    {
+        const size_t digit = s.find_first_of("0123456789", pos);
+        if (digit == std::string::npos)
+            break;
+        size_t len = 0;
+        shape.push_back((size_t)std::stoull(s.substr(digit), &len));
+        pos = digit + len;
+    }
+    return dataOffset;
+}
+
+inline uint32_t crc32(uint32_t crc, const void* data, size_t size)
+{
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i)
+        {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k)
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i)
+        crc = table[(crc ^ p[i]) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+inline void putU16(std::string& out, uint16_t v)
+{
+    out += (char)(v & 0xFF);
+    out += (char)(v >> 8);
+}
+
+inline void putU32(std::string& out, uint32_t v)
+{
+    for (int b = 0; b < 4; ++b)
+        out += (char)((v >> (8 * b)) & 0xFF);
+}
+
+inline uint64_t getLE(const char* p, size_t bytes)
+{
+    uint64_t v = 0;
+    for (size_t b = 0; b < bytes; ++b)
+        v |= (uint64_t)(unsigned char)p[b] << (8 * b);
+    return v;
+}
+
+/** Strings as a '<U' array (UCS4 code units, one byte per character is assumed, i.e. ASCII/Latin-1) */
+inline std::vector<uint32_t> encodeStrings(const std::vector<std::string>& strings, size_t& maxLength)
+{
+    maxLength = 1;
+    for (const std::string& s : strings)
+        maxLength = std::max(maxLength, s.size());
+    std::vector<uint32_t> ucs4(strings.size() * maxLength, 0);
+    for (size_t i = 0; i < strings.size(); ++i)
+        for (size_t c = 0; c < strings[i].size(); ++c)
+            ucs4[i * maxLength + c] = (unsigned char)strings[i][c];
+    return ucs4;
+}
+
+} // namespace detail
+
+//==============================================================================
+/** Read-only file contents, memory-mapped when possible */
+class MappedFile
+{
+public:
+    /** @throws std::runtime_error if the file can not be opened */
+    explicit MappedFile(const std::string& path, bool useMmap = true)
+    {
+     #if TID_NPY_MMAP
+        if (useMmap)
+        {
+            const int fd = ::open(path.c_str(), O_RDONLY);
+            if (fd < 0)
+                throw std::runtime_error("tid::npy: can not open " + path);
+            struct stat st;
+            if (::fstat(fd, &st) == 0 && st.st_size > 0)
+            {
+                void* mapped = ::mmap(nullptr, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+                if (mapped != MAP_FAILED)
+                {
+                    this->mappedData = static_cast<const char*>(mapped);
+                    this->mappedSize = (size_t)st.st_size;
+                }
+            }
+            ::close(fd);
+            if (this->mappedData != nullptr)
+                return;
+        }
+     #endif
+        std::ifstream stream(path, std::ios::binary | std::ios::ate);
+        if (!stream)
+            throw std::runtime_error("tid::npy: can not open " + path);
+        const std::streamsize size = stream.tellg();
+        stream.seekg(0);
+        this->buffer.resize((size_t)size / sizeof(uint64_t) + 1);
+        if (!stream.read(reinterpret_cast<char*>(this->buffer.data()), size))
+            throw std::runtime_error("tid::npy: can not read " + path);
+        this->readSize = (size_t)size;
+    }
+
+    ~MappedFile()
+    {
+     #if TID_NPY_MMAP
+        if (this->mappedData != nullptr)
+            ::munmap(const_cast<char*>(this->mappedData), this->mappedSize);
+     #endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const char* data() const noexcept
+    {
+        return this->mappedData != nullptr ? this->mappedData : reinterpret_cast<const char*>(this->buffer.data());
+    }
+
+    size_t size() const noexcept { return this->mappedData != nullptr ? this->mappedSize : this->readSize; }
+
+    bool isMapped() const noexcept { return this->mappedData != nullptr; }
+
+private:
+    const char* mappedData = nullptr;
+    size_t mappedSize = 0;
+    std::vector<uint64_t> buffer; // uint64_t for the alignment of the fallback
+    size_t readSize = 0;
+};
+
+//==============================================================================
+/** N-dimensional C-order array, a view of a MappedFile (or a copy, if the mapped data is misaligned) */
+class Array
+{
+public:
+    Array() = default;
+
+    /** Array whose NPY data (preamble included) starts at offset in file */
+    Array(std::shared_ptr<const MappedFile> file, size_t offset, size_t available)
+        : file(std::move(file))
+    {
+        if (offset > this->file->size() || available > this->file->size() - offset)
+            throw std::invalid_argument("tid::npy: array out of the file bounds");
+        const char* start = this->file->data() + offset;
+        const size_t dataOffset = detail::parsePreamble(start, available, this->descr, this->shape);
+        this->numBytes = detail::numElements(this->shape) * detail::itemSize(this->descr);
+        if (this->numBytes > available - dataOffset)
+            throw std::invalid_argument("tid::npy: truncated array data");
+
+        this->ptr = start + dataOffset;
+        if (reinterpret_cast<uintptr_t>(this->ptr) % alignof(uint64_t) != 0)
+        {
+            this->aligned.resize(this->numBytes / sizeof(uint64_t) + 1);
+            std::memcpy(this->aligned.data(), this->ptr, this->numBytes);
+            this->ptr = reinterpret_cast<const char*>(this->aligned.data());
+        }
+    }
+
+    const std::string& getDescr() const noexcept { return this->descr; }
+    const std::vector<size_t>& getShape() const noexcept { return this->shape; }
+    size_t getNumElements() const noexcept { return detail::numElements(this->shape); }
+    size_t getNumBytes() const noexcept { return this->numBytes; }
+
+    /** First dimension (1 for scalars) */
+    size_t getNumRows() const noexcept { return this->shape.empty() ? 1 : this->shape[0]; }
+
+    /** Product of the dimensions after the first one */
+    size_t getNumCols() const noexcept
+    {
+        return this->shape.empty() ? 1 : detail::numElements(std::vector<size_t>(this->shape.begin() + 1, this->shape.end()));
+    }
+
+    /** True if data() points directly into the memory-mapped file */
+    bool isMapped() const noexcept
+    {
+        return this->file != nullptr && this->file->isMapped() && this->aligned.empty();
+    }
+
+    template <typename T>
+    bool hasType() const noexcept
+    {
+        return this->descr == DType<T>::descr || (sizeof(T) == 1 && this->descr.substr(1) == std::string(DType<T>::descr).substr(1));
+    }
+
+    /** @throws std::invalid_argument if the array does not contain values of type T */
+    template <typename T>
+    const T* data() const
+    {
+        if (!hasType<T>())
+            throw std::invalid_argument("tid::npy: array of type '" + this->descr + "' read as '" + DType<T>::descr + "'");
+        return reinterpret_cast<const T*>(this->ptr);
+    }
+
+    /** Copy of the values, converted to T from any numeric type */
+    template <typename T>
+    std::vector<T> toVector() const
+    {
+        const size_t n = getNumElements();
+        if (hasType<T>())
+            return std::vector<T>(data<T>(), data<T>() + n);
+
+        std::vector<T> values(n);
+        const std::string& d = this->descr;
+        auto convert = [&](auto tag) {
+            using S = decltype(tag);
+            const S* src = reinterpret_cast<const S*>(this->ptr);
+            for (size_t i = 0; i < n; ++i)
+                values[i] = (T)src[i];
+        };
+        if      (d == "<f4") convert(float());
+        else if (d == "<f8") convert(double());
+        else if (d == "|i1") convert(int8_t());
+        else if (d == "|u1" || d == "|b1") convert(uint8_t());
+        else if (d == "<i2") convert(int16_t());
+        else if (d == "<u2") convert(uint16_t());
+        else if (d == "<i4") convert(int32_t());
+        else if (d == "<u4") convert(uint32_t());
+        else if (d == "<i8") convert(int64_t());
+        else if (d == "<u8") convert(uint64_t());
+        else
+            throw std::invalid_argument("tid::npy: can not convert type '" + d + "'");
+        return values;
+    }
+
+    /** Values of a '<U' string array (characters above 255 are replaced by '?') */
+    std::vector<std::string> toStrings() const
+    {
+        if (this->descr.size() < 3 || this->descr[1] != 'U')
+            throw std::invalid_argument("tid::npy: array of type '" + this->descr + "' is not a string array");
+        const size_t length = detail::itemSize(this->descr) / 4;
+        const uint32_t* ucs4 = reinterpret_cast<const uint32_t*>(this->ptr);
+        std::vector<std::string> strings(getNumElements());
+        for (size_t i = 0; i < strings.size(); ++i)
+            for (size_t c = 0; c < length && ucs4[i * length + c] != 0; ++c)
+                strings[i] += (ucs4[i * length + c] < 256) ? (char)ucs4[i * length + c] : '?';
+        return strings;
+    }
+
+private:
+    std::shared_ptr<const MappedFile> file;
+    const char* ptr = nullptr;
+    std::string descr;
+    std::vector<size_t> shape;
+    size_t numBytes = 0;
+    std::vector<uint64_t> aligned;
+};
+
+//==============================================================================
+/**
+ * Writes an NPY file.
+ * @throws std::invalid_argument if shape does not match the number of values
+ * @throws std::runtime_error if the file can not be written
+*/
+template <typename T>
+void writeNpy(const std::string& path, const T* data, size_t numValues, const std::vector<size_t>& shape)
+{
+    if (detail::numElements(shape) != numValues)
+        throw std::invalid_argument("tid::npy: shape does not match the number of values (" + std::to_string(numValues) + ")");
+    std::ofstream stream(path, std::ios::binary);
+    if (!stream)
+        throw std::runtime_error("tid::npy: can not create " + path);
+    const std::string preamble = detail::makePreamble(DType<T>::descr, shape);
+    stream.write(preamble.data(), (std::streamsize)preamble.size());
+    stream.write(reinterpret_cast<const char*>(data), (std::streamsize)(numValues * sizeof(T)));
+    if (!stream)
+        throw std::runtime_error("tid::npy: can not write " + path);
+}
+
+template <typename T>
+void writeNpy(const std::string& path, const std::vector<T>& values, const std::vector<size_t>& shape)
+{
+    writeNpy(path, values.data(), values.size(), shape);
+}
+
+/**
+ * Maps an NPY file.
+ * @throws std::runtime_error if the file can not be read
+ * @throws std::invalid_argument if it is not a valid NPY file
+*/
+inline Array loadNpy(const std::string& path, bool useMmap = true)
+{
+    auto file = std::make_shared<const MappedFile>(path, useMmap);
+    return Array(file, 0, file->size());
+}
+
+//==============================================================================
+/** Writes arrays to an uncompressed NPZ archive (np.savez) */
+class NpzWriter
+{
+public:
+    /** @throws std::runtime_error if the file can not be created */
+    explicit NpzWriter(const std::string& path)
+        : path(path), stream(path, std::ios::binary)
+    {
+        if (!this->stream)
+            throw std::runtime_error("tid::npy: can not create " + path);
+    }
+
+    /** Closes the archive if close() was not called (errors are ignored here) */
+    ~NpzWriter()
+    {
+        try
+        {
+            if (this->stream.is_open())
+                close();
+        }
+        catch (...)
+        {
+        }
+    }
+
+    NpzWriter(const NpzWriter&) = delete;
+    NpzWriter& operator=(const NpzWriter&) = delete;
+
+    /**
+     * Adds an array, named name in numpy (name.npy in the archive)
+     * @throws std::invalid_argument if shape does not match the number of values
+     * @throws std::runtime_error if writing fails or the archive exceeds 4 GB
+    */
+    template <typename T>
+    void add(const std::string& name, const T* data, size_t numValues, const std::vector<size_t>& shape)
+    {
+        if (detail::numElements(shape) != numValues)
+            throw std::invalid_argument("tid::npy: shape of '" + name + "' does not match the number of values");
+        addEntry(name, DType<T>::descr, shape, data, numValues * sizeof(T));
+    }
+
+    template <typename T>
+    void add(const std::string& name, const std::vector<T>& values, const std::vector<size_t>& shape)
+    {
+        add(name, values.data(), values.size(), shape);
+    }
+
+    /** Adds a 1D array of strings (e.g. feature names) */
+    void addStrings(const std::string& name, const std::vector<std::string>& strings)
+    {
+        size_t maxLength;
+        const std::vector<uint32_t> ucs4 = detail::encodeStrings(strings, maxLength);
+        addEntry(name, "<U" + std::to_string(maxLength), {strings.size()}, ucs4.data(), ucs4.size() * sizeof(uint32_t));
+    }
+
+    /** Writes the central directory. @throws std::runtime_error if writing fails */
+    void close()
+    {
+        const uint64_t directoryOffset = this->offset;
+        this->stream.write(this->centralDirectory.data(), (std::streamsize)this->centralDirectory.size());
+
+        std::string end;
+        detail::putU32(end, 0x06054b50);
+        detail::putU16(end, 0);
+        detail::putU16(end, 0);
+        detail::putU16(end, (uint16_t)this->numEntries);
+        detail::putU16(end, (uint16_t)this->numEntries);
+        detail::putU32(end, (uint32_t)this->centralDirectory.size());
+        detail::putU32(end, (uint32_t)directoryOffset);
+        detail::putU16(end, 0);
+        this->stream.write(end.data(), (std::streamsize)end.size());
+        this->stream.close();
+        if (this->stream.fail())
+            throw std::runtime_error("tid::npy: can not write " + this->path);
+    }
+
+private:
+    void addEntry(const std::string& name, const std::string& descr, const std::vector<size_t>& shape,
+                  const void* data, size_t dataBytes)
+    {
+        const std::string fileName = name + ".npy";
+        const size_t localHeaderSize = 30 + fileName.size();
+
+        // the NPY header padding aligns the data with respect to the start of the archive
+        const std::string preamble = detail::makePreamble(descr, shape, this->offset + localHeaderSize);
+
+        const uint64_t entrySize = preamble.size() + dataBytes;
+        if (this->offset + localHeaderSize + entrySize > 0xFFFFFFFFull || this->numEntries == 0xFFFF)
+            throw std::runtime_error("tid::npy: " + this->path + " would exceed the 4 GB NPZ limit");
+
+        uint32_t crc = detail::crc32(0, preamble.data(), preamble.size());
+        crc = detail::crc32(crc, data, dataBytes);
+
+        auto header = [&](bool central) {
+            std::string h;
+            detail::putU32(h, central ? 0x02014b50 : 0x04034b50);
+            if (central)
+                detail::putU16(h, 20);  // version made by
+            detail::putU16(h, 20);      // version needed
+            detail::putU16(h, 0);       // flags
+            detail::putU16(h, 0);       // stored
+            detail::putU16(h, 0);       // time
+            detail::putU16(h, 0x21);    // date (1980-01-01)
+            detail::putU32(h, crc);
+            detail::putU32(h, (uint32_t)entrySize);
+            detail::putU32(h, (uint32_t)entrySize);
+            detail::putU16(h, (uint16_t)fileName.size());
+            detail::putU16(h, 0);       // extra field
+            if (central)
+            {
+                detail::putU16(h, 0);   // comment
+                detail::putU16(h, 0);   // disk
+                detail::putU16(h, 0);   // internal attributes
+                detail::putU32(h, 0);   // external attributes
+                detail::putU32(h, (uint32_t)this->offset);
+            }
+            return h + fileName;
+        };
+
+        const std::string local = header(false);
+        this->stream.write(local.data(), (std::streamsize)local.size());
+        this->stream.write(preamble.data(), (std::streamsize)preamble.size());
+        this->stream.write(static_cast<const char*>(data), (std::streamsize)dataBytes);
+        if (!this->stream)
+            throw std::runtime_error("tid::npy: can not write " + this->path);
+
+        this->centralDirectory += header(true);
+        this->offset += local.size() + entrySize;
+        ++this->numEntries;
+    }
+
+    std::string path;
+    std::ofstream stream;
+    std::string centralDirectory;
+    uint64_t offset = 0;
+    size_t numEntries = 0;
+};
+
+//==============================================================================
+/** Uncompressed NPZ archive, memory-mapped */
+class NpzFile
+{
+public:
+    /**
+     * @throws std::runtime_error if the file can not be read
+     * @throws std::invalid_argument if it is not a valid or an uncompressed archive
+    */
+    explicit NpzFile(const std::string& path, bool useMmap = true)
+        : file(std::make_shared<const MappedFile>(path, useMmap))
+    {
+        const char* bytes = this->file->data();
+        const size_t size = this->file->size();
+
+        // end of central directory record (followed by a comment of at most 65535 bytes)
+        if (size < 22)
+            throw std::invalid_argument("tid::npy: " + path + " is not a NPZ file");
+        size_t eocd = size - 22;
+        while (detail::getLE(bytes + eocd, 4) != 0x06054b50)
+        {
+            if (eocd == 0 || size - eocd > 22 + 65535)
+                throw std::invalid_argument("tid::npy: " + path + " is not a NPZ file");
+            --eocd;
+        }
+        uint64_t numEntries = detail::getLE(bytes + eocd + 10, 2);
+        uint64_t directoryOffset = detail::getLE(bytes + eocd + 16, 4);
+
+        // zip64 end of central directory, written by numpy for large archives
+        if (eocd >= 20 && detail::getLE(bytes + eocd - 20, 4) == 0x07064b50)
+        {
+            const uint64_t zip64End = detail::getLE(bytes + eocd - 12, 8);
+            if (zip64End + 56 > size || detail::getLE(bytes + zip64End, 4) != 0x06064b50)
+                throw std::invalid_argument("tid::npy: malformed zip64 record in " + path);
+            numEntries = detail::getLE(bytes + zip64End + 32, 8);
+            directoryOffset = detail::getLE(bytes + zip64End + 48, 8);
+        }
+
+        size_t pos = (size_t)directoryOffset;
+        for (uint64_t e = 0; e < numEntries; ++e)
+        {
+            if (pos + 46 > size || detail::getLE(bytes + pos, 4) != 0x02014b50)
+                throw std::invalid_argument("tid::npy: malformed central directory in " + path);
+            const uint64_t method = detail::getLE(bytes + pos + 10, 2);
+            uint64_t compressedSize = detail::getLE(bytes + pos + 20, 4);
+            uint64_t uncompressedSize = detail::getLE(bytes + pos + 24, 4);
+            const size_t nameLength = (size_t)detail::getLE(bytes + pos + 28, 2);
+            const size_t extraLength = (size_t)detail::getLE(bytes + pos + 30, 2);
+            const size_t commentLength = (size_t)detail::getLE(bytes + pos + 32, 2);
+            uint64_t localOffset = detail::getLE(bytes + pos + 42, 4);
+            if (pos + 46 + nameLength + extraLength > size)
+                throw std::invalid_argument("tid::npy: malformed central directory in " + path);
+            std::string name(bytes + pos + 46, nameLength);
+
+            // zip64 extended information: the 64 bit values of the fields set to 0xFFFFFFFF, in this order
+            size_t extra = pos + 46 + nameLength;
+            const size_t extraEnd = extra + extraLength;
+            while (extra + 4 <= extraEnd)
+            {
+                const uint64_t id = detail::getLE(bytes + extra, 2);
+                const size_t length = (size_t)detail::getLE(bytes + extra + 2, 2);
+                if (id == 0x0001)
+                {
+                    size_t field = extra + 4;
+                    for (uint64_t* value : {&uncompressedSize, &compressedSize, &localOffset})
+                        if (*value == 0xFFFFFFFFu && field + 8 <= extra + 4 + length)
+                        {
+                            *value = detail::getLE(bytes + field, 8);
+                            field += 8;
+                        }
+                }
+                extra += 4 + length;
+            }
+            pos = extraEnd + commentLength;
+
+            if (name.size() > 4 && name.compare(name.size() - 4, 4, ".npy") == 0)
+                name.resize(name.size() - 4);
+            if (method != 0)
+                throw std::invalid_argument("tid::npy: '" + name + "' in " + path +
+                                            " is compressed, write the archive with np.savez");
+            if (localOffset + 30 > size || detail::getLE(bytes + localOffset, 4) != 0x04034b50)
+                throw std::invalid_argument("tid::npy: malformed local header in " + path);
+            const uint64_t dataOffset = localOffset + 30 + detail::getLE(bytes + localOffset + 26, 2) +
+                                        detail::getLE(bytes + localOffset + 28, 2);
+            this->entries.push_back({name, (size_t)dataOffset, (size_t)compressedSize});
+        }
+    }
+
+    std::vector<std::string> getNames() const
+    {
+        std::vector<std::string> names;
+        for (const Entry& entry : this->entries)
+            names.push_back(entry.name);
+        return names;
+    }
+
+    bool contains(const std::string& name) const
+    {
+        return std::any_of(this->entries.begin(), this->entries.end(), [&](const Entry& e) { return e.name == name; });
+    }
+
+    /**
+     * Array named name (without the .npy extension)
+     * @throws std::invalid_argument if there is no such array or it is malformed
+    */
+    Array get(const std::string& name) const
+    {
+        for (const Entry& entry : this->entries)
+            if (entry.name == name)
+                return Array(this->file, entry.offset, entry.size);
+        throw std::invalid_argument("tid::npy: no array named '" + name + "'");
+    }
+
+private:
+    struct Entry
+    {
+        std::string name;
+        size_t offset;
+        size_t size;
+    };
+
+    std::shared_ptr<const MappedFile> file;
+    std::vector<Entry> entries;
+};
+
+} // namespace npy
+} // namespace tid
@@ -0,0 +1,117 @@
+/*
+
+tidOnsetEvents - Onset event queue of the onset detectors
+Author: Domenico Stefani (domenico.stefani96@gmail.com)
+
+Base class of Bark and MultiBark: the detector publishes its onset events
+from the audio thread into a lock-free queue, and a consumer thread pops them
+or dispatches them to the listeners.
+Detector is the class that inherits from it (the listeners receive a pointer
+to it), Event the type of the events it publishes and Capacity the number of
+events queued.
+
+*/
+#pragma once
+
+#include "tidJuceCompat.hpp"
+#include <atomic>
+#include "choc/containers/choc_SingleReaderSingleWriterFIFO.h"
+
+namespace tid   /* TimbreID namespace*/
+{
+
+template <typename Detector, typename Event, size_t Capacity>
+class OnsetEventQueue
+{
+public:
+    /** Capacity of the onset event queue, events are dropped when it is full */
+    static constexpr size_t ONSET_QUEUE_SIZE = Capacity;
+
+    /**
+     * Pop the oldest onset event from the queue.
+     * Lock-free, to be called by a single consumer thread (or by the audio
+     * thread itself, right after store(), for offline processing).
+     * @return false if there are no events
+    */
+    bool popOnsetEvent(Event& event) noexcept
+    {
+        return this->onsetEvents.pop(event);
+    }
+
+    /**
+     * Pop all the queued onset events and call the listeners for each one.
+     * Call it from the consumer thread (e.g. the message thread, from a Timer),
+     * never from the audio thread.
+     * @return number of events dispatched
+    */
+    size_t dispatchOnsetEvents()
+    {
+        size_t numEvents = 0;
+        Event event;
+        while (this->onsetEvents.pop(event))
+        {
+            Detector* detector = static_cast<Detector*>(this);
+            onsetListeners.call([detector, &event] (Listener& l) { l.onsetDetected (detector, event); });
+            ++numEvents;
+        }
+        return numEvents;
+    }
+
+    /** Number of onset events dropped because the queue was full (nobody consumed them) */
+    uint32 getNumDroppedOnsetEvents() const noexcept
+    {
+        return this->droppedOnsetEvents.load(std::memory_order_relaxed);
+    }
+
+    /**
+        Used to receive the onsets dispatched by dispatchOnsetEvents().
+
+        @see addListener, removeListener
+    */
+    class Listener
+    {
+    public:
+        /** Destructor. */
+        virtual ~Listener() = default;
+
+        /** Called by dispatchOnsetEvents() for every onset, on the thread that dispatches them. */
+        virtual void onsetDetected (Detector *, const Event& event) = 0;
+    };
+
+    /** Registers a listener to receive the onsets dispatched by dispatchOnsetEvents().
+        If the listener is already registered, this will not register it again.
+        @see removeListener
+    */
+    void addListener (Listener* newListener)
+    {
+        onsetListeners.add(newListener);
+    }
+
+    /** Removes a previously-registered listener
+        @see addListener
+    */
+    void removeListener (Listener* listener)
+    {
+        onsetListeners.remove(listener);
+    }
+
+protected:
+    OnsetEventQueue()
+    {
+        this->onsetEvents.reset(Capacity);
+    }
+
+    /** Publish an onset event (lock-free, real-time safe) */
+    void publishOnsetEvent(const Event& event) noexcept
+    {
+        if (!this->onsetEvents.push(event))
+            this->droppedOnsetEvents.fetch_add(1, std::memory_order_relaxed);
+    }
+
+private:
+    ListenerList<Listener> onsetListeners;
+    choc::fifo::SingleReaderSingleWriterFIFO<Event> onsetEvents;
+    std::atomic<uint32> droppedOnsetEvents { 0 };
+};
+
+} // namespace tid
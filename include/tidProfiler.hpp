@@ -0,0 +1,346 @@
+/*
+
+tidProfiler - Hot-path profiler for the timbreID modules
+Author: Domenico Stefani (domenico.stefani96@gmail.com)
+
+Instrumentation points inside the library (storeAudioBlock, window copy, FFT,
+filterbank, DCT, KNN distance and top-k) record their duration, in cycle
+counter ticks, into lock-free log-linear (HDR-style) histograms.
+Each (module, stage) pair has a fixed pool of per-thread histograms, so that
+recording is a couple of relaxed atomic increments on a cache line that no
+other thread writes. A thread takes a slot of the pool at its first record,
+for the life of the process; once all the slots are taken, the records of
+further threads are only counted (getNumDroppedRecords()), so that they never
+share a histogram.
+A non real-time thread can read p50/p99/max per stage and per module at any
+time with getStats() or printReport().
+
+Instrumentation convention: TID_PROFILE_SCOPE times a whole function (e.g. the
+storeAudioBlock stage is the store() of a module), TID_PROFILE_BEGIN/END time a
+section inside a function.
+
+Everything compiles to nothing unless TID_ENABLE_PROFILER is defined to 1.
+
+*/
+#pragma once
+
+#ifndef TID_ENABLE_PROFILER
+#define TID_ENABLE_PROFILER 0
+#endif
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ostream>
+#include <thread>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+#include <x86intrin.h>
+#endif
+
+namespace tid   /* TimbreID namespace*/
+{
+namespace profiler
+{
+
+enum class Module : uint8_t
+{
+    attackTime = 0,
+    bark,
+    barkSpec,
+    barkSpecBrightness,
+    bfcc,
+    cepstrum,
+    mfcc,
+    peakSample,
+    zeroCrossing,
+    knn,
+    numModules
+};
+
+enum class Stage : uint8_t
+{
+    storeAudioBlock = 0,
+    windowCopy,     // Copy of the analysis window from the signal buffer, including windowing
+    fft,
+    ifft,           // Inverse FFT (cepstrum)
+    filterbank,
+    dct,
+    growth,         // Bark loudness weighting, growth and mask update
+    earlyDetection, // Bark short-window onset detection, including its growth
+    knnDistance,
+    knnTopK,
+    numStages
+};
+
+inline const char* getModuleName(Module module)
+{
+    static const char* names[] = {"attackTime", "bark", "barkSpec", "barkSpecBrightness", "bfcc",
+                                  "cepstrum", "mfcc", "peakSample", "zeroCrossing", "knn"};
+    return names[(size_t)module];
+}
+
+inline const char* getStageName(Stage stage)
+{
+    static const char* names[] = {"storeAudioBlock", "windowCopy", "fft", "ifft", "filterbank", "dct",
+                                  "growth", "earlyDetection", "knnDistance", "knnTopK"};
+    return names[(size_t)stage];
+}
+
+/** Read the cycle counter (TSC on x86, virtual counter on ARM64, steady_clock ns otherwise) */
+inline uint64_t now() noexcept
+{
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t value;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(value));
+    return value;
+#else
+    return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+/** Frequency of now() in ticks per second, measured once (call it from a non real-time thread) */
+inline double getTicksPerSecond()
+{
+    static const double ticksPerSecond = []() {
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64)
+        const auto clockStart = std::chrono::steady_clock::now();
+        const uint64_t ticksStart = now();
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+        const uint64_t ticksEnd = now();
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - clockStart).count();
+        return (ticksEnd - ticksStart) / seconds;
+#elif defined(__aarch64__)
+        uint64_t frequency;
+        asm volatile("mrs %0, cntfrq_el0" : "=r"(frequency));
+        return (double)frequency;
+#else
+        return 1e9;
+#endif
+    }();
+    return ticksPerSecond;
+}
+
+/**
+ * Log-linear histogram of tick counts.
+ * Values below 2^SUB_BUCKET_BITS have their own bucket, larger values are split
+ * into 2^SUB_BUCKET_BITS buckets per power of two (relative error < 1/2^SUB_BUCKET_BITS).
+ */
+class alignas(64) Histogram
+{
+public:
+    enum : unsigned int
+    {
+        SUB_BUCKET_BITS = 3,
+        SUB_BUCKETS = 1u << SUB_BUCKET_BITS,
+        MAX_BITS = 40, // Up to 2^40 ticks (minutes), larger values saturate
+        NUM_BUCKETS = (MAX_BITS - SUB_BUCKET_BITS + 1) * SUB_BUCKETS
+    };
+
+    static unsigned int bucketIndex(uint64_t value) noexcept
+    {
+        if (value < SUB_BUCKETS)
+            return (unsigned int)value;
+        const unsigned int msb = 63u - (unsigned int)__builtin_clzll(value);
+        if (msb >= MAX_BITS)
+            return NUM_BUCKETS - 1;
+        const unsigned int shift = msb - SUB_BUCKET_BITS;
+        return (shift + 1) * SUB_BUCKETS + (unsigned int)((value >> shift) - SUB_BUCKETS);
+    }
+
+    /** Largest value that falls in a bucket */
+    static uint64_t bucketUpperBound(unsigned int index) noexcept
+    {
+        if (index < SUB_BUCKETS)
+            return index;
+        const unsigned int shift = index / SUB_BUCKETS - 1;
+        const uint64_t base = (uint64_t)(SUB_BUCKETS + index % SUB_BUCKETS) << shift;
+        return base + ((uint64_t)1 << shift) - 1;
+    }
+
+    /** Only the thread that owns the histogram records into it, so max needs no compare-and-swap */
+    void record(uint64_t value) noexcept
+    {
+        this->counts[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+        this->total.fetch_add(1, std::memory_order_relaxed);
+        if (value > this->max.load(std::memory_order_relaxed))
+            this->max.store(value, std::memory_order_relaxed);
+    }
+
+    void reset() noexcept
+    {
+        for (auto& c : this->counts)
+            c.store(0, std::memory_order_relaxed);
+        this->total.store(0, std::memory_order_relaxed);
+        this->max.store(0, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint32_t> counts[NUM_BUCKETS];
+    std::atomic<uint64_t> total;
+    std::atomic<uint64_t> max;
+};
+
+/** Statistics of a (module, stage) pair, in nanoseconds */
+struct Stats
+{
+    uint64_t count = 0;
+    double p50 = 0.0, p99 = 0.0, max = 0.0;
+};
+
+/** Fixed pool of histograms, MAX_THREADS per (module, stage) */
+struct Registry
+{
+    enum : unsigned int { MAX_THREADS = 8 }; // The records of further threads are counted and dropped
+
+    Histogram histograms[(size_t)Module::numModules][(size_t)Stage::numStages][MAX_THREADS];
+    std::atomic<unsigned int> numThreads;   // Threads that recorded so far
+    std::atomic<uint64_t> droppedRecords;   // Records of the threads without a slot
+};
+
+/** Static storage, zero-initialized without any dynamic initialization (no guard on the hot path) */
+inline Registry& getRegistry() noexcept
+{
+    static Registry registry;
+    return registry;
+}
+
+enum : unsigned int { NO_SLOT = Registry::MAX_THREADS };
+
+/**
+ * Index of the histogram slot of the calling thread, assigned at its first
+ * record, or NO_SLOT if the first MAX_THREADS recording threads took them all
+ */
+inline unsigned int getThreadSlot() noexcept
+{
+    static thread_local unsigned int slot = getRegistry().numThreads.fetch_add(1, std::memory_order_relaxed);
+    return slot < Registry::MAX_THREADS ? slot : (unsigned int)NO_SLOT;
+}
+
+/** Record a duration in ticks (real-time safe) */
+inline void record(Module module, Stage stage, uint64_t ticks) noexcept
+{
+    const unsigned int slot = getThreadSlot();
+    if (slot == NO_SLOT)
+    {
+        getRegistry().droppedRecords.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    getRegistry().histograms[(size_t)module][(size_t)stage][slot].record(ticks);
+}
+
+/** Number of records dropped because all the slots were taken */
+inline uint64_t getNumDroppedRecords() noexcept
+{
+    return getRegistry().droppedRecords.load(std::memory_order_relaxed);
+}
+
+/** Records the lifetime of the object */
+class ScopedTimer
+{
+public:
+    ScopedTimer(Module module, Stage stage) noexcept : module(module), stage(stage), start(now()) {}
+    ~ScopedTimer() { record(this->module, this->stage, now() - this->start); }
+
+private:
+    Module module;
+    Stage stage;
+    uint64_t start;
+};
+
+/** Merge the per-thread histograms of a (module, stage) pair (non real-time) */
+inline Stats getStats(Module module, Stage stage)
+{
+    uint64_t merged[Histogram::NUM_BUCKETS];
+    Stats stats;
+    uint64_t maxTicks = 0;
+    for (unsigned int b = 0; b < Histogram::NUM_BUCKETS; ++b)
+        merged[b] = 0;
+    for (const Histogram& h : getRegistry().histograms[(size_t)module][(size_t)stage])
+    {
+        for (unsigned int b = 0; b < Histogram::NUM_BUCKETS; ++b)
+        {
+            const uint64_t c = h.counts[b].load(std::memory_order_relaxed);
+            merged[b] += c;
+            stats.count += c;
+        }
+        const uint64_t m = h.max.load(std::memory_order_relaxed);
+        maxTicks = m > maxTicks ? m : maxTicks;
+    }
+    if (stats.count == 0)
+        return stats;
+
+    const double nsPerTick = 1e9 / getTicksPerSecond();
+    const uint64_t p50Rank = (stats.count + 1) / 2, p99Rank = (stats.count * 99 + 99) / 100;
+    uint64_t cumulative = 0;
+    bool p50Found = false;
+    for (unsigned int b = 0; b < Histogram::NUM_BUCKETS; ++b)
+    {
+        cumulative += merged[b];
+        if (!p50Found && cumulative >= p50Rank)
+        {
+            stats.p50 = Histogram::bucketUpperBound(b) * nsPerTick;
+            p50Found = true;
+        }
+        if (cumulative >= p99Rank)
+        {
+            stats.p99 = Histogram::bucketUpperBound(b) * nsPerTick;
+            break;
+        }
+    }
+    stats.max = maxTicks * nsPerTick;
+    return stats;
+}
+
+/** Clear all the histograms (results are approximate if called while recording) */
+inline void reset()
+{
+    for (auto& module : getRegistry().histograms)
+        for (auto& stage : module)
+            for (Histogram& h : stage)
+                h.reset();
+    getRegistry().droppedRecords.store(0, std::memory_order_relaxed);
+}
+
+/** Print one line per (module, stage) pair that recorded something */
+inline void printReport(std::ostream& out)
+{
+    char line[160];
+    std::snprintf(line, sizeof(line), "%-20s %-16s %10s %12s %12s %12s\n", "module", "stage", "count", "p50 (ns)",
+                  "p99 (ns)", "max (ns)");
+    out << line;
+    for (size_t m = 0; m < (size_t)Module::numModules; ++m)
+        for (size_t s = 0; s < (size_t)Stage::numStages; ++s)
+        {
+            const Stats stats = getStats((Module)m, (Stage)s);
+            if (stats.count == 0)
+                continue;
+            std::snprintf(line, sizeof(line), "%-20s %-16s %10llu %12.0f %12.0f %12.0f\n", getModuleName((Module)m),
+                          getStageName((Stage)s), (unsigned long long)stats.count, stats.p50, stats.p99, stats.max);
+            out << line;
+        }
+    if (getNumDroppedRecords() > 0)
+        out << getNumDroppedRecords() << " records dropped (threads beyond the first "
+            << (unsigned int)Registry::MAX_THREADS << " that recorded)\n";
+}
+
+} // namespace profiler
+} // namespace tid
+
+#if TID_ENABLE_PROFILER
+/** Time the rest of the enclosing scope */
+#define TID_PROFILE_SCOPE(module, stage) \
+    ::tid::profiler::ScopedTimer tidProfilerScope_##stage(::tid::profiler::Module::module, ::tid::profiler::Stage::stage)
+/** Start timing a section, closed by TID_PROFILE_END with the same arguments */
+#define TID_PROFILE_BEGIN(module, stage) const uint64_t tidProfilerStart_##stage = ::tid::profiler::now()
+#define TID_PROFILE_END(module, stage) \
+    ::tid::profiler::record(::tid::profiler::Module::module, ::tid::profiler::Stage::stage, \
+                            ::tid::profiler::now() - tidProfilerStart_##stage)
+#else
+#define TID_PROFILE_SCOPE(module, stage)
+#define TID_PROFILE_BEGIN(module, stage)
+#define TID_PROFILE_END(module, stage)
+#endif
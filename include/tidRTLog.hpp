@@ -7,6 +7,16 @@
     It makes use of a circular buffer to post some messages and have them
     written to file by a polling routine outside of the real time audio thread.
 
+    Two modes are available:
+    - Text mode (logInfo, logValue): the message is formatted on the calling
+      thread and copied in a fixed size LogEntry.
+    - Binary mode (logBinary): only a pointer to a static format string, the
+      typed arguments and a timestamp are pushed in a compact variable-length
+      record ring. Formatting happens on the consumer thread, in pop().
+      This is the mode to use on the audio thread.
+    Entries of both modes get a timestamp and a sequence number shared by the
+    two queues, and pop() returns them in the order in which they were logged.
+
     Created: 19 Nov 2020
     Author:  Domenico Stefani (domenico.stefani[at]unitn.it)
 
@@ -15,25 +25,139 @@
 
 #pragma once
 
-#include <JuceHeader.h>
+#include "tidJuceCompat.hpp"
+#include <atomic>   // For the binary ring indexes
 #include <cstring>  // For strncpy
 #include <memory>   // For unique_ptr
+#include <string>
+#include <type_traits>
+#include <vector>
 #include "choc/containers/choc_SingleReaderSingleWriterFIFO.h"  // Jules' thread safe fifo buffer implementation
 
 namespace tid   /* TimbreID namespace*/
 {
 
+/**
+ * Lock-free ring of variable-length records, for a single producer and a single consumer.
+ * Records are contiguous in memory: when a record does not fit before the end of the
+ * buffer, a wrap marker is written and the record starts back at the beginning.
+ */
+class BinaryLogRing
+{
+public:
+    static const uint32 RECORD_ALIGNMENT = 8;
+
+    /** Allocate a ring of (at least) capacityBytes bytes, rounded up to a power of 2 */
+    explicit BinaryLogRing(size_t capacityBytes)
+    {
+        size_t capacity = 64;
+        while (capacity < capacityBytes)
+            capacity *= 2;
+        this->buffer.assign(capacity, 0);
+        this->mask = capacity - 1;
+    }
+
+    /**
+     * Reserve a contiguous record of size bytes (producer side).
+     * @return nullptr if the ring does not have enough free space
+     */
+    uint8* prepareWrite(uint32 size)
+    {
+        size = alignedSize(size);
+        const uint64 head = this->writeIndex.load(std::memory_order_relaxed);
+        const uint64 freeSpace = this->buffer.size() - (head - this->readIndex.load(std::memory_order_acquire));
+        const size_t position = (size_t)(head & this->mask);
+        const size_t untilEnd = this->buffer.size() - position;
+
+        if (untilEnd >= size)
+        {
+            if (freeSpace < size)
+                return nullptr;
+            this->pendingHead = head + size;
+            return &this->buffer[position];
+        }
+        // Skip the end of the buffer with a wrap marker
+        if (freeSpace < untilEnd + size)
+            return nullptr;
+        writeHeader(&this->buffer[position], WRAP_MARKER);
+        this->pendingHead = head + untilEnd + size;
+        return &this->buffer[0];
+    }
+
+    /** Publish the record reserved by the last prepareWrite */
+    void finishWrite()
+    {
+        this->writeIndex.store(this->pendingHead, std::memory_order_release);
+    }
+
+    /**
+     * Get the oldest record (consumer side), its size is stored in the first 4 bytes.
+     * @return nullptr if the ring is empty
+     */
+    const uint8* prepareRead()
+    {
+        uint64 tail = this->readIndex.load(std::memory_order_relaxed);
+        if (tail == this->writeIndex.load(std::memory_order_acquire))
+            return nullptr;
+        const uint8* record = &this->buffer[(size_t)(tail & this->mask)];
+        if (readHeader(record) == WRAP_MARKER)
+        {
+            tail += this->buffer.size() - (size_t)(tail & this->mask);
+            record = &this->buffer[0];
+        }
+        this->pendingTail = tail + alignedSize(readHeader(record));
+        return record;
+    }
+
+    /** Release the record returned by the last prepareRead */
+    void finishRead()
+    {
+        this->readIndex.store(this->pendingTail, std::memory_order_release);
+    }
+
+    static uint32 readHeader(const uint8* record)
+    {
+        uint32 size;
+        std::memcpy(&size, record, sizeof(size));
+        return size;
+    }
+
+    static void writeHeader(uint8* record, uint32 size)
+    {
+        std::memcpy(record, &size, sizeof(size));
+    }
+
+private:
+    static const uint32 WRAP_MARKER = 0xFFFFFFFF;
+
+    static uint32 alignedSize(uint32 size)
+    {
+        return (size + RECORD_ALIGNMENT - 1) & ~(RECORD_ALIGNMENT - 1);
+    }
+
+    std::vector<uint8> buffer;
+    size_t mask = 0;
+    uint64 pendingHead = 0;  // Only used by the producer
+    uint64 pendingTail = 0;  // Only used by the consumer
+    alignas(64) std::atomic<uint64> writeIndex{0};
+    alignas(64) std::atomic<uint64> readIndex{0};
+};
+
 /** Logger class for real-time usage */
 class RealTimeLogger
 {
 public:
     static const size_t LOG_MAX_ENTRIES = 2048; // Size of the fifo buffer for the log
+    static const size_t LOG_BINARY_BYTES = 1 << 16; // Size of the record ring of the binary mode
+    static const size_t MAX_STRING_ARG_LENGTH = 64; // Longer string arguments of logBinary are truncated
 
     /** Entry in the log */
     struct LogEntry {
         static const int MESSAGE_LENGTH = 240;       // Length of messages in the fifo buffer
         int64 timeAtStart,  // Intended to log time intervals
             timeAtEnd;    // Intended to log time intervals
+        int64 timestamp = 0;  // High resolution ticks at the time of logging
+        uint64 sequence = 0;  // Order of logging, shared by text and binary entries
         char message[MESSAGE_LENGTH+1];
     };
 
@@ -51,11 +175,90 @@ public:
     bool logValue(const char message[], long unsigned int value, const char suffix[]=nullptr);
     bool logValue(const char message[], unsigned int value, const char suffix[]=nullptr);
     bool logValue(const char message[], const char value[]);
+
+    /**
+     * Log in binary mode: no formatting on the calling thread.
+     * The format must be a string literal (only its address is stored), and each "{}"
+     * in it is replaced by the next argument when the entry is popped.
+     * Arguments can be integers, floating point values, bools or C strings (copied,
+     * up to MAX_STRING_ARG_LENGTH characters).
+     * Example: rtlogger.logBinary("Onset at {} ms, block {}", timeMs, blockIdx);
+     * @return false if the record ring is full (the entry is dropped)
+     */
+    template <size_t N, typename... Args>
+    bool logBinary(const char (&format)[N], const Args&... args);
+
+    /** Pop the oldest entry, text or binary (binary entries are formatted here) */
     bool pop(LogEntry& logEntry);
 
     std::string getName() const { return this->name; }
 private:
+    enum ArgType : uint8 { ARG_INT = 0, ARG_UINT, ARG_DOUBLE, ARG_STRING };
+
+    /** Header of a binary record, followed by the arguments (1 byte type + value) */
+    struct RecordHeader {
+        uint32 size;        // Total size of the record (read by BinaryLogRing)
+        uint32 numArgs;
+        const char* format;
+        int64 timestamp;
+        uint64 sequence;
+    };
+
+    template <typename T>
+    static uint32 argSize(const T&)
+    {
+        static_assert(std::is_arithmetic<T>::value, "logBinary arguments must be numbers, bools or C strings");
+        return 1 + 8;
+    }
+    static uint32 argSize(const char* value)
+    {
+        return 1 + 1 + (uint32)strnlen(value, MAX_STRING_ARG_LENGTH);
+    }
+    static uint32 argSize(char* value) { return argSize((const char*)value); }
+
+    template <typename T>
+    static uint8* writeArg(uint8* dest, const T& value)
+    {
+        if (std::is_floating_point<T>::value)
+        {
+            *dest = ARG_DOUBLE;
+            const double v = (double)value;
+            std::memcpy(dest + 1, &v, 8);
+        }
+        else if (std::is_signed<T>::value)
+        {
+            *dest = ARG_INT;
+            const int64 v = (int64)value;
+            std::memcpy(dest + 1, &v, 8);
+        }
+        else
+        {
+            *dest = ARG_UINT;
+            const uint64 v = (uint64)value;
+            std::memcpy(dest + 1, &v, 8);
+        }
+        return dest + 9;
+    }
+    static uint8* writeArg(uint8* dest, const char* value)
+    {
+        const uint8 length = (uint8)strnlen(value, MAX_STRING_ARG_LENGTH);
+        dest[0] = ARG_STRING;
+        dest[1] = length;
+        std::memcpy(dest + 2, value, length);
+        return dest + 2 + length;
+    }
+    static uint8* writeArg(uint8* dest, char* value) { return writeArg(dest, (const char*)value); }
+
+    bool popBinary(LogEntry& logEntry);
+
+    uint64 nextSequence() { return this->sequence.fetch_add(1, std::memory_order_relaxed); }
+
     choc::fifo::SingleReaderSingleWriterFIFO<RealTimeLogger::LogEntry> fifoBuffer;
+    BinaryLogRing binaryRing { LOG_BINARY_BYTES };
+    std::atomic<uint64> sequence{0};
+    // Heads of the two queues already taken by pop() (consumer side)
+    LogEntry pendingText, pendingBinary;
+    bool hasPendingText = false, hasPendingBinary = false;
     std::string name = "";
 };
 
@@ -65,6 +268,8 @@ inline bool RealTimeLogger::logInfo(const char message[], int64 timeAtStart, int
     LogEntry logEntry;
     logEntry.timeAtStart = timeAtStart;
     logEntry.timeAtEnd = timeAtEnd;
+    logEntry.timestamp = juce::Time::getHighResolutionTicks();
+    logEntry.sequence = nextSequence();
     strncpy(logEntry.message, message, LogEntry::MESSAGE_LENGTH);
     logEntry.message[LogEntry::MESSAGE_LENGTH] = '\0';
     return fifoBuffer.push(logEntry);
@@ -85,12 +290,124 @@ inline bool RealTimeLogger::logInfo(const char message[], const char suffix[])
     }
 }
 
+template <size_t N, typename... Args>
+inline bool RealTimeLogger::logBinary(const char (&format)[N], const Args&... args)
+{
+    uint32 size = sizeof(RecordHeader);
+    for (uint32 s : {0u, argSize(args)...})
+        size += s;
+
+    uint8* record = binaryRing.prepareWrite(size);
+    if (record == nullptr)
+        return false;
+
+    RecordHeader header;
+    header.size = size;
+    header.numArgs = sizeof...(Args);
+    header.format = format;
+    header.timestamp = juce::Time::getHighResolutionTicks();
+    header.sequence = nextSequence();
+    std::memcpy(record, &header, sizeof(header));
+
+    uint8* dest = record + sizeof(RecordHeader);
+    (void)dest;
+    (void)std::initializer_list<int>{0, (dest = writeArg(dest, args), 0)...};
+
+    binaryRing.finishWrite();
+    return true;
+}
+
 /** Pop safely an element from the fifo buffer
  *  Do this from a non RT thread if you intend on writing to a file
 */
 inline bool RealTimeLogger::pop(LogEntry& logEntry)
 {
-    return fifoBuffer.pop(logEntry);
+    // The binary ring is read first: a text entry logged before the binary head is then visible too
+    if (!this->hasPendingBinary)
+        this->hasPendingBinary = popBinary(this->pendingBinary);
+    if (!this->hasPendingText)
+        this->hasPendingText = fifoBuffer.pop(this->pendingText);
+    if (!this->hasPendingText && !this->hasPendingBinary)
+        return false;
+
+    const bool textFirst = this->hasPendingText && (!this->hasPendingBinary || this->pendingText.sequence < this->pendingBinary.sequence);
+    if (textFirst)
+    {
+        logEntry = this->pendingText;
+        this->hasPendingText = false;
+    }
+    else
+    {
+        logEntry = this->pendingBinary;
+        this->hasPendingBinary = false;
+    }
+    return true;
+}
+
+/** Pop a binary record and format it (consumer thread) */
+inline bool RealTimeLogger::popBinary(LogEntry& logEntry)
+{
+    const uint8* record = binaryRing.prepareRead();
+    if (record == nullptr)
+        return false;
+
+    RecordHeader header;
+    std::memcpy(&header, record, sizeof(header));
+    const uint8* arg = record + sizeof(RecordHeader);
+    uint32 argsLeft = header.numArgs;
+
+    std::string text;
+    for (const char* c = header.format; *c != '\0'; ++c)
+    {
+        if (c[0] != '{' || c[1] != '}' || argsLeft == 0)
+        {
+            text += *c;
+            continue;
+        }
+        ++c; // Skip "}"
+        --argsLeft;
+        char valueText[MAX_STRING_ARG_LENGTH+1];
+        switch (arg[0])
+        {
+            case ARG_INT: {
+                int64 v;
+                std::memcpy(&v, arg + 1, 8);
+                snprintf(valueText, sizeof(valueText), "%lld", (long long)v);
+                arg += 9;
+                break;
+            }
+            case ARG_UINT: {
+                uint64 v;
+                std::memcpy(&v, arg + 1, 8);
+                snprintf(valueText, sizeof(valueText), "%llu", (unsigned long long)v);
+                arg += 9;
+                break;
+            }
+            case ARG_DOUBLE: {
+                double v;
+                std::memcpy(&v, arg + 1, 8);
+                snprintf(valueText, sizeof(valueText), "%f", v);
+                arg += 9;
+                break;
+            }
+            default: { // ARG_STRING
+                std::memcpy(valueText, arg + 2, arg[1]);
+                valueText[arg[1]] = '\0';
+                arg += 2 + arg[1];
+                break;
+            }
+        }
+        text += valueText;
+    }
+    binaryRing.finishRead();
+
+    logEntry.timeAtStart = 0;
+    logEntry.timeAtEnd = 0;
+    logEntry.timestamp = header.timestamp;
+    logEntry.sequence = header.sequence;
+    strncpy(logEntry.message, text.c_str(), LogEntry::MESSAGE_LENGTH);
+    logEntry.message[LogEntry::MESSAGE_LENGTH] = '\0';
+    return true;
 }
 
 inline bool RealTimeLogger::logValue(const char message[], int value, const char suffix[])
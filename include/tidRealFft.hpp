@@ -0,0 +1,724 @@
+/*
+
+tidRealFft - Built-in real FFT (no external dependency)
+Author: Domenico Stefani (domenico.stefani96@gmail.com)
+
+FFT backend of the spectral modules when the library is built with
+TID_FFT_BACKEND=TID_FFT_BACKEND_BUILTIN (see tidFft.hpp), and a portable
+alternative to FFTW for cross-builds.
+
+Power-of-two sizes, like the 256-sample windows of WFE::FeatureExtractors,
+compute a real FFT of size n as a complex FFT of size n/2 on the even/odd
+samples, followed by a split step. The complex FFT works on separate real and
+imaginary arrays, so the radix-2 butterflies of a stage run four at a time
+with SSE or NEON. Other sizes use Bluestein's algorithm on a power-of-two
+complex FFT, so every window size the modules accept is supported.
+
+The spectrum layout is the one of FFTW: n/2+1 interleaved complex values
+(re, im), and the inverse is not normalized (forward then inverse gives n*x).
+
+InterleavedRealFft transforms up to eight signals at once (the channels of
+the multi-channel modules), one SIMD lane per signal, with the arithmetic of
+RealFft in every lane. With SSE or NEON a vector holds four signals, the same
+width RealFft uses for the butterflies of one signal, so the gain comes from
+the stages RealFft runs in scalar code (bit reversal, first two stages, split
+step and power) and from the fused stages. Built with AVX (-mavx, see
+TID_USE_AVX in CMakeLists.txt) a vector holds all eight.
+
+*/
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#ifndef M_PI
+#define M_PI 3.1415926535897932384626433832795
+#endif
+
+#if defined(__AVX__) || defined(__SSE__) || defined(_M_X64)
+#include <immintrin.h>
+#define TIDFFT_USE_SSE 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define TIDFFT_USE_NEON 1
+#endif
+
+namespace tid   /* TimbreID namespace*/
+{
+namespace fft
+{
+
+class RealFft
+{
+public:
+    /**
+     * Precompute the tables for transforms of size n.
+     * It allocates memory, do not call it from a real-time thread.
+    */
+    void prepare(size_t n)
+    {
+        if (n < 1)
+            throw std::invalid_argument("FFT size must be 1 or greater");
+        this->size = n;
+        this->powerOfTwo = n >= 2 && (n & (n - 1)) == 0;
+
+        if (this->powerOfTwo)
+        {
+            const size_t half = n / 2;
+            prepareComplex(half);
+            this->splitRe.resize(half);
+            this->splitIm.resize(half);
+            for (size_t k = 0; k < half; ++k)
+            {
+                const double angle = -2.0 * M_PI * (double)k / (double)n;
+                this->splitRe[k] = (float)std::cos(angle);
+                this->splitIm[k] = (float)std::sin(angle);
+            }
+            this->chirpRe.clear();
+            this->chirpIm.clear();
+            this->kernelRe.clear();
+            this->kernelIm.clear();
+        }
+        else
+            prepareBluestein(n);
+    }
+
+    size_t getSize() const noexcept { return this->size; }
+
+    /**
+     * Forward transform
+     * @param input n real samples
+     * @param output n/2+1 complex values, interleaved (2*(n/2+1) floats)
+    */
+    void forward(const float* input, float* output) noexcept
+    {
+        if (this->powerOfTwo)
+            forwardPowerOfTwo(input, output);
+        else
+            forwardBluestein(input, output);
+    }
+
+    /**
+     * Inverse transform, not normalized. The imaginary parts of the DC and
+     * Nyquist values are ignored, like in FFTW's complex to real transforms.
+     * @param input n/2+1 complex values, interleaved
+     * @param output n real samples
+    */
+    void inverse(const float* input, float* output) noexcept
+    {
+        if (this->powerOfTwo)
+            inversePowerOfTwo(input, output);
+        else
+            inverseBluestein(input, output);
+    }
+
+private:
+    //==========================================================================
+    // Complex FFT of size fftSize (power of two), decimation in time on split arrays
+
+    void prepareComplex(size_t n)
+    {
+        this->fftSize = n;
+        unsigned int bits = 0;
+        while (((size_t)1 << bits) < n)
+            ++bits;
+
+        this->bitReverse.resize(n);
+        for (size_t i = 0; i < n; ++i)
+        {
+            uint32_t reversed = 0;
+            for (unsigned int b = 0; b < bits; ++b)
+                reversed |= (uint32_t)((i >> b) & 1) << (bits - 1 - b);
+            this->bitReverse[i] = reversed;
+        }
+
+        // Twiddles of the stage with half-length h are at [h-1, 2h-1)
+        this->twiddleRe.resize(n > 1 ? n - 1 : 0);
+        this->twiddleIm.resize(n > 1 ? n - 1 : 0);
+        for (size_t h = 1; h < n; h <<= 1)
+            for (size_t j = 0; j < h; ++j)
+            {
+                const double angle = -M_PI * (double)j / (double)h;
+                this->twiddleRe[h - 1 + j] = (float)std::cos(angle);
+                this->twiddleIm[h - 1 + j] = (float)std::sin(angle);
+            }
+
+        this->workRe.assign(n, 0.0f);
+        this->workIm.assign(n, 0.0f);
+    }
+
+    /** In-place forward FFT, from bit-reversed to natural order (swap re and im for the inverse) */
+    void transform(float* re, float* im) const noexcept
+    {
+        const size_t n = this->fftSize;
+        size_t h = 1;
+
+        // First two stages together (twiddles 1 and -i)
+        if (n >= 4)
+        {
+            for (size_t s = 0; s < n; s += 4)
+            {
+                const float r0 = re[s] + re[s + 1], i0 = im[s] + im[s + 1];
+                const float r1 = re[s] - re[s + 1], i1 = im[s] - im[s + 1];
+                const float r2 = re[s + 2] + re[s + 3], i2 = im[s + 2] + im[s + 3];
+                const float r3 = re[s + 2] - re[s + 3], i3 = im[s + 2] - im[s + 3];
+                re[s] = r0 + r2;     im[s] = i0 + i2;
+                re[s + 2] = r0 - r2; im[s + 2] = i0 - i2;
+                re[s + 1] = r1 + i3; im[s + 1] = i1 - r3;
+                re[s + 3] = r1 - i3; im[s + 3] = i1 + r3;
+            }
+            h = 4;
+        }
+
+        for (; h < n; h <<= 1)
+        {
+            const float* wr = &this->twiddleRe[h - 1];
+            const float* wi = &this->twiddleIm[h - 1];
+            for (size_t s = 0; s < n; s += 2 * h)
+            {
+                float *ar = re + s, *ai = im + s, *br = re + s + h, *bi = im + s + h;
+                size_t j = 0;
+#if defined(TIDFFT_USE_SSE)
+                for (; j + 4 <= h; j += 4)
+                {
+                    const __m128 twr = _mm_loadu_ps(wr + j), twi = _mm_loadu_ps(wi + j);
+                    const __m128 xr = _mm_loadu_ps(br + j), xi = _mm_loadu_ps(bi + j);
+                    const __m128 tr = _mm_sub_ps(_mm_mul_ps(xr, twr), _mm_mul_ps(xi, twi));
+                    const __m128 ti = _mm_add_ps(_mm_mul_ps(xr, twi), _mm_mul_ps(xi, twr));
+                    const __m128 yr = _mm_loadu_ps(ar + j), yi = _mm_loadu_ps(ai + j);
+                    _mm_storeu_ps(br + j, _mm_sub_ps(yr, tr));
+                    _mm_storeu_ps(bi + j, _mm_sub_ps(yi, ti));
+                    _mm_storeu_ps(ar + j, _mm_add_ps(yr, tr));
+                    _mm_storeu_ps(ai + j, _mm_add_ps(yi, ti));
+                }
+#elif defined(TIDFFT_USE_NEON)
+                for (; j + 4 <= h; j += 4)
+                {
+                    const float32x4_t twr = vld1q_f32(wr + j), twi = vld1q_f32(wi + j);
+                    const float32x4_t xr = vld1q_f32(br + j), xi = vld1q_f32(bi + j);
+                    const float32x4_t tr = vmlsq_f32(vmulq_f32(xr, twr), xi, twi);
+                    const float32x4_t ti = vmlaq_f32(vmulq_f32(xr, twi), xi, twr);
+                    const float32x4_t yr = vld1q_f32(ar + j), yi = vld1q_f32(ai + j);
+                    vst1q_f32(br + j, vsubq_f32(yr, tr));
+                    vst1q_f32(bi + j, vsubq_f32(yi, ti));
+                    vst1q_f32(ar + j, vaddq_f32(yr, tr));
+                    vst1q_f32(ai + j, vaddq_f32(yi, ti));
+                }
+#endif
+                for (; j < h; ++j)
+                {
+                    const float tr = br[j] * wr[j] - bi[j] * wi[j];
+                    const float ti = br[j] * wi[j] + bi[j] * wr[j];
+                    br[j] = ar[j] - tr;
+                    bi[j] = ai[j] - ti;
+                    ar[j] += tr;
+                    ai[j] += ti;
+                }
+            }
+        }
+    }
+
+    /** In-place bit-reversal permutation of the work arrays */
+    void permuteWork() noexcept
+    {
+        for (size_t i = 0; i < this->fftSize; ++i)
+        {
+            const size_t j = this->bitReverse[i];
+            if (i < j)
+            {
+                std::swap(this->workRe[i], this->workRe[j]);
+                std::swap(this->workIm[i], this->workIm[j]);
+            }
+        }
+    }
+
+    //==========================================================================
+    // Power-of-two real transform: half-size complex FFT and split step
+
+    void forwardPowerOfTwo(const float* input, float* output) noexcept
+    {
+        const size_t half = this->fftSize;
+        float* re = this->workRe.data();
+        float* im = this->workIm.data();
+        for (size_t k = 0; k < half; ++k)
+        {
+            re[this->bitReverse[k]] = input[2 * k];
+            im[this->bitReverse[k]] = input[2 * k + 1];
+        }
+        transform(re, im);
+
+        // X[k] = E[k] + W^k O[k], with E and O the spectra of the even and odd samples
+        output[0] = re[0] + im[0];
+        output[1] = 0.0f;
+        output[2 * half] = re[0] - im[0];
+        output[2 * half + 1] = 0.0f;
+        for (size_t k = 1; k < half; ++k)
+        {
+            const float zr = re[k], zi = im[k], cr = re[half - k], ci = -im[half - k];
+            const float er = 0.5f * (zr + cr), ei = 0.5f * (zi + ci);
+            const float orr = 0.5f * (zi - ci), oi = -0.5f * (zr - cr);
+            output[2 * k] = er + this->splitRe[k] * orr - this->splitIm[k] * oi;
+            output[2 * k + 1] = ei + this->splitRe[k] * oi + this->splitIm[k] * orr;
+        }
+    }
+
+    void inversePowerOfTwo(const float* input, float* output) noexcept
+    {
+        const size_t half = this->fftSize;
+        float* re = this->workRe.data();
+        float* im = this->workIm.data();
+
+        // Z[k] = E[k] + i O[k], E[k] = X[k] + conj(X[half-k]), O[k] = (X[k] - conj(X[half-k])) conj(W^k)
+        for (size_t k = 0; k < half; ++k)
+        {
+            const float xr = input[2 * k], xi = (k == 0) ? 0.0f : input[2 * k + 1];
+            const float cr = input[2 * (half - k)], ci = (k == 0) ? 0.0f : -input[2 * (half - k) + 1];
+            const float er = xr + cr, ei = xi + ci;
+            const float dr = xr - cr, di = xi - ci;
+            const float orr = dr * this->splitRe[k] + di * this->splitIm[k];
+            const float oi = di * this->splitRe[k] - dr * this->splitIm[k];
+            // Conjugated, so that the forward transform computes the inverse
+            re[this->bitReverse[k]] = er - oi;
+            im[this->bitReverse[k]] = -(ei + orr);
+        }
+        transform(re, im);
+        for (size_t k = 0; k < half; ++k)
+        {
+            output[2 * k] = re[k];
+            output[2 * k + 1] = -im[k];
+        }
+    }
+
+    //==========================================================================
+    // Bluestein: X[k] = conj(c[k]) sum_j (x[j] conj(c[j])) c[k-j], c[j] = exp(i pi j^2 / n)
+
+    void prepareBluestein(size_t n)
+    {
+        size_t m = 1;
+        while (m < 2 * n - 1)
+            m <<= 1;
+        prepareComplex(m);
+
+        this->chirpRe.resize(n);
+        this->chirpIm.resize(n);
+        for (size_t j = 0; j < n; ++j)
+        {
+            const double angle = M_PI * (double)((uint64_t)j * j % (2 * (uint64_t)n)) / (double)n;
+            this->chirpRe[j] = (float)std::cos(angle);
+            this->chirpIm[j] = (float)std::sin(angle);
+        }
+
+        // FFT of the chirp (wrapped around for negative indices), scaled by 1/m for the inverse
+        std::fill(this->workRe.begin(), this->workRe.end(), 0.0f);
+        std::fill(this->workIm.begin(), this->workIm.end(), 0.0f);
+        for (size_t j = 0; j < n; ++j)
+        {
+            this->workRe[j] = this->chirpRe[j];
+            this->workIm[j] = this->chirpIm[j];
+            if (j > 0)
+            {
+                this->workRe[m - j] = this->chirpRe[j];
+                this->workIm[m - j] = this->chirpIm[j];
+            }
+        }
+        permuteWork();
+        transform(this->workRe.data(), this->workIm.data());
+        this->kernelRe.resize(m);
+        this->kernelIm.resize(m);
+        for (size_t k = 0; k < m; ++k)
+        {
+            this->kernelRe[k] = this->workRe[k] / (float)m;
+            this->kernelIm[k] = this->workIm[k] / (float)m;
+        }
+        this->splitRe.clear();
+        this->splitIm.clear();
+    }
+
+    /** Circular convolution of the work arrays (natural order) with the chirp */
+    void convolveWithChirp() noexcept
+    {
+        permuteWork();
+        transform(this->workRe.data(), this->workIm.data());
+        for (size_t k = 0; k < this->fftSize; ++k)
+        {
+            const float ar = this->workRe[k], ai = this->workIm[k];
+            // Conjugated product, the forward transform of the conjugate gives the conjugated inverse
+            this->workRe[k] = ar * this->kernelRe[k] - ai * this->kernelIm[k];
+            this->workIm[k] = -(ar * this->kernelIm[k] + ai * this->kernelRe[k]);
+        }
+        permuteWork();
+        transform(this->workRe.data(), this->workIm.data());
+        for (size_t k = 0; k < this->fftSize; ++k)
+            this->workIm[k] = -this->workIm[k];
+    }
+
+    void forwardBluestein(const float* input, float* output) noexcept
+    {
+        const size_t n = this->size;
+        std::fill(this->workRe.begin(), this->workRe.end(), 0.0f);
+        std::fill(this->workIm.begin(), this->workIm.end(), 0.0f);
+        for (size_t j = 0; j < n; ++j)
+        {
+            this->workRe[j] = input[j] * this->chirpRe[j];
+            this->workIm[j] = -input[j] * this->chirpIm[j];
+        }
+        convolveWithChirp();
+        for (size_t k = 0; k <= n / 2; ++k)
+        {
+            const float cr = this->workRe[k], ci = this->workIm[k];
+            output[2 * k] = cr * this->chirpRe[k] + ci * this->chirpIm[k];
+            output[2 * k + 1] = ci * this->chirpRe[k] - cr * this->chirpIm[k];
+        }
+    }
+
+    /** x[t] = Re(sum_k Y[k] exp(2 pi i k t / n)), Y the hermitian extension of the input */
+    void inverseBluestein(const float* input, float* output) noexcept
+    {
+        const size_t n = this->size;
+        std::fill(this->workRe.begin(), this->workRe.end(), 0.0f);
+        std::fill(this->workIm.begin(), this->workIm.end(), 0.0f);
+        for (size_t k = 0; k < n; ++k)
+        {
+            // conj(Y[k]) * conj(c[k])
+            float yr, yi;
+            if (k <= n / 2)
+            {
+                yr = input[2 * k];
+                yi = (k == 0 || 2 * k == n) ? 0.0f : input[2 * k + 1];
+            }
+            else
+            {
+                yr = input[2 * (n - k)];
+                yi = -input[2 * (n - k) + 1];
+            }
+            this->workRe[k] = yr * this->chirpRe[k] - yi * this->chirpIm[k];
+            this->workIm[k] = -(yr * this->chirpIm[k] + yi * this->chirpRe[k]);
+        }
+        convolveWithChirp();
+        for (size_t t = 0; t < n; ++t)
+            output[t] = this->workRe[t] * this->chirpRe[t] + this->workIm[t] * this->chirpIm[t];
+    }
+
+    //==========================================================================
+
+    size_t size = 0;
+    bool powerOfTwo = false;
+
+    size_t fftSize = 0;
+    std::vector<uint32_t> bitReverse;
+    std::vector<float> twiddleRe, twiddleIm;
+    std::vector<float> workRe, workIm;
+
+    std::vector<float> splitRe, splitIm;    // W^k = exp(-2 pi i k / n), power-of-two sizes
+    std::vector<float> chirpRe, chirpIm;    // Bluestein chirp c[j]
+    std::vector<float> kernelRe, kernelIm;  // FFT of the chirp, divided by fftSize
+};
+
+/**
+ * Lanes of an InterleavedRealFft: four with SSE, NEON or plain floats
+ * (FftLanes4), eight with AVX (FftLanes8).
+ * Only the separate operations of RealFft (no fused multiply-add), so every
+ * lane rounds like the scalar code.
+*/
+struct FftLanes4
+{
+    static constexpr size_t WIDTH = 4;
+#if defined(TIDFFT_USE_SSE)
+    __m128 v;
+    static FftLanes4 load(const float* p) noexcept { return {_mm_loadu_ps(p)}; }
+    static FftLanes4 broadcast(float x) noexcept { return {_mm_set1_ps(x)}; }
+    void store(float* p) const noexcept { _mm_storeu_ps(p, this->v); }
+    friend FftLanes4 operator+(FftLanes4 a, FftLanes4 b) noexcept { return {_mm_add_ps(a.v, b.v)}; }
+    friend FftLanes4 operator-(FftLanes4 a, FftLanes4 b) noexcept { return {_mm_sub_ps(a.v, b.v)}; }
+    friend FftLanes4 operator*(FftLanes4 a, FftLanes4 b) noexcept { return {_mm_mul_ps(a.v, b.v)}; }
+    friend FftLanes4 operator-(FftLanes4 a) noexcept { return {_mm_xor_ps(a.v, _mm_set1_ps(-0.0f))}; }
+    friend FftLanes4 sqrt(FftLanes4 a) noexcept { return {_mm_sqrt_ps(a.v)}; }
+#elif defined(TIDFFT_USE_NEON)
+    float32x4_t v;
+    static FftLanes4 load(const float* p) noexcept { return {vld1q_f32(p)}; }
+    static FftLanes4 broadcast(float x) noexcept { return {vdupq_n_f32(x)}; }
+    void store(float* p) const noexcept { vst1q_f32(p, this->v); }
+    friend FftLanes4 operator+(FftLanes4 a, FftLanes4 b) noexcept { return {vaddq_f32(a.v, b.v)}; }
+    friend FftLanes4 operator-(FftLanes4 a, FftLanes4 b) noexcept { return {vsubq_f32(a.v, b.v)}; }
+    friend FftLanes4 operator*(FftLanes4 a, FftLanes4 b) noexcept { return {vmulq_f32(a.v, b.v)}; }
+    friend FftLanes4 operator-(FftLanes4 a) noexcept { return {vnegq_f32(a.v)}; }
+#if defined(__aarch64__)
+    friend FftLanes4 sqrt(FftLanes4 a) noexcept { return {vsqrtq_f32(a.v)}; }
+#else
+    friend FftLanes4 sqrt(FftLanes4 a) noexcept
+    {
+        float x[4];
+        vst1q_f32(x, a.v);
+        for (float& value : x)
+            value = std::sqrt(value);
+        return {vld1q_f32(x)};
+    }
+#endif
+#else
+    float v[4];
+    static FftLanes4 load(const float* p) noexcept { return {{p[0], p[1], p[2], p[3]}}; }
+    static FftLanes4 broadcast(float x) noexcept { return {{x, x, x, x}}; }
+    void store(float* p) const noexcept { std::copy(this->v, this->v + 4, p); }
+    friend FftLanes4 operator+(FftLanes4 a, FftLanes4 b) noexcept { return {{a.v[0] + b.v[0], a.v[1] + b.v[1], a.v[2] + b.v[2], a.v[3] + b.v[3]}}; }
+    friend FftLanes4 operator-(FftLanes4 a, FftLanes4 b) noexcept { return {{a.v[0] - b.v[0], a.v[1] - b.v[1], a.v[2] - b.v[2], a.v[3] - b.v[3]}}; }
+    friend FftLanes4 operator*(FftLanes4 a, FftLanes4 b) noexcept { return {{a.v[0] * b.v[0], a.v[1] * b.v[1], a.v[2] * b.v[2], a.v[3] * b.v[3]}}; }
+    friend FftLanes4 operator-(FftLanes4 a) noexcept { return {{-a.v[0], -a.v[1], -a.v[2], -a.v[3]}}; }
+    friend FftLanes4 sqrt(FftLanes4 a) noexcept { return {{std::sqrt(a.v[0]), std::sqrt(a.v[1]), std::sqrt(a.v[2]), std::sqrt(a.v[3])}}; }
+#endif
+};
+
+#if defined(__AVX__)
+struct FftLanes8
+{
+    static constexpr size_t WIDTH = 8;
+    __m256 v;
+    static FftLanes8 load(const float* p) noexcept { return {_mm256_loadu_ps(p)}; }
+    static FftLanes8 broadcast(float x) noexcept { return {_mm256_set1_ps(x)}; }
+    void store(float* p) const noexcept { _mm256_storeu_ps(p, this->v); }
+    friend FftLanes8 operator+(FftLanes8 a, FftLanes8 b) noexcept { return {_mm256_add_ps(a.v, b.v)}; }
+    friend FftLanes8 operator-(FftLanes8 a, FftLanes8 b) noexcept { return {_mm256_sub_ps(a.v, b.v)}; }
+    friend FftLanes8 operator*(FftLanes8 a, FftLanes8 b) noexcept { return {_mm256_mul_ps(a.v, b.v)}; }
+    friend FftLanes8 operator-(FftLanes8 a) noexcept { return {_mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f))}; }
+    friend FftLanes8 sqrt(FftLanes8 a) noexcept { return {_mm256_sqrt_ps(a.v)}; }
+};
+#endif
+
+/**
+ * Real FFT of up to LANES signals at once, one SIMD lane per signal.
+ * Signals and spectra are interleaved: sample t of signal c at
+ * [t*getNumLanes() + c], bin k of signal c at [k*LANES + c].
+ * Every lane does the operations of RealFft in the same order, so each signal
+ * gets the spectrum RealFft computes for it alone.
+ * Power-of-two sizes only (see isSupportedSize). Only the lanes that hold the
+ * signals are computed: four up to four signals, else eight (one AVX vector,
+ * or two vectors of four transformed in turn). Each vector has its own
+ * contiguous work arrays, that stay in the L1 cache for the demo windows.
+*/
+class InterleavedRealFft
+{
+public:
+    static constexpr size_t LANES = 8;
+
+    static bool isSupportedSize(size_t n) noexcept { return n >= 2 && (n & (n - 1)) == 0; }
+
+    /**
+     * Precompute the tables for transforms of size n of numSignals signals.
+     * It allocates memory, do not call it from a real-time thread.
+    */
+    void prepare(size_t n, unsigned int numSignals)
+    {
+        if (!isSupportedSize(n))
+            throw std::invalid_argument("The interleaved FFT size must be a power of two (found " + std::to_string(n) + ")");
+        if (numSignals < 1 || numSignals > LANES)
+            throw std::invalid_argument("The interleaved FFT transforms 1 to " + std::to_string(LANES) + " signals");
+        this->size = n;
+        this->numLanes = (numSignals <= 4) ? 4 : 8;
+
+        const size_t half = n / 2;
+        unsigned int bits = 0;
+        while (((size_t)1 << bits) < half)
+            ++bits;
+        this->bitReverse.resize(half);
+        for (size_t i = 0; i < half; ++i)
+        {
+            uint32_t reversed = 0;
+            for (unsigned int b = 0; b < bits; ++b)
+                reversed |= (uint32_t)((i >> b) & 1) << (bits - 1 - b);
+            this->bitReverse[i] = reversed;
+        }
+
+        // Same tables of RealFft
+        this->twiddleRe.resize(half > 1 ? half - 1 : 0);
+        this->twiddleIm.resize(half > 1 ? half - 1 : 0);
+        for (size_t h = 1; h < half; h <<= 1)
+            for (size_t j = 0; j < h; ++j)
+            {
+                const double angle = -M_PI * (double)j / (double)h;
+                this->twiddleRe[h - 1 + j] = (float)std::cos(angle);
+                this->twiddleIm[h - 1 + j] = (float)std::sin(angle);
+            }
+        this->splitRe.resize(half);
+        this->splitIm.resize(half);
+        for (size_t k = 0; k < half; ++k)
+        {
+            const double angle = -2.0 * M_PI * (double)k / (double)n;
+            this->splitRe[k] = (float)std::cos(angle);
+            this->splitIm[k] = (float)std::sin(angle);
+        }
+
+        this->workRe.assign(half * this->numLanes, 0.0f);
+        this->workIm.assign(half * this->numLanes, 0.0f);
+    }
+
+    size_t getSize() const noexcept { return this->size; }
+
+    /** Lanes of the input signals, 4 up to four signals, else 8 */
+    size_t getNumLanes() const noexcept { return this->numLanes; }
+
+    /**
+     * Power spectrum of every signal, re^2 + im^2 as tIDLib::power
+     * (or its square root, the magnitude spectrum)
+     * @param input n x getNumLanes() interleaved samples
+     * @param output (n/2+1) x LANES interleaved values (the lanes of the signals)
+    */
+    void forwardPower(const float* input, float* output, bool magnitude) noexcept
+    {
+#if defined(__AVX__)
+        if (this->numLanes == 8)
+        {
+            forwardPowerLanes<FftLanes8>(input, output, magnitude);
+            return;
+        }
+#endif
+        forwardPowerLanes<FftLanes4>(input, output, magnitude);
+    }
+
+private:
+    /**
+     * RealFft::forwardPowerOfTwo and tIDLib::power, on each vector V of lanes
+     * in turn. The work arrays of a vector are contiguous (n/2 x V::WIDTH).
+    */
+    template <typename V>
+    void forwardPowerLanes(const float* input, float* output, bool magnitude) noexcept
+    {
+        constexpr size_t W = V::WIDTH;
+        const size_t half = this->size / 2;
+        const V zero = V::broadcast(0.0f), plusHalf = V::broadcast(0.5f), minusHalf = V::broadcast(-0.5f);
+        auto storePower = [&output, magnitude](size_t k, V xr, V xi) {
+            V power = (xr * xr) + (xi * xi);
+            if (magnitude)
+                power = sqrt(power);
+            power.store(output + k * LANES);
+        };
+
+        for (size_t lane = 0; lane < this->numLanes; lane += W, input += W, output += W)
+        {
+            float* re = this->workRe.data() + lane * half;
+            float* im = this->workIm.data() + lane * half;
+            for (size_t k = 0; k < half; ++k)
+            {
+                V::load(input + (2 * k) * this->numLanes).store(re + this->bitReverse[k] * W);
+                V::load(input + (2 * k + 1) * this->numLanes).store(im + this->bitReverse[k] * W);
+            }
+            transform<V>(re, im);
+
+            // X[k] = E[k] + W^k O[k], with E and O the spectra of the even and odd samples
+            const V r0 = V::load(re), i0 = V::load(im);
+            storePower(0, r0 + i0, zero);
+            storePower(half, r0 - i0, zero);
+            for (size_t k = 1; k < half; ++k)
+            {
+                const V wr = V::broadcast(this->splitRe[k]), wi = V::broadcast(this->splitIm[k]);
+                const V zr = V::load(re + k * W), zi = V::load(im + k * W);
+                const V cr = V::load(re + (half - k) * W), ci = -V::load(im + (half - k) * W);
+                const V er = plusHalf * (zr + cr), ei = plusHalf * (zi + ci);
+                const V orr = plusHalf * (zi - ci), oi = minusHalf * (zr - cr);
+                storePower(k, er + wr * orr - wi * oi, ei + wr * oi + wi * orr);
+            }
+        }
+    }
+
+    /** Butterfly of RealFft::transform: a, b = a + w b, a - w b */
+    template <typename V>
+    static inline void butterfly(V& ar, V& ai, V& br, V& bi, V wr, V wi) noexcept
+    {
+        const V tr = br * wr - bi * wi;
+        const V ti = br * wi + bi * wr;
+        br = ar - tr;
+        bi = ai - ti;
+        ar = ar + tr;
+        ai = ai + ti;
+    }
+
+    /**
+     * RealFft::transform on n/2 x V::WIDTH work arrays. The stages of
+     * half-length h and 2h run together on four points at a time, with the
+     * butterflies of RealFft: only the memory passes are halved.
+    */
+    template <typename V>
+    void transform(float* re, float* im) const noexcept
+    {
+        constexpr size_t W = V::WIDTH;
+        const size_t n = this->size / 2;
+        size_t h = 1;
+
+        // First two stages together (twiddles 1 and -i)
+        if (n >= 4)
+        {
+            for (size_t s = 0; s < n; s += 4)
+            {
+                float *pr = re + s * W, *pi = im + s * W;
+                const V a0r = V::load(pr), a1r = V::load(pr + W), a2r = V::load(pr + 2 * W), a3r = V::load(pr + 3 * W);
+                const V a0i = V::load(pi), a1i = V::load(pi + W), a2i = V::load(pi + 2 * W), a3i = V::load(pi + 3 * W);
+                const V r0 = a0r + a1r, i0 = a0i + a1i;
+                const V r1 = a0r - a1r, i1 = a0i - a1i;
+                const V r2 = a2r + a3r, i2 = a2i + a3i;
+                const V r3 = a2r - a3r, i3 = a2i - a3i;
+                (r0 + r2).store(pr);         (i0 + i2).store(pi);
+                (r0 - r2).store(pr + 2 * W); (i0 - i2).store(pi + 2 * W);
+                (r1 + i3).store(pr + W);     (i1 - r3).store(pi + W);
+                (r1 - i3).store(pr + 3 * W); (i1 + r3).store(pi + 3 * W);
+            }
+            h = 4;
+        }
+
+        // Stages h and 2h: points j, j+h, j+2h, j+3h of each block of 4h
+        for (; 2 * h < n; h <<= 2)
+        {
+            const float* wr = &this->twiddleRe[h - 1];
+            const float* wi = &this->twiddleIm[h - 1];
+            const float* wr2 = &this->twiddleRe[2 * h - 1];
+            const float* wi2 = &this->twiddleIm[2 * h - 1];
+            for (size_t s = 0; s < n; s += 4 * h)
+                for (size_t j = 0; j < h; ++j)
+                {
+                    float *pr = re + (s + j) * W, *pi = im + (s + j) * W;
+                    V ar = V::load(pr), ai = V::load(pi);
+                    V br = V::load(pr + h * W), bi = V::load(pi + h * W);
+                    V cr = V::load(pr + 2 * h * W), ci = V::load(pi + 2 * h * W);
+                    V dr = V::load(pr + 3 * h * W), di = V::load(pi + 3 * h * W);
+                    const V twr = V::broadcast(wr[j]), twi = V::broadcast(wi[j]);
+                    butterfly(ar, ai, br, bi, twr, twi);
+                    butterfly(cr, ci, dr, di, twr, twi);
+                    butterfly(ar, ai, cr, ci, V::broadcast(wr2[j]), V::broadcast(wi2[j]));
+                    butterfly(br, bi, dr, di, V::broadcast(wr2[j + h]), V::broadcast(wi2[j + h]));
+                    ar.store(pr);              ai.store(pi);
+                    br.store(pr + h * W);      bi.store(pi + h * W);
+                    cr.store(pr + 2 * h * W);  ci.store(pi + 2 * h * W);
+                    dr.store(pr + 3 * h * W);  di.store(pi + 3 * h * W);
+                }
+        }
+
+        // Last stage, if the stages left were odd
+        if (h < n)
+        {
+            const float* wr = &this->twiddleRe[h - 1];
+            const float* wi = &this->twiddleIm[h - 1];
+            for (size_t j = 0; j < h; ++j)
+            {
+                float *pr = re + j * W, *pi = im + j * W;
+                V ar = V::load(pr), ai = V::load(pi);
+                V br = V::load(pr + h * W), bi = V::load(pi + h * W);
+                butterfly(ar, ai, br, bi, V::broadcast(wr[j]), V::broadcast(wi[j]));
+                ar.store(pr);          ai.store(pi);
+                br.store(pr + h * W);  bi.store(pi + h * W);
+            }
+        }
+    }
+
+    size_t size = 0;
+    size_t numLanes = LANES;                // lanes computed, 4 or 8
+    std::vector<uint32_t> bitReverse;
+    std::vector<float> twiddleRe, twiddleIm;
+    std::vector<float> splitRe, splitIm;
+    std::vector<float> workRe, workIm;      // n/2 x V::WIDTH per vector of lanes
+};
+
+} // namespace fft
+} // namespace tid
@@ -0,0 +1,279 @@
+/*
+
+tidReconfigurable - Real-time safe reconfiguration of a module
+Author: Domenico Stefani (domenico.stefani96@gmail.com)
+
+Setters such as setWindowSize(), createFilterbank(), setWindowFunction() or
+setMaxSearchRange() reallocate buffers, recreate FFT plans and acquire new
+filterbanks on the thread that calls them, usually the message thread, while
+the audio thread stores blocks into the same module.
+Reconfigurable keeps two instances of a module with the same configuration:
+the audio thread uses the live one, changes are applied to the other one
+(the standby) off the audio thread, and the standby is swapped in atomically
+at the next block boundary. The old live instance becomes the standby and
+gets the same changes, again off the audio thread, where the memory it no
+longer needs is freed.
+The standby is also reset off the audio thread, after the changes, since
+reset() clears the whole analysis state (e.g. the 2 s history of AttackTime).
+The audio thread never allocates, frees, waits or resets: at the swap it only
+replays into the new instance the last blocks stored (historyLength samples,
+given to prepare()), so the analysis window is continuous across the change.
+
+Bark reports onsets from store(): with historyLength > 0 the replay would
+report them again, so use it with historyLength 0 (the new instance starts
+from reset(), its sample clock included). Bark's thresholds, mask and
+debounce can be changed while the audio runs anyway, they do not allocate.
+
+*/
+#pragma once
+
+#include "tidJuceCompat.hpp"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace tid   /* TimbreID namespace*/
+{
+
+/**
+ * Two instances of Module, reconfigured off the audio thread and swapped in
+ * at a block boundary.
+ * Threads: prepare() when the audio is not running (prepareToPlay()),
+ * store() and get() from the audio thread, reconfigure(), update() and
+ * getLatest() from one other thread at a time (e.g. the message thread).
+ *
+ * @tparam Module module type (e.g. tid::Bfcc<float>)
+ * @tparam SampleType type of the samples stored into the module
+*/
+template <typename Module, typename SampleType = float>
+class Reconfigurable
+{
+public:
+    using Change = std::function<void(Module&)>;
+
+    /** Constructs the two instances with the same arguments */
+    template <typename... Args>
+    explicit Reconfigurable(const Args&... args)
+    {
+        this->instances[0].reset(new Module(args...));
+        this->instances[1].reset(new Module(args...));
+    }
+
+    Reconfigurable(const Reconfigurable&) = delete;
+    Reconfigurable& operator=(const Reconfigurable&) = delete;
+
+    /**
+     * Prepare both instances, applying the changes still queued.
+     * Not real-time safe, call it when the audio is not running.
+     * @param sampleRate sample rate
+     * @param blockSize maximum number of samples stored at a time
+     * @param historyLength samples replayed into the instance swapped in
+     *        (e.g. the largest analysis window plus the block size), 0 to
+     *        start it from reset()
+    */
+    void prepare(double sampleRate, unsigned int blockSize, size_t historyLength)
+    {
+        if (blockSize == 0)
+            throw std::invalid_argument("Block size must be greater than 0");
+
+        std::lock_guard<std::mutex> lock(this->mutex);
+        // no block is being stored, the audio thread takes the latest instance without replay
+        const int latest = this->published.load(std::memory_order_relaxed);
+        this->liveIndex = latest;
+        this->acknowledged.store(latest, std::memory_order_relaxed);
+
+        Module& other = *this->instances[1 - latest];
+        for (Change& change : this->backlog)
+            change(other);
+        this->backlog.clear();
+        std::vector<Change> changes;
+        std::swap(changes, this->queued);
+        for (Change& change : changes)
+        {
+            change(*this->instances[latest]);
+            change(other);
+        }
+
+        this->instances[0]->prepare(sampleRate, blockSize);
+        this->instances[1]->prepare(sampleRate, blockSize);
+
+        this->blockSize = blockSize;
+        const size_t numBlocks = (historyLength + blockSize - 1) / blockSize;
+        this->history.assign(numBlocks * blockSize, SampleType{0});
+        this->historySizes.assign(numBlocks, 0);
+        this->historyNext = 0;
+        this->historyCount = 0;
+    }
+
+    /**
+     * Apply a change to the module (not real-time safe).
+     * The change is applied to the standby, which goes live at the next
+     * block, and then to the other instance. If the previous change is not
+     * live yet, it is queued and applied by update().
+     * If the change throws (e.g. invalid filterbank spacing), the exception
+     * is rethrown and the module keeps its configuration (the setters of the
+     * modules do not change the module when they throw).
+     * @param change callable that configures a Module&, e.g.
+     *        [](tid::Bfcc<float>& bfcc) { bfcc.createFilterbank(1.0f); }
+     * @return true if the change was applied, false if it was queued
+    */
+    template <typename Callable>
+    bool reconfigure(Callable&& change)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->queued.emplace_back(std::forward<Callable>(change));
+        return applyQueued();
+    }
+
+    /**
+     * Apply the queued changes, if the last swap has happened, and bring the
+     * old live instance up to date (not real-time safe).
+     * Call it periodically (e.g. from a Timer) after reconfigure() returned false.
+     * A queued change that throws is dropped and its exception rethrown, as in reconfigure().
+     * @return true if no change is left in the queue
+    */
+    bool update()
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return applyQueued();
+    }
+
+    /** True if all the changes applied are live */
+    bool isUpToDate() const noexcept
+    {
+        return this->published.load(std::memory_order_acquire) == this->acknowledged.load(std::memory_order_acquire);
+    }
+
+    /**
+     * Swap in the latest instance, if a change is pending, and store a block
+     * into it. Real-time safe.
+     * @param input samples of the audio block
+     * @param n number of samples (up to the block size given to prepare())
+    */
+    void store(const SampleType* input, size_t n) noexcept
+    {
+        jassert(n <= this->blockSize);
+        acquireLatest();
+        pushHistory(input, n);
+        this->instances[this->liveIndex]->store(input, n);
+    }
+
+    /**
+     * Stores a channel of an audio block, like the store() of the modules
+     * @param buffer audio buffer
+     * @param channel index of the channel to use
+    */
+    void store(AudioBuffer<SampleType>& buffer, short channel)
+    {
+        const short numChannels = (short)buffer.getNumChannels();
+        if (channel < 0 || channel >= numChannels)
+            throw std::invalid_argument("Channel index has to be between 0 and "+std::to_string(numChannels-1)+" (found "+std::to_string(channel)+" instead)");
+        store(buffer.getReadPointer(channel), (size_t)buffer.getNumSamples());
+    }
+
+    /** Live instance, for the audio thread (compute(), getters) */
+    Module& get() noexcept { return *this->instances[this->liveIndex]; }
+
+    /** Instance with all the changes applied so far, for the getters of the thread that reconfigures */
+    const Module& getLatest() const noexcept { return *this->instances[this->published.load(std::memory_order_relaxed)]; }
+
+private:
+    /** Called with the mutex locked */
+    bool applyQueued()
+    {
+        // until the audio thread acknowledges the last swap, the standby may still be the live instance
+        const int latest = this->published.load(std::memory_order_relaxed);
+        if (this->acknowledged.load(std::memory_order_acquire) != latest)
+            return this->queued.empty();
+
+        Module& standby = *this->instances[1 - latest];
+        // changes of the live instance that the standby does not have yet (they succeeded there)
+        for (Change& change : this->backlog)
+            change(standby);
+        this->backlog.clear();
+
+        std::exception_ptr error;
+        std::vector<Change> changes;
+        std::swap(changes, this->queued);
+        for (Change& change : changes)
+        {
+            try
+            {
+                change(standby);
+                this->backlog.push_back(std::move(change));
+            }
+            catch (...)
+            {
+                // dropped, the module is unchanged
+                if (!error)
+                    error = std::current_exception();
+            }
+        }
+
+        if (!this->backlog.empty())
+        {
+            // the audio thread only replays the history into it
+            standby.reset();
+            this->published.store(1 - latest, std::memory_order_release);
+        }
+        if (error)
+            std::rethrow_exception(error);
+        return true;
+    }
+
+    /** Audio thread */
+    void acquireLatest() noexcept
+    {
+        const int latest = this->published.load(std::memory_order_acquire);
+        if (latest == this->liveIndex)
+            return;
+
+        // reset by applyQueued(), off the audio thread
+        Module& next = *this->instances[latest];
+        const size_t numBlocks = this->historySizes.size();
+        for (size_t b = 0; b < this->historyCount; ++b)
+        {
+            const size_t block = (this->historyNext + numBlocks - this->historyCount + b) % numBlocks;
+            next.store(&this->history[block * this->blockSize], this->historySizes[block]);
+        }
+
+        this->liveIndex = latest;
+        // from here on the audio thread does not use the old instance
+        this->acknowledged.store(latest, std::memory_order_release);
+    }
+
+    /** Audio thread */
+    void pushHistory(const SampleType* input, size_t n) noexcept
+    {
+        const size_t numBlocks = this->historySizes.size();
+        if (numBlocks == 0)
+            return;
+        std::copy(input, input + n, &this->history[this->historyNext * this->blockSize]);
+        this->historySizes[this->historyNext] = n;
+        this->historyNext = (this->historyNext + 1) % numBlocks;
+        this->historyCount = std::min(this->historyCount + 1, numBlocks);
+    }
+
+    std::unique_ptr<Module> instances[2];
+    int liveIndex = 0;                      // audio thread
+    std::atomic<int> published{0};          // instance with the latest configuration
+    std::atomic<int> acknowledged{0};       // instance used by the audio thread
+
+    std::mutex mutex;                       // changes, standby instance
+    std::vector<Change> queued;             // not applied yet
+    std::vector<Change> backlog;            // applied to the latest instance only
+
+    unsigned int blockSize = 0;
+    std::vector<SampleType> history;        // last blocks stored, for the replay
+    std::vector<size_t> historySizes;
+    size_t historyNext = 0, historyCount = 0;
+};
+
+} // namespace tid
@@ -0,0 +1,119 @@
+/*
+
+tidSampleClockTimer - Timer driven by the audio sample clock
+Author: Domenico Stefani (domenico.stefani96@gmail.com)
+
+Replacement for juce::Timer that does not need a message thread: time is
+advanced by the owner, with the number of samples processed, and the callback
+is called synchronously from advanceTimer().
+Same interface as juce::Timer (startTimer, stopTimer, isTimerRunning,
+timerCallback), so that a module can inherit from either one.
+
+*/
+#pragma once
+
+#include <cstddef>
+
+namespace tid   /* TimbreID namespace*/
+{
+
+class SampleClockTimer
+{
+public:
+    virtual ~SampleClockTimer() {}
+
+    /** The callback, called by advanceTimer() every interval while the timer is running */
+    virtual void timerCallback() = 0;
+
+    /** Sample rate used to convert the milliseconds of startTimer() to samples */
+    void setTimerSampleRate(double sampleRate) noexcept
+    {
+        this->timerSampleRate = sampleRate;
+    }
+
+    /** Start (or restart) the timer with an interval in milliseconds */
+    void startTimer(int intervalInMilliseconds) noexcept
+    {
+        this->intervalSamples = (long long)(intervalInMilliseconds * 0.001 * this->timerSampleRate + 0.5);
+        if (this->intervalSamples < 1)
+            this->intervalSamples = 1;
+        this->remainingSamples = this->intervalSamples;
+        this->running = true;
+    }
+
+    void stopTimer() noexcept
+    {
+        this->running = false;
+    }
+
+    bool isTimerRunning() const noexcept
+    {
+        return this->running;
+    }
+
+    /**
+     * Move the clock forward by a number of samples.
+     * Call it from the thread that processes the audio, the callback is
+     * called (possibly more than once) if its intervals elapsed.
+    */
+    void advanceTimer(size_t numSamples)
+    {
+        if (!this->running)
+            return;
+        this->remainingSamples -= (long long)numSamples;
+        while (this->running && this->remainingSamples <= 0)
+        {
+            this->remainingSamples += this->intervalSamples;
+            timerCallback();
+        }
+    }
+
+private:
+    double timerSampleRate = 44100.0;
+    long long intervalSamples = 1;
+    long long remainingSamples = 0;
+    bool running = false;
+};
+
+/**
+ * Debounce of the onset detectors on the sample clock: active from start()
+ * until its interval of samples elapsed
+*/
+class SampleClockDebounce : private SampleClockTimer
+{
+public:
+    void setSampleRate(double sampleRate) noexcept
+    {
+        this->setTimerSampleRate(sampleRate);
+    }
+
+    /** Start (or restart) the debounce, lasting intervalInMilliseconds */
+    void start(int intervalInMilliseconds) noexcept
+    {
+        this->startTimer(intervalInMilliseconds);
+    }
+
+    void clear() noexcept
+    {
+        this->stopTimer();
+    }
+
+    bool isActive() const noexcept
+    {
+        return this->isTimerRunning();
+    }
+
+    /** Move the clock forward by a number of samples, from the audio thread */
+    void advance(size_t numSamples) noexcept
+    {
+        this->advanceTimer(numSamples);
+    }
+
+private:
+    void timerCallback() override
+    {
+        this->stopTimer();
+    }
+};
+
+} // namespace tid
@@ -0,0 +1,114 @@
+/*
+
+tidSlidingWindow - Incremental sliding-window helpers for the time domain modules
+Author: Domenico Stefani (domenico.stefani96@gmail.com)
+
+Used by AttackTime and PeakSample to update their statistics one sample at a
+time in store(), so that compute() does not rescan the analysis window.
+Samples are identified by their absolute time (number of samples stored
+before them). Nothing allocates after setCapacity()/setWindowLength().
+
+*/
+#pragma once
+
+#include "tidJuceCompat.hpp"
+#include "tidArena.hpp"
+#include <algorithm>
+#include <vector>
+
+namespace tid   /* TimbreID namespace*/
+{
+
+/** Fixed capacity FIFO with access to both ends */
+template <typename T>
+class RingQueue
+{
+public:
+    void setCapacity(size_t capacity) { this->items.assign(capacity, T{}); clear(); }
+    void clear() noexcept { this->head = 0; this->count = 0; }
+    size_t size() const noexcept { return this->count; }
+    bool empty() const noexcept { return this->count == 0; }
+
+    /** i-th element from the front */
+    const T& operator[](size_t i) const noexcept { return this->items[wrap(this->head + i)]; }
+    const T& front() const noexcept { return this->items[this->head]; }
+    const T& back() const noexcept { return (*this)[this->count - 1]; }
+
+    void push_back(const T& item) noexcept
+    {
+        jassert(this->count < this->items.size());
+        this->items[wrap(this->head + this->count)] = item;
+        ++this->count;
+    }
+
+    void pop_front() noexcept { this->head = wrap(this->head + 1); --this->count; }
+    void pop_back() noexcept { --this->count; }
+
+    /** Place the items in an arena (see tid::Arena) */
+    void layoutBuffers(Arena& arena) { arena.place(this->items); }
+
+private:
+    size_t wrap(size_t i) const noexcept { return i >= this->items.size() ? i - this->items.size() : i; }
+
+    ArenaVector<T> items;
+    size_t head = 0, count = 0;
+};
+
+/**
+ * Maximum of the last windowLength values, with a monotonic deque.
+ * Among equal values the earliest one is the maximum, as in the scans of the
+ * original modules (strict greater-than comparison).
+*/
+class SlidingMax
+{
+public:
+    void setWindowLength(size_t length)
+    {
+        this->windowLength = (int64)std::max<size_t>(length, 1);
+        this->entries.setCapacity((size_t)this->windowLength + 1);
+    }
+
+    void clear() noexcept { this->entries.clear(); }
+
+    /** Adds the value of sample time (times must increase), dropping the values out of the window */
+    void push(int64 time, float value) noexcept
+    {
+        while (!this->entries.empty() && this->entries.back().value < value)
+            this->entries.pop_back();
+        this->entries.push_back({time, value});
+        while (this->entries.front().time <= time - this->windowLength)
+            this->entries.pop_front();
+    }
+
+    /**
+     * Maximum of the values pushed from windowStart on (windowStart can be
+     * later than the start of the window, then the entries before it are skipped)
+     * @return false if there is no such value
+    */
+    bool getMax(int64 windowStart, int64& time, float& value) const noexcept
+    {
+        for (size_t i = 0; i < this->entries.size(); ++i)
+            if (this->entries[i].time >= windowStart)
+            {
+                time = this->entries[i].time;
+                value = this->entries[i].value;
+                return true;
+            }
+        return false;
+    }
+
+    /** Place the entries in an arena (see tid::Arena) */
+    void layoutBuffers(Arena& arena) { this->entries.layoutBuffers(arena); }
+
+private:
+    struct Entry
+    {
+        int64 time;
+        float value;
+    };
+
+    RingQueue<Entry> entries;
+    int64 windowLength = 1;
+};
+
+} // namespace tid
@@ -1,5 +1,7 @@
 #pragma once
 
+#include "tidJuceCompat.hpp"
+
 namespace tid   /* TimbreID namespace*/
 {
 
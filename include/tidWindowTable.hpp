@@ -0,0 +1,211 @@
+/*
+
+tidWindowTable - Process-wide cache of window function tables
+Author: Domenico Stefani (domenico.stefani96@gmail.com)
+
+Every spectral module used to allocate and initialize the blackman, cosine,
+hamming and hann tables of its analysis window size, although only one
+window function is active at a time.
+WindowTableCache computes each table once per process, keyed by window
+function and size, and modules share it, read-only, through WindowTable
+handles. Tables are 64-byte aligned for SIMD loads.
+
+Lifetime of the entries, the same for the three process-wide caches
+(WindowTableCache, FilterbankCache in tidFilterbank.hpp and FftwPlanCache in
+tidFftw.hpp): handles count the uses of their entry, and entries no longer
+used by any handle stay in the cache until releaseUnused(). So a handle that
+changes entry (e.g. the window function or the filter spacing is changed from
+the GUI) never frees memory that the audio thread may still be reading, and a
+module created again later (e.g. the plugin is reloaded) finds its entry
+ready. Call releaseUnused() only when no module is processing audio with an
+entry it has just replaced (e.g. when the plugin is released).
+
+*/
+#pragma once
+
+#include "tIDLib.hpp"
+#include "tidJuceCompat.hpp"
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+namespace tid   /* TimbreID namespace*/
+{
+
+class WindowTable;
+
+class WindowTableCache
+{
+public:
+    static constexpr size_t TABLE_ALIGNMENT = 64;
+
+    static WindowTableCache& getInstance()
+    {
+        static WindowTableCache instance;
+        return instance;
+    }
+
+    /** Number of tables in the cache, in use or not */
+    size_t getNumTables()
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        return this->tables.size();
+    }
+
+    /** Bytes of all the tables in the cache */
+    size_t getNumBytes()
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        size_t bytes = 0;
+        for (const auto& keyAndEntry : this->tables)
+            bytes += keyAndEntry.first.second * sizeof(float);
+        return bytes;
+    }
+
+    /**
+     * Free the tables that no WindowTable uses.
+     * Call it only when no module is processing audio with a table it has
+     * just replaced (e.g. when the plugin is released).
+    */
+    void releaseUnused()
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        for (auto it = this->tables.begin(); it != this->tables.end();)
+        {
+            if (it->second.useCount == 0)
+                it = this->tables.erase(it);
+            else
+                ++it;
+        }
+    }
+
+    WindowTableCache(const WindowTableCache&) = delete;
+    WindowTableCache& operator=(const WindowTableCache&) = delete;
+
+private:
+    friend class WindowTable;
+
+    using Key = std::pair<tIDLib::WindowFunctionType, unsigned long int>;
+
+    struct AlignedDelete
+    {
+        void operator()(float* table) const noexcept { ::operator delete[](table, std::align_val_t(TABLE_ALIGNMENT)); }
+    };
+
+    struct Entry
+    {
+        std::unique_ptr<float[], AlignedDelete> table;
+        size_t useCount;
+    };
+
+    WindowTableCache() = default;
+
+    const float* acquire(const Key& key)
+    {
+        if (key.second < 1)
+            throw std::invalid_argument("Window size must be 1 or greater");
+
+        std::lock_guard<std::mutex> lock(this->mutex);
+        auto it = this->tables.find(key);
+        if (it == this->tables.end())
+            it = this->tables.emplace(key, Entry{createTable(key.first, key.second), 0}).first;
+        ++it->second.useCount;
+        return it->second.table.get();
+    }
+
+    void release(const Key& key)
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        auto it = this->tables.find(key);
+        if (it != this->tables.end() && it->second.useCount > 0)
+            --it->second.useCount;
+    }
+
+    /** Table computed by the tIDLib init functions, the same values of the per-module tables */
+    static std::unique_ptr<float[], AlignedDelete> createTable(tIDLib::WindowFunctionType type, unsigned long int size)
+    {
+        std::vector<float> values(size);
+        switch (type)
+        {
+            case tIDLib::WindowFunctionType::cosine:
+                tIDLib::initCosineWindow(values);
+                break;
+            case tIDLib::WindowFunctionType::hamming:
+                tIDLib::initHammingWindow(values);
+                break;
+            case tIDLib::WindowFunctionType::hann:
+                tIDLib::initHannWindow(values);
+                break;
+            case tIDLib::WindowFunctionType::blackman:
+            default:
+                tIDLib::initBlackmanWindow(values);
+                break;
+        }
+
+        std::unique_ptr<float[], AlignedDelete> table(new (std::align_val_t(TABLE_ALIGNMENT)) float[size]);
+        std::copy(values.begin(), values.end(), table.get());
+        return table;
+    }
+
+    std::mutex mutex;
+    std::map<Key, Entry> tables;
+};
+
+/**
+ * Handle to a shared, read-only window table of WindowTableCache.
+ * Acquire it (not real-time safe) when the window function or size change,
+ * and read it from the audio thread. The rectangular window has no table.
+*/
+class WindowTable
+{
+public:
+    WindowTable() = default;
+    ~WindowTable() { reset(); }
+
+    WindowTable(const WindowTable&) = delete;
+    WindowTable& operator=(const WindowTable&) = delete;
+
+    /** Use the table of a window function and size */
+    void acquire(tIDLib::WindowFunctionType type, unsigned long int size)
+    {
+        if (type == tIDLib::WindowFunctionType::rectangular)
+        {
+            reset();
+            this->key = {type, size};
+            return;
+        }
+        if (this->table != nullptr && this->key == WindowTableCache::Key{type, size})
+            return;
+
+        const WindowTableCache::Key newKey{type, size};
+        const float* newTable = WindowTableCache::getInstance().acquire(newKey);
+        reset();
+        this->key = newKey;
+        this->table = newTable;
+    }
+
+    /** Release the table (it stays in the cache) */
+    void reset()
+    {
+        if (this->table == nullptr)
+            return;
+        WindowTableCache::getInstance().release(this->key);
+        this->table = nullptr;
+    }
+
+    /** Window values, nullptr for the rectangular window */
+    const float* data() const noexcept { return this->table; }
+
+    tIDLib::WindowFunctionType getType() const noexcept { return this->key.first; }
+    unsigned long int getSize() const noexcept { return this->key.second; }
+
+private:
+    WindowTableCache::Key key{tIDLib::WindowFunctionType::rectangular, 0};
+    const float* table = nullptr;
+};
+
+} // namespace tid
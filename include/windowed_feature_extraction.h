@@ -15,10 +15,23 @@
 
 #pragma once
 
-// TODO: remove if not needed
-#include "juce_timbreID.h"
-#include <JuceHeader.h>
-
+#include "tidJuceCompat.hpp"
+#include "attackTime.hpp"
+#include "barkSpec.hpp"
+#include "barkSpecBrightness.hpp"
+#include "bfcc.hpp"
+#include "cepstrum.hpp"
+#include "mfcc.hpp"
+#include "peakSample.hpp"
+#include "zeroCrossing.hpp"
+#include "tidNpy.hpp"
+#include "tidArena.hpp"
+#include "tidFilterbank.hpp"
+#include "tidWindowTable.hpp"
+
+#include <array>
+#include <iostream>
+#include <memory>
 #include <regex>
 
 namespace SCL
@@ -127,6 +140,7 @@ template <size_t BUFFER_SIZE, size_t INNER_VEC_SIZE> class CircularVectorBuffer
   public:
     CircularVectorBuffer() : write_index(0)
     {
+        clear();
     }
 
     // getWritePointer method, returns a pointer to C float vector to write
@@ -138,6 +152,12 @@ template <size_t BUFFER_SIZE, size_t INNER_VEC_SIZE> class CircularVectorBuffer
     {
         write_index = (write_index + 1) % BUFFER_SIZE;
     }
+    void clear()
+    {
+        for (auto &vector : feature_vectors_buffer)
+            vector.fill(0.0f);
+        write_index = 0;
+    }
     const float *at(size_t index)
     {
         // Here index 0 refers to the oldest vector written
@@ -196,16 +216,22 @@ class FeatureExtractors
 
     //==================== FEATURE EXTRACTION OBJECTS ==========================
 
+    // Declared before the extractors, which may have their buffers in it (it must outlive them)
+    tid::Arena arena;
+    bool arenaEnabled = false;
+
     /*
             Here all the feature extractors have window size equal to FRAME_SIZE * BLOCK_SIZE instead of
-       FEATUREEXT_WINDOW_SIZE
+       FEATUREEXT_WINDOW_SIZE.
+            The spectral extractors have that window size fixed at compile time (tidFixedSize.hpp), the block size
+       stays the one given to prepare() (the host block size)
     */
-    tid::Bfcc<float> bfcc{FRAME_SIZE * BLOCK_SIZE, BARK_SPACING};
-    tid::Cepstrum<float> cepstrum{FRAME_SIZE * BLOCK_SIZE};
+    tid::Bfcc<float, FRAME_SIZE * BLOCK_SIZE> bfcc{FRAME_SIZE * BLOCK_SIZE, BARK_SPACING};
+    tid::Cepstrum<float, FRAME_SIZE * BLOCK_SIZE> cepstrum{FRAME_SIZE * BLOCK_SIZE};
     tid::AttackTime<float> attackTime{FRAME_SIZE * BLOCK_SIZE};
-    tid::BarkSpecBrightness<float> barkSpecBrightness{FRAME_SIZE * BLOCK_SIZE, BARK_SPACING, BARK_BOUNDARY};
-    tid::BarkSpec<float> barkSpec{FRAME_SIZE * BLOCK_SIZE, BARK_SPACING};
-    tid::Mfcc<float> mfcc{FRAME_SIZE * BLOCK_SIZE, MEL_SPACING};
+    tid::BarkSpecBrightness<float, FRAME_SIZE * BLOCK_SIZE> barkSpecBrightness{FRAME_SIZE * BLOCK_SIZE, BARK_SPACING, BARK_BOUNDARY};
+    tid::BarkSpec<float, FRAME_SIZE * BLOCK_SIZE> barkSpec{FRAME_SIZE * BLOCK_SIZE, BARK_SPACING};
+    tid::Mfcc<float, FRAME_SIZE * BLOCK_SIZE> mfcc{FRAME_SIZE * BLOCK_SIZE, MEL_SPACING};
     tid::PeakSample<float> peakSample{FRAME_SIZE * BLOCK_SIZE};
     tid::ZeroCrossing<float> zeroCrossing{FRAME_SIZE * BLOCK_SIZE};
 
@@ -233,7 +259,7 @@ class FeatureExtractors
     static const unsigned int HOWMANYFRAMES_RES = (BUFFERSIZE / FRAME_INTERVAL);
     static const unsigned int WHOLE_FLATRESMATRIX_SIZE = SINGLE_VECTOR_SIZE * HOWMANYFRAMES_RES;
 
-    juce::AudioBuffer<float> zero_block{1, BLOCK_SIZE}; // Block of zeros for convenience
+    juce::AudioBuffer<float> zero_block{1, BLOCK_SIZE}; // Block of zeros for convenience, resized by prepare()
 
     std::vector<std::string> whole_header;
     CircularVectorBuffer<BUFFERSIZE, SINGLE_VECTOR_SIZE> feature_vectors_buffer;
@@ -374,10 +400,12 @@ class FeatureExtractors
             /-----------------------------------------*/
             barkSpecRes = this->barkSpec.compute();
 
-            jassert(barkSpecRes.size() == _BARKSPEC_RES_SIZE);
+            // The number of bands depends on the sample rate (50 Bark bands at 44.1 kHz, 51 at 48 kHz):
+            // the vector keeps the first ones, and the bands missing at lower sample rates are 0
+            const int numBarkSpec = std::min<int>((int)barkSpecRes.size(), _BARKSPEC_RES_SIZE);
             for (int i = 0; i < _BARKSPEC_RES_SIZE; ++i)
             {
-                featureVector[(last + 1) + i] = barkSpecRes[i];
+                featureVector[(last + 1) + i] = (i < numBarkSpec) ? barkSpecRes[i] : 0.0f;
             }
             newLast = last + _BARKSPEC_RES_SIZE;
 #ifdef LOG_SIZES
@@ -392,10 +420,10 @@ class FeatureExtractors
             | 04 - Bark Frequency Cepstral Coefficients |
             /------------------------------------------*/
             bfccRes = this->bfcc.compute();
-            jassert(bfccRes.size() == _BFCC_RES_SIZE);
+            const int numBfcc = std::min<int>((int)bfccRes.size(), _BFCC_RES_SIZE);
             for (int i = 0; i < _BFCC_RES_SIZE; ++i)
             {
-                featureVector[(last + 1) + i] = bfccRes[i];
+                featureVector[(last + 1) + i] = (i < numBfcc) ? bfccRes[i] : 0.0f;
             }
             newLast = last + _BFCC_RES_SIZE;
 #ifdef LOG_SIZES
@@ -428,10 +456,10 @@ class FeatureExtractors
             | 06 - Mel Frequency Cepstral Coefficients |
             /-----------------------------------------*/
             mfccRes = this->mfcc.compute();
-            jassert(mfccRes.size() == _MFCC_RES_SIZE);
+            const int numMfcc = std::min<int>((int)mfccRes.size(), _MFCC_RES_SIZE);
             for (int i = 0; i < _MFCC_RES_SIZE; ++i)
             {
-                featureVector[(last + 1) + i] = mfccRes[i];
+                featureVector[(last + 1) + i] = (i < numMfcc) ? mfccRes[i] : 0.0f;
             }
             newLast = last + _MFCC_RES_SIZE;
 #ifdef LOG_SIZES
@@ -445,9 +473,9 @@ class FeatureExtractors
             /*-----------------------------------------/
             | 07 - Peak sample                         |
             /-----------------------------------------*/
-            std::pair<float, unsigned long int> peakSample = this->peakSample.compute();
-            float peakSampleRes = peakSample.first;
-            unsigned long int peakSampleIndex = peakSample.second;
+            float peakSampleRes;
+            unsigned long int peakSampleIndex;
+            this->peakSample.compute(peakSampleRes, peakSampleIndex);
             featureVector[last + 1] = peakSampleRes;
             featureVector[last + 2] = peakSampleIndex;
             newLast = last + 2;
@@ -472,6 +500,27 @@ class FeatureExtractors
         }
     }
 
+    /** Count or place the buffers of the extractors in use, in storeAndCompute() order (see tid::Arena) */
+    void layoutBuffers(tid::Arena &target)
+    {
+        if (USE_BFCC)
+            bfcc.layoutBuffers(target);
+        if (USE_CEPSTRUM)
+            cepstrum.layoutBuffers(target);
+        if (USE_ATTACKTIME)
+            attackTime.layoutBuffers(target);
+        if (USE_BARKSPECBRIGHTNESS)
+            barkSpecBrightness.layoutBuffers(target);
+        if (USE_BARKSPEC)
+            barkSpec.layoutBuffers(target);
+        if (USE_MFCC)
+            mfcc.layoutBuffers(target);
+        if (USE_PEAKSAMPLE)
+            peakSample.layoutBuffers(target);
+        if (USE_ZEROCROSSING)
+            zeroCrossing.layoutBuffers(target);
+    }
+
   public:
     std::unique_ptr<SCL::Scaler> scaler;
 
@@ -714,6 +763,11 @@ class FeatureExtractors
         return WHOLE_FLATRESMATRIX_SIZE;
     }
 
+    constexpr static size_t getBlockSize()
+    {
+        return BLOCK_SIZE;
+    }
+
     std::vector<std::string> getHeader()
     {
         if (whole_header.size() == 0)
@@ -721,8 +775,49 @@ class FeatureExtractors
         return whole_header;
     }
 
+    /**
+     * Saves numMatrices contiguous flat feature matrices (as returned by computeFeatureVectors)
+     * to an NPZ archive for numpy, with the arrays "features", of shape
+     * [numMatrices, HOWMANYFRAMES_RES, SINGLE_VECTOR_SIZE], and "feature_names"
+     * (names of the SINGLE_VECTOR_SIZE features of each frame).
+     * @throws std::runtime_error if the file can not be written
+    */
+    void writeFeatureMatricesNpz(const std::string &path, const float *flatMatrices, size_t numMatrices)
+    {
+        tid::npy::NpzWriter npz(path);
+        npz.add("features", flatMatrices, numMatrices * WHOLE_FLATRESMATRIX_SIZE,
+                {numMatrices, (size_t)HOWMANYFRAMES_RES, (size_t)SINGLE_VECTOR_SIZE});
+        npz.addStrings("feature_names", prefixedHeader(""));
+        npz.close();
+    }
+
+    /**
+     * Memory-maps feature matrices saved with writeFeatureMatricesNpz (.npz) or
+     * with np.save (.npy, float32 of shape [N, ...] with getFeVectorSize() values per row).
+     * Data is not copied, matrix i starts at array.data<float>() + i * getFeVectorSize().
+     * @throws std::invalid_argument if the file does not match this configuration
+    */
+    static tid::npy::Array readFeatureMatrices(const std::string &path)
+    {
+        const bool isNpz = path.size() > 4 && path.compare(path.size() - 4, 4, ".npz") == 0;
+        tid::npy::Array features = isNpz ? tid::npy::NpzFile(path).get("features") : tid::npy::loadNpy(path);
+        if (!features.hasType<float>() || features.getShape().size() < 2 || features.getNumCols() != WHOLE_FLATRESMATRIX_SIZE)
+            throw std::invalid_argument("Feature matrices in " + path + " do not match the extractor configuration (" +
+                                        std::to_string(WHOLE_FLATRESMATRIX_SIZE) + " float32 values per matrix)");
+        return features;
+    }
+
+    /**
+     * @brief Prepare the feature extractors (not real-time safe)
+     * samplesPerBlock can differ from BLOCK_SIZE (e.g. the block size of the host): the window size stays
+     * FRAME_SIZE * BLOCK_SIZE, but a feature vector is computed for every block stored, so the frames of
+     * computeFeatureVectors() are samplesPerBlock samples apart.
+     */
     void prepare(double sampleRate, unsigned int samplesPerBlock)
     {
+        zero_block.setSize(1, (int)samplesPerBlock);
+        zero_block.clear();
+
         /** Prepare feature extractors **/
         bfcc.prepare(sampleRate, (uint32)samplesPerBlock);
         cepstrum.prepare(sampleRate, (uint32)samplesPerBlock);
@@ -732,6 +827,56 @@ class FeatureExtractors
         mfcc.prepare(sampleRate, (uint32)samplesPerBlock);
         peakSample.prepare(sampleRate, (uint32)samplesPerBlock);
         zeroCrossing.prepare(sampleRate, (uint32)samplesPerBlock);
+
+        if (arenaEnabled)
+        {
+            arena.beginLayout();
+            layoutBuffers(arena);
+            arena.beginPlacement();
+            layoutBuffers(arena);
+            arena.endPlacement();
+        }
+    }
+
+    /**
+     * @brief Place the per-block buffers of the extractors in use in one 64-byte aligned block (tid::Arena),
+     * one after the other in the order in which storeAndCompute() accesses them.
+     * It takes effect at the next prepare(), which lays the buffers out again (e.g. after a sample rate change).
+     */
+    void setArenaEnabled(bool enabled) { arenaEnabled = enabled; }
+    bool isArenaEnabled() const { return arenaEnabled; }
+
+    struct MemoryFootprint
+    {
+        size_t objectBytes = 0;   // the FeatureExtractors object itself (extractors, feature vector history)
+        size_t bufferBytes = 0;   // per-block buffers of the extractors in use
+        size_t arenaBytes = 0;    // arena block holding them (0 if the arena is not enabled)
+        size_t overflowBytes = 0; // buffers that outgrew the arena since the last prepare(), on the heap
+        size_t sharedBytes = 0;   // window tables and filterbanks of the process-wide caches, shared with other instances
+
+        size_t getTotalBytes() const { return objectBytes + bufferBytes + sharedBytes; }
+    };
+
+    /**
+     * @brief Memory used by this instance (not real-time safe).
+     * Result vectors and setup-only tables of the extractors are not counted in bufferBytes, FFTW plans are not counted.
+     */
+    MemoryFootprint getMemoryFootprint()
+    {
+        MemoryFootprint footprint;
+        footprint.objectBytes = sizeof(*this);
+        tid::Arena counter;
+        counter.beginLayout();
+        layoutBuffers(counter);
+        footprint.bufferBytes = counter.getLayoutBytes();
+        if (arenaEnabled)
+        {
+            footprint.arenaBytes = arena.getCapacity();
+            footprint.overflowBytes = arena.getOverflowBytes();
+        }
+        footprint.sharedBytes =
+            tid::WindowTableCache::getInstance().getNumBytes() + tid::FilterbankCache::getInstance().getNumBytes();
+        return footprint;
     }
 
     void reset()
@@ -747,6 +892,9 @@ class FeatureExtractors
         mfcc.reset();
         peakSample.reset();
         zeroCrossing.reset();
+
+        // Clear the history of feature vectors too, so that after a reset the extractors behave like new ones
+        feature_vectors_buffer.clear();
     }
 
     template <typename SampleType> void storeAndCompute(AudioBuffer<SampleType> &buffer, short int channel)
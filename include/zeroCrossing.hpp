@@ -22,7 +22,11 @@ You should have received a copy of the GNU General Public License along with thi
 */
 #pragma once
 
+#include "tidJuceCompat.hpp"
 #include "tIDLib.hpp"
+#include "tidProfiler.hpp"
+#include "tidMultiChannel.hpp"
+#include <cstdlib>
 #include <vector>
 
 namespace tid   /* TimbreID namespace*/
@@ -66,8 +70,10 @@ public:
     /** Resets the processing pipeline. */
     void reset() noexcept
     {
-        std::fill(signalBuffer.begin(), signalBuffer.end(), SampleType{0});
-        std::fill(analysisBuffer.begin(), analysisBuffer.end(), 0.0f);
+        // the signal buffer starts filled with zeros (no crossings), as in the original module
+        std::fill(this->crossingSums.begin(), this->crossingSums.end(), 0);
+        this->numSamples = (int64)(this->analysisWindowSize + this->blockSize);
+        this->lastSign = 0;
        #if ASYNC_FEATURE_EXTRACTION
         this->lastStoreTime = juce::Time::currentTimeMillis();
        #endif
@@ -85,6 +91,17 @@ public:
             throw std::invalid_argument("Channel index has to be between 0 and "+std::to_string(numChannels-1)+" (found "+std::to_string(channel)+" instead)");
         storeAudioBlock(buffer.getReadPointer(channel), buffer.getNumSamples());
     }
+
+    /**
+     * Stores an audio block into the buffer of the module
+     * Raw pointer version of store(), for use without JUCE buffers.
+     * @param input samples of the audio block
+     * @param n number of samples, it has to match the block size given to prepare()
+    */
+    void store (const SampleType* input, size_t n)
+    {
+        storeAudioBlock(input, n);
+    }
     //==============================================================================
 
     uint32 compute()
@@ -98,18 +115,15 @@ public:
         if(offsetSample >= this->blockSize)
             offsetSample = this->blockSize - 1;
        #else
-        if ((tIDLib::FEATURE_EXTRACTION_OFFSET < 0.0f) || (tIDLib::FEATURE_EXTRACTION_OFFSET > 1.0f)) throw new std::logic_error("FEATURE_EXTRACTION_OFFSET must be between 0.0 and 1.0 (found "+std::to_string(tIDLib::FEATURE_EXTRACTION_OFFSET)+" instead)");
         uint32 offsetSample = (uint32)(tIDLib::FEATURE_EXTRACTION_OFFSET * (double)this->blockSize);
        #endif
 
-    	// construct analysis window using offsetSample as the end of the window
-        for(uint64 i = 0, j = offsetSample; i < this->analysisWindowSize; ++i, ++j)
-            this->analysisBuffer[i] = (float)this->signalBuffer[j];
-
-        uint32 crossings = 0;
-
-        jassert(this->analysisBuffer.size() == this->analysisWindowSize);
-        crossings = tIDLib::zeroCrossingRate(analysisBuffer);
+        // the analysis window of the original module is signalBuffer[offsetSample ... offsetSample+analysisWindowSize-1],
+        // its crossings are the difference of the running sums at its ends (same result of tIDLib::zeroCrossingRate)
+        const int64 windowEnd = this->numSamples - 1 - (int64)this->blockSize + (int64)offsetSample;
+        const int64 windowStart = windowEnd - (int64)this->analysisWindowSize + 1;
+        uint32 crossings = (uint32)(crossingSumAt(windowEnd) - crossingSumAt(windowStart));
+        crossings *= 0.5f;
 
         return crossings;
     }
@@ -152,25 +166,43 @@ public:
         return res;
     }
 
+    /**
+     * Place the buffers used at every block in an arena, in the order in
+     * which they are accessed (see tid::Arena)
+    */
+    void layoutBuffers(Arena& arena)
+    {
+        arena.place(this->crossingSums);
+    }
+
 private:
 
     void resizeBuffers()
     {
-        signalBuffer.resize(analysisWindowSize + blockSize, SampleType{0});
-        analysisBuffer.resize(analysisWindowSize, 0.0f);
+        // running sums for the signal buffer of the original module (analysisWindowSize + blockSize samples)
+        this->crossingSums.assign(this->analysisWindowSize + this->blockSize + 1, 0);
+    }
+
+    int64 crossingSumAt(int64 time) const noexcept
+    {
+        return this->crossingSums[(size_t)(time % (int64)this->crossingSums.size())];
     }
 
     void storeAudioBlock (const SampleType* input, size_t n) noexcept
     {
+        TID_PROFILE_SCOPE(zeroCrossing, storeAudioBlock);
         jassert(n ==  this->blockSize);
 
-        // shift signal buffer contents N positions back
-    	for(uint64 i=0; i<analysisWindowSize; ++i)
-    		signalBuffer[i] = signalBuffer[i+n];
-
-    	// write new block to end of signal buffer.
-    	for(size_t i=0; i<n; ++i)
-    		signalBuffer[analysisWindowSize+i] = input[i];
+        // running sum of |signum(x[t]) - signum(x[t-1])|, twice the number of crossings
+        int64 sum = crossingSumAt(this->numSamples - 1);
+        for (size_t i = 0; i < n; ++i)
+        {
+            const int sign = tIDLib::signum((float)input[i]);
+            sum += std::abs(sign - this->lastSign);
+            this->lastSign = sign;
+            this->crossingSums[(size_t)(this->numSamples % (int64)this->crossingSums.size())] = sum;
+            ++this->numSamples;
+        }
        #if ASYNC_FEATURE_EXTRACTION
         this->lastStoreTime = juce::Time::currentTimeMillis();
        #endif
@@ -181,8 +213,11 @@ private:
     uint32 blockSize = tIDLib::BLOCKSIZEDEFAULT;    // x_n field in Original PD library library
     uint64 analysisWindowSize = tIDLib::WINDOWSIZEDEFAULT;   // x_window in Original PD library
 
-    std::vector<SampleType> signalBuffer;
-    std::vector<float> analysisBuffer;
+    /** Number of samples stored since reset(), including the zeros of the initial signal buffer */
+    int64 numSamples = 0;
+    /** Running sum of the sign changes, indexed by sample time */
+    ArenaVector<int64> crossingSums;
+    int lastSign = 0;
 
    #if ASYNC_FEATURE_EXTRACTION
     uint32 lastStoreTime = juce::Time::currentTimeMillis(); // x_lastDspTime in Original PD library
@@ -191,4 +226,155 @@ private:
     JUCE_LEAK_DETECTOR (ZeroCrossing)
 };
 
+/**
+ * Zero crossings of up to tIDLib::INTERLEAVEDLANES channels (e.g. hexaphonic pickups)
+ * Same results of a ZeroCrossing per channel. The running sums of the sign
+ * changes are interleaved and updated for all the channels at once, one SIMD
+ * lane per channel (tIDLib::signChangeSumsInterleaved).
+*/
+template <typename SampleType>
+class MultiZeroCrossing
+{
+public:
+    static constexpr unsigned int LANES = tIDLib::INTERLEAVEDLANES;
+
+    /**
+     * MultiZeroCrossing constructor
+     * @param numChannels number of channels analysed (1 to tIDLib::INTERLEAVEDLANES)
+     * @param windowSize size of the analysis window
+    */
+    MultiZeroCrossing(unsigned int numChannels, unsigned long int windowSize = tIDLib::WINDOWSIZEDEFAULT)
+    {
+        InterleavedBlock::checkNumChannels(numChannels);
+        this->numChannels = numChannels;
+        this->analysisWindowSize = windowSize;
+        resizeBuffers();
+        reset();
+    }
+
+    /** Initialization of the module (it allocates) */
+    void prepare (double sampleRate, uint32 blockSize)
+    {
+        this->sampleRate = sampleRate;
+        this->blockSize = blockSize;
+        resizeBuffers();
+        reset();
+    }
+
+    /** Resets the processing pipeline. */
+    void reset() noexcept
+    {
+        // the signal buffers start filled with zeros (no crossings), as in ZeroCrossing
+        std::fill(this->crossingSums.begin(), this->crossingSums.end(), 0u);
+        std::fill(this->sums, this->sums + LANES, 0u);
+        std::fill(this->lastSigns, this->lastSigns + LANES, 0);
+        this->numSamples = (int64)(this->analysisWindowSize + this->blockSize);
+    }
+
+    /**
+     * Stores the channels firstChannel ... firstChannel+getNumChannels()-1 of an audio block
+     * @param buffer audio buffer
+     * @param firstChannel index of the first channel analysed
+    */
+    template <typename OtherSampleType>
+    void store (AudioBuffer<OtherSampleType>& buffer, short firstChannel = 0)
+    {
+        static_assert (std::is_same<OtherSampleType, SampleType>::value,
+                       "The sample-type of the zeroCrossing module must match the sample-type supplied to this store callback");
+        this->block.interleave(buffer, firstChannel);
+        store(this->block);
+    }
+
+    /**
+     * Stores an audio block of every channel
+     * @param channels getNumChannels() pointers to n samples
+     * @param n number of samples, it has to match the block size given to prepare()
+    */
+    void store (const SampleType* const* channels, size_t n)
+    {
+        this->block.interleave(channels, n);
+        store(this->block);
+    }
+
+    /** Stores an audio block already interleaved (at least getNumChannels() channels) */
+    void store (const InterleavedBlock& interleaved)
+    {
+        if (interleaved.getNumChannels() < this->numChannels)
+            throw std::invalid_argument("The interleaved block has "+std::to_string(interleaved.getNumChannels())+" channels, "+std::to_string(this->numChannels)+" are analysed");
+        TID_PROFILE_SCOPE(zeroCrossing, storeAudioBlock);
+        jassert(interleaved.getNumFrames() == this->blockSize);
+
+        const float* frames = interleaved.getFrames();
+        const size_t ringLength = this->crossingSums.size() / LANES;
+        for (size_t n = interleaved.getNumFrames(); n > 0;)
+        {
+            const size_t position = (size_t)(this->numSamples % (int64)ringLength);
+            const size_t count = std::min(n, ringLength - position);
+            tIDLib::signChangeSumsInterleaved(frames, count, this->lastSigns, this->sums, &this->crossingSums[position * LANES]);
+            frames += count * LANES;
+            this->numSamples += (int64)count;
+            n -= count;
+        }
+    }
+
+    /**
+     * Compute the zero crossings of all the channels
+     * @return getNumChannels() crossing counts
+    */
+    const std::vector<uint32>& compute() noexcept
+    {
+        const int64 windowEnd = this->numSamples - 1 - (int64)getFeatureExtractionLag(this->blockSize);
+        const int64 windowStart = windowEnd - (int64)this->analysisWindowSize + 1;
+        const unsigned int* endSums = crossingSumsAt(windowEnd);
+        const unsigned int* startSums = crossingSumsAt(windowStart);
+        for (unsigned int c = 0; c < this->numChannels; ++c)
+        {
+            uint32 crossings = endSums[c] - startSums[c];
+            crossings *= 0.5f;
+            this->crossingsOut[c] = crossings;
+        }
+        return this->crossingsOut;
+    }
+
+    void setWindowSize(uint32 windowSize)
+    {
+        if(windowSize < tIDLib::MINWINDOWSIZE)
+            throw std::invalid_argument("window size must be "+std::to_string(tIDLib::MINWINDOWSIZE)+" or greater");
+        this->analysisWindowSize = windowSize;
+        resizeBuffers();
+        reset();
+    }
+
+    uint32 getWindowSize() const noexcept { return (uint32)this->analysisWindowSize; }
+    unsigned int getNumChannels() const noexcept { return this->numChannels; }
+
+private:
+    void resizeBuffers()
+    {
+        // running sums of the sign changes of the last analysisWindowSize + blockSize + 1 samples
+        this->crossingSums.assign((this->analysisWindowSize + this->blockSize + 1) * LANES, 0u);
+        this->crossingsOut.assign(this->numChannels, 0);
+        this->block.prepare(this->numChannels, this->blockSize);
+    }
+
+    const unsigned int* crossingSumsAt(int64 time) const noexcept
+    {
+        return &this->crossingSums[(size_t)(time % (int64)(this->crossingSums.size() / LANES)) * LANES];
+    }
+
+    double sampleRate = tIDLib::SAMPLERATEDEFAULT;
+    uint32 blockSize = tIDLib::BLOCKSIZEDEFAULT;
+    uint64 analysisWindowSize = tIDLib::WINDOWSIZEDEFAULT;
+    unsigned int numChannels = 1;
+
+    /** Number of samples stored since reset(), including the zeros of the initial signal buffer */
+    int64 numSamples = 0;
+    /** Running sums of the sign changes, interleaved, indexed by sample time */
+    std::vector<unsigned int> crossingSums;
+    unsigned int sums[LANES];
+    int lastSigns[LANES];
+    std::vector<uint32> crossingsOut;
+    InterleavedBlock block;
+};
+
 } // namespace tid
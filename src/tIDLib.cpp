@@ -18,11 +18,27 @@ You should have received a copy of the GNU General Public License along with thi
 */
 #include "tIDLib.hpp"
 
-#include <JuceHeader.h>
+#include "tidJuceCompat.hpp"
 #include <cmath>
 #include <vector>
 #include <cfloat>   // FLT_MAX
 #include <climits>  // ULONG_MAX
+#include <algorithm>
+
+#if defined(__AVX__) || defined(__SSE__) || defined(_M_X64)
+#include <immintrin.h>
+#define TIDLIB_USE_SSE 1
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define TIDLIB_USE_NEON 1
+#endif
+
+#ifndef TID_USE_CBLAS
+#define TID_USE_CBLAS 0
+#endif
+#if TID_USE_CBLAS
+#include <cblas.h>
+#endif
 
 namespace tIDLib
 {
@@ -285,20 +301,18 @@ void sortKnnInfo(unsigned short int k, t_instanceIdx numInstances, t_instanceIdx
 
 t_binIdx nearestBinIndex(float target, const float *binFreqs, t_binIdx n)
 {
-    float bestDist = FLT_MAX;
-    float dist = 0.0f;
-    t_binIdx bin = 0;
-
-    for(t_binIdx i=0; i<n; ++i)
-    {
-        if((dist=fabs(binFreqs[i]-target)) < bestDist)
-        {
-            bestDist = dist;
-            bin = i;
-        }
-    }
-
-    return(bin);
+    if(n == 0)
+        return 0;
+
+    // first frequency >= target, the nearest is either it or the previous one
+    const t_binIdx upper = (t_binIdx)(std::lower_bound(binFreqs, binFreqs + n, target) - binFreqs);
+    if(upper == 0)
+        return 0;
+    if(upper == n)
+        return n-1;
+
+    // ties go to the lower bin, like the linear search of the original library
+    return (fabs(binFreqs[upper]-target) < fabs(binFreqs[upper-1]-target)) ? upper : upper-1;
 }
 
 t_binIdx nearestBinIndex(float target, const std::vector<float> &binFreqs, t_binIdx n)
@@ -376,7 +390,7 @@ t_filterIdx getMelBoundFreqs(std::vector<float> &filterFreqs, float spacing, flo
 }
 
 void createFilterbank(const std::vector<float> &filterFreqs,
-                    std::vector<t_filter> &filterbank, t_filterIdx newNumFilters,
+                    Filterbank &filterbank, t_filterIdx newNumFilters,
                     float window, float sr)
 {
     t_binIdx windowHalf = window*0.5;
@@ -388,30 +402,19 @@ void createFilterbank(const std::vector<float> &filterFreqs,
     // create local memory
     std::vector<float> binFreqs(windowHalfPlus1);
 
-    // resize filterbank vector
-    filterbank.resize(newNumFilters);
-
-    for(t_filterIdx i=0; i<newNumFilters; ++i)
-    {
-        // initialize indices
-        for(unsigned char j = 0; j < 2; ++j)
-            filterbank[i].indices[j] = 0;
-
-        // initialize filterbank sizes
-        filterbank[i].size = 0;
-    }
-
     // first, find the actual freq for each bin based on current window size
     for(t_binIdx bfi = 0; bfi < windowHalfPlus1; ++bfi)
         binFreqs[bfi] = bin2freq(bfi, window, sr);
 
-    // finally, build the filterbank
+    // bin ranges of the filters, to allocate all the weights at once
+    std::vector<t_filter> &filters = filterbank.filters;
+    filters.assign(newNumFilters, t_filter{nullptr, 0, {0, 0}, {0.0f, 0.0f}});
+    std::vector<t_binIdx> peaks(newNumFilters);
+    size_t numWeights = 0;
     for(t_filterIdx ffi = 1; ffi <= newNumFilters; ++ffi)
     {
         t_binIdx startIdx, peakIdx, finishIdx;
 
-        startIdx = peakIdx = finishIdx = 0;
-
         startIdx = nearestBinIndex(filterFreqs[ffi-1], binFreqs, windowHalfPlus1);
         peakIdx = nearestBinIndex(filterFreqs[ffi], binFreqs, windowHalfPlus1);
         finishIdx = nearestBinIndex(filterFreqs[ffi+1], binFreqs, windowHalfPlus1);
@@ -420,28 +423,39 @@ void createFilterbank(const std::vector<float> &filterFreqs,
         jassert(peakIdx<=finishIdx);
         jassert(startIdx<=peakIdx);
 
-        // resize this filter
         t_binIdx filterWidth = finishIdx-startIdx + 1;
         filterWidth = (filterWidth<1)?1:filterWidth;
 
-        filterbank[ffi-1].size = filterWidth; // store the sizes for freeing memory later
-        filterbank[ffi-1].filter.resize(filterWidth);
+        filters[ffi-1].size = filterWidth;
+        filters[ffi-1].indices[0] = startIdx;
+        filters[ffi-1].indices[1] = finishIdx;
+        filters[ffi-1].filterFreqs[0] = binFreqs[startIdx];
+        filters[ffi-1].filterFreqs[1] = binFreqs[finishIdx];
+        peaks[ffi-1] = peakIdx;
+        numWeights += filterWidth;
+    }
 
-        // initialize this filter
-        for(t_binIdx j = 0; j < filterWidth; ++j)
-            filterbank[ffi-1].filter[j] = 0.0f;
+    // finally, build the filters in the packed weights
+    filterbank.weights.assign(numWeights, 0.0f);
+    float *weights = filterbank.weights.data();
+    for(t_filterIdx i = 0; i < newNumFilters; ++i)
+    {
+        const t_binIdx startIdx = filters[i].indices[0], peakIdx = peaks[i], finishIdx = filters[i].indices[1];
+        const t_binIdx filterWidth = filters[i].size;
+        float *filter = weights;
+        weights += filterWidth;
 
         // some special cases for very narrow filter widths
         switch(filterWidth)
         {
             case 1:
-                filterbank[ffi-1].filter[0] = 1.0f;
+                filter[0] = 1.0f;
                 break;
             // original wbrent comment:
             // no great way to do a triangle with a filter width of 2, so might as well average
             case 2:
-                filterbank[ffi-1].filter[0] = 0.5f;
-                filterbank[ffi-1].filter[1] = 0.5f;
+                filter[0] = 0.5f;
+                filter[1] = 0.5f;
                 break;
 
             // with 3 and greater, we can use our ramps
@@ -455,44 +469,30 @@ void createFilterbank(const std::vector<float> &filterFreqs,
                 linspace(downRamp, 1.0f, 0.0f);
 
                 t_binIdx fj;
-                // copy into filterbank[i-1].filter
                 for(fj = 0; fj < upN; ++fj)
-                    filterbank[ffi-1].filter[fj] = upRamp[fj];
+                    filter[fj] = upRamp[fj];
 
                 // start at k=1 because k=0 will be the peak (i.e., 1.0)
                 for(t_binIdx k = 1; k < downN; ++fj, ++k)
-                    filterbank[ffi-1].filter[fj] = downRamp[k];
+                    filter[fj] = downRamp[k];
 
                 // clip the triangle within 0 and 1, just in case
                 for(t_binIdx fj = 0; fj < filterWidth; ++fj)
-                {
-                    if(filterbank[ffi-1].filter[fj] < 0.0f)
-                        filterbank[ffi-1].filter[fj] = 0.0f;
-
-                    if(filterbank[ffi-1].filter[fj] > 1.0f)
-                        filterbank[ffi-1].filter[fj] = 1.0f;
-                }
-
-                // free up memory (Does this actually )
-                std::vector<float>().swap(upRamp); // Swaps with empty vec
-                std::vector<float>().swap(downRamp); // Swaps with empty vec
+                    filter[fj] = std::min(1.0f, std::max(0.0f, filter[fj]));
                 break;
         };
 
-        filterbank[ffi-1].indices[0] = startIdx;
-        filterbank[ffi-1].indices[1] = finishIdx;
-        filterbank[ffi-1].filterFreqs[0] = binFreqs[startIdx];
-        filterbank[ffi-1].filterFreqs[1] = binFreqs[finishIdx];
+        filters[i].filter = filter;
     }
-
-    // free local memory
-    std::vector<float>().swap(binFreqs); // Swaps binfreqs with an empty array (btter than clear())
 }
 
-void specFilterBands(t_binIdx n, t_filterIdx numFilters, float *spectrum, std::vector<t_filter> &filterbank, bool normalize)
+void specFilterBands(t_binIdx n, t_filterIdx numFilters, const float *spectrum, float *output, const std::vector<t_filter> &filterbank, bool normalize)
 {
     float totalEnergy = 0;
 
+    // Check that the spectrum window size N is larger than the number of filters, otherwise we'll be writing to invalid memory indices
+    const t_filterIdx numOutputs = (n>=numFilters) ? numFilters : (t_filterIdx)n;
+
     for(t_filterIdx i=0; i<numFilters; ++i)
     {
         float smoothedSpec = 0.0f;
@@ -503,29 +503,16 @@ void specFilterBands(t_binIdx n, t_filterIdx numFilters, float *spectrum, std::v
         smoothedSpec /= filterbank[i].size;
         totalEnergy += smoothedSpec;
 
-        filterbank[i].tmpValue = smoothedSpec; // tmpVal is the smoothedSpec for each filter bank
+        if(i < numOutputs)
+            output[i] = smoothedSpec;
     };
 
-    // Check that the spectrum window size N is larger than the number of filters, otherwise we'll be writing to invalid memory indices
-    if(n>=numFilters)
-    {
-        for(t_filterIdx si=0; si<numFilters; ++si)
-            if(normalize)
-                spectrum[si] = filterbank[si].tmpValue/totalEnergy; // tmpValue is the smoothedSpec
-            else
-                spectrum[si] = filterbank[si].tmpValue; // tmpValue is the smoothedSpec
-    }
-    else
-    {
-        for(t_filterIdx si=0; si<n; ++si)
-            if(normalize)
-                spectrum[si] = filterbank[si].tmpValue/totalEnergy; // tmpValue is the smoothedSpec
-            else
-                spectrum[si] = filterbank[si].tmpValue; // tmpValue is the smoothedSpec
-    }
+    if(normalize)
+        for(t_filterIdx si=0; si<numOutputs; ++si)
+            output[si] = output[si]/totalEnergy;
 }
 
-void filterbankMultiply(float *spectrum, bool normalize, bool filterAvg, std::vector<t_filter> &filterbank, t_filterIdx numFilters)
+void filterbankMultiply(const float *spectrum, float *output, bool normalize, bool filterAvg, const std::vector<t_filter> &filterbank, t_filterIdx numFilters)
 {
     float sumSum = 0;
     for(t_filterIdx i=0; i<numFilters; ++i)
@@ -540,7 +527,7 @@ void filterbankMultiply(float *spectrum, bool normalize, bool filterAvg, std::ve
         if(filterAvg)
             sum /= k;
 
-        filterbank[i].tmpValue = sum;  // get the total power.  another weighting might be better.
+        output[i] = sum;  // get the total power.  another weighting might be better.
 
         sumSum += sum;  // normalize so power in all bands sums to 1
     };
@@ -557,12 +544,381 @@ void filterbankMultiply(float *spectrum, bool normalize, bool filterAvg, std::ve
         sumSum=1.0f;
 
     for(t_binIdx si=0; si<numFilters; ++si)
-        spectrum[si] = filterbank[si].tmpValue * sumSum;
+        output[si] = output[si] * sumSum;
 }
 
 /* ---------------- END filterbank functions ---------------------- */
 
 
+/* ---------------- onset detection functions ---------------------- */
+
+void growthMaskUpdate(t_filterIdx numFilters, const float *energy, const float *weights, const float *bandRange,
+                      float *mask, unsigned short *maskCounters, unsigned short maskPeriods, float maskDecay,
+                      float *growth, float &totalGrowth, float &totalVel)
+{
+    // from p.3 of Puckette/Apel/Zicarelli, 1998
+    // salt divisor with + 1.0e-15 in case previous power was zero
+    const float salt = 1.0e-15f;
+    maskPeriods = std::min(maskPeriods, MAXMASKPERIODS);
+    float growthSum = 0.0f, velSum = 0.0f;
+    t_filterIdx i = 0;
+
+#if defined(TIDLIB_USE_SSE)
+    const __m128 zero = _mm_setzero_ps(), one = _mm_set1_ps(1.0f), salt4 = _mm_set1_ps(salt), decay4 = _mm_set1_ps(maskDecay);
+    const __m128i periods4 = _mm_set1_epi32(maskPeriods), oneI = _mm_set1_epi32(1), zeroI = _mm_setzero_si128();
+    __m128 growthAcc = zero, velAcc = zero;
+    for(; i + 4 <= numFilters; i += 4)
+    {
+        const __m128 e = _mm_mul_ps(_mm_loadu_ps(energy + i), _mm_loadu_ps(weights + i));
+        const __m128 m = _mm_loadu_ps(mask + i);
+        const __m128 above = _mm_cmpgt_ps(e, m);
+        const __m128 g = _mm_and_ps(above, _mm_sub_ps(_mm_div_ps(e, _mm_add_ps(m, salt4)), one));
+        _mm_storeu_ps(growth + i, g);
+        velAcc = _mm_add_ps(velAcc, e);
+        growthAcc = _mm_add_ps(growthAcc, _mm_mul_ps(_mm_max_ps(g, zero), _mm_loadu_ps(bandRange + i)));
+
+        // counters: min(counter+1, maskPeriods), reset above the mask
+        __m128i c = _mm_add_epi32(_mm_unpacklo_epi16(_mm_loadl_epi64((const __m128i*)(maskCounters + i)), zeroI), oneI);
+        const __m128i saturated = _mm_cmpgt_epi32(c, periods4);
+        c = _mm_or_si128(_mm_and_si128(saturated, periods4), _mm_andnot_si128(saturated, c));
+        c = _mm_andnot_si128(_mm_castps_si128(above), c);
+        _mm_storel_epi64((__m128i*)(maskCounters + i), _mm_packs_epi32(c, c));
+
+        const __m128 decays = _mm_castsi128_ps(_mm_cmpeq_epi32(c, periods4));
+        const __m128 decayed = _mm_or_ps(_mm_and_ps(decays, _mm_mul_ps(m, decay4)), _mm_andnot_ps(decays, m));
+        _mm_storeu_ps(mask + i, _mm_or_ps(_mm_and_ps(above, e), _mm_andnot_ps(above, decayed)));
+    }
+    float lanes[4];
+    _mm_storeu_ps(lanes, growthAcc);
+    growthSum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+    _mm_storeu_ps(lanes, velAcc);
+    velSum = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(TIDLIB_USE_NEON) && defined(__aarch64__)
+    const float32x4_t zero = vdupq_n_f32(0.0f), one = vdupq_n_f32(1.0f), salt4 = vdupq_n_f32(salt), decay4 = vdupq_n_f32(maskDecay);
+    const uint32x4_t periods4 = vdupq_n_u32(maskPeriods), oneI = vdupq_n_u32(1);
+    float32x4_t growthAcc = zero, velAcc = zero;
+    for(; i + 4 <= numFilters; i += 4)
+    {
+        const float32x4_t e = vmulq_f32(vld1q_f32(energy + i), vld1q_f32(weights + i));
+        const float32x4_t m = vld1q_f32(mask + i);
+        const uint32x4_t above = vcgtq_f32(e, m);
+        const float32x4_t g = vreinterpretq_f32_u32(vandq_u32(above, vreinterpretq_u32_f32(vsubq_f32(vdivq_f32(e, vaddq_f32(m, salt4)), one))));
+        vst1q_f32(growth + i, g);
+        velAcc = vaddq_f32(velAcc, e);
+        growthAcc = vaddq_f32(growthAcc, vmulq_f32(vmaxq_f32(g, zero), vld1q_f32(bandRange + i)));
+
+        // counters: min(counter+1, maskPeriods), reset above the mask
+        uint32x4_t c = vminq_u32(vaddq_u32(vmovl_u16(vld1_u16(maskCounters + i)), oneI), periods4);
+        c = vbicq_u32(c, above);
+        vst1_u16(maskCounters + i, vmovn_u32(c));
+
+        const float32x4_t decayed = vbslq_f32(vceqq_u32(c, periods4), vmulq_f32(m, decay4), m);
+        vst1q_f32(mask + i, vbslq_f32(above, e, decayed));
+    }
+    growthSum = (vgetq_lane_f32(growthAcc, 0) + vgetq_lane_f32(growthAcc, 1)) + (vgetq_lane_f32(growthAcc, 2) + vgetq_lane_f32(growthAcc, 3));
+    velSum = (vgetq_lane_f32(velAcc, 0) + vgetq_lane_f32(velAcc, 1)) + (vgetq_lane_f32(velAcc, 2) + vgetq_lane_f32(velAcc, 3));
+#endif
+
+    for(; i < numFilters; ++i)
+    {
+        const float e = energy[i] * weights[i];
+        const float m = mask[i];
+        const bool above = e > m;
+        const float g = above ? e/(m + salt) - 1.0f : 0.0f;
+        growth[i] = g;
+        velSum += e;
+        growthSum += std::max(g, 0.0f) * bandRange[i];
+
+        const unsigned short c = above ? 0 : std::min<unsigned short>(maskCounters[i] + 1, maskPeriods);
+        maskCounters[i] = c;
+        mask[i] = above ? e : (c == maskPeriods ? m * maskDecay : m);
+    }
+
+    totalGrowth = growthSum;
+    totalVel = velSum;
+}
+
+/* ---------------- END onset detection functions ---------------------- */
+
+
+/* ---------------- batched (offline) functions ---------------------- */
+
+/*  acc[t] += column[t] * weight for the frames of a tile (multiply then add, like the scalar code) */
+static inline void accumulateTile(float *acc, const float *column, float weight)
+{
+#if defined(__AVX__)
+    _mm256_storeu_ps(acc, _mm256_add_ps(_mm256_loadu_ps(acc), _mm256_mul_ps(_mm256_loadu_ps(column), _mm256_set1_ps(weight))));
+#elif defined(TIDLIB_USE_SSE)
+    const __m128 w = _mm_set1_ps(weight);
+    _mm_storeu_ps(acc, _mm_add_ps(_mm_loadu_ps(acc), _mm_mul_ps(_mm_loadu_ps(column), w)));
+    _mm_storeu_ps(acc + 4, _mm_add_ps(_mm_loadu_ps(acc + 4), _mm_mul_ps(_mm_loadu_ps(column + 4), w)));
+#elif defined(TIDLIB_USE_NEON)
+    const float32x4_t w = vdupq_n_f32(weight);
+    vst1q_f32(acc, vaddq_f32(vld1q_f32(acc), vmulq_f32(vld1q_f32(column), w)));
+    vst1q_f32(acc + 4, vaddq_f32(vld1q_f32(acc + 4), vmulq_f32(vld1q_f32(column + 4), w)));
+#else
+    for(size_t t=0; t<BATCHTILEFRAMES; ++t)
+        acc[t] += column[t] * weight;
+#endif
+}
+static_assert(BATCHTILEFRAMES == 8 && INTERLEAVEDLANES == 8, "accumulateTile works on tiles of 8 frames (or channels)");
+
+#if !TID_USE_CBLAS
+/*  Copy a tile of up to BATCHTILEFRAMES rows (numCols values each) to panel, transposed, so that
+    the values of the frames for one column are contiguous. Missing frames are zeros. */
+static void transposeTile(const float *input, size_t numFrames, size_t inputStride, size_t numCols, float *panel)
+{
+    for(size_t k=0; k<numCols; ++k)
+        for(size_t t=0; t<BATCHTILEFRAMES; ++t)
+            panel[k*BATCHTILEFRAMES + t] = t < numFrames ? input[t*inputStride + k] : 0.0f;
+}
+#endif
+
+/*  Normalize the filter energies of each frame so that they sum to 1, like filterbankMultiply */
+static void normalizeRows(float *output, size_t numFrames, size_t outputStride, t_filterIdx numFilters)
+{
+    for(size_t f=0; f<numFrames; ++f)
+    {
+        float *row = output + f*outputStride;
+        float sumSum = 0.0f;
+        for(t_filterIdx i=0; i<numFilters; ++i)
+            sumSum += row[i];
+        sumSum = (sumSum == 0) ? 1.0f : 1.0f/sumSum;
+        for(t_filterIdx i=0; i<numFilters; ++i)
+            row[i] = row[i] * sumSum;
+    }
+}
+
+void filterbankMultiplyBatch(const float *spectra, size_t numFrames, size_t spectrumStride, float *output, size_t outputStride, bool normalize, bool filterAvg, const std::vector<t_filter> &filterbank, t_filterIdx numFilters)
+{
+    if(numFilters > filterbank.size() || outputStride < numFilters)
+        throw std::invalid_argument("filterbankMultiplyBatch: invalid number of filters or output stride");
+    if(numFrames == 0 || numFilters == 0)
+        return;
+    size_t numBins = 0;
+    for(t_filterIdx i=0; i<numFilters; ++i)
+        numBins = std::max<size_t>(numBins, filterbank[i].indices[1] + 1);
+    if(spectrumStride < numBins)
+        throw std::invalid_argument("filterbankMultiplyBatch: the spectra are shorter than the filterbank");
+
+#if TID_USE_CBLAS
+    // Dense [numFilters x numBins] filterbank matrix (zeros outside each filter), then a single GEMM
+    std::vector<float> dense(numFilters * numBins, 0.0f);
+    for(t_filterIdx i=0; i<numFilters; ++i)
+        for(t_binIdx j=filterbank[i].indices[0], k=0; j<=filterbank[i].indices[1]; ++j, ++k)
+            dense[i*numBins + j] = filterAvg ? filterbank[i].filter[k] / filterbank[i].size : filterbank[i].filter[k];
+    cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasTrans, (int)numFrames, (int)numFilters, (int)numBins,
+                1.0f, spectra, (int)spectrumStride, dense.data(), (int)numBins, 0.0f, output, (int)outputStride);
+#else
+    std::vector<float> panel(numBins * BATCHTILEFRAMES);
+    float acc[BATCHTILEFRAMES];
+    for(size_t f0=0; f0<numFrames; f0+=BATCHTILEFRAMES)
+    {
+        const size_t tileFrames = std::min(BATCHTILEFRAMES, numFrames - f0);
+        transposeTile(spectra + f0*spectrumStride, tileFrames, spectrumStride, numBins, panel.data());
+
+        // The filters are narrow bands of the spectrum, only their bins are visited
+        for(t_filterIdx i=0; i<numFilters; ++i)
+        {
+            std::fill(acc, acc + BATCHTILEFRAMES, 0.0f);
+            for(t_binIdx j=filterbank[i].indices[0], k=0; j<=filterbank[i].indices[1]; ++j, ++k)
+                accumulateTile(acc, &panel[j*BATCHTILEFRAMES], filterbank[i].filter[k]);
+
+            for(size_t t=0; t<tileFrames; ++t)
+                output[(f0+t)*outputStride + i] = filterAvg ? acc[t] / filterbank[i].size : acc[t];
+        }
+    }
+#endif
+
+    if(normalize)
+        normalizeRows(output, numFrames, outputStride, numFilters);
+}
+
+void matrixMultiplyBatch(const float *input, size_t numFrames, size_t inputStride, const float *matrix, size_t numRows, size_t numCols, float *output, size_t outputStride)
+{
+    if(inputStride < numCols || outputStride < numRows)
+        throw std::invalid_argument("matrixMultiplyBatch: strides must be at least as long as the rows");
+    if(numFrames == 0 || numRows == 0)
+        return;
+
+#if TID_USE_CBLAS
+    cblas_sgemm(CblasRowMajor, CblasNoTrans, CblasTrans, (int)numFrames, (int)numRows, (int)numCols,
+                1.0f, input, (int)inputStride, matrix, (int)numCols, 0.0f, output, (int)outputStride);
+#else
+    std::vector<float> panel(numCols * BATCHTILEFRAMES);
+    float acc[BATCHTILEFRAMES];
+    for(size_t f0=0; f0<numFrames; f0+=BATCHTILEFRAMES)
+    {
+        const size_t tileFrames = std::min(BATCHTILEFRAMES, numFrames - f0);
+        transposeTile(input + f0*inputStride, tileFrames, inputStride, numCols, panel.data());
+
+        // One matrix row at a time, it is reused by all the frames of the tile
+        for(size_t i=0; i<numRows; ++i)
+        {
+            std::fill(acc, acc + BATCHTILEFRAMES, 0.0f);
+            const float *row = matrix + i*numCols;
+            for(size_t k=0; k<numCols; ++k)
+                accumulateTile(acc, &panel[k*BATCHTILEFRAMES], row[k]);
+
+            for(size_t t=0; t<tileFrames; ++t)
+                output[(f0+t)*outputStride + i] = acc[t];
+        }
+    }
+#endif
+}
+
+/* ---------------- END batched (offline) functions ---------------------- */
+
+
+/* ---------------- multi-channel (interleaved) functions ---------------------- */
+
+void filterbankMultiplyInterleaved(const float *spectra, float *output, bool normalize, bool filterAvg, const std::vector<t_filter> &filterbank, t_filterIdx numFilters)
+{
+    const unsigned int L = INTERLEAVEDLANES;
+    float sumSum[INTERLEAVEDLANES] = {};
+    for(t_filterIdx i=0; i<numFilters; ++i)
+    {
+        // local accumulators, so that they stay in registers across the bins
+        float acc[INTERLEAVEDLANES] = {};
+        for(t_binIdx j=filterbank[i].indices[0], k=0; j<=filterbank[i].indices[1]; ++j, ++k)
+            accumulateTile(acc, spectra + j*L, filterbank[i].filter[k]);
+
+        float *sum = output + i*L;
+        std::copy(acc, acc + L, sum);
+
+        for(unsigned int c=0; c<L; ++c)
+        {
+            if(filterAvg)
+                sum[c] /= filterbank[i].size;
+            sumSum[c] += sum[c];
+        }
+    }
+
+    // same normalization of filterbankMultiply, for each channel
+    for(unsigned int c=0; c<L; ++c)
+    {
+        if(normalize)
+            sumSum[c] = (sumSum[c] == 0) ? 1.0f : 1.0f/sumSum[c];
+        else
+            sumSum[c] = 1.0f;
+    }
+    for(t_filterIdx i=0; i<numFilters; ++i)
+        for(unsigned int c=0; c<L; ++c)
+            output[i*L + c] = output[i*L + c] * sumSum[c];
+}
+
+void matrixMultiplyInterleaved(const float *input, const float *matrix, size_t numRows, size_t numCols, float *output)
+{
+    const unsigned int L = INTERLEAVEDLANES;
+    for(size_t i=0; i<numRows; ++i)
+    {
+        float *acc = output + i*L;
+        std::fill(acc, acc + L, 0.0f);
+        for(size_t k=0; k<numCols; ++k)
+            accumulateTile(acc, input + k*L, matrix[i*numCols + k]);
+    }
+}
+
+void signChangeSumsInterleaved(const float *input, size_t numFrames, int *lastSigns, unsigned int *sums, unsigned int *output)
+{
+    const unsigned int L = INTERLEAVEDLANES;
+#if defined(TIDLIB_USE_SSE)
+    // signum as (x<0) - (x>0) of the comparison masks (all ones is -1), |d| as (d^s)-s with s the sign of d
+    const __m128 zero = _mm_setzero_ps();
+    for(unsigned int h=0; h<L; h+=4)
+    {
+        __m128i last = _mm_loadu_si128((const __m128i*)(lastSigns + h));
+        __m128i sum = _mm_loadu_si128((const __m128i*)(sums + h));
+        for(size_t t=0; t<numFrames; ++t)
+        {
+            const __m128 x = _mm_loadu_ps(input + t*L + h);
+            const __m128i sign = _mm_sub_epi32(_mm_castps_si128(_mm_cmplt_ps(x, zero)), _mm_castps_si128(_mm_cmpgt_ps(x, zero)));
+            const __m128i d = _mm_sub_epi32(sign, last);
+            const __m128i s = _mm_srai_epi32(d, 31);
+            sum = _mm_add_epi32(sum, _mm_sub_epi32(_mm_xor_si128(d, s), s));
+            _mm_storeu_si128((__m128i*)(output + t*L + h), sum);
+            last = sign;
+        }
+        _mm_storeu_si128((__m128i*)(lastSigns + h), last);
+        _mm_storeu_si128((__m128i*)(sums + h), sum);
+    }
+#elif defined(TIDLIB_USE_NEON)
+    const float32x4_t zero = vdupq_n_f32(0.0f);
+    for(unsigned int h=0; h<L; h+=4)
+    {
+        int32x4_t last = vld1q_s32(lastSigns + h);
+        uint32x4_t sum = vld1q_u32(sums + h);
+        for(size_t t=0; t<numFrames; ++t)
+        {
+            const float32x4_t x = vld1q_f32(input + t*L + h);
+            const int32x4_t sign = vsubq_s32(vreinterpretq_s32_u32(vcltq_f32(x, zero)), vreinterpretq_s32_u32(vcgtq_f32(x, zero)));
+            sum = vaddq_u32(sum, vreinterpretq_u32_s32(vabsq_s32(vsubq_s32(sign, last))));
+            vst1q_u32(output + t*L + h, sum);
+            last = sign;
+        }
+        vst1q_s32(lastSigns + h, last);
+        vst1q_u32(sums + h, sum);
+    }
+#else
+    for(size_t t=0; t<numFrames; ++t)
+        for(unsigned int c=0; c<L; ++c)
+        {
+            const int sign = signum(input[t*L + c]);
+            sums[c] += (unsigned int)std::abs(sign - lastSigns[c]);
+            lastSigns[c] = sign;
+            output[t*L + c] = sums[c];
+        }
+#endif
+}
+
+void peakInterleaved(const float *input, size_t numFrames, float *peaks, unsigned int *peakIdx)
+{
+    const unsigned int L = INTERLEAVEDLANES;
+#if defined(TIDLIB_USE_SSE)
+    for(unsigned int h=0; h<L; h+=4)
+    {
+        __m128 peak = _mm_loadu_ps(peaks + h);
+        __m128i idx = _mm_loadu_si128((const __m128i*)(peakIdx + h));
+        for(size_t t=0; t<numFrames; ++t)
+        {
+            const __m128 x = _mm_loadu_ps(input + t*L + h);
+            const __m128 greater = _mm_cmpgt_ps(x, peak);
+            const __m128i greaterI = _mm_castps_si128(greater);
+            peak = _mm_or_ps(_mm_and_ps(greater, x), _mm_andnot_ps(greater, peak));
+            idx = _mm_or_si128(_mm_and_si128(greaterI, _mm_set1_epi32((int)t)), _mm_andnot_si128(greaterI, idx));
+        }
+        _mm_storeu_ps(peaks + h, peak);
+        _mm_storeu_si128((__m128i*)(peakIdx + h), idx);
+    }
+#elif defined(TIDLIB_USE_NEON)
+    for(unsigned int h=0; h<L; h+=4)
+    {
+        float32x4_t peak = vld1q_f32(peaks + h);
+        uint32x4_t idx = vld1q_u32(peakIdx + h);
+        for(size_t t=0; t<numFrames; ++t)
+        {
+            const float32x4_t x = vld1q_f32(input + t*L + h);
+            const uint32x4_t greater = vcgtq_f32(x, peak);
+            peak = vbslq_f32(greater, x, peak);
+            idx = vbslq_u32(greater, vdupq_n_u32((unsigned int)t), idx);
+        }
+        vst1q_f32(peaks + h, peak);
+        vst1q_u32(peakIdx + h, idx);
+    }
+#else
+    for(size_t t=0; t<numFrames; ++t)
+        for(unsigned int c=0; c<L; ++c)
+            if(input[t*L + c] > peaks[c])
+            {
+                peaks[c] = input[t*L + c];
+                peakIdx[c] = (unsigned int)t;
+            }
+#endif
+}
+
+/* ---------------- END multi-channel (interleaved) functions ---------------------- */
+
+
 /* ---------------- dsp utility functions ---------------------- */
 
 void peakSample(std::vector<float> &input, unsigned long int *peakIdx, float *peakVal)
@@ -630,7 +986,8 @@ unsigned int zeroCrossingRate(const std::vector<float>& buffer)
 
 void power(t_binIdx n, void *fftw_out, float *powBuf)
 {
-    fftwf_complex *fftw_out_local = (fftwf_complex *)fftw_out;
+    // Interleaved (re, im) values, the layout of fftwf_complex and of the built-in FFT
+    float (*fftw_out_local)[2] = (float (*)[2])fftw_out;
 
     while(n--)
         powBuf[n] = (fftw_out_local[n][0] * fftw_out_local[n][0]) + (fftw_out_local[n][1] * fftw_out_local[n][1]);
@@ -699,6 +1056,26 @@ void initHannWindow(std::vector<float> &window)
     for(unsigned long int i = 0; i < n; ++i)
         window[i]  = 0.5f * (1.0f - cos(2.0f*M_PI*i/n));
 }
+
+void windowCopy(const float *input, const float *window, float *output, unsigned long int n)
+{
+    if(window == nullptr)
+    {
+        std::copy(input, input + n, output);
+        return;
+    }
+
+    unsigned long int i = 0;
+#if defined(TIDLIB_USE_SSE)
+    for(; i + 4 <= n; i += 4)
+        _mm_storeu_ps(output + i, _mm_mul_ps(_mm_loadu_ps(input + i), _mm_loadu_ps(window + i)));
+#elif defined(TIDLIB_USE_NEON)
+    for(; i + 4 <= n; i += 4)
+        vst1q_f32(output + i, vmulq_f32(vld1q_f32(input + i), vld1q_f32(window + i)));
+#endif
+    for(; i < n; ++i)
+        output[i] = input[i] * window[i];
+}
 /* ---------------- END windowing buffer functions ---------------------- */
 
 }